@@ -0,0 +1,518 @@
+#include <JuceHeader.h>
+
+#include "AppConfig.h"
+#include "audio/AudioEngine.h"
+#include "audio/Biquad.h"
+#include "audio/BiquadCascade.h"
+#include "audio/BuiltInProcessors.h"
+#include "audio/NoiseSuppressor.h"
+#include "audio/PartitionedConvolver.h"
+#include "audio/Resampler.h"
+#include "audio/TruePeakLimiter.h"
+#include "plugins/SandboxTransport.h"
+#include "plugins/VstHost.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Repeatable micro and macro benchmarks for the realtime hot paths. Every run reports
+// ns per processed sample and heap allocations per iteration, and can write the same
+// figures as JSON so builds can be compared.
+
+namespace
+{
+std::atomic<uint64_t> allocationCount { 0 };
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace fizzle::bench
+{
+namespace
+{
+constexpr int kBlockSize = 256;
+
+struct BenchResult
+{
+    juce::String name;
+    int samplesPerIteration { 0 };
+    int64_t iterations { 0 };
+    double nsPerSampleMedian { 0.0 };
+    double nsPerSampleMin { 0.0 };
+    double allocationsPerIteration { 0.0 };
+};
+
+struct BenchConfig
+{
+    int repetitions { 15 };
+    double minRepetitionSeconds { 0.005 };
+    juce::String filter;
+};
+
+void fillNoise(juce::AudioBuffer<float>& buffer, juce::Random& random)
+{
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+    {
+        auto* d = buffer.getWritePointer(c);
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+            d[i] = random.nextFloat() * 0.5f - 0.25f;
+    }
+}
+
+// Runs body() in timed repetitions. Each repetition is scaled to at least
+// minRepetitionSeconds so timer resolution does not dominate short kernels.
+BenchResult runBenchmark(const BenchConfig& config, const juce::String& name, int samplesPerIteration, const std::function<void()>& body)
+{
+    BenchResult result;
+    result.name = name;
+    result.samplesPerIteration = samplesPerIteration;
+
+    for (int i = 0; i < 16; ++i)
+        body();
+
+    int64_t batch = 1;
+    for (;;)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int64_t i = 0; i < batch; ++i)
+            body();
+        const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        if (seconds >= config.minRepetitionSeconds || batch >= (int64_t { 1 } << 30))
+            break;
+        batch *= 2;
+    }
+
+    std::vector<double> nsPerSample;
+    nsPerSample.reserve(static_cast<size_t>(config.repetitions));
+    const auto allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    for (int r = 0; r < config.repetitions; ++r)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int64_t i = 0; i < batch; ++i)
+            body();
+        const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        nsPerSample.push_back(seconds * 1.0e9 / static_cast<double>(batch * samplesPerIteration));
+    }
+    const auto allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    std::sort(nsPerSample.begin(), nsPerSample.end());
+    result.iterations = batch * config.repetitions;
+    result.nsPerSampleMedian = nsPerSample[nsPerSample.size() / 2];
+    result.nsPerSampleMin = nsPerSample.front();
+    result.allocationsPerIteration = static_cast<double>(allocations) / static_cast<double>(result.iterations);
+    return result;
+}
+
+// Minimal stand-in so AudioEngine can be started and driven without audio hardware.
+class BenchDevice final : public juce::AudioIODevice
+{
+public:
+    BenchDevice(double rate, int block) : juce::AudioIODevice("Bench", "Bench"), sampleRate(rate), blockSize(block)
+    {
+        channels.setRange(0, 2, true);
+    }
+
+    juce::StringArray getOutputChannelNames() override { return { "L", "R" }; }
+    juce::StringArray getInputChannelNames() override { return { "L", "R" }; }
+    juce::Array<double> getAvailableSampleRates() override { return { sampleRate }; }
+    juce::Array<int> getAvailableBufferSizes() override { return { blockSize }; }
+    int getDefaultBufferSize() override { return blockSize; }
+    juce::String open(const juce::BigInteger&, const juce::BigInteger&, double, int) override { return {}; }
+    void close() override {}
+    bool isOpen() override { return true; }
+    void start(juce::AudioIODeviceCallback*) override {}
+    void stop() override {}
+    bool isPlaying() override { return true; }
+    juce::String getLastError() override { return {}; }
+    int getCurrentBufferSizeSamples() override { return blockSize; }
+    double getCurrentSampleRate() override { return sampleRate; }
+    int getCurrentBitDepth() override { return 32; }
+    juce::BigInteger getActiveOutputChannels() const override { return channels; }
+    juce::BigInteger getActiveInputChannels() const override { return channels; }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+
+private:
+    double sampleRate;
+    int blockSize;
+    juce::BigInteger channels;
+};
+
+void benchResampler(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const std::pair<double, double> ratePairs[] { { 44100.0, 48000.0 }, { 48000.0, 44100.0 }, { 48000.0, 96000.0 }, { 96000.0, 48000.0 } };
+    const std::pair<Resampler::Quality, const char*> qualities[] { { Resampler::Quality::low, "low" },
+                                                                   { Resampler::Quality::balanced, "balanced" },
+                                                                   { Resampler::Quality::high, "high" } };
+    juce::Random random(1);
+
+    for (const auto& [inRate, outRate] : ratePairs)
+    {
+        for (const auto& [quality, qualityName] : qualities)
+        {
+            const auto name = "resampler/" + juce::String(static_cast<int>(inRate)) + "-" + juce::String(static_cast<int>(outRate)) + "/" + qualityName;
+            if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+                continue;
+
+            Resampler resampler;
+            resampler.prepare(inRate, outRate, 2, kBlockSize, quality);
+            juce::AudioBuffer<float> input(2, kBlockSize);
+            juce::AudioBuffer<float> output(2, resampler.getMaxOutputForInput(kBlockSize));
+            fillNoise(input, random);
+            results.push_back(runBenchmark(config, name, kBlockSize, [&]
+            {
+                resampler.process(input, kBlockSize, output);
+            }));
+        }
+    }
+}
+
+void benchBuiltInProcessors(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name("builtin/process");
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    BuiltInProcessors processors;
+    processors.prepare(kInternalSampleRate, 2);
+    EffectParameters params;
+    juce::AudioBuffer<float> source(2, kBlockSize);
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::Random random(2);
+    fillNoise(source, random);
+    results.push_back(runBenchmark(config, name, kBlockSize * 2, [&]
+    {
+        buffer.makeCopyOf(source, true);
+        processors.process(buffer, params);
+    }));
+}
+
+void benchBiquad(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name("biquad/process");
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    Biquad biquad;
+    biquad.setHighPass(static_cast<float>(kInternalSampleRate), 120.0f);
+    juce::AudioBuffer<float> buffer(1, kBlockSize);
+    juce::Random random(3);
+    fillNoise(buffer, random);
+    auto* d = buffer.getWritePointer(0);
+    results.push_back(runBenchmark(config, name, kBlockSize, [&]
+    {
+        for (int i = 0; i < kBlockSize; ++i)
+            d[i] = biquad.process(d[i]);
+    }));
+}
+
+// Same filter over a stereo block in SIMD lanes; per-channel-sample cost is comparable
+// with biquad/process.
+void benchBiquadCascade(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name("biquad/cascade/stereo");
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    BiquadCascade<1> cascade;
+    cascade.setStage(0, BiquadCoefficients::highPass(static_cast<float>(kInternalSampleRate), 120.0f), false);
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::Random random(3);
+    fillNoise(buffer, random);
+    results.push_back(runBenchmark(config, name, kBlockSize * 2, [&]
+    {
+        cascade.process(buffer.getArrayOfWritePointers(), 2, kBlockSize);
+    }));
+}
+
+void benchTruePeakLimiter(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name("limiter/truepeak/stereo");
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    TruePeakLimiter limiter;
+    limiter.prepare(kInternalSampleRate, 2);
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::Random random(5);
+    fillNoise(buffer, random);
+    results.push_back(runBenchmark(config, name, kBlockSize * 2, [&]
+    {
+        limiter.process(buffer.getArrayOfWritePointers(), 2, kBlockSize, 0.25f);
+    }));
+}
+
+void benchNoiseSuppressor(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name("denoise/spectral/mono");
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    NoiseSuppressor suppressor;
+    suppressor.prepare(kInternalSampleRate, 1);
+    juce::AudioBuffer<float> buffer(1, kBlockSize);
+    juce::Random random(6);
+    fillNoise(buffer, random);
+    results.push_back(runBenchmark(config, name, kBlockSize, [&]
+    {
+        suppressor.process(buffer.getArrayOfWritePointers(), 1, kBlockSize);
+    }));
+}
+
+// Stereo convolution at a range of response lengths; the cost should grow far more
+// slowly than the length. Runs back to back in non-realtime mode, so every background
+// level's work is waited for and counted rather than left out as late.
+void benchConvolver(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    for (const auto milliseconds : { 100, 1000, 5000 })
+    {
+        const auto name = "convolver/partitioned/" + juce::String(milliseconds) + "ms";
+        if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+            continue;
+
+        juce::Random random(8);
+        juce::AudioBuffer<float> response(2, static_cast<int>(milliseconds * kInternalSampleRate / 1000.0));
+        fillNoise(response, random);
+        PartitionedConvolver convolver;
+        convolver.setNonRealtime(true);
+        convolver.setImpulseResponse(response, kInternalSampleRate);
+        convolver.prepare(kInternalSampleRate, 2);
+
+        juce::AudioBuffer<float> input(2, kBlockSize);
+        juce::AudioBuffer<float> buffer(2, kBlockSize);
+        fillNoise(input, random);
+        results.push_back(runBenchmark(config, name, kBlockSize * 2, [&]
+        {
+            for (int c = 0; c < 2; ++c)
+                buffer.copyFrom(c, 0, input, c, 0, kBlockSize);
+            convolver.process(buffer.getArrayOfWritePointers(), 2, kBlockSize);
+        }));
+    }
+}
+
+void benchVstMix(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::AudioBuffer<float> wet(2, kBlockSize);
+    juce::Random random(4);
+    fillNoise(buffer, random);
+    fillNoise(wet, random);
+
+    struct MixCase
+    {
+        const char* name;
+        float startMix;
+        float endMix;
+    };
+
+    for (const auto& mixCase : { MixCase { "0.5", 0.5f, 0.5f }, MixCase { "1.0", 1.0f, 1.0f }, MixCase { "ramp", 0.2f, 0.8f } })
+    {
+        const auto name = "vsthost/mix/" + juce::String(mixCase.name);
+        if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+            continue;
+
+        results.push_back(runBenchmark(config, name, kBlockSize * 2, [&]
+        {
+            VstHost::mixDryWet(buffer, wet, mixCase.startMix, mixCase.endMix);
+        }));
+    }
+}
+
+// Round trip of one block through the plugin sandbox transport with a helper that does
+// no processing, i.e. the fixed cost isolation adds to every sandboxed plugin. The helper
+// runs on a thread here; a separate process wakes the same way.
+void benchSandboxRoundTrip(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    const juce::String name = "sandbox/roundtrip";
+    if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+        return;
+
+    juce::String error;
+    auto host = SandboxTransport::create(kBlockSize, error);
+    auto helper = host != nullptr ? SandboxTransport::open(host->getFile(), error) : nullptr;
+    if (helper == nullptr)
+    {
+        std::cerr << "Skipping " << name << ": " << error << "\n";
+        return;
+    }
+
+    std::atomic<bool> stop { false };
+    std::thread helperThread([&]
+    {
+        while (! stop.load())
+            if (helper->waitForRequest(20))
+                helper->completeRequest(0);
+    });
+
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::Random random(6);
+    fillNoise(buffer, random);
+    results.push_back(runBenchmark(config, name, kBlockSize, [&]
+    {
+        const auto deadline = juce::Time::getHighResolutionTicks() + juce::Time::getHighResolutionTicksPerSecond();
+        if (host->submit(buffer))
+            host->awaitResponse(buffer, deadline);
+    }));
+
+    stop.store(true);
+    helperThread.join();
+}
+
+void benchEngineCallback(const BenchConfig& config, std::vector<BenchResult>& results)
+{
+    for (const auto deviceRate : { 48000.0, 44100.0 })
+    {
+        const auto name = "engine/callback/" + juce::String(static_cast<int>(deviceRate));
+        if (config.filter.isNotEmpty() && ! name.contains(config.filter))
+            continue;
+
+        AudioEngine engine;
+        EffectParameters params;
+        engine.setEffectParameters(&params);
+        BenchDevice device(deviceRate, kBlockSize);
+        engine.audioDeviceAboutToStart(&device);
+
+        juce::AudioBuffer<float> input(2, kBlockSize);
+        juce::AudioBuffer<float> output(2, kBlockSize);
+        juce::Random random(5);
+        fillNoise(input, random);
+        const juce::AudioIODeviceCallbackContext context {};
+        results.push_back(runBenchmark(config, name, kBlockSize, [&]
+        {
+            engine.audioDeviceIOCallbackWithContext(input.getArrayOfReadPointers(), 2, output.getArrayOfWritePointers(), 2, kBlockSize, context);
+        }));
+        engine.audioDeviceStopped();
+    }
+}
+
+juce::var toJson(const std::vector<BenchResult>& results)
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", FIZZLE_VERSION);
+    root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("cores", juce::SystemStats::getNumCpus());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+#if JUCE_DEBUG
+    root->setProperty("build", "debug");
+#else
+    root->setProperty("build", "release");
+#endif
+
+    juce::Array<juce::var> entries;
+    for (const auto& r : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", r.name);
+        entry->setProperty("samplesPerIteration", r.samplesPerIteration);
+        entry->setProperty("iterations", static_cast<juce::int64>(r.iterations));
+        entry->setProperty("nsPerSampleMedian", r.nsPerSampleMedian);
+        entry->setProperty("nsPerSampleMin", r.nsPerSampleMin);
+        entry->setProperty("allocationsPerIteration", r.allocationsPerIteration);
+        entries.add(juce::var(entry));
+    }
+    root->setProperty("results", entries);
+    return juce::var(root);
+}
+
+int run(const juce::StringArray& args)
+{
+    BenchConfig config;
+    juce::File jsonFile;
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--filter" && i + 1 < args.size())
+            config.filter = args[++i];
+        else if (args[i] == "--json" && i + 1 < args.size())
+            jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+        else if (args[i] == "--quick")
+        {
+            config.repetitions = 5;
+            config.minRepetitionSeconds = 0.001;
+        }
+        else
+        {
+            std::cerr << "Usage: FizzleBench [--filter <substring>] [--json <file>] [--quick]\n";
+            return 2;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    benchResampler(config, results);
+    benchBuiltInProcessors(config, results);
+    benchBiquad(config, results);
+    benchBiquadCascade(config, results);
+    benchTruePeakLimiter(config, results);
+    benchNoiseSuppressor(config, results);
+    benchConvolver(config, results);
+    benchVstMix(config, results);
+    benchSandboxRoundTrip(config, results);
+    benchEngineCallback(config, results);
+
+    for (const auto& r : results)
+    {
+        std::cout << r.name.paddedRight(' ', 36) << juce::String(r.nsPerSampleMedian, 3).paddedLeft(' ', 10) << " ns/sample (min "
+                  << juce::String(r.nsPerSampleMin, 3) << ")  " << juce::String(r.allocationsPerIteration, 3) << " allocs/iter\n";
+    }
+
+    if (jsonFile != juce::File())
+    {
+        if (! jsonFile.replaceWithText(juce::JSON::toString(toJson(results), false)))
+        {
+            std::cerr << "Could not write " << jsonFile.getFullPathName() << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << jsonFile.getFullPathName() << "\n";
+    }
+
+    return 0;
+}
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // AudioEngine owns device managers and an AsyncUpdater, which need the message manager.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    return fizzle::bench::run(args);
+}
@@ -6,6 +6,7 @@
 namespace fizzle
 {
 constexpr double kInternalSampleRate = 48000.0;
+constexpr double kDeviceNativeSampleRate = 0.0; // run the processing chain at whatever rate the device opens at
 constexpr int kDefaultBlockSize = 256;
 
 struct EffectParameters
@@ -24,6 +25,9 @@ struct EffectParameters
     std::atomic<float> outputGainDb { 0.0f };
     std::atomic<bool> bypass { false };
     std::atomic<bool> mute { false };
+    std::atomic<bool> voiceStrip { false };
+    std::atomic<bool> noiseSuppression { false };
+    std::atomic<bool> convolution { false };
 };
 
 struct EngineSettings
@@ -33,6 +37,14 @@ struct EngineSettings
     juce::String outputDeviceType { "Windows Audio" };
     int bufferSize { kDefaultBlockSize };
     double preferredSampleRate { kInternalSampleRate };
+    int resamplerQuality { 1 }; // 0 = Low latency, 1 = Balanced, 2 = High quality
+    double internalSampleRate { kInternalSampleRate }; // kDeviceNativeSampleRate skips resampling entirely
+    int pipelineStages { 1 }; // Cores the serial plugin chain is split across; each extra stage adds one maximum-length block of latency
+    bool sandboxPlugins { false }; // Host newly loaded plugins in a helper process so a crash or hang cannot take Fizzle down
+    bool builtInVoiceStrip { false }; // Run the built-in HPF/gate/de-esser/EQ/compressor/limiter ahead of the plugin chain
+    bool builtInNoiseSuppression { false }; // Run the built-in spectral noise suppressor ahead of the plugin chain
+    bool builtInConvolution { false }; // Convolve with impulseResponsePath ahead of the plugin chain
+    juce::String impulseResponsePath; // WAV impulse response for the built-in convolver
     juce::String vstScanFolder;
     bool hasCompletedInitialVstScan { false };
     juce::StringArray scannedVstPaths;
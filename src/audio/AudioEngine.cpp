@@ -1,4 +1,7 @@
 #include "AudioEngine.h"
+#include "SimdKernels.h"
+#include "../core/RealtimeAudit.h"
+#include "../core/Tracer.h"
 
 namespace fizzle
 {
@@ -15,6 +18,7 @@ AudioEngine::~AudioEngine()
 
 bool AudioEngine::start(const EngineSettings& requested, juce::String& error)
 {
+    const TraceScope trace("engine", "AudioEngine::start");
     const juce::ScopedLock lifecycleScope(lifecycleLock);
 
     auto nextSettings = requested;
@@ -105,6 +109,7 @@ bool AudioEngine::start(const EngineSettings& requested, juce::String& error)
         settings = nextSettings;
     }
 
+    vstHost.setPipelineStages(nextSettings.pipelineStages);
     deviceManager.addAudioCallback(this);
 
     if (listenEnabled.load() && monitorOutputDevice.isNotEmpty())
@@ -118,6 +123,7 @@ bool AudioEngine::start(const EngineSettings& requested, juce::String& error)
 
 void AudioEngine::stop()
 {
+    const TraceScope trace("engine", "AudioEngine::stop");
     const juce::ScopedLock lifecycleScope(lifecycleLock);
     deviceReconfiguring.store(true);
     deviceManager.removeAudioCallback(this);
@@ -195,8 +201,45 @@ void AudioEngine::setEffectParameters(EffectParameters* paramsRef)
 
 Diagnostics AudioEngine::getDiagnostics() const
 {
-    const juce::ScopedLock sl(diagnosticsLock);
-    return diagnostics;
+    Diagnostics out;
+    {
+        const juce::ScopedLock sl(diagnosticsReadLock);
+        diagnosticsChannel.read(lastDiagnosticsCounters);
+        const auto& counters = lastDiagnosticsCounters;
+        out.sampleRate = counters.sampleRate;
+        out.processingSampleRate = counters.processingSampleRate;
+        out.bufferSize = counters.bufferSize;
+        out.cpuPercent = counters.cpuPercent;
+        out.dryLatencyMs = counters.dryLatencyMs;
+        out.postFxLatencyMs = counters.postFxLatencyMs;
+        out.inputLevel = counters.inputLevel;
+        out.outputLevel = counters.outputLevel;
+        out.droppedBuffers = counters.droppedBuffers;
+    }
+
+    out.monitorActive = listenEnabled.load();
+    if (out.monitorActive)
+    {
+        out.monitorDriftPpm = monitorCompensator.getDriftPpm();
+        out.monitorQueueMs = monitorCompensator.getQueueMs();
+        out.monitorUnderruns = monitorCompensator.getUnderrunCount();
+    }
+
+    const juce::ScopedLock sl(deviceNamesLock);
+    out.inputDevice = diagnosticsInputDevice;
+    out.outputDevice = diagnosticsOutputDevice;
+    return out;
+}
+
+TimingReport AudioEngine::takeTimingWindow()
+{
+    const juce::ScopedLock sl(timingReadLock);
+    TimingReport report;
+    report.blockBudgetUs = 1.0e6 * static_cast<double>(currentDeviceBufferSize.load()) / juce::jmax(1000.0, currentDeviceSampleRate.load());
+    report.callback = callbackHistogram.takeWindow();
+    for (size_t i = 0; i < stageHistograms.size(); ++i)
+        report.stages[i] = stageHistograms[i].takeWindow();
+    return report;
 }
 
 EngineSettings AudioEngine::currentSettings() const
@@ -205,14 +248,49 @@ EngineSettings AudioEngine::currentSettings() const
     return settings;
 }
 
+void AudioEngine::setProcessingSampleRate(double rate)
+{
+    const juce::ScopedLock settingsScope(settingsLock);
+    settings.internalSampleRate = rate;
+}
+
 void AudioEngine::restartAudio(juce::String& error)
 {
+    const TraceScope trace("engine", "AudioEngine::restartAudio");
     const auto current = currentSettings();
     stop();
     if (! start(current, error))
         Logger::instance().log("Audio restart failed: " + error);
 }
 
+bool AudioEngine::loadImpulseResponse(const juce::File& file, juce::String& error)
+{
+    const TraceScope trace("engine", "AudioEngine::loadImpulseResponse");
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+    {
+        error = "Could not read an impulse response from " + file.getFullPathName();
+        return false;
+    }
+
+    // Anything past the convolver's limit would be dropped anyway.
+    const auto maxSamples = static_cast<juce::int64>(PartitionedConvolver::kMaxImpulseSeconds * reader->sampleRate);
+    const auto length = static_cast<int>(juce::jmin(reader->lengthInSamples, maxSamples));
+    juce::AudioBuffer<float> response(juce::jlimit(1, 2, static_cast<int>(reader->numChannels)), length);
+    reader->read(&response, 0, length, 0, true, response.getNumChannels() > 1);
+    signalPath.setImpulseResponse(response, reader->sampleRate);
+    Logger::instance().log("Loaded impulse response " + file.getFileName() + " (" + juce::String(length) + " samples at "
+                           + juce::String(reader->sampleRate, 0) + " Hz)");
+    return true;
+}
+
+void AudioEngine::clearImpulseResponse()
+{
+    signalPath.setImpulseResponse({}, 0.0);
+}
+
 void AudioEngine::audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
                                                    int numInputChannels,
                                                    float* const* outputChannelData,
@@ -220,6 +298,11 @@ void AudioEngine::audioDeviceIOCallbackWithContext(const float* const* inputChan
                                                    int numSamples,
                                                    const juce::AudioIODeviceCallbackContext&)
 {
+    const RealtimeAudit::Scope realtimeAudit;
+    auto& tracer = Tracer::instance();
+    tracer.nameCurrentThread("Audio callback");
+    const TraceScope trace("audio", "Device callback");
+
     const juce::SpinLock::ScopedTryLockType ioLock(ioCallbackLock);
     if (! ioLock.isLocked() || deviceReconfiguring.load())
     {
@@ -245,101 +328,126 @@ void AudioEngine::audioDeviceIOCallbackWithContext(const float* const* inputChan
         return;
     }
 
-    inBuffer.setSize(juce::jmax(1, numInputChannels), numSamples, false, false, true);
-    for (int ch = 0; ch < numInputChannels; ++ch)
-    {
-        if (inputChannelData[ch] != nullptr)
-            inBuffer.copyFrom(ch, 0, inputChannelData[ch], numSamples);
-        else
-            inBuffer.clear(ch, 0, numSamples);
-    }
-
     const auto deviceRate = currentDeviceSampleRate.load();
     const auto safeDeviceRate = (deviceRate > 1000.0) ? deviceRate : kInternalSampleRate;
+    const auto procRate = processingSampleRate.load();
+
+    SignalPath::BlockOptions options;
+    options.bypass = params->bypass.load();
+    options.mute = params->mute.load();
+    options.outputGain = juce::Decibels::decibelsToGain(params->outputGainDb.load());
+    options.testTone = testToneEnabled.load();
+    options.builtIn = params->voiceStrip.load() || params->noiseSuppression.load() || params->convolution.load() ? params : nullptr;
+    auto lap = juce::Time::getHighResolutionTicks();
+    if (signalPath.processDirect(inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples, vstHost, options))
+    {
+        // The outputs already hold the block; only the monitor tap is left.
+        if (listenEnabled.load())
+            pushMonitor(outputChannelData, numOutputChannels, numSamples);
+    }
+    else
+    {
+        const auto& deviceOut = signalPath.process(inputChannelData, numInputChannels, numSamples, vstHost, options);
+        lap = juce::Time::getHighResolutionTicks();
+        writeOutputs(deviceOut, outputChannelData, numOutputChannels, numSamples);
+    }
 
-    const auto internalSamples = static_cast<int>(std::ceil((static_cast<double>(numSamples) * kInternalSampleRate) / safeDeviceRate));
-    internalBuffer.setSize(2, juce::jmax(1, internalSamples), false, false, true);
-    internalBuffer.clear();
-
-    resampler.process(inBuffer, internalBuffer, safeDeviceRate, kInternalSampleRate);
-    if (numInputChannels <= 1 && internalBuffer.getNumChannels() > 1)
-        internalBuffer.copyFrom(1, 0, internalBuffer, 0, 0, internalBuffer.getNumSamples());
+    const auto inPeak = signalPath.getInputPeak();
+    const auto outPeak = signalPath.getOutputPeak();
+    auto stageTicks = signalPath.getStageTicks();
+    const auto endTick = juce::Time::getHighResolutionTicks();
+    stageTicks[static_cast<size_t>(SignalPath::Stage::outputCopy)] = endTick - lap;
+    tracer.record("audio", SignalPath::getStageName(SignalPath::Stage::outputCopy), lap, endTick);
+    const auto elapsedTicks = endTick - tick;
+    const auto seconds = juce::Time::highResolutionTicksToSeconds(elapsedTicks);
+    const auto ticksToNs = [](juce::int64 ticks)
+    {
+        return static_cast<uint64_t>(juce::jmax(0.0, juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9));
+    };
+    callbackHistogram.record(ticksToNs(elapsedTicks));
+    for (size_t i = 0; i < stageTicks.size(); ++i)
+        stageHistograms[i].record(ticksToNs(stageTicks[i]));
+    const auto blockSeconds = static_cast<double>(numSamples) / safeDeviceRate;
+    const auto configuredBuffer = numSamples;
 
-    float inPeak = 0.0f;
-    for (int c = 0; c < internalBuffer.getNumChannels(); ++c)
-        inPeak = juce::jmax(inPeak, internalBuffer.getMagnitude(c, 0, internalBuffer.getNumSamples()));
+    DiagnosticsCounters counters;
+    counters.sampleRate = safeDeviceRate;
+    counters.processingSampleRate = procRate;
+    counters.bufferSize = configuredBuffer;
+    counters.cpuPercent = juce::jlimit(0.0, 100.0, (seconds / blockSeconds) * 100.0);
+    const auto resampleMs = signalPath.getResamplingLatencySeconds() * 1000.0;
+    const auto dryMs = ((safeDeviceRate > 0.0) ? ((2.0 * static_cast<double>(configuredBuffer)) / safeDeviceRate) * 1000.0 : 0.0) + resampleMs;
+    const auto pluginMs = 1000.0 * static_cast<double>(vstHost.getLatencySamples()) / procRate;
+    const auto builtInMs = options.builtIn != nullptr && ! options.bypass ? signalPath.getBuiltInLatencySeconds(*options.builtIn) * 1000.0 : 0.0;
+    counters.dryLatencyMs = dryMs;
+    counters.postFxLatencyMs = dryMs + pluginMs + builtInMs;
+    counters.inputLevel = inPeak;
+    counters.outputLevel = outPeak;
+    if (seconds > blockSeconds)
+        droppedBuffers.fetch_add(1, std::memory_order_relaxed);
+    counters.droppedBuffers = droppedBuffers.load(std::memory_order_relaxed);
+    diagnosticsChannel.write(counters);
+}
 
-    if (testToneEnabled.load())
+void AudioEngine::writeOutputs(const juce::AudioBuffer<float>& deviceOut, float* const* outputChannelData, int numOutputChannels, int numSamples) noexcept
+{
+    // Device outputs and the monitor tap are written in one pass over the processed block.
+    const auto numOut = deviceOut.getNumSamples();
+    const auto listening = listenEnabled.load();
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    if (listening)
+        monitorFifo.prepareToWrite(numOut, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < juce::jmax(numOutputChannels, listening ? 2 : 0); ++ch)
     {
-        const auto phaseDelta = juce::MathConstants<double>::twoPi * 440.0 / kInternalSampleRate;
-        auto phase = tonePhase.load();
-        for (int c = 0; c < internalBuffer.getNumChannels(); ++c)
+        const auto* src = deviceOut.getReadPointer(juce::jmin(ch, deviceOut.getNumChannels() - 1));
+        auto* out = ch < numOutputChannels ? outputChannelData[ch] : nullptr;
+        auto* fifo = (listening && ch < 2) ? monitorFifoBuffer.getWritePointer(ch) : nullptr;
+        if (out != nullptr && fifo != nullptr)
         {
-            auto* d = internalBuffer.getWritePointer(c);
-            for (int i = 0; i < internalBuffer.getNumSamples(); ++i)
-                d[i] = static_cast<float>(std::sin(phase + static_cast<double>(i) * phaseDelta) * 0.1);
+            simd::copyToBoth(out, fifo + start1, src, size1);
+            simd::copyToBoth(out + size1, fifo + start2, src + size1, size2);
+            const auto tapped = size1 + size2;
+            juce::FloatVectorOperations::copy(out + tapped, src + tapped, numOut - tapped);
+        }
+        else if (out != nullptr)
+        {
+            juce::FloatVectorOperations::copy(out, src, numOut);
+        }
+        else if (fifo != nullptr)
+        {
+            juce::FloatVectorOperations::copy(fifo + start1, src, size1);
+            juce::FloatVectorOperations::copy(fifo + start2, src + size1, size2);
         }
-        phase += phaseDelta * static_cast<double>(internalBuffer.getNumSamples());
-        tonePhase.store(std::fmod(phase, juce::MathConstants<double>::twoPi));
-    }
-
-    // Built-in FX removed: VST chain is the processing path.
-    if (! params->bypass.load())
-        vstHost.processBlock(internalBuffer);
-
-    if (params->mute.load())
-        internalBuffer.clear();
-
-    internalBuffer.applyGain(juce::Decibels::decibelsToGain(params->outputGainDb.load()));
-
-    outBuffer.setSize(juce::jmax(1, numOutputChannels), numSamples, false, false, true);
-    outBuffer.clear();
-    resampler.process(internalBuffer, outBuffer, kInternalSampleRate, safeDeviceRate);
-
-    float outPeak = 0.0f;
-    for (int c = 0; c < outBuffer.getNumChannels(); ++c)
-        outPeak = juce::jmax(outPeak, outBuffer.getMagnitude(c, 0, outBuffer.getNumSamples()));
 
-    for (int ch = 0; ch < numOutputChannels; ++ch)
-    {
-        if (outputChannelData[ch] != nullptr)
-            juce::FloatVectorOperations::copy(outputChannelData[ch], outBuffer.getReadPointer(juce::jmin(ch, outBuffer.getNumChannels() - 1)), numSamples);
+        if (out != nullptr && numOut < numSamples)
+            juce::FloatVectorOperations::clear(out + numOut, numSamples - numOut);
     }
 
-    if (listenEnabled.load())
+    if (listening)
+        monitorFifo.finishedWrite(size1 + size2);
+}
+
+void AudioEngine::pushMonitor(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    monitorFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int c = 0; c < 2; ++c)
     {
-        int start1, size1, start2, size2;
-        monitorFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
-        for (int c = 0; c < 2; ++c)
+        auto* fifo = monitorFifoBuffer.getWritePointer(c);
+        const auto* src = numChannels > 0 ? channels[juce::jmin(c, numChannels - 1)] : nullptr;
+        if (src != nullptr)
         {
-            auto* fifo = monitorFifoBuffer.getWritePointer(c);
-            const auto* src = outBuffer.getReadPointer(juce::jmin(c, outBuffer.getNumChannels() - 1));
-            if (size1 > 0)
-                juce::FloatVectorOperations::copy(fifo + start1, src, size1);
-            if (size2 > 0)
-                juce::FloatVectorOperations::copy(fifo + start2, src + size1, size2);
+            juce::FloatVectorOperations::copy(fifo + start1, src, size1);
+            juce::FloatVectorOperations::copy(fifo + start2, src + size1, size2);
+        }
+        else
+        {
+            juce::FloatVectorOperations::clear(fifo + start1, size1);
+            juce::FloatVectorOperations::clear(fifo + start2, size2);
         }
-        monitorFifo.finishedWrite(size1 + size2);
     }
-
-    const auto elapsedTicks = juce::Time::getHighResolutionTicks() - tick;
-    const auto seconds = juce::Time::highResolutionTicksToSeconds(elapsedTicks);
-    const auto blockSeconds = static_cast<double>(numSamples) / safeDeviceRate;
-    const auto configuredBuffer = numSamples;
-
-    const juce::ScopedLock sl(diagnosticsLock);
-    diagnostics.sampleRate = safeDeviceRate;
-    diagnostics.bufferSize = configuredBuffer;
-    diagnostics.cpuPercent = juce::jlimit(0.0, 100.0, (seconds / blockSeconds) * 100.0);
-    const auto dryMs = (safeDeviceRate > 0.0) ? ((2.0 * static_cast<double>(configuredBuffer)) / safeDeviceRate) * 1000.0 : 0.0;
-    const auto pluginMs = (safeDeviceRate > 0.0) ? (1000.0 * static_cast<double>(vstHost.getLatencySamples()) / safeDeviceRate) : 0.0;
-    diagnostics.dryLatencyMs = dryMs;
-    diagnostics.postFxLatencyMs = dryMs + pluginMs;
-    diagnostics.inputLevel = inPeak;
-    diagnostics.outputLevel = outPeak;
-    if (seconds > blockSeconds)
-        ++droppedBuffers;
-    diagnostics.droppedBuffers = droppedBuffers.load();
+    monitorFifo.finishedWrite(size1 + size2);
 }
 
 void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice* device)
@@ -348,35 +456,46 @@ void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice* device)
     const auto rawRate = device != nullptr ? device->getCurrentSampleRate() : kInternalSampleRate;
     const auto sampleRate = rawRate > 1000.0 ? rawRate : kInternalSampleRate;
     const auto deviceBuffer = device != nullptr ? juce::jmax(1, device->getCurrentBufferSizeSamples()) : 256;
-    const auto internalBlock = static_cast<int>(std::ceil((static_cast<double>(deviceBuffer) * kInternalSampleRate) / sampleRate));
+    const auto configured = currentSettings();
+    const auto procRate = configured.internalSampleRate > 1000.0 ? configured.internalSampleRate : sampleRate;
+    const auto internalBlock = static_cast<int>(std::ceil((static_cast<double>(deviceBuffer) * procRate) / sampleRate));
+    const auto inputChannels = device != nullptr ? juce::jlimit(1, 2, device->getActiveInputChannels().countNumberOfSetBits()) : 1;
+    const auto quality = Resampler::qualityFromIndex(configured.resamplerQuality);
+    const auto maxDeviceBlock = juce::jmax(2 * deviceBuffer, 2048);
     currentDeviceSampleRate.store(sampleRate);
-    chain.prepare(kInternalSampleRate, 2);
-    chain.reset();
-    vstHost.prepare(kInternalSampleRate, juce::jmax(64, internalBlock));
+    currentDeviceBufferSize.store(deviceBuffer);
+    processingSampleRate.store(procRate);
+    signalPath.prepare(sampleRate, procRate, inputChannels, maxDeviceBlock, quality);
+    vstHost.prepare(procRate, juce::jmax(64, internalBlock), signalPath.getMaxProcessingBlock());
 
     if (device != nullptr)
     {
-        const auto current = currentSettings();
-        const juce::ScopedLock sl(diagnosticsLock);
-        diagnostics.inputDevice = current.inputDeviceName;
-        diagnostics.outputDevice = current.outputDeviceName;
-        diagnostics.sampleRate = sampleRate;
-        diagnostics.bufferSize = device->getCurrentBufferSizeSamples();
+        {
+            const juce::ScopedLock sl(deviceNamesLock);
+            diagnosticsInputDevice = configured.inputDeviceName;
+            diagnosticsOutputDevice = configured.outputDeviceName;
+        }
+
+        DiagnosticsCounters counters;
+        counters.sampleRate = sampleRate;
+        counters.processingSampleRate = procRate;
+        counters.bufferSize = device->getCurrentBufferSizeSamples();
         const auto ioMs = (device->getInputLatencyInSamples() + device->getOutputLatencyInSamples()) * 1000.0 / sampleRate;
-        diagnostics.dryLatencyMs = ioMs;
-        diagnostics.postFxLatencyMs = ioMs + (1000.0 * static_cast<double>(vstHost.getLatencySamples()) / sampleRate);
-        diagnostics.droppedBuffers = droppedBuffers.load();
+        counters.dryLatencyMs = ioMs;
+        counters.postFxLatencyMs = ioMs + (1000.0 * static_cast<double>(vstHost.getLatencySamples()) / procRate);
+        counters.droppedBuffers = droppedBuffers.load(std::memory_order_relaxed);
+        diagnosticsChannel.write(counters);
     }
 
-    Logger::instance().log("Audio device started at " + juce::String(sampleRate));
+    Logger::instance().log("Audio device started at " + juce::String(sampleRate)
+                           + (std::abs(procRate - sampleRate) < 0.01 ? " (native-rate processing)" : ", processing at " + juce::String(procRate)));
 }
 
 void AudioEngine::audioDeviceStopped()
 {
     const juce::SpinLock::ScopedLockType ioLock(ioCallbackLock);
-    chain.reset();
     vstHost.release();
-    Logger::instance().log("Audio device stopped");
+    Logger::instance().log(Logger::Level::info, { "Audio device stopped" });
 
     if (! deviceReconfiguring.load())
         queueAutoRecoveryRestart("device stopped");
@@ -384,7 +503,7 @@ void AudioEngine::audioDeviceStopped()
 
 void AudioEngine::audioDeviceError(const juce::String& errorMessage)
 {
-    Logger::instance().log("Audio device error: " + errorMessage);
+    Logger::instance().log(Logger::Level::error, { "Audio device error: ", errorMessage });
     if (! deviceReconfiguring.load())
         queueAutoRecoveryRestart("device error");
 }
@@ -413,6 +532,8 @@ void AudioEngine::handleAsyncUpdate()
     if (deviceReconfiguring.load())
         return;
 
+    const TraceScope trace("engine", "Auto recovery");
+
     const auto now = juce::Time::getMillisecondCounter();
     const auto last = lastAutoRecoveryAttemptMs.load();
     if (last != 0 && static_cast<juce::uint32>(now - last) < 1500u)
@@ -434,42 +555,20 @@ void AudioEngine::handleAsyncUpdate()
         Logger::instance().log("Auto recovery restart succeeded (" + reason + ")");
 }
 
+void AudioEngine::MonitorCallback::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    const auto rate = device != nullptr ? device->getCurrentSampleRate() : 0.0;
+    const auto block = device != nullptr ? device->getCurrentBufferSizeSamples() : 0;
+    owner.monitorCompensator.prepare(owner.currentDeviceSampleRate.load(), rate, owner.currentDeviceBufferSize.load(), block);
+    Logger::instance().log("Monitor device started at " + juce::String(rate) + ", block " + juce::String(block));
+}
+
 void AudioEngine::MonitorCallback::audioDeviceIOCallbackWithContext(const float* const*, int, float* const* outputChannelData, int numOutputChannels, int numSamples, const juce::AudioIODeviceCallbackContext&)
 {
+    const RealtimeAudit::Scope realtimeAudit;
     if (outputChannelData == nullptr || numSamples <= 0)
         return;
 
-    for (int c = 0; c < numOutputChannels; ++c)
-        if (outputChannelData[c] != nullptr)
-            juce::FloatVectorOperations::clear(outputChannelData[c], numSamples);
-
-    const auto queued = owner.monitorFifo.getNumReady();
-    const auto maxQueued = numSamples * 2;
-    if (queued > maxQueued)
-    {
-        int dropStart1, dropSize1, dropStart2, dropSize2;
-        owner.monitorFifo.prepareToRead(queued - maxQueued, dropStart1, dropSize1, dropStart2, dropSize2);
-        owner.monitorFifo.finishedRead(dropSize1 + dropSize2);
-    }
-
-    int start1, size1, start2, size2;
-    owner.monitorFifo.prepareToRead(numSamples, start1, size1, start2, size2);
-    const auto readSamples = size1 + size2;
-    if (readSamples <= 0)
-        return;
-
-    for (int c = 0; c < numOutputChannels; ++c)
-    {
-        if (outputChannelData[c] == nullptr)
-            continue;
-
-        const auto* fifo = owner.monitorFifoBuffer.getReadPointer(juce::jmin(c, owner.monitorFifoBuffer.getNumChannels() - 1));
-        if (size1 > 0)
-            juce::FloatVectorOperations::copy(outputChannelData[c], fifo + start1, size1);
-        if (size2 > 0)
-            juce::FloatVectorOperations::copy(outputChannelData[c] + size1, fifo + start2, size2);
-    }
-
-    owner.monitorFifo.finishedRead(readSamples);
+    owner.monitorCompensator.process(owner.monitorFifo, owner.monitorFifoBuffer, outputChannelData, numOutputChannels, numSamples);
 }
 }
@@ -1,18 +1,36 @@
 #pragma once
 
 #include "../AppConfig.h"
+#include "../core/LatencyHistogram.h"
 #include "../core/Logger.h"
-#include "ProcessorChain.h"
-#include "Resampler.h"
+#include "../core/TripleBuffer.h"
+#include "DriftCompensator.h"
+#include "SignalPath.h"
 #include "../plugins/VstHost.h"
 
 namespace fizzle
 {
+// Plain numeric figures published by the audio callback. Kept trivially copyable so
+// the callback can hand them to the message thread without locks or allocation.
+struct DiagnosticsCounters
+{
+    double sampleRate { 0.0 };
+    double processingSampleRate { 0.0 };
+    int bufferSize { 0 };
+    double cpuPercent { 0.0 };
+    double dryLatencyMs { 0.0 };
+    double postFxLatencyMs { 0.0 };
+    float inputLevel { 0.0f };
+    float outputLevel { 0.0f };
+    uint64_t droppedBuffers { 0 };
+};
+
 struct Diagnostics
 {
     juce::String inputDevice;
     juce::String outputDevice;
     double sampleRate { 0.0 };
+    double processingSampleRate { 0.0 };
     int bufferSize { 0 };
     double cpuPercent { 0.0 };
     double dryLatencyMs { 0.0 };
@@ -20,6 +38,18 @@ struct Diagnostics
     float inputLevel { 0.0f };
     float outputLevel { 0.0f };
     uint64_t droppedBuffers { 0 };
+    bool monitorActive { false };
+    double monitorDriftPpm { 0.0 };
+    double monitorQueueMs { 0.0 };
+    uint64_t monitorUnderruns { 0 };
+};
+
+// Callback and per-stage durations over one reporting window.
+struct TimingReport
+{
+    double blockBudgetUs { 0.0 };
+    LatencyHistogram::Summary callback;
+    std::array<LatencyHistogram::Summary, SignalPath::kNumStages> stages {};
 };
 
 class AudioEngine : public juce::AudioIODeviceCallback,
@@ -39,10 +69,22 @@ public:
     void setMute(bool mute) { if (params != nullptr) params->mute.store(mute); }
 
     Diagnostics getDiagnostics() const;
+    // Summarises callback timing since the previous call. Intended for a single
+    // periodic consumer such as the diagnostics panel.
+    TimingReport takeTimingWindow();
     EngineSettings currentSettings() const;
+    double getProcessingSampleRate() const { return processingSampleRate.load(); }
+    // Rate the chain runs at from the next device start; kDeviceNativeSampleRate runs it at
+    // whatever rate the device opens at. start() sets it too, from its settings.
+    void setProcessingSampleRate(double rate);
 
     void restartAudio(juce::String& error);
 
+    // Reads an impulse response (WAV or another basic format) for the built-in convolver.
+    // Returns false and sets error if the file cannot be read.
+    bool loadImpulseResponse(const juce::File& file, juce::String& error);
+    void clearImpulseResponse();
+
     void setTestToneEnabled(bool enabled) { testToneEnabled.store(enabled); }
     void setListenEnabled(bool enabled);
     bool isListenEnabled() const { return listenEnabled.load(); }
@@ -67,7 +109,7 @@ private:
     public:
         explicit MonitorCallback(AudioEngine& ownerRef) : owner(ownerRef) {}
         void audioDeviceIOCallbackWithContext(const float* const*, int, float* const* outputChannelData, int numOutputChannels, int numSamples, const juce::AudioIODeviceCallbackContext&) override;
-        void audioDeviceAboutToStart(juce::AudioIODevice*) override {}
+        void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
         void audioDeviceStopped() override {}
     private:
         AudioEngine& owner;
@@ -83,29 +125,39 @@ private:
     mutable juce::CriticalSection settingsLock;
     EngineSettings settings;
 
-    ProcessorChain chain;
     VstHost vstHost;
 
-    mutable juce::CriticalSection diagnosticsLock;
-    Diagnostics diagnostics;
+    // Written only by the device thread (callback and aboutToStart, which are serialised
+    // by ioCallbackLock); read only through getDiagnostics().
+    mutable TripleBuffer<DiagnosticsCounters> diagnosticsChannel;
+    mutable juce::CriticalSection diagnosticsReadLock;
+    mutable DiagnosticsCounters lastDiagnosticsCounters;
+    juce::CriticalSection deviceNamesLock;
+    juce::String diagnosticsInputDevice;
+    juce::String diagnosticsOutputDevice;
     std::atomic<uint64_t> droppedBuffers { 0 };
 
-    juce::AudioBuffer<float> inBuffer;
-    juce::AudioBuffer<float> internalBuffer;
-    juce::AudioBuffer<float> outBuffer;
+    // Recorded by the device thread only; windows are taken under timingReadLock.
+    LatencyHistogram callbackHistogram;
+    std::array<LatencyHistogram, SignalPath::kNumStages> stageHistograms;
+    juce::CriticalSection timingReadLock;
+
     juce::SpinLock ioCallbackLock;
     std::atomic<bool> deviceReconfiguring { false };
 
-    Resampler resampler;
+    SignalPath signalPath;
 
     std::atomic<bool> testToneEnabled { false };
-    std::atomic<double> tonePhase { 0.0 };
     std::atomic<double> currentDeviceSampleRate { kInternalSampleRate };
+    std::atomic<int> currentDeviceBufferSize { 256 };
+    std::atomic<double> processingSampleRate { kInternalSampleRate };
     std::atomic<bool> listenEnabled { false };
     juce::String monitorOutputDevice;
 
     juce::AbstractFifo monitorFifo { 32768 };
     juce::AudioBuffer<float> monitorFifoBuffer { 2, 32768 };
+    // Prepared and run only on the monitor device thread; its figures are atomics.
+    DriftCompensator monitorCompensator;
 
     std::atomic<bool> autoRecoveryPending { false };
     std::atomic<juce::uint32> lastAutoRecoveryAttemptMs { 0 };
@@ -113,6 +165,10 @@ private:
     juce::CriticalSection autoRecoveryLock;
 
     void queueAutoRecoveryRestart(const juce::String& reason);
+    // Realtime safe. Copy a processed block to the device outputs, and to the monitor
+    // FIFO while listening.
+    void writeOutputs(const juce::AudioBuffer<float>& deviceOut, float* const* outputChannelData, int numOutputChannels, int numSamples) noexcept;
+    void pushMonitor(const float* const* channels, int numChannels, int numSamples) noexcept;
     void handleAsyncUpdate() override;
 };
 }
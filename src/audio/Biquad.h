@@ -3,9 +3,86 @@
 #include <JuceHeader.h>
 #include <array>
 #include <cmath>
+#include <utility>
 
 namespace fizzle
 {
+// Normalised biquad coefficients (a0 == 1) from the RBJ cookbook formulas. Shelf and
+// peak gains are in dB; at 0 dB they return the identity exactly, so a flat band can be
+// recognised and skipped.
+struct BiquadCoefficients
+{
+    float b0 { 1.0f };
+    float b1 { 0.0f };
+    float b2 { 0.0f };
+    float a1 { 0.0f };
+    float a2 { 0.0f };
+
+    bool operator==(const BiquadCoefficients&) const = default;
+    bool isIdentity() const noexcept { return *this == BiquadCoefficients {}; }
+
+    static BiquadCoefficients highPass(float sampleRate, float frequency, float q = 0.7071f)
+    {
+        const auto [cosW0, alpha] = prewarp(sampleRate, frequency, q);
+        return normalise((1.0f + cosW0) * 0.5f, -(1.0f + cosW0), (1.0f + cosW0) * 0.5f,
+                         1.0f + alpha, -2.0f * cosW0, 1.0f - alpha);
+    }
+
+    static BiquadCoefficients lowPass(float sampleRate, float frequency, float q = 0.7071f)
+    {
+        const auto [cosW0, alpha] = prewarp(sampleRate, frequency, q);
+        return normalise((1.0f - cosW0) * 0.5f, 1.0f - cosW0, (1.0f - cosW0) * 0.5f,
+                         1.0f + alpha, -2.0f * cosW0, 1.0f - alpha);
+    }
+
+    static BiquadCoefficients lowShelf(float sampleRate, float frequency, float gainDb, float q = 0.7071f)
+    {
+        if (gainDb == 0.0f)
+            return {};
+
+        const auto [cosW0, alpha] = prewarp(sampleRate, frequency, q);
+        const auto a = std::pow(10.0f, gainDb / 40.0f);
+        const auto k = 2.0f * std::sqrt(a) * alpha;
+        return normalise(a * ((a + 1.0f) - (a - 1.0f) * cosW0 + k), 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cosW0), a * ((a + 1.0f) - (a - 1.0f) * cosW0 - k),
+                         (a + 1.0f) + (a - 1.0f) * cosW0 + k, -2.0f * ((a - 1.0f) + (a + 1.0f) * cosW0), (a + 1.0f) + (a - 1.0f) * cosW0 - k);
+    }
+
+    static BiquadCoefficients highShelf(float sampleRate, float frequency, float gainDb, float q = 0.7071f)
+    {
+        if (gainDb == 0.0f)
+            return {};
+
+        const auto [cosW0, alpha] = prewarp(sampleRate, frequency, q);
+        const auto a = std::pow(10.0f, gainDb / 40.0f);
+        const auto k = 2.0f * std::sqrt(a) * alpha;
+        return normalise(a * ((a + 1.0f) + (a - 1.0f) * cosW0 + k), -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cosW0), a * ((a + 1.0f) + (a - 1.0f) * cosW0 - k),
+                         (a + 1.0f) - (a - 1.0f) * cosW0 + k, 2.0f * ((a - 1.0f) - (a + 1.0f) * cosW0), (a + 1.0f) - (a - 1.0f) * cosW0 - k);
+    }
+
+    static BiquadCoefficients peak(float sampleRate, float frequency, float gainDb, float q = 0.7071f)
+    {
+        if (gainDb == 0.0f)
+            return {};
+
+        const auto [cosW0, alpha] = prewarp(sampleRate, frequency, q);
+        const auto a = std::pow(10.0f, gainDb / 40.0f);
+        return normalise(1.0f + alpha * a, -2.0f * cosW0, 1.0f - alpha * a,
+                         1.0f + alpha / a, -2.0f * cosW0, 1.0f - alpha / a);
+    }
+
+private:
+    static std::pair<float, float> prewarp(float sampleRate, float frequency, float q)
+    {
+        const auto w0 = 2.0f * juce::MathConstants<float>::pi * frequency / sampleRate;
+        return { std::cos(w0), std::sin(w0) / (2.0f * q) };
+    }
+
+    static BiquadCoefficients normalise(float b0, float b1, float b2, float a0, float a1, float a2)
+    {
+        return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+    }
+};
+
 class Biquad
 {
 public:
@@ -15,36 +92,23 @@ public:
         z2 = 0.0f;
     }
 
+    void setCoefficients(const BiquadCoefficients& newCoeffs) { coeffs = newCoeffs; }
+
     void setHighPass(float sampleRate, float frequency, float q = 0.7071f)
     {
-        const auto w0 = 2.0f * juce::MathConstants<float>::pi * frequency / sampleRate;
-        const auto alpha = std::sin(w0) / (2.0f * q);
-        const auto cosW0 = std::cos(w0);
-
-        const auto b0 = (1.0f + cosW0) * 0.5f;
-        const auto b1 = -(1.0f + cosW0);
-        const auto b2 = (1.0f + cosW0) * 0.5f;
-        const auto a0 = 1.0f + alpha;
-        const auto a1 = -2.0f * cosW0;
-        const auto a2 = 1.0f - alpha;
-
-        coeffs[0] = b0 / a0;
-        coeffs[1] = b1 / a0;
-        coeffs[2] = b2 / a0;
-        coeffs[3] = a1 / a0;
-        coeffs[4] = a2 / a0;
+        coeffs = BiquadCoefficients::highPass(sampleRate, frequency, q);
     }
 
     float process(float x)
     {
-        const auto y = coeffs[0] * x + z1;
-        z1 = coeffs[1] * x - coeffs[3] * y + z2;
-        z2 = coeffs[2] * x - coeffs[4] * y;
+        const auto y = coeffs.b0 * x + z1;
+        z1 = coeffs.b1 * x - coeffs.a1 * y + z2;
+        z2 = coeffs.b2 * x - coeffs.a2 * y;
         return y;
     }
 
 private:
-    std::array<float, 5> coeffs { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    BiquadCoefficients coeffs;
     float z1 { 0.0f };
     float z2 { 0.0f };
 };
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "Biquad.h"
+#include "SimdKernels.h"
+
+namespace fizzle
+{
+// A chain of biquad sections that filters up to four channels at once, one channel per
+// SIMD lane, so a stereo filter costs one vector pass rather than a scalar pass per
+// channel. All channels share the coefficients.
+//
+// Coefficients are cached: setStage() is cheap to call every block and only starts a
+// change when they differ from the current target. A change is ramped in linearly over
+// a short stretch so a moving parameter does not click. The state is flushed to zero
+// once it decays below audibility, so silence never leaves denormals in the loop.
+template <int NumStages, int NumChannels = 2>
+class BiquadCascade
+{
+public:
+    static_assert(NumStages > 0, "a cascade needs at least one section");
+    static_assert(NumChannels > 0 && NumChannels <= 4, "one channel per lane of a four-lane vector");
+
+    static constexpr int kDefaultRampSamples = 64;
+
+    BiquadCascade() { reset(); }
+
+    // Realtime safe. With ramp false the new coefficients take effect immediately, which
+    // is what a filter's first setting wants.
+    void setStage(int stage, const BiquadCoefficients& coefficients, bool ramp = true) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(stage, NumStages));
+        auto& targetStage = target[static_cast<size_t>(stage)];
+        if (coefficients == targetStage)
+            return;
+
+        if (! ramp)
+        {
+            finishRamp();
+            targetStage = coefficients;
+            sections[static_cast<size_t>(stage)] = broadcast(coefficients);
+            return;
+        }
+
+        // Every stage restarts from wherever its ramp has got to.
+        std::array<BiquadCoefficients, NumStages> from;
+        for (size_t s = 0; s < NumStages; ++s)
+            from[s] = currentOf(s, static_cast<float>(rampRemaining));
+
+        targetStage = coefficients;
+        rampRemaining = rampSamples;
+        const auto scale = 1.0f / static_cast<float>(rampSamples);
+        for (size_t s = 0; s < NumStages; ++s)
+        {
+            const auto& to = target[s];
+            rampSteps[s] = { (to.b0 - from[s].b0) * scale, (to.b1 - from[s].b1) * scale, (to.b2 - from[s].b2) * scale,
+                             (to.a1 - from[s].a1) * scale, (to.a2 - from[s].a2) * scale };
+            steps[s] = broadcast(rampSteps[s]);
+            sections[s] = broadcast(from[s]);
+        }
+    }
+
+    void setRampSamples(int samples) noexcept { rampSamples = juce::jmax(1, samples); }
+
+    // Realtime safe. Clears the filter state and completes any ramp.
+    void reset() noexcept
+    {
+        finishRamp();
+        z1.fill(simd::Float4::zero());
+        z2.fill(simd::Float4::zero());
+    }
+
+    // True when the cascade would pass audio through unchanged.
+    bool isIdentity() const noexcept
+    {
+        if (rampRemaining > 0)
+            return false;
+
+        for (const auto& stage : target)
+            if (! stage.isIdentity())
+                return false;
+
+        return true;
+    }
+
+    // Realtime safe. Filters numChannels channels in place.
+    void process(float* const* channels, int numChannels, int numSamples) noexcept
+    {
+        process(channels, channels, numChannels, numSamples);
+    }
+
+    // Realtime safe. output may alias input channel for channel.
+    void process(const float* const* input, float* const* output, int numChannels, int numSamples) noexcept
+    {
+        numChannels = juce::jlimit(0, NumChannels, numChannels);
+        if (isIdentity())
+        {
+            for (int c = 0; c < numChannels; ++c)
+                if (output[c] != input[c])
+                    std::copy(input[c], input[c] + numSamples, output[c]);
+            return;
+        }
+
+        // Four samples of every channel are loaded as rows and transposed, so each
+        // vector then holds one sample across the channels.
+        std::array<simd::Float4, 4> frames;
+        for (int i = 0; i < numSamples; i += 4)
+        {
+            const auto count = juce::jmin(4, numSamples - i);
+            for (int lane = 0; lane < 4; ++lane)
+                frames[static_cast<size_t>(lane)] = lane < numChannels ? loadPartial(input[lane] + i, count) : simd::Float4::zero();
+
+            simd::Float4::transpose(frames[0], frames[1], frames[2], frames[3]);
+            for (int k = 0; k < count; ++k)
+                frames[static_cast<size_t>(k)] = tick(frames[static_cast<size_t>(k)]);
+            simd::Float4::transpose(frames[0], frames[1], frames[2], frames[3]);
+
+            for (int c = 0; c < numChannels; ++c)
+                storePartial(frames[static_cast<size_t>(c)], output[c] + i, count);
+
+            if ((i + 4) % kFlushInterval == 0)
+                flushState();
+        }
+
+        flushState();
+    }
+
+private:
+    struct Section
+    {
+        simd::Float4 b0, b1, b2, a1, a2;
+    };
+
+    // Checked often enough that even a fast-decaying section cannot fall from here into
+    // the denormal range between two checks.
+    static constexpr int kFlushInterval = 64;
+    static constexpr float kFlushThreshold = 1.0e-15f;
+
+    std::array<BiquadCoefficients, NumStages> target {};
+    std::array<Section, NumStages> sections {};
+    std::array<BiquadCoefficients, NumStages> rampSteps {};
+    std::array<Section, NumStages> steps {};
+    std::array<simd::Float4, NumStages> z1 {};
+    std::array<simd::Float4, NumStages> z2 {};
+    int rampSamples { kDefaultRampSamples };
+    int rampRemaining { 0 };
+
+    static Section broadcast(const BiquadCoefficients& c) noexcept
+    {
+        return { simd::Float4::broadcast(c.b0), simd::Float4::broadcast(c.b1), simd::Float4::broadcast(c.b2),
+                 simd::Float4::broadcast(c.a1), simd::Float4::broadcast(c.a2) };
+    }
+
+    // Where stage s's ramp stands with the given number of samples still to go.
+    BiquadCoefficients currentOf(size_t s, float remaining) const noexcept
+    {
+        const auto& to = target[s];
+        const auto& step = rampSteps[s];
+        return { to.b0 - step.b0 * remaining, to.b1 - step.b1 * remaining, to.b2 - step.b2 * remaining,
+                 to.a1 - step.a1 * remaining, to.a2 - step.a2 * remaining };
+    }
+
+    void finishRamp() noexcept
+    {
+        rampRemaining = 0;
+        for (size_t s = 0; s < NumStages; ++s)
+            sections[s] = broadcast(target[s]);
+    }
+
+    void flushState() noexcept
+    {
+        for (size_t s = 0; s < NumStages; ++s)
+        {
+            z1[s] = simd::Float4::flushBelow(z1[s], kFlushThreshold);
+            z2[s] = simd::Float4::flushBelow(z2[s], kFlushThreshold);
+        }
+    }
+
+    simd::Float4 tick(simd::Float4 x) noexcept
+    {
+        if (rampRemaining > 0)
+        {
+            if (--rampRemaining == 0)
+            {
+                finishRamp();
+            }
+            else
+            {
+                for (size_t s = 0; s < NumStages; ++s)
+                {
+                    auto& section = sections[s];
+                    const auto& step = steps[s];
+                    section = { section.b0 + step.b0, section.b1 + step.b1, section.b2 + step.b2,
+                                section.a1 + step.a1, section.a2 + step.a2 };
+                }
+            }
+        }
+
+        // Transposed direct form II, as Biquad.
+        for (size_t s = 0; s < NumStages; ++s)
+        {
+            const auto& c = sections[s];
+            const auto y = c.b0 * x + z1[s];
+            z1[s] = c.b1 * x - c.a1 * y + z2[s];
+            z2[s] = c.b2 * x - c.a2 * y;
+            x = y;
+        }
+        return x;
+    }
+
+    static simd::Float4 loadPartial(const float* src, int count) noexcept
+    {
+        if (count == 4)
+            return simd::Float4::load(src);
+
+        float lanes[4] {};
+        std::copy(src, src + count, lanes);
+        return simd::Float4::load(lanes);
+    }
+
+    static void storePartial(simd::Float4 x, float* dst, int count) noexcept
+    {
+        if (count == 4)
+        {
+            x.store(dst);
+            return;
+        }
+
+        float lanes[4];
+        x.store(lanes);
+        std::copy(lanes, lanes + count, dst);
+    }
+};
+}
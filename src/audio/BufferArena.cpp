@@ -0,0 +1,88 @@
+#include "BufferArena.h"
+#include <cstdint>
+
+namespace fizzle
+{
+namespace
+{
+constexpr size_t kFloatsPerLine = static_cast<size_t>(BufferArena::kAlignment) / sizeof(float);
+
+size_t strideFor(int capacity) noexcept
+{
+    return (static_cast<size_t>(capacity) + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+}
+}
+
+void BufferArena::clear()
+{
+    regions.clear();
+    channelPointers.clear();
+    storage.reset();
+    sizeInBytes = 0;
+}
+
+int BufferArena::reserve(int numChannels, int maxSamples)
+{
+    // Reserving after allocate() would leave the new region without memory.
+    jassert(storage == nullptr);
+
+    Region region;
+    region.firstChannel = static_cast<int>(channelPointers.size());
+    region.numChannels = juce::jmax(0, numChannels);
+    region.capacity = juce::jmax(1, maxSamples);
+    regions.push_back(region);
+    channelPointers.resize(channelPointers.size() + static_cast<size_t>(region.numChannels), nullptr);
+    return static_cast<int>(regions.size()) - 1;
+}
+
+void BufferArena::allocate()
+{
+    size_t totalFloats = 0;
+    for (const auto& region : regions)
+        totalFloats += strideFor(region.capacity) * static_cast<size_t>(region.numChannels);
+
+    // One line of slack lets the start be rounded up to the alignment.
+    storage.reset(new float[totalFloats + kFloatsPerLine]());
+    sizeInBytes = totalFloats * sizeof(float);
+
+    const auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+    const auto aligned = (address + static_cast<std::uintptr_t>(kAlignment - 1)) & ~static_cast<std::uintptr_t>(kAlignment - 1);
+    auto* next = reinterpret_cast<float*>(aligned);
+    for (const auto& region : regions)
+    {
+        const auto stride = strideFor(region.capacity);
+        for (int c = 0; c < region.numChannels; ++c)
+        {
+            channelPointers[static_cast<size_t>(region.firstChannel + c)] = next;
+            next += stride;
+        }
+    }
+}
+
+int BufferArena::getNumChannels(int region) const noexcept
+{
+    return juce::isPositiveAndBelow(region, getNumRegions()) ? regions[static_cast<size_t>(region)].numChannels : 0;
+}
+
+int BufferArena::getCapacity(int region) const noexcept
+{
+    return juce::isPositiveAndBelow(region, getNumRegions()) ? regions[static_cast<size_t>(region)].capacity : 0;
+}
+
+float* BufferArena::getChannel(int region, int channel) const noexcept
+{
+    if (! juce::isPositiveAndBelow(channel, getNumChannels(region)))
+        return nullptr;
+
+    return channelPointers[static_cast<size_t>(regions[static_cast<size_t>(region)].firstChannel + channel)];
+}
+
+void BufferArena::attach(int region, juce::AudioBuffer<float>& view, int numSamples) const noexcept
+{
+    if (storage == nullptr || ! juce::isPositiveAndBelow(region, getNumRegions()))
+        return;
+
+    const auto& r = regions[static_cast<size_t>(region)];
+    view.setDataToReferTo(channelPointers.data() + r.firstChannel, r.numChannels, juce::jlimit(0, r.capacity, numSamples));
+}
+}
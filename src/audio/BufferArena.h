@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace fizzle
+{
+// Scratch audio memory for one realtime component, laid out and allocated at prepare time.
+//
+// Regions are reserved first; allocate() then makes a single zeroed allocation that holds
+// all of them. Every channel starts on a kAlignment-byte boundary and its stride is a
+// whole number of cache lines, so vector loops can use aligned loads and neighbouring
+// channels never share a line. After allocate() the audio thread only points
+// juce::AudioBuffer views at the memory: nothing is resized or reallocated until the
+// next prepare.
+class BufferArena
+{
+public:
+    static constexpr int kAlignment = 64;
+
+    // Not realtime safe. Drops the layout and the memory.
+    void clear();
+
+    // Not realtime safe. Adds a region of numChannels x maxSamples and returns its index.
+    int reserve(int numChannels, int maxSamples);
+
+    // Not realtime safe. Allocates every reserved region in one block, zeroed.
+    void allocate();
+
+    int getNumRegions() const noexcept { return static_cast<int>(regions.size()); }
+    int getNumChannels(int region) const noexcept;
+    int getCapacity(int region) const noexcept;
+    float* getChannel(int region, int channel) const noexcept;
+    size_t getSizeInBytes() const noexcept { return sizeInBytes; }
+
+    // Realtime safe. Points view at the first numSamples of every channel of region.
+    // numSamples is clamped to the region's capacity; check view.getNumSamples().
+    void attach(int region, juce::AudioBuffer<float>& view, int numSamples) const noexcept;
+
+private:
+    struct Region
+    {
+        int firstChannel { 0 };
+        int numChannels { 0 };
+        int capacity { 0 };
+    };
+
+    std::vector<Region> regions;
+    std::vector<float*> channelPointers;
+    std::unique_ptr<float[]> storage;
+    size_t sizeInBytes { 0 };
+};
+}
@@ -1,116 +1,155 @@
 #include "BuiltInProcessors.h"
+#include "SimdKernels.h"
 
 namespace fizzle
 {
+namespace
+{
+// Envelopes are floored here (-140 dB) before their level is taken.
+constexpr float kEnvelopeFloor = 1.0e-7f;
+constexpr float kCompAttack = 0.01f;
+constexpr float kCompRelease = 0.001f;
+constexpr float kLowShelfHz = 200.0f;
+constexpr float kMidPeakHz = 1000.0f;
+constexpr float kHighShelfHz = 5000.0f;
+
+float dbToLin(float db)
+{
+    return std::pow(10.0f, db / 20.0f);
+}
+}
+
 void BuiltInProcessors::prepare(double sampleRate, int)
 {
     sr = sampleRate;
-    for (auto& biquad : hpf)
-        biquad.setHighPass(static_cast<float>(sr), 80.0f);
-
-    for (auto& biquad : deEss)
-        biquad.setHighPass(static_cast<float>(sr), 4200.0f, 0.8f);
-
+    hpfCutoff = -1.0f;
+    deEss.setStage(0, BiquadCoefficients::highPass(static_cast<float>(sr), 4200.0f, 0.8f), false);
     reset();
 }
 
 void BuiltInProcessors::reset()
 {
-    for (auto& biquad : hpf)
-        biquad.reset();
-
-    for (auto& biquad : deEss)
-        biquad.reset();
-
+    hpf.reset();
+    deEss.reset();
+    eq.reset();
     gateEnv = { 0.0f, 0.0f };
     compEnv = { 0.0f, 0.0f };
 }
 
-float BuiltInProcessors::dbToLin(float db)
+BuiltInProcessors::Settings BuiltInProcessors::snapshot(const EffectParameters& params) noexcept
 {
-    return std::pow(10.0f, db / 20.0f);
+    Settings settings;
+    settings.hpfHz = juce::jlimit(40.0f, 300.0f, params.hpfHz.load());
+
+    // Both dynamics stages reduce to gain = (envelope / threshold)^exponent on one side
+    // of the threshold, which is what the dB-domain curves work out to.
+    const auto gateRatio = juce::jmax(1.0f, params.gateRatio.load());
+    settings.gateInvThreshold = 1.0f / dbToLin(params.gateThresholdDb.load());
+    settings.gateExponent = 1.0f - 1.0f / gateRatio;
+    settings.deEssDepth = juce::jlimit(0.0f, 1.0f, params.deEssAmount.load()) * 0.8f;
+    settings.lowGainDb = params.lowGainDb.load();
+    settings.midGainDb = params.midGainDb.load();
+    settings.highGainDb = params.highGainDb.load();
+
+    const auto compRatio = juce::jmax(1.0f, params.compRatio.load());
+    settings.compInvThreshold = 1.0f / dbToLin(params.compThresholdDb.load());
+    settings.compExponent = -(1.0f - 1.0f / compRatio) * (1.0f - kCompAttack);
+    settings.makeup = dbToLin(params.compMakeupDb.load());
+    return settings;
 }
 
-float BuiltInProcessors::linToDb(float lin)
+void BuiltInProcessors::updateFilters(const Settings& settings) noexcept
 {
-    constexpr float floorVal = 1.0e-7f;
-    return 20.0f * std::log10(std::max(lin, floorVal));
+    // The first block after prepare() sets the filters outright; later changes are ramped.
+    const auto fresh = hpfCutoff < 0.0f;
+    const auto rate = static_cast<float>(sr);
+    if (settings.hpfHz != hpfCutoff)
+    {
+        hpfCutoff = settings.hpfHz;
+        hpf.setStage(0, BiquadCoefficients::highPass(rate, hpfCutoff), ! fresh);
+    }
+
+    const std::array<float, 3> gainsDb { settings.lowGainDb, settings.midGainDb, settings.highGainDb };
+    if (fresh || gainsDb != eqGainsDb)
+    {
+        eqGainsDb = gainsDb;
+        eq.setStage(0, BiquadCoefficients::lowShelf(rate, kLowShelfHz, gainsDb[0]), ! fresh);
+        eq.setStage(1, BiquadCoefficients::peak(rate, kMidPeakHz, gainsDb[1]), ! fresh);
+        eq.setStage(2, BiquadCoefficients::highShelf(rate, kHighShelfHz, gainsDb[2]), ! fresh);
+    }
 }
 
-void BuiltInProcessors::process(juce::AudioBuffer<float>& buffer, const EffectParameters& params)
+void BuiltInProcessors::process(juce::AudioBuffer<float>& buffer, const EffectParameters& params) noexcept
 {
     if (params.bypass.load())
         return;
 
+    const auto settings = snapshot(params);
+    updateFilters(settings);
+
     const auto channels = std::min(2, buffer.getNumChannels());
     const auto samples = buffer.getNumSamples();
+    if (channels == 0)
+        return;
 
-    const auto hpfHz = juce::jlimit(40.0f, 300.0f, params.hpfHz.load());
-    const auto gateThresh = params.gateThresholdDb.load();
-    const auto gateRatio = juce::jmax(1.0f, params.gateRatio.load());
-    const auto deEssAmount = juce::jlimit(0.0f, 1.0f, params.deEssAmount.load());
+    auto* const* data = buffer.getArrayOfWritePointers();
+    for (int start = 0; start < samples; start += kSubBlock)
+    {
+        float* block[2] { data[0] + start, channels > 1 ? data[1] + start : nullptr };
+        processSubBlock(block, channels, juce::jmin(kSubBlock, samples - start), settings);
+    }
+}
 
-    const auto low = dbToLin(params.lowGainDb.load());
-    const auto mid = dbToLin(params.midGainDb.load());
-    const auto high = dbToLin(params.highGainDb.load());
+void BuiltInProcessors::processSubBlock(float* const* channels, int numChannels, int numSamples, const Settings& settings) noexcept
+{
+    hpf.process(channels, numChannels, numSamples);
 
-    const auto compThresh = params.compThresholdDb.load();
-    const auto compRatio = juce::jmax(1.0f, params.compRatio.load());
-    const auto compMakeup = dbToLin(params.compMakeupDb.load());
-    const auto limiterCeil = dbToLin(params.limiterCeilDb.load());
+    // Gate.
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* data = channels[c];
+        auto level = gateEnv[static_cast<size_t>(c)];
+        for (int i = 0; i < numSamples; ++i)
+        {
+            level = 0.995f * level + 0.005f * std::abs(data[i]);
+            envelope[static_cast<size_t>(i)] = level;
+        }
+        gateEnv[static_cast<size_t>(c)] = level;
+
+        simd::thresholdGain(gain.data(), envelope.data(), kEnvelopeFloor, settings.gateInvThreshold, settings.gateExponent, numSamples);
+        for (int i = 0; i < numSamples; ++i)
+            data[i] *= gain[static_cast<size_t>(i)];
+    }
 
-    for (int c = 0; c < channels; ++c)
+    // De-esser, keyed on the gated signal's top end.
+    float* bands[2] { sidechain[0].data(), sidechain[1].data() };
+    deEss.process(channels, bands, numChannels, numSamples);
+    for (int c = 0; c < numChannels; ++c)
     {
-        hpf[static_cast<size_t>(c)].setHighPass(static_cast<float>(sr), hpfHz);
-        auto* data = buffer.getWritePointer(c);
+        auto* data = channels[c];
+        const auto* band = bands[c];
+        for (int i = 0; i < numSamples; ++i)
+            data[i] *= juce::jlimit(0.5f, 1.0f, 1.0f - std::abs(band[i]) * settings.deEssDepth);
+    }
+
+    eq.process(channels, numChannels, numSamples);
 
-        for (int i = 0; i < samples; ++i)
+    // Compressor and makeup.
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* data = channels[c];
+        auto level = compEnv[static_cast<size_t>(c)];
+        for (int i = 0; i < numSamples; ++i)
         {
-            auto x = hpf[static_cast<size_t>(c)].process(data[i]);
-
-            const auto absx = std::abs(x);
-            gateEnv[static_cast<size_t>(c)] = 0.995f * gateEnv[static_cast<size_t>(c)] + 0.005f * absx;
-            const auto gateDb = linToDb(gateEnv[static_cast<size_t>(c)]);
-            float gateGain = 1.0f;
-            if (gateDb < gateThresh)
-            {
-                const auto delta = gateThresh - gateDb;
-                gateGain = dbToLin(-delta * (1.0f - (1.0f / gateRatio)));
-            }
-            x *= gateGain;
-
-            const auto sibilance = std::abs(deEss[static_cast<size_t>(c)].process(x));
-            const auto deEssGain = juce::jlimit(0.5f, 1.0f, 1.0f - (sibilance * deEssAmount * 0.8f));
-            x *= deEssGain;
-
-            const auto lowMid = x * low;
-            const auto midBand = x * mid;
-            const auto highBand = x * high;
-            x = (lowMid + midBand + highBand) * (1.0f / 3.0f);
-
-            const auto level = std::abs(x);
-            const auto atk = 0.01f;
-            const auto rel = 0.001f;
-            compEnv[static_cast<size_t>(c)] = juce::jmax(level, compEnv[static_cast<size_t>(c)] * (1.0f - rel) + level * rel);
-            const auto levelDb = linToDb(compEnv[static_cast<size_t>(c)]);
-
-            float compGain = 1.0f;
-            if (levelDb > compThresh)
-            {
-                const auto over = levelDb - compThresh;
-                const auto reduced = over - (over / compRatio);
-                compGain = dbToLin(-reduced * (1.0f - atk));
-            }
-
-            x *= compGain;
-            x *= compMakeup;
-            x = juce::jlimit(-limiterCeil, limiterCeil, x);
-
-            if (params.mute.load())
-                x = 0.0f;
-
-            data[i] = x;
+            const auto x = std::abs(data[i]);
+            level = juce::jmax(x, level * (1.0f - kCompRelease) + x * kCompRelease);
+            envelope[static_cast<size_t>(i)] = level;
         }
+        compEnv[static_cast<size_t>(c)] = level;
+
+        simd::thresholdGain(gain.data(), envelope.data(), kEnvelopeFloor, settings.compInvThreshold, settings.compExponent, numSamples);
+        for (int i = 0; i < numSamples; ++i)
+            data[i] *= gain[static_cast<size_t>(i)] * settings.makeup;
     }
 }
 }
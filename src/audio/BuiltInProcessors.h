@@ -1,25 +1,60 @@
 #pragma once
 
-#include "Biquad.h"
+#include "BiquadCascade.h"
 #include "../AppConfig.h"
 
 namespace fizzle
 {
+// Built-in voice strip: high-pass, gate, de-esser, EQ and compressor. The limiter that
+// follows it is a separate stage of ProcessorChain.
+//
+// Parameters are read once per block. Work is done in sub-blocks: the filters run both
+// channels together in SIMD lanes, the envelope followers run per sample, and the gain
+// curves, which need a log and an exp, are evaluated for the whole sub-block with
+// vector kernels.
 class BuiltInProcessors
 {
 public:
     void prepare(double sampleRate, int channels);
     void reset();
-    void process(juce::AudioBuffer<float>& buffer, const EffectParameters& params);
+
+    // Realtime safe. Processes up to two channels in place.
+    void process(juce::AudioBuffer<float>& buffer, const EffectParameters& params) noexcept;
 
 private:
+    static constexpr int kSubBlock = 64;
+
+    // One block's worth of parameters, already turned into linear-domain constants.
+    struct Settings
+    {
+        float hpfHz { 80.0f };
+        float gateInvThreshold { 1.0f };
+        float gateExponent { 0.0f };
+        float deEssDepth { 0.0f };
+        float lowGainDb { 0.0f };
+        float midGainDb { 0.0f };
+        float highGainDb { 0.0f };
+        float compInvThreshold { 1.0f };
+        float compExponent { 0.0f };
+        float makeup { 1.0f };
+    };
+
     double sr { kInternalSampleRate };
-    std::array<Biquad, 2> hpf;
-    std::array<Biquad, 2> deEss;
+    // The filter settings last designed, so coefficients are only recomputed on a change.
+    // A negative cutoff means the filters have not been set up since prepare().
+    float hpfCutoff { -1.0f };
+    std::array<float, 3> eqGainsDb {};
+    BiquadCascade<1> hpf;
+    BiquadCascade<1> deEss;
+    BiquadCascade<3> eq;
     std::array<float, 2> gateEnv { 0.0f, 0.0f };
     std::array<float, 2> compEnv { 0.0f, 0.0f };
+    std::array<float, kSubBlock> envelope {};
+    std::array<float, kSubBlock> gain {};
+    std::array<std::array<float, kSubBlock>, 2> sidechain {};
 
-    static float dbToLin(float db);
-    static float linToDb(float lin);
+    static Settings snapshot(const EffectParameters& params) noexcept;
+    void updateFilters(const Settings& settings) noexcept;
+    void processSubBlock(float* const* channels, int numChannels, int numSamples, const Settings& settings) noexcept;
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,215 @@
+#include "DriftCompensator.h"
+#include <cmath>
+#include <cstring>
+
+namespace fizzle
+{
+namespace
+{
+// Proportional gain per sample of depth error, integral gain per sample-second.
+constexpr double kProportionalGain = 2.0e-5;
+constexpr double kIntegralGain = 4.0e-6;
+constexpr double kMaxCorrection = 2.0e-3;
+constexpr double kMaxIntegral = 1.0e-3;
+constexpr double kLevelTimeConstantSeconds = 0.5;
+constexpr double kDriftReportTimeConstantSeconds = 8.0;
+
+inline float hermite(float x0, float x1, float x2, float x3, float t) noexcept
+{
+    const auto c1 = 0.5f * (x2 - x0);
+    const auto c2 = x0 - 2.5f * x1 + 2.0f * x2 - 0.5f * x3;
+    const auto c3 = 0.5f * (x3 - x0) + 1.5f * (x1 - x2);
+    return ((c3 * t + c2) * t + c1) * t + x1;
+}
+}
+
+void DriftCompensator::prepare(double producerRate, double consumerRate, int producerBlock, int consumerBlock)
+{
+    producerRateHz = producerRate > 1000.0 ? producerRate : 48000.0;
+    consumerRateHz = consumerRate > 1000.0 ? consumerRate : producerRateHz;
+    producerBlockSize = juce::jmax(1, producerBlock);
+    const auto safeConsumerBlock = juce::jmax(1, consumerBlock);
+    nominalStep = producerRateHz / consumerRateHz;
+    retarget(safeConsumerBlock);
+
+    // Drivers can deliver more than they announce, so work holds the same worst case the
+    // signal path is prepared for; anything longer still is rendered in several passes.
+    maxChunk = juce::jmax(2 * safeConsumerBlock, 2048);
+    const auto maxRead = static_cast<int>(std::ceil(static_cast<double>(maxChunk) * nominalStep * (1.0 + kMaxCorrection))) + kInterpolatorTaps + 2;
+    work.setSize(kChannels, maxRead + kInterpolatorTaps, false, true, false);
+    reset();
+}
+
+void DriftCompensator::retarget(int consumerBlock) noexcept
+{
+    targetBlock = consumerBlock;
+    blockSeconds = static_cast<double>(consumerBlock) / consumerRateHz;
+    levelSmoothing = 1.0 - std::exp(-blockSeconds / kLevelTimeConstantSeconds);
+    driftSmoothing = 1.0 - std::exp(-blockSeconds / kDriftReportTimeConstantSeconds);
+
+    // Depth at the consumer's read point swings by one producer block, so aim for a
+    // consumer block plus one producer block plus a little headroom.
+    const auto consumed = static_cast<double>(consumerBlock) * nominalStep;
+    targetQueue = consumed + static_cast<double>(producerBlockSize) + 16.0;
+    resyncThreshold = targetQueue + 4.0 * juce::jmax(consumed, static_cast<double>(producerBlockSize));
+}
+
+void DriftCompensator::reset()
+{
+    filling = true;
+    filteredQueue = targetQueue;
+    integral = 0.0;
+    position = 0.0;
+    pending = 0;
+    work.clear();
+    driftPpm.store(0.0, std::memory_order_relaxed);
+    queueMs.store(0.0, std::memory_order_relaxed);
+}
+
+void DriftCompensator::silence(float* const* output, int numOutputChannels, int offset, int numSamples) noexcept
+{
+    for (int c = 0; c < numOutputChannels; ++c)
+        if (output[c] != nullptr)
+            juce::FloatVectorOperations::clear(output[c] + offset, numSamples);
+}
+
+void DriftCompensator::discard(juce::AbstractFifo& fifo, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    fifo.finishedRead(size1 + size2);
+}
+
+bool DriftCompensator::readInto(juce::AbstractFifo& fifo, const juce::AudioBuffer<float>& fifoBuffer, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return true;
+
+    if (pending + numSamples > work.getNumSamples() || fifo.getNumReady() < numSamples)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    for (int c = 0; c < kChannels; ++c)
+    {
+        const auto* src = fifoBuffer.getReadPointer(juce::jmin(c, fifoBuffer.getNumChannels() - 1));
+        auto* dst = work.getWritePointer(c, pending);
+        if (size1 > 0)
+            juce::FloatVectorOperations::copy(dst, src + start1, size1);
+        if (size2 > 0)
+            juce::FloatVectorOperations::copy(dst + size1, src + start2, size2);
+    }
+    fifo.finishedRead(size1 + size2);
+    pending += size1 + size2;
+    return true;
+}
+
+void DriftCompensator::process(juce::AbstractFifo& fifo,
+                               const juce::AudioBuffer<float>& fifoBuffer,
+                               float* const* output,
+                               int numOutputChannels,
+                               int numSamples) noexcept
+{
+    if (output == nullptr || numSamples <= 0)
+        return;
+
+    if (numSamples > targetBlock)
+    {
+        // The queue was sized for shorter blocks and would run dry on every one of these.
+        retarget(numSamples);
+        filling = true;
+        pending = 0;
+        position = 0.0;
+    }
+
+    const auto queued = static_cast<double>(fifo.getNumReady() + pending);
+    queueMs.store(1000.0 * queued / producerRateHz, std::memory_order_relaxed);
+
+    if (filling)
+    {
+        if (queued < targetQueue)
+        {
+            silence(output, numOutputChannels, 0, numSamples);
+            return;
+        }
+
+        discard(fifo, static_cast<int>(queued - targetQueue));
+        filteredQueue = targetQueue;
+        filling = false;
+    }
+    else if (queued > resyncThreshold)
+    {
+        // A stall on either side left far too much queued; jump back to the target
+        // once rather than spending seconds pitching it away.
+        discard(fifo, static_cast<int>(queued - targetQueue));
+        filteredQueue = targetQueue;
+        resyncs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    filteredQueue += levelSmoothing * (static_cast<double>(fifo.getNumReady() + pending) - filteredQueue);
+    const auto error = filteredQueue - targetQueue;
+    integral = juce::jlimit(-kMaxIntegral, kMaxIntegral, integral + kIntegralGain * error * blockSeconds);
+    const auto correction = juce::jlimit(-kMaxCorrection, kMaxCorrection, kProportionalGain * error + integral);
+    const auto step = nominalStep * (1.0 + correction);
+
+    for (int offset = 0; offset < numSamples; offset += maxChunk)
+    {
+        const auto chunk = juce::jmin(maxChunk, numSamples - offset);
+        if (! render(fifo, fifoBuffer, output, numOutputChannels, offset, chunk, step))
+        {
+            silence(output, numOutputChannels, offset, numSamples - offset);
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            filling = true;
+            pending = 0;
+            position = 0.0;
+            return;
+        }
+    }
+
+    // The applied correction averages out to the clock mismatch once the depth holds.
+    const auto reported = driftPpm.load(std::memory_order_relaxed);
+    driftPpm.store(reported + driftSmoothing * (correction * 1.0e6 - reported), std::memory_order_relaxed);
+}
+
+bool DriftCompensator::render(juce::AbstractFifo& fifo,
+                              const juce::AudioBuffer<float>& fifoBuffer,
+                              float* const* output,
+                              int numOutputChannels,
+                              int offset,
+                              int numSamples,
+                              double step) noexcept
+{
+    const auto lastPosition = position + step * static_cast<double>(numSamples - 1);
+    const auto needed = static_cast<int>(lastPosition) + kInterpolatorTaps;
+    if (! readInto(fifo, fifoBuffer, needed - pending))
+        return false;
+
+    for (int c = 0; c < numOutputChannels; ++c)
+    {
+        if (output[c] == nullptr)
+            continue;
+
+        const auto* w = work.getReadPointer(juce::jmin(c, kChannels - 1));
+        auto* out = output[c] + offset;
+        auto pos = position;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto index = static_cast<int>(pos);
+            const auto t = static_cast<float>(pos - static_cast<double>(index));
+            out[i] = hermite(w[index], w[index + 1], w[index + 2], w[index + 3], t);
+            pos += step;
+        }
+    }
+
+    const auto endPosition = position + step * static_cast<double>(numSamples);
+    const auto advance = juce::jmin(pending, static_cast<int>(endPosition));
+    position = endPosition - static_cast<double>(advance);
+    pending -= advance;
+    for (int c = 0; c < kChannels; ++c)
+    {
+        auto* w = work.getWritePointer(c);
+        std::memmove(w, w + advance, sizeof(float) * static_cast<size_t>(pending));
+    }
+    return true;
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+namespace fizzle
+{
+// Drains a FIFO that is filled by one device clock from a callback driven by another.
+//
+// A PI controller watches the low-passed queue depth and nudges the read ratio of a
+// cubic fractional resampler so the depth settles on a small fixed target instead
+// of drifting until it has to drop or repeat whole blocks. Once settled the mean
+// correction equals the relative clock drift, which is reported in parts per million.
+class DriftCompensator
+{
+public:
+    // All rates in Hz, block sizes in samples of the respective device. Not realtime safe.
+    // The consumer block is what the device announced; process() copes with longer ones.
+    void prepare(double producerRate, double consumerRate, int producerBlock, int consumerBlock);
+    void reset();
+
+    // Writes exactly numSamples to every non-null output channel, reading stereo
+    // frames from fifo/fifoBuffer. Outputs silence while (re)filling to the target. A
+    // block longer than any before raises the target to suit it and refills once.
+    void process(juce::AbstractFifo& fifo,
+                 const juce::AudioBuffer<float>& fifoBuffer,
+                 float* const* output,
+                 int numOutputChannels,
+                 int numSamples) noexcept;
+
+    double getDriftPpm() const noexcept { return driftPpm.load(std::memory_order_relaxed); }
+    double getQueueMs() const noexcept { return queueMs.load(std::memory_order_relaxed); }
+    uint64_t getUnderrunCount() const noexcept { return underruns.load(std::memory_order_relaxed); }
+    uint64_t getResyncCount() const noexcept { return resyncs.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kChannels = 2;
+    static constexpr int kInterpolatorTaps = 4;
+
+    double producerRateHz { 0.0 };
+    double consumerRateHz { 0.0 };
+    int producerBlockSize { 1 };
+    int targetBlock { 1 }; // longest consumer block the target and time constants are set for
+    int maxChunk { 1 }; // longest run one pass through work can produce
+    double nominalStep { 1.0 };
+    double targetQueue { 0.0 };
+    double resyncThreshold { 0.0 };
+    double blockSeconds { 0.0 };
+    double levelSmoothing { 0.0 };
+    double driftSmoothing { 0.0 };
+
+    bool filling { true };
+    double filteredQueue { 0.0 };
+    double integral { 0.0 };
+    double position { 0.0 };
+
+    juce::AudioBuffer<float> work;
+    int pending { 0 };
+
+    std::atomic<double> driftPpm { 0.0 };
+    std::atomic<double> queueMs { 0.0 };
+    std::atomic<uint64_t> underruns { 0 };
+    std::atomic<uint64_t> resyncs { 0 };
+
+    void retarget(int consumerBlock) noexcept;
+    void discard(juce::AbstractFifo& fifo, int numSamples) noexcept;
+    bool readInto(juce::AbstractFifo& fifo, const juce::AudioBuffer<float>& fifoBuffer, int numSamples) noexcept;
+    bool render(juce::AbstractFifo& fifo,
+                const juce::AudioBuffer<float>& fifoBuffer,
+                float* const* output,
+                int numOutputChannels,
+                int offset,
+                int numSamples,
+                double step) noexcept;
+    static void silence(float* const* output, int numOutputChannels, int offset, int numSamples) noexcept;
+};
+}
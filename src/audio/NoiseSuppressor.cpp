@@ -0,0 +1,208 @@
+#include "NoiseSuppressor.h"
+#include "SimdKernels.h"
+#include <limits>
+
+namespace fizzle
+{
+namespace
+{
+constexpr double kPowerSmoothingSeconds = 0.02;
+constexpr double kMinimumWindowSeconds = 1.5;
+constexpr double kGainRiseSeconds = 0.002;
+constexpr double kGainFallSeconds = 0.05;
+// The minimum of the smoothed power sits well under the noise's mean power, so the
+// estimate is scaled back up before it is subtracted.
+constexpr float kOverSubtraction = 2.5f;
+// Smoothed powers below this are flushed to zero so long silences cannot decay into
+// denormals; the same value keeps the gain curve's division finite.
+constexpr float kPowerFloor = 1.0e-20f;
+
+float frameCoefficient(double timeConstantSeconds, double hopSeconds)
+{
+    return static_cast<float>(1.0 - std::exp(-hopSeconds / timeConstantSeconds));
+}
+}
+
+void NoiseSuppressor::prepare(double sampleRate, int numChannels)
+{
+    const auto order = sampleRate > 64000.0 ? 9 : 8;
+    fft = std::make_unique<juce::dsp::FFT>(order);
+    frameSize = 1 << order;
+    hopSize = frameSize / 4;
+    numBins = frameSize / 2 + 1;
+    paddedBins = (numBins + 3) & ~3;
+    channels = juce::jlimit(0, kMaxChannels, numChannels);
+
+    const auto hopSeconds = static_cast<double>(hopSize) / sampleRate;
+    powerSmoothing = frameCoefficient(kPowerSmoothingSeconds, hopSeconds);
+    gainRise = frameCoefficient(kGainRiseSeconds, hopSeconds);
+    gainFall = frameCoefficient(kGainFallSeconds, hopSeconds);
+    gainFloor = juce::Decibels::decibelsToGain(-kMaxReductionDb);
+    subWindowFrames = juce::jmax(1, juce::roundToInt(kMinimumWindowSeconds / (kMinimumSubWindows * hopSeconds)));
+
+    // Periodic square-root Hann on both sides: the products are Hann windows, and four of
+    // those overlapping at a quarter-frame hop sum to 2.
+    analysisWindow.resize(static_cast<size_t>(frameSize));
+    synthesisWindow.resize(static_cast<size_t>(frameSize));
+    for (int i = 0; i < frameSize; ++i)
+    {
+        const auto w = std::sqrt(0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / frameSize));
+        analysisWindow[static_cast<size_t>(i)] = static_cast<float>(w);
+        synthesisWindow[static_cast<size_t>(i)] = static_cast<float>(0.5 * w);
+    }
+
+    spectrum.assign(static_cast<size_t>(2 * frameSize), 0.0f);
+    framePower.assign(static_cast<size_t>(paddedBins), 0.0f);
+    for (auto& channel : state)
+    {
+        channel.input.assign(static_cast<size_t>(frameSize), 0.0f);
+        channel.output.assign(static_cast<size_t>(frameSize), 0.0f);
+        channel.smoothedPower.assign(static_cast<size_t>(paddedBins), 0.0f);
+        channel.currentMinimum.assign(static_cast<size_t>(paddedBins), 0.0f);
+        channel.pastMinimum.assign(static_cast<size_t>(paddedBins), 0.0f);
+        for (auto& minima : channel.subWindowMinima)
+            minima.assign(static_cast<size_t>(paddedBins), 0.0f);
+        channel.gain.assign(static_cast<size_t>(paddedBins), 1.0f);
+    }
+    reset();
+}
+
+void NoiseSuppressor::reset() noexcept
+{
+    constexpr auto unknown = std::numeric_limits<float>::max();
+    hopPosition = 0;
+    subWindowFrame = 0;
+    subWindowIndex = 0;
+    warmupFrames = frameSize / juce::jmax(1, hopSize);
+    for (auto& channel : state)
+    {
+        std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+        std::fill(channel.smoothedPower.begin(), channel.smoothedPower.end(), 0.0f);
+        std::fill(channel.currentMinimum.begin(), channel.currentMinimum.end(), unknown);
+        std::fill(channel.pastMinimum.begin(), channel.pastMinimum.end(), unknown);
+        for (auto& minima : channel.subWindowMinima)
+            std::fill(minima.begin(), minima.end(), unknown);
+        std::fill(channel.gain.begin(), channel.gain.end(), 1.0f);
+    }
+}
+
+void NoiseSuppressor::process(float* const* audio, int numChannels, int numSamples) noexcept
+{
+    const auto active = juce::jmin(numChannels, channels);
+    if (active <= 0 || fft == nullptr)
+        return;
+
+    // Input goes into the newest hop of each frame while the finished output of the
+    // frames before it is read out from the same positions.
+    const auto newest = frameSize - hopSize;
+    for (int done = 0; done < numSamples;)
+    {
+        const auto todo = juce::jmin(hopSize - hopPosition, numSamples - done);
+        for (int c = 0; c < active; ++c)
+        {
+            auto& channel = state[static_cast<size_t>(c)];
+            auto* io = audio[c] + done;
+            std::copy(io, io + todo, channel.input.data() + newest + hopPosition);
+            std::copy(channel.output.data() + hopPosition, channel.output.data() + hopPosition + todo, io);
+        }
+
+        done += todo;
+        hopPosition += todo;
+        if (hopPosition == hopSize)
+        {
+            hopPosition = 0;
+            for (int c = 0; c < active; ++c)
+                processFrame(state[static_cast<size_t>(c)]);
+
+            if (warmupFrames > 0)
+                --warmupFrames;
+            else if (++subWindowFrame == subWindowFrames)
+                endSubWindow();
+        }
+    }
+}
+
+void NoiseSuppressor::processFrame(Channel& channel) noexcept
+{
+    auto* data = spectrum.data();
+    juce::FloatVectorOperations::multiply(data, channel.input.data(), analysisWindow.data(), frameSize);
+    fft->performRealOnlyForwardTransform(data, true);
+
+    simd::complexPower(framePower.data(), data, numBins);
+    updateGains(channel);
+    simd::scaleComplex(data, channel.gain.data(), numBins);
+
+    fft->performRealOnlyInverseTransform(data);
+
+    // Drop the hop that has just been read out and add this frame on top of the rest.
+    auto& output = channel.output;
+    std::copy(output.begin() + hopSize, output.end(), output.begin());
+    std::fill(output.end() - hopSize, output.end(), 0.0f);
+    juce::FloatVectorOperations::addWithMultiply(output.data(), data, synthesisWindow.data(), frameSize);
+
+    std::copy(channel.input.begin() + hopSize, channel.input.end(), channel.input.begin());
+}
+
+void NoiseSuppressor::updateGains(Channel& channel) noexcept
+{
+    // Until the frames are full of real input, only seed the smoothed power: the zeros
+    // would otherwise pull the noise minimum down for a whole window.
+    if (warmupFrames > 0)
+    {
+        std::copy(framePower.begin(), framePower.end(), channel.smoothedPower.begin());
+        return;
+    }
+
+    using simd::Float4;
+    const auto smoothing = Float4::broadcast(powerSmoothing);
+    const auto overSubtraction = Float4::broadcast(kOverSubtraction);
+    const auto powerFloor = Float4::broadcast(kPowerFloor);
+    const auto floor = Float4::broadcast(gainFloor);
+    const auto one = Float4::broadcast(1.0f);
+    const auto zero = Float4::zero();
+    const auto rise = Float4::broadcast(gainRise);
+    const auto fall = Float4::broadcast(gainFall);
+
+    for (int k = 0; k < paddedBins; k += 4)
+    {
+        auto* smoothedPower = channel.smoothedPower.data() + k;
+        auto* currentMinimum = channel.currentMinimum.data() + k;
+        auto* gain = channel.gain.data() + k;
+
+        auto power = Float4::load(smoothedPower);
+        power = Float4::flushBelow(power + (Float4::load(framePower.data() + k) - power) * smoothing, kPowerFloor);
+        power.store(smoothedPower);
+
+        const auto minimum = Float4::min(Float4::load(currentMinimum), power);
+        minimum.store(currentMinimum);
+        const auto noise = Float4::min(minimum, Float4::load(channel.pastMinimum.data() + k));
+
+        const auto target = Float4::max(floor, one - overSubtraction * noise / (power + powerFloor));
+        const auto current = Float4::load(gain);
+        const auto change = target - current;
+        (current + Float4::max(change, zero) * rise + Float4::min(change, zero) * fall).store(gain);
+    }
+}
+
+void NoiseSuppressor::endSubWindow() noexcept
+{
+    // The oldest sub-window's minimum is replaced by the one just completed, and the
+    // running minimum starts over.
+    subWindowFrame = 0;
+    const auto slot = static_cast<size_t>(subWindowIndex);
+    subWindowIndex = (subWindowIndex + 1) % kMinimumSubWindows;
+    for (int c = 0; c < channels; ++c)
+    {
+        auto& channel = state[static_cast<size_t>(c)];
+        std::swap(channel.subWindowMinima[slot], channel.currentMinimum);
+        std::fill(channel.currentMinimum.begin(), channel.currentMinimum.end(), std::numeric_limits<float>::max());
+
+        auto& past = channel.pastMinimum;
+        std::copy(channel.subWindowMinima[0].begin(), channel.subWindowMinima[0].end(), past.begin());
+        for (size_t w = 1; w < channel.subWindowMinima.size(); ++w)
+            for (size_t k = 0; k < past.size(); ++k)
+                past[k] = std::min(past[k], channel.subWindowMinima[w][k]);
+    }
+}
+}
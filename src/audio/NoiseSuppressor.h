@@ -0,0 +1,85 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace fizzle
+{
+// Spectral noise suppressor for steady background noise: fans, hum, hiss.
+//
+// Each channel is analysed in overlapping frames (256 samples up to 48 kHz, 512 above,
+// hop of a quarter frame) under a square-root Hann window, and resynthesised with the
+// same window. Per bin, the power is smoothed over time and the noise floor is its
+// minimum over the last second and a half (minimum statistics: speech leaves gaps, the
+// noise does not), so a floor that rises is picked up within that time. The bin gain is
+// a spectral-subtraction curve clamped at kMaxReductionDb, smoothed between frames with
+// a fast rise and a slower fall so the residual noise does not warble.
+//
+// All buffers are allocated by prepare(); frames are processed as soon as a hop of input
+// has arrived, so the cost is the same whatever the block size.
+class NoiseSuppressor
+{
+public:
+    static constexpr float kMaxReductionDb = 18.0f;
+
+    // Builds the FFT and frame buffers. Not realtime safe.
+    void prepare(double sampleRate, int numChannels);
+    void reset() noexcept;
+
+    // Realtime safe. Processes up to the prepared number of channels in place. Output lags
+    // input by getLatencySamples().
+    void process(float* const* audio, int numChannels, int numSamples) noexcept;
+
+    // One frame, in samples at the prepared rate.
+    int getLatencySamples() const noexcept { return frameSize; }
+
+private:
+    static constexpr int kMaxChannels = 2;
+    // The noise minimum is taken over this many sub-windows, so it can be aged out one
+    // sub-window at a time.
+    static constexpr int kMinimumSubWindows = 4;
+
+    struct Channel
+    {
+        std::vector<float> input; // the last frameSize input samples
+        std::vector<float> output; // overlap-add of the frames still being output
+        // Per bin from here on, padded to a multiple of four.
+        std::vector<float> smoothedPower;
+        std::vector<float> currentMinimum; // over the sub-window in progress
+        std::vector<float> pastMinimum; // over the completed sub-windows
+        std::array<std::vector<float>, kMinimumSubWindows> subWindowMinima;
+        std::vector<float> gain;
+    };
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int channels { 0 };
+    int frameSize { 0 };
+    int hopSize { 0 };
+    int numBins { 0 };
+    int paddedBins { 0 };
+    int hopPosition { 0 };
+    int subWindowFrames { 1 };
+    int subWindowFrame { 0 };
+    int subWindowIndex { 0 };
+    // Frames still partly made of the silence the input started from.
+    int warmupFrames { 0 };
+
+    float powerSmoothing { 1.0f };
+    float gainRise { 1.0f };
+    float gainFall { 1.0f };
+    float gainFloor { 1.0f };
+
+    std::vector<float> analysisWindow;
+    std::vector<float> synthesisWindow;
+    // FFT workspace, 2 * frameSize floats, and the current frame's bin powers.
+    std::vector<float> spectrum;
+    std::vector<float> framePower;
+    std::array<Channel, kMaxChannels> state;
+
+    void processFrame(Channel& channel) noexcept;
+    void updateGains(Channel& channel) noexcept;
+    void endSubWindow() noexcept;
+};
+}
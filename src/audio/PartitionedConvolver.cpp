@@ -0,0 +1,621 @@
+#include "PartitionedConvolver.h"
+#include "Resampler.h"
+#include "SimdKernels.h"
+#include "../core/Tracer.h"
+#include <cmath>
+#include <thread>
+#include <utility>
+
+namespace fizzle
+{
+namespace
+{
+struct LevelLayout
+{
+    int blockSize;
+    int offset;
+    int end; // 0 on the last level, which takes the rest of the response
+};
+
+// Each background level starts at twice its partition size, which is what gives its
+// job a whole partition of time to finish, and ends at sixteen times it.
+constexpr std::array<LevelLayout, 5> kLayout {
+    { { 64, 64, 1024 }, { 512, 1024, 8192 }, { 4096, 8192, 65536 }, { 32768, 65536, 524288 }, { 262144, 524288, 0 } }
+};
+
+// JUCE's fallback FFT does its real-only transforms in place, through a scratch copy it
+// keeps on the stack up to 16384 points and allocates beyond. Larger transforms use the
+// out-of-place complex transform instead, which needs no scratch and costs the fallback
+// the same.
+constexpr int kLargestInPlaceFftOrder = 14;
+
+int fftOrderFor(int blockSize)
+{
+    auto order = 0;
+    while ((1 << order) < 2 * blockSize)
+        ++order;
+    return order;
+}
+
+// Converts a response to another rate. The taps are scaled by the rate ratio so the gain
+// stays the same: a converted unit impulse is spread over more or fewer samples.
+juce::AudioBuffer<float> convertRate(const juce::AudioBuffer<float>& taps, double fromRate, double toRate)
+{
+    if (fromRate <= 0.0 || std::abs(fromRate - toRate) < 1.0e-6)
+        return taps;
+
+    constexpr int chunk = 4096;
+    const auto numChannels = taps.getNumChannels();
+    Resampler resampler;
+    resampler.prepare(fromRate, toRate, numChannels, chunk, Resampler::Quality::high);
+
+    // The resampler starts with its history centred on the first input, so the output is
+    // already aligned; enough silence after the response flushes its end out.
+    juce::AudioBuffer<float> padded(numChannels, taps.getNumSamples() + resampler.getNumTaps() + 1);
+    padded.clear();
+    for (int c = 0; c < numChannels; ++c)
+        padded.copyFrom(c, 0, taps, c, 0, taps.getNumSamples());
+
+    const auto ratio = toRate / fromRate;
+    juce::AudioBuffer<float> converted(numChannels, static_cast<int>(std::ceil(padded.getNumSamples() * ratio)) + 2 * chunk);
+    auto written = 0;
+    for (int start = 0; start < padded.getNumSamples(); start += chunk)
+    {
+        std::array<const float*, 2> in {};
+        std::array<float*, 2> out {};
+        for (int c = 0; c < numChannels; ++c)
+        {
+            in[static_cast<size_t>(c)] = padded.getReadPointer(c, start);
+            out[static_cast<size_t>(c)] = converted.getWritePointer(c, written);
+        }
+        resampler.push(in.data(), numChannels, juce::jmin(chunk, padded.getNumSamples() - start));
+        written += resampler.pull(out.data(), numChannels, converted.getNumSamples() - written);
+    }
+
+    const auto length = juce::jlimit(0, written, juce::roundToInt(taps.getNumSamples() * ratio));
+    juce::AudioBuffer<float> result(numChannels, length);
+    for (int c = 0; c < numChannels; ++c)
+        result.copyFrom(c, 0, converted, c, 0, length);
+    result.applyGain(static_cast<float>(1.0 / ratio));
+    return result;
+}
+}
+
+class PartitionedConvolver::Worker final : public juce::Thread
+{
+public:
+    Worker(PartitionedConvolver& ownerRef, Level& levelRef)
+        : juce::Thread("Fizzle convolution"), owner(ownerRef), level(levelRef)
+    {
+    }
+
+    void run() override
+    {
+        Tracer::instance().nameCurrentThread("Convolution");
+        owner.workerLoop(*this, level);
+    }
+
+private:
+    PartitionedConvolver& owner;
+    Level& level;
+};
+
+PartitionedConvolver::PartitionedConvolver() = default;
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    for (size_t l = 0; l < workers.size(); ++l)
+    {
+        auto& worker = workers[l];
+        if (worker == nullptr)
+            continue;
+
+        worker->signalThreadShouldExit();
+        levels[l].wakeups.fetch_add(1, std::memory_order_release);
+        levels[l].wakeups.notify_all();
+        worker->stopThread(1000);
+    }
+
+    delete pendingResponse.exchange(nullptr);
+    delete retiredResponse.exchange(nullptr);
+    delete response;
+}
+
+void PartitionedConvolver::prepare(double newSampleRate, int numChannels)
+{
+    stopJobs();
+
+    const juce::ScopedLock sl(sourceLock);
+    sampleRate = newSampleRate;
+    channels = juce::jlimit(0, kMaxChannels, numChannels);
+    maxLength = juce::jmax(1, juce::roundToInt(kMaxImpulseSeconds * sampleRate));
+
+    numLevels = 0;
+    for (const auto& layout : kLayout)
+    {
+        if (layout.offset >= maxLength)
+            break;
+
+        auto& level = levels[static_cast<size_t>(numLevels)];
+        const auto blockSize = layout.blockSize;
+        const auto end = layout.end > 0 ? juce::jmin(layout.end, maxLength) : maxLength;
+        const auto order = fftOrderFor(blockSize);
+        level.blockSize = blockSize;
+        level.offset = layout.offset;
+        level.stride = (2 * (blockSize + 1) + 3) & ~3;
+        level.maxPartitions = (end - layout.offset + blockSize - 1) / blockSize;
+        level.background = numLevels > 0;
+        level.fft = std::make_unique<juce::dsp::FFT>(order);
+        level.workspace.assign(static_cast<size_t>(4 * blockSize), 0.0f);
+        level.scratch.assign(order > kLargestInPlaceFftOrder ? static_cast<size_t>(2 * blockSize) : 0, {});
+        level.sum.assign(static_cast<size_t>(level.stride), 0.0f);
+        level.newest = 0;
+        level.filled = 0;
+        for (auto& state : level.state)
+        {
+            state.input.assign(static_cast<size_t>(blockSize), 0.0f);
+            state.output.assign(static_cast<size_t>(blockSize), 0.0f);
+            state.pending.assign(static_cast<size_t>(blockSize), 0.0f);
+            state.last.assign(static_cast<size_t>(blockSize), 0.0f);
+            state.history.assign(static_cast<size_t>(level.maxPartitions * level.stride), 0.0f);
+            state.result.assign(static_cast<size_t>(blockSize), 0.0f);
+        }
+        ++numLevels;
+    }
+
+    for (auto& input : headInput)
+        input.assign(static_cast<size_t>(2 * kHeadLength - 1), 0.0f);
+
+    // Nothing is processed during prepare(), so the current response is swapped directly.
+    delete pendingResponse.exchange(nullptr);
+    delete retiredResponse.exchange(nullptr);
+    delete response;
+    response = buildResponse().release();
+    restartLevels();
+    startWorkersIfNeeded();
+}
+
+void PartitionedConvolver::startWorkersIfNeeded()
+{
+    if (source.getNumSamples() == 0)
+        return;
+
+    for (int l = 1; l < numLevels; ++l)
+    {
+        auto& worker = workers[static_cast<size_t>(l)];
+        if (worker != nullptr)
+            continue;
+
+        worker = std::make_unique<Worker>(*this, levels[static_cast<size_t>(l)]);
+        if (! worker->startRealtimeThread(juce::Thread::RealtimeOptions {}.withPriority(8)))
+            worker->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    restartLevels();
+}
+
+void PartitionedConvolver::restartLevels() noexcept
+{
+    position = 0;
+    for (auto& level : levels)
+    {
+        auto expected = static_cast<int>(queued);
+        level.job.compare_exchange_strong(expected, idle, std::memory_order_acquire, std::memory_order_relaxed);
+        level.awaiting = false;
+        level.live = false;
+        level.lostWindows = 0;
+        level.restartPending = true;
+        for (auto& state : level.state)
+        {
+            std::fill(state.input.begin(), state.input.end(), 0.0f);
+            std::fill(state.output.begin(), state.output.end(), 0.0f);
+        }
+    }
+    for (auto& input : headInput)
+        std::fill(input.begin(), input.end(), 0.0f);
+}
+
+void PartitionedConvolver::stopJobs() noexcept
+{
+    for (auto& level : levels)
+    {
+        auto expected = static_cast<int>(queued);
+        level.job.compare_exchange_strong(expected, idle, std::memory_order_acquire, std::memory_order_relaxed);
+        while (level.job.load(std::memory_order_acquire) != idle)
+            std::this_thread::yield();
+        level.awaiting = false;
+    }
+}
+
+void PartitionedConvolver::setImpulseResponse(const juce::AudioBuffer<float>& newResponse, double responseSampleRate)
+{
+    const juce::ScopedLock sl(sourceLock);
+    auto length = newResponse.getNumSamples();
+    if (responseSampleRate > 0.0)
+        length = juce::jmin(length, juce::roundToInt(kMaxImpulseSeconds * responseSampleRate));
+
+    const auto numChannels = juce::jmin(kMaxChannels, newResponse.getNumChannels());
+    source.setSize(numChannels, numChannels > 0 ? length : 0);
+    for (int c = 0; c < numChannels; ++c)
+        source.copyFrom(c, 0, newResponse, c, 0, length);
+    sourceRate = responseSampleRate;
+
+    if (sampleRate > 0.0)
+    {
+        startWorkersIfNeeded();
+        publish(buildResponse());
+    }
+}
+
+bool PartitionedConvolver::hasImpulseResponse() const
+{
+    const juce::ScopedLock sl(sourceLock);
+    return source.getNumSamples() > 0;
+}
+
+std::unique_ptr<PartitionedConvolver::Response> PartitionedConvolver::buildResponse() const
+{
+    auto next = std::make_unique<Response>();
+    if (source.getNumSamples() == 0 || source.getNumChannels() == 0 || sampleRate <= 0.0)
+        return next;
+
+    const auto taps = convertRate(source, sourceRate, sampleRate);
+    next->length = juce::jmin(taps.getNumSamples(), maxLength);
+    next->channels = taps.getNumChannels();
+
+    for (int c = 0; c < next->channels; ++c)
+    {
+        auto& head = next->head[static_cast<size_t>(c)];
+        head.assign(static_cast<size_t>(kHeadLength), 0.0f);
+        for (int i = 0; i < juce::jmin(kHeadLength, next->length); ++i)
+            head[static_cast<size_t>(kHeadLength - 1 - i)] = taps.getSample(c, i);
+    }
+
+    for (int l = 0; l < numLevels; ++l)
+    {
+        const auto& level = levels[static_cast<size_t>(l)];
+        const auto blockSize = level.blockSize;
+        const auto remaining = next->length - level.offset;
+        const auto partitions = remaining > 0 ? juce::jmin(level.maxPartitions, (remaining + blockSize - 1) / blockSize) : 0;
+        next->partitions[static_cast<size_t>(l)] = partitions;
+        if (partitions == 0)
+            continue;
+
+        // A separate FFT, so building never touches what the audio thread is using.
+        juce::dsp::FFT fft(fftOrderFor(blockSize));
+        std::vector<float> workspace(static_cast<size_t>(4 * blockSize));
+        for (int c = 0; c < next->channels; ++c)
+        {
+            auto& spectra = next->spectra[static_cast<size_t>(l)][static_cast<size_t>(c)];
+            spectra.assign(static_cast<size_t>(partitions * level.stride), 0.0f);
+            for (int k = 0; k < partitions; ++k)
+            {
+                const auto start = level.offset + k * blockSize;
+                std::fill(workspace.begin(), workspace.end(), 0.0f);
+                const auto* partition = taps.getReadPointer(c, start);
+                std::copy(partition, partition + juce::jmin(blockSize, next->length - start), workspace.begin());
+                fft.performRealOnlyForwardTransform(workspace.data(), true);
+                std::copy(workspace.begin(), workspace.begin() + 2 * (blockSize + 1), spectra.begin() + k * level.stride);
+            }
+        }
+    }
+    return next;
+}
+
+void PartitionedConvolver::publish(std::unique_ptr<Response> next)
+{
+    delete retiredResponse.exchange(nullptr, std::memory_order_acq_rel);
+    delete pendingResponse.exchange(next.release(), std::memory_order_acq_rel);
+}
+
+bool PartitionedConvolver::adoptPendingResponse() noexcept
+{
+    // The response being replaced needs the retired slot, which the setting thread
+    // empties on its next call.
+    if (pendingResponse.load(std::memory_order_relaxed) == nullptr || retiredResponse.load(std::memory_order_relaxed) != nullptr)
+        return false;
+
+    auto* next = pendingResponse.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+        return false;
+
+    retiredResponse.store(response, std::memory_order_release);
+    response = next;
+    return true;
+}
+
+void PartitionedConvolver::process(float* const* audio, int numChannels, int numSamples) noexcept
+{
+    const auto active = juce::jmin(numChannels, channels);
+    if (active <= 0 || numLevels == 0)
+        return;
+
+    // Without a response nothing is queued, so a new one can be taken straight away.
+    if (response == nullptr || response->length == 0)
+    {
+        if (! adoptPendingResponse() || response->length == 0)
+            return;
+        restartLevels();
+    }
+
+    // Runs end on every 64-sample boundary, which all levels' blocks line up with.
+    for (int done = 0; done < numSamples;)
+    {
+        const auto run = juce::jmin(kHeadLength - static_cast<int>(position % kHeadLength), numSamples - done);
+        for (int c = 0; c < active; ++c)
+        {
+            auto* io = audio[c] + done;
+            auto* history = headInput[static_cast<size_t>(c)].data();
+            std::copy(io, io + run, history + kHeadLength - 1);
+            for (int l = 0; l < numLevels; ++l)
+            {
+                auto& level = levels[static_cast<size_t>(l)];
+                std::copy(io, io + run, level.state[static_cast<size_t>(c)].input.data() + position % level.blockSize);
+            }
+
+            const auto* taps = response->head[static_cast<size_t>(juce::jmin(c, response->channels - 1))].data();
+            for (int i = 0; i < run; ++i)
+                io[i] = simd::dotProduct(taps, history + i, kHeadLength);
+
+            for (int l = 0; l < numLevels; ++l)
+            {
+                auto& level = levels[static_cast<size_t>(l)];
+                if (level.live)
+                    juce::FloatVectorOperations::add(io, level.state[static_cast<size_t>(c)].output.data() + position % level.blockSize, run);
+            }
+
+            std::copy(history + run, history + run + kHeadLength - 1, history);
+        }
+
+        done += run;
+        position += run;
+        if (position % kHeadLength == 0)
+        {
+            endBlocks();
+            // The response was removed; the rest passes through.
+            if (response->length == 0)
+                return;
+        }
+    }
+}
+
+void PartitionedConvolver::endBlocks() noexcept
+{
+    // What the background levels computed from the previous block is due now.
+    for (int l = 1; l < numLevels; ++l)
+    {
+        auto& level = levels[static_cast<size_t>(l)];
+        if (position % level.blockSize == 0)
+            collectJob(level);
+    }
+
+    // A job that is queued or running still reads the current response.
+    if (pendingResponse.load(std::memory_order_relaxed) != nullptr && ! isAnyJobInFlight())
+    {
+        adoptPendingResponse();
+        if (response->length == 0)
+            return;
+    }
+
+    for (int l = 0; l < numLevels; ++l)
+    {
+        auto& level = levels[static_cast<size_t>(l)];
+        if (position % level.blockSize == 0)
+            startJob(level);
+    }
+}
+
+bool PartitionedConvolver::isAnyJobInFlight() const noexcept
+{
+    for (int l = 1; l < numLevels; ++l)
+        if (levels[static_cast<size_t>(l)].job.load(std::memory_order_acquire) != idle)
+            return true;
+    return false;
+}
+
+void PartitionedConvolver::collectJob(Level& level) noexcept
+{
+    level.live = false;
+    if (! level.awaiting)
+        return;
+    level.awaiting = false;
+
+    if (level.job.load(std::memory_order_acquire) != idle)
+    {
+        if (! nonRealtime.load(std::memory_order_relaxed))
+        {
+            // Late: the level is left out of the coming block. A job no thread has started
+            // is taken back, and its window counts as lost.
+            auto expected = static_cast<int>(queued);
+            if (level.job.compare_exchange_strong(expected, idle, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                level.restartPending = level.restartPending || level.restart;
+                level.lostWindows += level.skippedWindows + 1;
+            }
+            countMissedBlock();
+            return;
+        }
+
+        // No clock to keep up with: run the job here if no thread has started it,
+        // otherwise wait for it.
+        claimJob(level);
+        while (level.job.load(std::memory_order_acquire) != idle)
+            std::this_thread::yield();
+    }
+
+    for (int c = 0; c < channels; ++c)
+        std::swap(level.state[static_cast<size_t>(c)].result, level.state[static_cast<size_t>(c)].output);
+    level.live = true;
+}
+
+void PartitionedConvolver::startJob(Level& level) noexcept
+{
+    const auto index = static_cast<size_t>(&level - levels.data());
+    if (response->partitions[index] == 0)
+    {
+        // Nothing to convolve here; the level starts from silence when a response needs it.
+        level.live = false;
+        level.restartPending = true;
+        level.lostWindows = 0;
+        return;
+    }
+
+    if (level.job.load(std::memory_order_acquire) != idle)
+    {
+        // A late job still owns the level, so this block gets no window of its own and
+        // the level is left out of the next one too.
+        ++level.lostWindows;
+        countMissedBlock();
+        return;
+    }
+
+    // The collected block goes to the job, which owns it from here.
+    for (int c = 0; c < channels; ++c)
+        std::swap(level.state[static_cast<size_t>(c)].input, level.state[static_cast<size_t>(c)].pending);
+    level.response = response;
+    level.restart = std::exchange(level.restartPending, false);
+    level.skippedWindows = std::exchange(level.lostWindows, 0);
+
+    if (! level.background)
+    {
+        runJob(level);
+        for (int c = 0; c < channels; ++c)
+            std::swap(level.state[static_cast<size_t>(c)].result, level.state[static_cast<size_t>(c)].output);
+        level.live = true;
+        return;
+    }
+
+    level.job.store(queued, std::memory_order_release);
+    level.awaiting = true;
+    level.wakeups.fetch_add(1, std::memory_order_release);
+    level.wakeups.notify_one();
+}
+
+void PartitionedConvolver::countMissedBlock() noexcept
+{
+    missedBlocks.store(missedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void PartitionedConvolver::runJob(Level& level) noexcept
+{
+    const auto index = static_cast<size_t>(&level - levels.data());
+    const auto partitions = level.response->partitions[index];
+    const auto blockSize = level.blockSize;
+    const auto bins = blockSize + 1;
+
+    if (level.restart)
+        level.filled = 0;
+
+    // Windows that never got a job count as silence, and so does the block before this
+    // one when it went with them.
+    for (int s = 0; s < juce::jmin(level.skippedWindows, level.maxPartitions); ++s)
+    {
+        level.newest = (level.newest + 1) % level.maxPartitions;
+        level.filled = juce::jmin(level.filled + 1, level.maxPartitions);
+        for (int c = 0; c < channels; ++c)
+        {
+            auto* slot = level.state[static_cast<size_t>(c)].history.data() + level.newest * level.stride;
+            std::fill(slot, slot + level.stride, 0.0f);
+        }
+    }
+    if (level.restart || level.skippedWindows > 0)
+        for (int c = 0; c < channels; ++c)
+            std::fill(level.state[static_cast<size_t>(c)].last.begin(), level.state[static_cast<size_t>(c)].last.end(), 0.0f);
+
+    level.newest = (level.newest + 1) % level.maxPartitions;
+    level.filled = juce::jmin(level.filled + 1, level.maxPartitions);
+    const auto count = juce::jmin(partitions, level.filled);
+
+    auto* sum = level.sum.data();
+    for (int c = 0; c < channels; ++c)
+    {
+        auto& state = level.state[static_cast<size_t>(c)];
+        forwardTransform(level, state.last.data(), state.pending.data());
+        std::copy(level.workspace.data(), level.workspace.data() + 2 * bins, state.history.data() + level.newest * level.stride);
+        std::swap(state.last, state.pending);
+
+        // Newest window against the first partition, the one before against the second...
+        const auto* spectra = level.response->spectra[index][static_cast<size_t>(juce::jmin(c, level.response->channels - 1))].data();
+        std::fill(level.sum.begin(), level.sum.end(), 0.0f);
+        for (int k = 0; k < count; ++k)
+        {
+            const auto slot = (level.newest - k + level.maxPartitions) % level.maxPartitions;
+            simd::complexMultiplyAdd(sum, state.history.data() + slot * level.stride, spectra + k * level.stride, bins);
+        }
+
+        inverseTransform(level, state.result.data());
+    }
+}
+
+void PartitionedConvolver::forwardTransform(Level& level, const float* first, const float* second) noexcept
+{
+    const auto blockSize = level.blockSize;
+    auto* workspace = level.workspace.data();
+    if (level.scratch.empty())
+    {
+        std::copy(first, first + blockSize, workspace);
+        std::copy(second, second + blockSize, workspace + blockSize);
+        level.fft->performRealOnlyForwardTransform(workspace, true);
+        return;
+    }
+
+    auto* input = level.scratch.data();
+    for (int i = 0; i < blockSize; ++i)
+    {
+        input[i] = { first[i], 0.0f };
+        input[blockSize + i] = { second[i], 0.0f };
+    }
+    level.fft->perform(input, reinterpret_cast<juce::dsp::Complex<float>*>(workspace), false);
+}
+
+void PartitionedConvolver::inverseTransform(Level& level, float* out) noexcept
+{
+    // Overlap-save: the second half of the circular result is the part that is valid.
+    const auto blockSize = level.blockSize;
+    auto* workspace = level.workspace.data();
+    if (level.scratch.empty())
+    {
+        std::copy(level.sum.begin(), level.sum.begin() + 2 * (blockSize + 1), workspace);
+        level.fft->performRealOnlyInverseTransform(workspace);
+        std::copy(workspace + blockSize, workspace + 2 * blockSize, out);
+        return;
+    }
+
+    // The complex transform wants the whole conjugate-symmetric spectrum.
+    auto* input = level.scratch.data();
+    const auto* sum = level.sum.data();
+    for (int k = 0; k <= blockSize; ++k)
+        input[k] = { sum[2 * k], sum[2 * k + 1] };
+    for (int k = 1; k < blockSize; ++k)
+        input[2 * blockSize - k] = std::conj(input[k]);
+
+    auto* output = reinterpret_cast<juce::dsp::Complex<float>*>(workspace);
+    level.fft->perform(input, output, true);
+    for (int i = 0; i < blockSize; ++i)
+        out[i] = output[blockSize + i].real();
+}
+
+bool PartitionedConvolver::claimJob(Level& level) noexcept
+{
+    auto expected = static_cast<int>(queued);
+    if (! level.job.compare_exchange_strong(expected, running, std::memory_order_acquire, std::memory_order_relaxed))
+        return false;
+
+    runJob(level);
+    level.job.store(idle, std::memory_order_release);
+    return true;
+}
+
+void PartitionedConvolver::workerLoop(Worker& thread, Level& level)
+{
+    while (! thread.threadShouldExit())
+    {
+        const auto seen = level.wakeups.load(std::memory_order_acquire);
+        if (! claimJob(level))
+            level.wakeups.wait(seen, std::memory_order_acquire);
+    }
+}
+}
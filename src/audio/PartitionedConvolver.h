@@ -0,0 +1,198 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fizzle
+{
+// Convolution with an impulse response (room, mic model, linear-phase EQ correction) that
+// adds no delay.
+//
+// The first kHeadLength taps are applied directly in the time domain. The rest of the
+// response is split into levels of uniformly partitioned overlap-save convolution whose
+// partitions grow eightfold from level to level: 64 samples for taps up to 1024, 512 up
+// to 8192, 4096 up to 65536, 32768 up to 524288 and 262144 beyond. The 64-sample level
+// runs on the audio thread as its blocks complete. Every later level starts two of its
+// own partitions into the response, so its result is due one partition after its input
+// is complete; it is computed in that time on a background thread of its own, so a long
+// transform never holds up a shorter level. No level sums more than fifteen partitions,
+// so the cost per sample grows with the number of levels, roughly the logarithm of the
+// response length, rather than with the number of taps.
+//
+// The audio thread never runs a background level's job. When a result is not ready in
+// time, the level is left out of that block and the miss is counted; offline rendering,
+// which runs faster than the clock, can have the caller wait instead (setNonRealtime()).
+// Transforms larger than JUCE's fallback FFT can do in place on its stack scratch go
+// through the out-of-place complex transform, so no level touches the heap.
+//
+// All delay lines are allocated by prepare() for the longest response. Responses are
+// turned into partition spectra on the thread that sets them and handed to the audio
+// thread through a single-slot mailbox, which it only empties at a 64-sample boundary
+// when no background job is queued or running.
+class PartitionedConvolver
+{
+public:
+    static constexpr double kMaxImpulseSeconds = 5.0;
+    // Taps convolved directly, ahead of the first partitioned level.
+    static constexpr int kHeadLength = 64;
+
+    PartitionedConvolver();
+    ~PartitionedConvolver();
+
+    // Allocates the partition buffers and rebuilds the current response for the new rate.
+    // Not realtime safe.
+    void prepare(double sampleRate, int numChannels);
+
+    // Realtime safe. Clears the convolution history; the response stays.
+    void reset() noexcept;
+
+    // Not realtime safe. Replaces the response, which the audio thread picks up as soon as
+    // no background job is in flight. A mono response is used for every channel; one
+    // recorded at another rate is converted to the prepared rate, and anything past
+    // kMaxImpulseSeconds is dropped. An empty buffer removes the response. The background
+    // threads are started with the first response, so a convolver that never gets one
+    // costs no thread.
+    void setImpulseResponse(const juce::AudioBuffer<float>& response, double responseSampleRate);
+    bool hasImpulseResponse() const;
+
+    // Realtime safe. Convolves up to the prepared number of channels in place. Without a
+    // response the audio passes unchanged.
+    void process(float* const* audio, int numChannels, int numSamples) noexcept;
+
+    // Realtime safe. With this on, process() waits for a background level that is late
+    // (or runs its job if no thread has started it) instead of leaving it out. Only for
+    // callers that are not bound to a clock, such as offline rendering.
+    void setNonRealtime(bool shouldWait) noexcept { nonRealtime.store(shouldWait, std::memory_order_relaxed); }
+
+    // Blocks in which a background level was left out because its result was late. Any
+    // thread.
+    uint32_t getNumMissedBlocks() const noexcept { return missedBlocks.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kMaxChannels = 2;
+    static constexpr int kNumLevels = 5;
+
+    class Worker;
+
+    enum JobState : int
+    {
+        idle,
+        queued,
+        running
+    };
+
+    // One response, ready to convolve with.
+    struct Response
+    {
+        int length { 0 };
+        int channels { 0 };
+        // The first kHeadLength taps, reversed so a dot product with the input history
+        // gives the newest output sample.
+        std::array<std::vector<float>, kMaxChannels> head;
+        std::array<int, kNumLevels> partitions {};
+        // Per level and channel, the partitions' spectra one after the other, stride
+        // floats apart.
+        std::array<std::array<std::vector<float>, kMaxChannels>, kNumLevels> spectra;
+    };
+
+    struct Level
+    {
+        int blockSize { 0 };
+        int offset { 0 }; // first tap the level covers
+        int stride { 0 }; // floats per spectrum: blockSize + 1 bins, padded to a multiple of four
+        int maxPartitions { 0 };
+        bool background { false };
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<float> workspace; // 4 * blockSize floats for the FFT
+        // Input of the out-of-place transform, 2 * blockSize bins; empty for levels
+        // transformed in place.
+        std::vector<std::complex<float>> scratch;
+        std::vector<float> sum;
+
+        struct Channel
+        {
+            std::vector<float> input; // audio thread: the block being collected
+            std::vector<float> output; // audio thread: the block being read out
+            std::vector<float> pending; // job: the block handed over with it
+            std::vector<float> last; // job: the block before that
+            std::vector<float> history; // job: spectra of past windows, maxPartitions * stride
+            std::vector<float> result; // job: its output
+        };
+
+        std::array<Channel, kMaxChannels> state;
+        int newest { 0 }; // history slot of the latest window
+        int filled { 0 }; // history slots written since the last restart
+
+        // Set by the audio thread while the job is idle, for whichever thread runs it next.
+        const Response* response { nullptr }; // what the job convolves with
+        int skippedWindows { 0 }; // windows that never got a job since the last one
+        bool restart { false }; // forget the history first
+
+        std::atomic<int> job { idle };
+        std::atomic<uint32_t> wakeups { 0 };
+
+        // Audio thread only.
+        bool awaiting { false }; // a job was queued at the last boundary
+        bool live { false }; // output holds this level's part of the current block
+        int lostWindows { 0 };
+        bool restartPending { false };
+    };
+
+    double sampleRate { 0.0 };
+    int channels { 0 };
+    int maxLength { 0 };
+    int numLevels { 0 };
+    int64_t position { 0 };
+    std::array<Level, kNumLevels> levels;
+    // Per channel, the kHeadLength - 1 previous input samples followed by the current run.
+    std::array<std::vector<float>, kMaxChannels> headInput;
+
+    // The source of the current response, kept so prepare() can rebuild it for a new rate.
+    mutable juce::CriticalSection sourceLock;
+    juce::AudioBuffer<float> source;
+    double sourceRate { 0.0 };
+
+    // Response hand-off. pendingResponse is a single-slot mailbox: a newer response
+    // replaces an unadopted one. The one the audio thread drops is parked in
+    // retiredResponse and deleted by the next setImpulseResponse().
+    std::atomic<Response*> pendingResponse { nullptr };
+    std::atomic<Response*> retiredResponse { nullptr };
+    Response* response { nullptr }; // audio thread only
+
+    std::atomic<bool> nonRealtime { false };
+    std::atomic<uint32_t> missedBlocks { 0 };
+    // One per background level, indexed like levels.
+    std::array<std::unique_ptr<Worker>, kNumLevels> workers;
+
+    // Starts a thread for every background level without one, if there is a response to
+    // convolve with. Called with sourceLock held.
+    void startWorkersIfNeeded();
+    std::unique_ptr<Response> buildResponse() const;
+    void publish(std::unique_ptr<Response> next);
+    bool adoptPendingResponse() noexcept;
+
+    // Audio thread. Takes back queued jobs and starts every level from silence; a job
+    // that is already running finishes, and its result is dropped.
+    void restartLevels() noexcept;
+    // Not realtime safe. Takes back queued jobs and waits for running ones.
+    void stopJobs() noexcept;
+    bool isAnyJobInFlight() const noexcept;
+    void endBlocks() noexcept;
+    void collectJob(Level& level) noexcept;
+    void startJob(Level& level) noexcept;
+    void countMissedBlock() noexcept;
+    void runJob(Level& level) noexcept;
+    bool claimJob(Level& level) noexcept;
+    // Transforms the window first, second (blockSize samples each) into bins
+    // 0..blockSize at the start of workspace.
+    void forwardTransform(Level& level, const float* first, const float* second) noexcept;
+    // Transforms sum back and writes the valid second half of the window to out.
+    void inverseTransform(Level& level, float* out) noexcept;
+    void workerLoop(Worker& thread, Level& level);
+};
+}
@@ -2,17 +2,74 @@
 
 namespace fizzle
 {
-void ProcessorChain::prepare(double sampleRate, int channels)
+void ProcessorChain::prepare(double sampleRate, int channels, double limiterLookaheadMs)
 {
-    juce::ignoreUnused(sampleRate, channels);
+    noiseSuppressor.prepare(sampleRate, channels);
+    convolver.prepare(sampleRate, channels);
+    voiceStrip.prepare(sampleRate, channels);
+    limiter.prepare(sampleRate, channels, limiterLookaheadMs);
+    suspend();
 }
 
 void ProcessorChain::reset()
 {
+    noiseSuppressor.reset();
+    convolver.reset();
+    voiceStrip.reset();
+    limiter.reset();
 }
 
-void ProcessorChain::process(juce::AudioBuffer<float>& buffer, const EffectParameters& params)
+void ProcessorChain::process(juce::AudioBuffer<float>& buffer, const EffectParameters& params) noexcept
 {
-    juce::ignoreUnused(buffer, params);
+    if (params.bypass.load())
+    {
+        suspend();
+        return;
+    }
+
+    const auto suppress = params.noiseSuppression.load();
+    if (suppress && ! suppressorActive)
+        noiseSuppressor.reset();
+    suppressorActive = suppress;
+    if (suppress)
+        noiseSuppressor.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+
+    const auto convolve = params.convolution.load();
+    if (convolve && ! convolverActive)
+        convolver.reset();
+    convolverActive = convolve;
+    if (convolve)
+        convolver.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+
+    const auto strip = params.voiceStrip.load();
+    if (strip && ! stripActive)
+    {
+        voiceStrip.reset();
+        limiter.reset();
+    }
+    stripActive = strip;
+    if (strip)
+    {
+        voiceStrip.process(buffer, params);
+        const auto ceiling = juce::Decibels::decibelsToGain(params.limiterCeilDb.load(), -200.0f);
+        limiter.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples(), ceiling);
+    }
+}
+
+void ProcessorChain::suspend() noexcept
+{
+    suppressorActive = false;
+    convolverActive = false;
+    stripActive = false;
+}
+
+int ProcessorChain::getLatencySamples(const EffectParameters& params) const noexcept
+{
+    auto latency = 0;
+    if (params.noiseSuppression.load())
+        latency += noiseSuppressor.getLatencySamples();
+    if (params.voiceStrip.load())
+        latency += limiter.getLatencySamples();
+    return latency;
 }
 }
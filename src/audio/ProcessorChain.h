@@ -1,14 +1,47 @@
 #pragma once
 
+#include "BuiltInProcessors.h"
+#include "NoiseSuppressor.h"
+#include "PartitionedConvolver.h"
+#include "TruePeakLimiter.h"
 #include "../AppConfig.h"
 
 namespace fizzle
 {
+// Fizzle's own processing, run ahead of the hosted plugins: the noise suppressor, the
+// impulse response convolver, then the built-in voice strip followed by a true-peak
+// limiter at the strip's ceiling. Each part runs only while its switch in
+// EffectParameters is on.
 class ProcessorChain
 {
 public:
-    void prepare(double sampleRate, int channels);
+    void prepare(double sampleRate, int channels, double limiterLookaheadMs = TruePeakLimiter::kDefaultLookaheadMs);
     void reset();
-    void process(juce::AudioBuffer<float>& buffer, const EffectParameters& params);
+
+    // Realtime safe.
+    void process(juce::AudioBuffer<float>& buffer, const EffectParameters& params) noexcept;
+
+    // Realtime safe. Call for blocks the chain is left out of, so that stages start from
+    // silence when they come back rather than replaying what they last held.
+    void suspend() noexcept;
+
+    // Delay added by the stages params switches on, at the prepared rate.
+    int getLatencySamples(const EffectParameters& params) const noexcept;
+
+    // Not realtime safe. Sets the convolver's impulse response; an empty buffer removes it.
+    void setImpulseResponse(const juce::AudioBuffer<float>& response, double responseSampleRate) { convolver.setImpulseResponse(response, responseSampleRate); }
+    bool hasImpulseResponse() const { return convolver.hasImpulseResponse(); }
+    // For offline rendering: stages with background work wait for it instead of leaving
+    // it out when it is late.
+    void setNonRealtime(bool shouldWait) noexcept { convolver.setNonRealtime(shouldWait); }
+
+private:
+    NoiseSuppressor noiseSuppressor;
+    PartitionedConvolver convolver;
+    BuiltInProcessors voiceStrip;
+    TruePeakLimiter limiter;
+    bool suppressorActive { false };
+    bool convolverActive { false };
+    bool stripActive { false };
 };
 }
@@ -1 +1,278 @@
-#include "Resampler.h"
\ No newline at end of file
+#include "Resampler.h"
+#include "SimdKernels.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace fizzle
+{
+namespace
+{
+constexpr int kMaxExactPhases = 1024;
+constexpr int kApproximatePhases = 1024;
+constexpr int kMaxTaps = 512;
+
+struct QualitySpec
+{
+    int taps;
+    double beta;
+    double rolloff;
+};
+
+QualitySpec getQualitySpec(Resampler::Quality quality)
+{
+    switch (quality)
+    {
+        case Resampler::Quality::low: return { 16, 6.0, 0.86 };
+        case Resampler::Quality::high: return { 64, 10.0, 0.95 };
+        case Resampler::Quality::balanced: break;
+    }
+    return { 32, 8.0, 0.91 };
+}
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const auto half = x * 0.5;
+    for (int k = 1; k < 64; ++k)
+    {
+        const auto factor = half / static_cast<double>(k);
+        term *= factor * factor;
+        sum += term;
+        if (term < sum * 1.0e-12)
+            break;
+    }
+    return sum;
+}
+}
+
+Resampler::Quality Resampler::qualityFromIndex(int index)
+{
+    switch (index)
+    {
+        case 0: return Quality::low;
+        case 2: return Quality::high;
+        default: return Quality::balanced;
+    }
+}
+
+void Resampler::prepare(double inputRate, double outputRate, int numChannels, int maxInputBlock, Quality quality)
+{
+    inRate = inputRate;
+    outRate = outputRate;
+    channels = juce::jmax(1, numChannels);
+
+    auto inHz = static_cast<int64_t>(std::llround(inputRate));
+    auto outHz = static_cast<int64_t>(std::llround(outputRate));
+    if (inHz <= 0 || outHz <= 0)
+        inHz = outHz = 1;
+
+    const auto divisor = std::gcd(inHz, outHz);
+    upFactor = outHz / divisor;
+    downFactor = inHz / divisor;
+
+    if (isPassThrough())
+    {
+        numTaps = 1;
+        numPhases = 1;
+        exactPhases = true;
+        coefficients.assign(1, 1.0f);
+    }
+    else
+    {
+        const auto spec = getQualitySpec(quality);
+        const auto ratio = static_cast<double>(upFactor) / static_cast<double>(downFactor);
+
+        // Downsampling narrows the cutoff, so widen the kernel to keep the same
+        // transition band relative to the output rate.
+        auto taps = spec.taps;
+        if (ratio < 1.0)
+            taps = static_cast<int>(std::ceil(static_cast<double>(spec.taps) / ratio));
+        numTaps = juce::jlimit(4, kMaxTaps, (taps + 3) & ~3);
+
+        exactPhases = upFactor <= kMaxExactPhases;
+        numPhases = exactPhases ? static_cast<int>(upFactor) : kApproximatePhases;
+        buildPhaseTable(spec.rolloff * juce::jmin(1.0, ratio), spec.beta);
+    }
+
+    capacity = 2 * juce::jmax(1, maxInputBlock) + 2 * numTaps + 64;
+    history.setSize(channels, capacity, false, true, false);
+    reset();
+}
+
+void Resampler::buildPhaseTable(double cutoff, double beta)
+{
+    coefficients.assign(static_cast<size_t>(numPhases) * static_cast<size_t>(numTaps), 0.0f);
+
+    const auto halfWidth = static_cast<double>(numTaps) * 0.5;
+    const auto windowNorm = 1.0 / besselI0(beta);
+    const auto centre = static_cast<double>(numTaps / 2 - 1);
+
+    for (int row = 0; row < numPhases; ++row)
+    {
+        const auto frac = static_cast<double>(row) / static_cast<double>(numPhases);
+        auto* c = coefficients.data() + static_cast<size_t>(row) * static_cast<size_t>(numTaps);
+        double sum = 0.0;
+
+        // Tap k multiplies history[readPos + k]; the output sits frac samples after
+        // history[readPos + centre].
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const auto x = centre + frac - static_cast<double>(k);
+            const auto arg = juce::MathConstants<double>::pi * cutoff * x;
+            const auto sinc = std::abs(arg) < 1.0e-9 ? 1.0 : std::sin(arg) / arg;
+            const auto norm = x / halfWidth;
+            const auto window = std::abs(norm) >= 1.0 ? 0.0 : besselI0(beta * std::sqrt(1.0 - norm * norm)) * windowNorm;
+            const auto value = cutoff * sinc * window;
+            c[k] = static_cast<float>(value);
+            sum += value;
+        }
+
+        if (std::abs(sum) > 1.0e-9)
+            for (int k = 0; k < numTaps; ++k)
+                c[k] = static_cast<float>(static_cast<double>(c[k]) / sum);
+    }
+}
+
+void Resampler::reset()
+{
+    history.clear();
+    readPos = 0;
+    phase = 0;
+    primedSamples = 0;
+    overflowCount = 0;
+    buffered = juce::jmax(0, numTaps / 2 - 1);
+}
+
+void Resampler::prime(int extraInputSamples) noexcept
+{
+    const auto extra = juce::jlimit(0, juce::jmax(0, capacity - buffered), extraInputSamples);
+    for (int c = 0; c < channels; ++c)
+        history.clear(c, buffered, extra);
+    buffered += extra;
+    primedSamples += extra;
+}
+
+void Resampler::compact() noexcept
+{
+    if (readPos <= 0)
+        return;
+
+    const auto keep = buffered - readPos;
+    for (int c = 0; c < channels; ++c)
+    {
+        auto* h = history.getWritePointer(c);
+        std::memmove(h, h + readPos, sizeof(float) * static_cast<size_t>(keep));
+    }
+    buffered = keep;
+    readPos = 0;
+}
+
+void Resampler::push(const float* const* input, int numInputChannels, int numSamples) noexcept
+{
+    if (numSamples <= 0 || capacity <= 0)
+        return;
+
+    int offset = 0;
+    if (numSamples > capacity)
+    {
+        offset = numSamples - capacity;
+        numSamples = capacity;
+    }
+
+    if (buffered + numSamples > capacity)
+        compact();
+
+    if (buffered + numSamples > capacity)
+    {
+        // The consumer fell behind; drop the oldest history rather than block.
+        const auto drop = buffered + numSamples - capacity;
+        readPos = drop;
+        compact();
+        ++overflowCount;
+    }
+
+    for (int c = 0; c < channels; ++c)
+    {
+        auto* h = history.getWritePointer(c, buffered);
+        const auto* src = (input != nullptr && c < numInputChannels) ? input[c] : nullptr;
+        if (src != nullptr)
+            juce::FloatVectorOperations::copy(h, src + offset, numSamples);
+        else
+            juce::FloatVectorOperations::clear(h, numSamples);
+    }
+    buffered += numSamples;
+}
+
+const float* Resampler::rowForPhase(int64_t phaseValue) const noexcept
+{
+    const auto row = exactPhases ? phaseValue : (phaseValue * numPhases) / upFactor;
+    return coefficients.data() + static_cast<size_t>(row) * static_cast<size_t>(numTaps);
+}
+
+int Resampler::getNumAvailable() const noexcept
+{
+    const auto room = static_cast<int64_t>(buffered - numTaps - readPos);
+    if (room < 0)
+        return 0;
+
+    const auto lastIndex = ((room + 1) * upFactor - 1 - phase) / downFactor;
+    return static_cast<int>(juce::jmin<int64_t>(lastIndex + 1, std::numeric_limits<int>::max()));
+}
+
+int Resampler::getMaxOutputForInput(int numInput) const noexcept
+{
+    const auto maxIn = static_cast<int64_t>(juce::jmax(0, numInput) + numTaps + primedSamples);
+    return static_cast<int>((maxIn * upFactor + downFactor - 1) / downFactor) + 1;
+}
+
+int Resampler::pull(float* const* output, int numOutputChannels, int numSamples) noexcept
+{
+    float peak = 0.0f;
+    return pull(output, numOutputChannels, numSamples, 1.0f, peak);
+}
+
+int Resampler::pull(float* const* output, int numOutputChannels, int numSamples, float gain, float& peak) noexcept
+{
+    peak = 0.0f;
+    const auto count = juce::jmin(numSamples, getNumAvailable());
+    if (count <= 0 || output == nullptr)
+        return 0;
+
+    const auto wholeStep = static_cast<int>(downFactor / upFactor);
+    const auto fracStep = downFactor % upFactor;
+    const auto activeChannels = juce::jmin(numOutputChannels, channels);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const auto* row = rowForPhase(phase);
+        for (int c = 0; c < activeChannels; ++c)
+        {
+            if (output[c] != nullptr)
+            {
+                const auto value = simd::dotProduct(history.getReadPointer(c, readPos), row, numTaps) * gain;
+                output[c][i] = value;
+                peak = juce::jmax(peak, std::abs(value));
+            }
+        }
+
+        readPos += wholeStep;
+        phase += fracStep;
+        if (phase >= upFactor)
+        {
+            phase -= upFactor;
+            ++readPos;
+        }
+    }
+
+    return count;
+}
+
+int Resampler::process(const juce::AudioBuffer<float>& input, int numInput, juce::AudioBuffer<float>& output) noexcept
+{
+    push(input.getArrayOfReadPointers(), input.getNumChannels(), juce::jmin(numInput, input.getNumSamples()));
+    return pull(output.getArrayOfWritePointers(), output.getNumChannels(), output.getNumSamples());
+}
+}
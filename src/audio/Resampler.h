@@ -1,47 +1,83 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <cstdint>
+#include <vector>
 
 namespace fizzle
 {
+// Streaming polyphase windowed-sinc sample rate converter.
+//
+// The conversion ratio is held as an exact integer fraction, so the read position is
+// advanced with integer arithmetic and never drifts. Input history and the fractional
+// phase persist between calls: audio is pushed in whatever block sizes the caller has
+// and pulled out as it becomes available, without discontinuities at block edges.
 class Resampler
 {
 public:
-    void process(const juce::AudioBuffer<float>& input,
-                 juce::AudioBuffer<float>& output,
-                 double inputRate,
-                 double outputRate)
+    enum class Quality
     {
-        const auto inSamples = input.getNumSamples();
-        const auto channels = juce::jmin(input.getNumChannels(), output.getNumChannels());
-        if (inSamples <= 0 || channels <= 0)
-            return;
-
-        if (std::abs(inputRate - outputRate) < 0.01)
-        {
-            const auto copyCount = juce::jmin(inSamples, output.getNumSamples());
-            for (int c = 0; c < channels; ++c)
-                output.copyFrom(c, 0, input, c, 0, copyCount);
-            if (copyCount < output.getNumSamples())
-                output.clear(copyCount, output.getNumSamples() - copyCount);
-            return;
-        }
-
-        const auto ratio = inputRate / outputRate;
-        const auto outSamples = output.getNumSamples();
-        for (int c = 0; c < channels; ++c)
-        {
-            const auto* in = input.getReadPointer(c);
-            auto* out = output.getWritePointer(c);
-            for (int i = 0; i < outSamples; ++i)
-            {
-                const auto pos = static_cast<double>(i) * ratio;
-                const auto i0 = juce::jlimit(0, inSamples - 1, static_cast<int>(pos));
-                const auto i1 = juce::jlimit(0, inSamples - 1, i0 + 1);
-                const auto frac = static_cast<float>(pos - static_cast<double>(i0));
-                out[i] = in[i0] + (in[i1] - in[i0]) * frac;
-            }
-        }
-    }
+        low,      // 16 taps, lowest latency
+        balanced, // 32 taps
+        high      // 64 taps, steepest transition band
+    };
+
+    static Quality qualityFromIndex(int index);
+
+    // Allocates the phase table and history. Not realtime safe.
+    void prepare(double inputRate, double outputRate, int numChannels, int maxInputBlock, Quality quality = Quality::balanced);
+    void reset();
+
+    // Appends input for every prepared channel. Channels beyond numInputChannels are
+    // fed silence so all channel histories stay aligned.
+    void push(const float* const* input, int numInputChannels, int numSamples) noexcept;
+
+    // Produces up to numSamples of output and returns how many were written.
+    int pull(float* const* output, int numOutputChannels, int numSamples) noexcept;
+
+    // As above, scaling every output sample by gain and setting peak to the largest
+    // magnitude written, so the caller needs no separate gain or meter pass.
+    int pull(float* const* output, int numOutputChannels, int numSamples, float gain, float& peak) noexcept;
+
+    // Convenience wrapper: pushes numInput samples and pulls everything that is ready.
+    int process(const juce::AudioBuffer<float>& input, int numInput, juce::AudioBuffer<float>& output) noexcept;
+
+    int getNumAvailable() const noexcept;
+    int getMaxOutputForInput(int numInput) const noexcept;
+    bool isPassThrough() const noexcept { return upFactor == downFactor; }
+    int getNumTaps() const noexcept { return numTaps; }
+
+    // Group delay of the filter plus any priming, in input samples.
+    int getLatencyInputSamples() const noexcept { return numTaps / 2 + primedSamples; }
+    double getLatencySeconds() const noexcept { return inRate > 0.0 ? static_cast<double>(getLatencyInputSamples()) / inRate : 0.0; }
+
+    // Pre-fills the history with silence so a consumer that pulls a fixed count per
+    // block has headroom against the +/- one sample jitter of the producer.
+    void prime(int extraInputSamples) noexcept;
+
+    uint64_t getOverflowCount() const noexcept { return overflowCount; }
+
+private:
+    double inRate { 0.0 };
+    double outRate { 0.0 };
+    int channels { 0 };
+    int numTaps { 1 };
+    int numPhases { 1 };
+    int64_t upFactor { 1 };
+    int64_t downFactor { 1 };
+    bool exactPhases { true };
+
+    std::vector<float> coefficients;
+    juce::AudioBuffer<float> history;
+    int capacity { 0 };
+    int buffered { 0 };
+    int readPos { 0 };
+    int64_t phase { 0 };
+    int primedSamples { 0 };
+    uint64_t overflowCount { 0 };
+
+    void buildPhaseTable(double cutoff, double beta);
+    const float* rowForPhase(int64_t phaseValue) const noexcept;
+    void compact() noexcept;
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,237 @@
+#include "SignalPath.h"
+#include "SimdKernels.h"
+#include "../core/Tracer.h"
+#include <cmath>
+
+namespace fizzle
+{
+const char* SignalPath::getStageName(Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::inputCopy: return "Input copy";
+        case Stage::resampleIn: return "Resample in";
+        case Stage::builtIn: return "Built-in";
+        case Stage::plugins: return "Plugins";
+        case Stage::gain: return "Gain";
+        case Stage::resampleOut: return "Resample out";
+        case Stage::outputCopy: return "Output copy";
+        case Stage::count: break;
+    }
+    return "";
+}
+
+void SignalPath::prepare(double deviceRate, double procRate, int inputChannels, int maxBlockToUse, Resampler::Quality quality)
+{
+    processingRate = procRate;
+    const auto maxBlock = juce::jmax(1, maxBlockToUse);
+    maxDeviceBlock = maxBlock;
+    inputResampler.prepare(deviceRate, procRate, inputChannels, maxBlock, quality);
+    maxProcessingBlock = isNativeRate() ? maxBlock : inputResampler.getMaxOutputForInput(maxBlock);
+    outputResampler.prepare(procRate, deviceRate, 2, maxProcessingBlock, quality);
+    // The output side is pulled a fixed device block at a time while the input side
+    // delivers +/- one internal sample per block, so keep a little silence queued.
+    if (! outputResampler.isPassThrough())
+        outputResampler.prime(2 + static_cast<int>(std::ceil(procRate / deviceRate)));
+    chain.prepare(procRate, 2);
+
+    arena.clear();
+    internalRegion = arena.reserve(2, juce::jmax(maxBlock, maxProcessingBlock));
+    outRegion = arena.reserve(2, maxBlock);
+    arena.allocate();
+    arena.attach(internalRegion, internalBuffer, arena.getCapacity(internalRegion));
+    arena.attach(outRegion, outBuffer, maxBlock);
+    tonePhase = 0.0;
+    inputPeak = 0.0f;
+    outputPeak = 0.0f;
+}
+
+void SignalPath::reset()
+{
+    inputResampler.reset();
+    outputResampler.reset();
+    chain.reset();
+    internalBuffer.clear();
+    outBuffer.clear();
+    tonePhase = 0.0;
+}
+
+void SignalPath::renderTestTone() noexcept
+{
+    const auto phaseDelta = juce::MathConstants<double>::twoPi * 440.0 / processingRate;
+    for (int c = 0; c < internalBuffer.getNumChannels(); ++c)
+    {
+        auto* d = internalBuffer.getWritePointer(c);
+        for (int i = 0; i < internalBuffer.getNumSamples(); ++i)
+            d[i] = static_cast<float>(std::sin(tonePhase + static_cast<double>(i) * phaseDelta) * 0.1);
+    }
+    tonePhase = std::fmod(tonePhase + phaseDelta * static_cast<double>(internalBuffer.getNumSamples()), juce::MathConstants<double>::twoPi);
+}
+
+bool SignalPath::processDirect(const float* const* input,
+                               int numInputChannels,
+                               float* const* output,
+                               int numOutputChannels,
+                               int numSamples,
+                               VstHost& host,
+                               const BlockOptions& options) noexcept
+{
+    if (! isNativeRate() || options.testTone || output == nullptr || numSamples <= 0)
+        return false;
+
+    if (! options.bypass && (options.builtIn != nullptr || ! host.isPassThrough()))
+        return false;
+
+    stageTicks.fill(0);
+    chain.suspend();
+
+    // Same channel mapping as process(): a mono source feeds both sides, and outputs
+    // past the second repeat it.
+    const auto sourceFor = [input, numInputChannels](int channel) -> const float*
+    {
+        const auto source = numInputChannels <= 1 ? 0 : juce::jmin(channel, 1);
+        return (input != nullptr && source < numInputChannels) ? input[source] : nullptr;
+    };
+
+    inputPeak = 0.0f;
+    for (int c = 0; c < juce::jmin(2, juce::jmax(1, numInputChannels)); ++c)
+        if (const auto* src = sourceFor(c))
+            inputPeak = juce::jmax(inputPeak, simd::peak(src, numSamples));
+
+    outputPeak = 0.0f;
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+    {
+        auto* out = output[ch];
+        if (out == nullptr)
+            continue;
+
+        const auto* src = sourceFor(ch);
+        if (src != nullptr && ! options.mute)
+            outputPeak = juce::jmax(outputPeak, simd::copyScaledWithPeak(out, src, options.outputGain, numSamples));
+        else
+            juce::FloatVectorOperations::clear(out, numSamples);
+    }
+
+    return true;
+}
+
+const juce::AudioBuffer<float>& SignalPath::process(const float* const* input,
+                                                    int numInputChannels,
+                                                    int numDeviceSamples,
+                                                    VstHost& host,
+                                                    const BlockOptions& options) noexcept
+{
+    // A driver that overruns the block it announced loses the excess rather than
+    // forcing an allocation here.
+    const auto numSamples = juce::jmin(numDeviceSamples, maxDeviceBlock);
+
+    // Native-rate mode: the chain runs at the device rate, so both conversion passes
+    // and their latency disappear and device input is copied straight in.
+    const auto nativeRate = isNativeRate();
+
+    stageTicks.fill(0);
+    auto lap = juce::Time::getHighResolutionTicks();
+    auto& tracer = Tracer::instance();
+    const auto endStage = [this, &lap, &tracer](Stage stage) noexcept
+    {
+        const auto now = juce::Time::getHighResolutionTicks();
+        stageTicks[static_cast<size_t>(stage)] += now - lap;
+        tracer.record("audio", getStageName(stage), lap, now);
+        lap = now;
+    };
+
+    int internalSamples = numSamples;
+    const auto monoInput = numInputChannels <= 1;
+    inputPeak = 0.0f;
+    if (nativeRate)
+    {
+        // One pass per channel copies the input, duplicates a mono source and measures it.
+        arena.attach(internalRegion, internalBuffer, numSamples);
+        for (int c = 0; c < internalBuffer.getNumChannels(); ++c)
+        {
+            const auto source = monoInput ? 0 : c;
+            const auto* src = (input != nullptr && source < numInputChannels && input[source] != nullptr) ? input[source] : nullptr;
+            if (src != nullptr)
+                inputPeak = juce::jmax(inputPeak, simd::copyScaledWithPeak(internalBuffer.getWritePointer(c), src, 1.0f, numSamples));
+            else
+                internalBuffer.clear(c, 0, numSamples);
+        }
+        endStage(Stage::inputCopy);
+    }
+    else
+    {
+        inputResampler.push(input, numInputChannels, numSamples);
+        // Anything beyond the prepared maximum stays queued for the next block.
+        internalSamples = juce::jmin(inputResampler.getNumAvailable(), arena.getCapacity(internalRegion));
+        arena.attach(internalRegion, internalBuffer, internalSamples);
+        if (internalSamples > 0)
+        {
+            // The pull writes every sample it is asked for and measures them on the way.
+            const auto pulled = monoInput ? 1 : internalBuffer.getNumChannels();
+            inputResampler.pull(internalBuffer.getArrayOfWritePointers(), pulled, internalSamples, 1.0f, inputPeak);
+            endStage(Stage::resampleIn);
+
+            if (monoInput)
+                internalBuffer.copyFrom(1, 0, internalBuffer, 0, 0, internalSamples);
+            endStage(Stage::inputCopy);
+        }
+        else
+        {
+            endStage(Stage::resampleIn);
+        }
+    }
+
+    // Output gain is applied in the same pass that measures the output: in place at the
+    // native rate, inside the output conversion otherwise.
+    const auto outputGain = options.outputGain;
+    outputPeak = 0.0f;
+    if (internalSamples > 0)
+    {
+        if (options.testTone)
+        {
+            renderTestTone();
+            endStage(Stage::inputCopy);
+        }
+
+        if (options.builtIn != nullptr && ! options.bypass)
+            chain.process(internalBuffer, *options.builtIn);
+        else
+            chain.suspend();
+        endStage(Stage::builtIn);
+
+        if (! options.bypass)
+            host.processBlock(internalBuffer);
+        endStage(Stage::plugins);
+
+        // Cleared rather than scaled by zero, so a plugin's NaNs cannot reach the output.
+        if (options.mute)
+            internalBuffer.clear();
+
+        if (nativeRate)
+        {
+            for (int c = 0; c < internalBuffer.getNumChannels(); ++c)
+            {
+                auto* d = internalBuffer.getWritePointer(c);
+                outputPeak = juce::jmax(outputPeak, simd::copyScaledWithPeak(d, d, outputGain, numSamples));
+            }
+            endStage(Stage::gain);
+        }
+        else
+        {
+            outputResampler.push(internalBuffer.getArrayOfReadPointers(), internalBuffer.getNumChannels(), internalSamples);
+        }
+    }
+
+    if (! nativeRate)
+    {
+        arena.attach(outRegion, outBuffer, numSamples);
+        const auto produced = outputResampler.pull(outBuffer.getArrayOfWritePointers(), outBuffer.getNumChannels(), numSamples, outputGain, outputPeak);
+        if (produced < numSamples)
+            for (int c = 0; c < outBuffer.getNumChannels(); ++c)
+                outBuffer.clear(c, produced, numSamples - produced);
+        endStage(Stage::resampleOut);
+    }
+
+    return nativeRate ? internalBuffer : outBuffer;
+}
+}
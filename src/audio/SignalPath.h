@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../AppConfig.h"
+#include "BufferArena.h"
+#include "ProcessorChain.h"
+#include "Resampler.h"
+#include "../plugins/VstHost.h"
+#include <array>
+
+namespace fizzle
+{
+// One device block through the processing chain: input conversion to the processing
+// rate, the optional built-in processing, the hosted plugin chain, mute and output gain,
+// then conversion back to the device rate. Shared by the live audio callback and offline
+// rendering so both run exactly the same code.
+class SignalPath
+{
+public:
+    // Timed sections of one device block. Peak metering is fused into the copy, gain
+    // and conversion passes and is timed with them. Output copy happens in the device
+    // callback after process() returns, together with the monitor push, and is filled
+    // in by the caller.
+    enum class Stage
+    {
+        inputCopy,
+        resampleIn,
+        builtIn,
+        plugins,
+        gain,
+        resampleOut,
+        outputCopy,
+        count
+    };
+
+    static constexpr int kNumStages = static_cast<int>(Stage::count);
+    static const char* getStageName(Stage stage) noexcept;
+
+    struct BlockOptions
+    {
+        bool bypass { false };
+        bool mute { false };
+        float outputGain { 1.0f };
+        bool testTone { false };
+        // Parameters for the built-in processing (noise suppressor, convolver, voice strip,
+        // limiter), or null to leave it all out.
+        const EffectParameters* builtIn { nullptr };
+    };
+
+    // Not realtime safe. maxDeviceBlock bounds the device-rate block passed to process();
+    // all scratch memory is allocated here for that worst case.
+    void prepare(double deviceRate, double processingRate, int inputChannels, int maxDeviceBlock, Resampler::Quality quality);
+    void reset();
+
+    // Processes numSamples of device-rate input and returns numSamples of stereo
+    // device-rate output. Blocks longer than the prepared maximum are cut to it, so
+    // callers must use the returned buffer's length. It stays valid until the next call.
+    const juce::AudioBuffer<float>& process(const float* const* input,
+                                            int numInputChannels,
+                                            int numSamples,
+                                            VstHost& host,
+                                            const BlockOptions& options) noexcept;
+
+    // Fast path for an idle chain. When the path runs at the device rate, the test tone is
+    // off and the chain (built-in processing included) is bypassed or would not touch the
+    // audio, writes input times the output gain straight to the device outputs, measures
+    // both peaks and returns true. Otherwise does nothing and returns false; call
+    // process() instead.
+    bool processDirect(const float* const* input,
+                       int numInputChannels,
+                       float* const* output,
+                       int numOutputChannels,
+                       int numSamples,
+                       VstHost& host,
+                       const BlockOptions& options) noexcept;
+
+    bool isNativeRate() const noexcept { return inputResampler.isPassThrough() && outputResampler.isPassThrough(); }
+    double getProcessingSampleRate() const noexcept { return processingRate; }
+    int getMaxDeviceBlock() const noexcept { return maxDeviceBlock; }
+    int getMaxProcessingBlock() const noexcept { return maxProcessingBlock; }
+    double getResamplingLatencySeconds() const noexcept { return inputResampler.getLatencySeconds() + outputResampler.getLatencySeconds(); }
+    // Delay the built-in processing adds with the stages params switches on.
+    double getBuiltInLatencySeconds(const EffectParameters& params) const noexcept { return static_cast<double>(chain.getLatencySamples(params)) / processingRate; }
+    // Not realtime safe. Impulse response for the built-in convolver; an empty buffer removes it.
+    void setImpulseResponse(const juce::AudioBuffer<float>& response, double responseSampleRate) { chain.setImpulseResponse(response, responseSampleRate); }
+    // Offline rendering is not bound to a clock, so built-in stages wait for their
+    // background work rather than leave it out.
+    void setNonRealtime(bool shouldWait) noexcept { chain.setNonRealtime(shouldWait); }
+
+    // Peaks of the last processed block, measured after input conversion and at the device output.
+    float getInputPeak() const noexcept { return inputPeak; }
+    float getOutputPeak() const noexcept { return outputPeak; }
+
+    // High-resolution ticks spent in each stage during the last process() call.
+    const std::array<juce::int64, kNumStages>& getStageTicks() const noexcept { return stageTicks; }
+
+private:
+    Resampler inputResampler;
+    Resampler outputResampler;
+    ProcessorChain chain;
+    // Views into arena; process() only re-points them.
+    BufferArena arena;
+    int internalRegion { -1 };
+    int outRegion { -1 };
+    juce::AudioBuffer<float> internalBuffer;
+    juce::AudioBuffer<float> outBuffer;
+    double processingRate { kInternalSampleRate };
+    int maxDeviceBlock { 0 };
+    int maxProcessingBlock { 0 };
+    double tonePhase { 0.0 };
+    float inputPeak { 0.0f };
+    float outputPeak { 0.0f };
+    std::array<juce::int64, kNumStages> stageTicks {};
+
+    void renderTestTone() noexcept;
+};
+}
@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define FIZZLE_SIMD_SSE 1
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define FIZZLE_SIMD_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace fizzle::simd
+{
+// Small hand-vectorised kernels shared by the realtime DSP paths. Loads are unaligned,
+// so callers can pass arbitrary offsets into their buffers.
+
+inline float dotProduct(const float* a, const float* b, int n) noexcept
+{
+    int i = 0;
+    float result = 0.0f;
+
+#if FIZZLE_SIMD_SSE
+    auto acc0 = _mm_setzero_ps();
+    auto acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 0x55));
+    result = _mm_cvtss_f32(acc0);
+#elif FIZZLE_SIMD_NEON
+    auto acc0 = vdupq_n_f32(0.0f);
+    auto acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+
+    acc0 = vaddq_f32(acc0, acc1);
+    const auto pair = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    result = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+    float acc[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (; i + 4 <= n; i += 4)
+    {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    result = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+
+    for (; i < n; ++i)
+        result += a[i] * b[i];
+
+    return result;
+}
+
+// dry[i] += (wet[i] - dry[i]) * g, with g ramping linearly from startMix towards endMix
+// across the n samples (g reaches endMix on the sample after the last one).
+inline void crossfade(float* dry, const float* wet, float startMix, float endMix, int n) noexcept
+{
+    if (n <= 0)
+        return;
+
+    int i = 0;
+    const auto step = (endMix - startMix) / static_cast<float>(n);
+
+#if FIZZLE_SIMD_SSE
+    auto g = _mm_add_ps(_mm_set1_ps(startMix), _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)));
+    const auto gStep = _mm_set1_ps(step * 4.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto d = _mm_loadu_ps(dry + i);
+        _mm_storeu_ps(dry + i, _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(wet + i), d), g)));
+        g = _mm_add_ps(g, gStep);
+    }
+#elif FIZZLE_SIMD_NEON
+    const float lanes[4] { 0.0f, 1.0f, 2.0f, 3.0f };
+    auto g = vmlaq_n_f32(vdupq_n_f32(startMix), vld1q_f32(lanes), step);
+    const auto gStep = vdupq_n_f32(step * 4.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto d = vld1q_f32(dry + i);
+        vst1q_f32(dry + i, vmlaq_f32(d, vsubq_f32(vld1q_f32(wet + i), d), g));
+        g = vaddq_f32(g, gStep);
+    }
+#endif
+
+    for (; i < n; ++i)
+        dry[i] += (wet[i] - dry[i]) * (startMix + step * static_cast<float>(i));
+}
+
+// dst[i] = src[i] * gain, returning the largest |dst[i]|. dst may equal src. Fuses the
+// copy, gain and peak passes of the audio callback into one read and one write.
+inline float copyScaledWithPeak(float* dst, const float* src, float gain, int n) noexcept
+{
+    int i = 0;
+    float peak = 0.0f;
+
+#if FIZZLE_SIMD_SSE
+    const auto g = _mm_set1_ps(gain);
+    const auto signMask = _mm_set1_ps(-0.0f);
+    auto p0 = _mm_setzero_ps();
+    auto p1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        const auto a = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+        const auto b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), g);
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+        p0 = _mm_max_ps(p0, _mm_andnot_ps(signMask, a));
+        p1 = _mm_max_ps(p1, _mm_andnot_ps(signMask, b));
+    }
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto a = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+        _mm_storeu_ps(dst + i, a);
+        p0 = _mm_max_ps(p0, _mm_andnot_ps(signMask, a));
+    }
+
+    p0 = _mm_max_ps(p0, p1);
+    p0 = _mm_max_ps(p0, _mm_movehl_ps(p0, p0));
+    p0 = _mm_max_ss(p0, _mm_shuffle_ps(p0, p0, 0x55));
+    peak = _mm_cvtss_f32(p0);
+#elif FIZZLE_SIMD_NEON
+    auto p0 = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto a = vmulq_n_f32(vld1q_f32(src + i), gain);
+        vst1q_f32(dst + i, a);
+        p0 = vmaxq_f32(p0, vabsq_f32(a));
+    }
+
+    const auto pair = vpmax_f32(vget_low_f32(p0), vget_high_f32(p0));
+    peak = vget_lane_f32(vpmax_f32(pair, pair), 0);
+#endif
+
+    for (; i < n; ++i)
+    {
+        dst[i] = src[i] * gain;
+        peak = std::max(peak, std::abs(dst[i]));
+    }
+
+    return peak;
+}
+
+// Largest |src[i]|.
+inline float peak(const float* src, int n) noexcept
+{
+    int i = 0;
+    float result = 0.0f;
+
+#if FIZZLE_SIMD_SSE
+    const auto signMask = _mm_set1_ps(-0.0f);
+    auto p0 = _mm_setzero_ps();
+    auto p1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        p0 = _mm_max_ps(p0, _mm_andnot_ps(signMask, _mm_loadu_ps(src + i)));
+        p1 = _mm_max_ps(p1, _mm_andnot_ps(signMask, _mm_loadu_ps(src + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        p0 = _mm_max_ps(p0, _mm_andnot_ps(signMask, _mm_loadu_ps(src + i)));
+
+    p0 = _mm_max_ps(p0, p1);
+    p0 = _mm_max_ps(p0, _mm_movehl_ps(p0, p0));
+    p0 = _mm_max_ss(p0, _mm_shuffle_ps(p0, p0, 0x55));
+    result = _mm_cvtss_f32(p0);
+#elif FIZZLE_SIMD_NEON
+    auto p0 = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+        p0 = vmaxq_f32(p0, vabsq_f32(vld1q_f32(src + i)));
+
+    const auto pair = vpmax_f32(vget_low_f32(p0), vget_high_f32(p0));
+    result = vget_lane_f32(vpmax_f32(pair, pair), 0);
+#endif
+
+    for (; i < n; ++i)
+        result = std::max(result, std::abs(src[i]));
+
+    return result;
+}
+
+// a[i] = b[i] = src[i]: writes the device output and the monitor tap from one read.
+inline void copyToBoth(float* a, float* b, const float* src, int n) noexcept
+{
+    int i = 0;
+
+#if FIZZLE_SIMD_SSE
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto x = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(a + i, x);
+        _mm_storeu_ps(b + i, x);
+    }
+#elif FIZZLE_SIMD_NEON
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto x = vld1q_f32(src + i);
+        vst1q_f32(a + i, x);
+        vst1q_f32(b + i, x);
+    }
+#endif
+
+    for (; i < n; ++i)
+        a[i] = b[i] = src[i];
+}
+
+// Polynomial log2 and exp2 for gain computers, accurate to about 1e-4 dB once turned
+// into a gain. fastLog2 expects a positive normal input; fastExp2 clamps to 2^+/-126.
+inline float fastLog2(float x) noexcept
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const auto exponent = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    const auto t = m - 1.0f;
+    return exponent + (1.43909329e-05f + t * (1.44159208f + t * (-0.707253433f + t * (0.41156148f + t * (-0.189832444f + t * 0.0439286267f)))));
+}
+
+inline float fastExp2(float x) noexcept
+{
+    x = std::min(126.0f, std::max(-126.0f, x));
+    const auto whole = static_cast<int>(std::floor(x));
+    const auto f = x - static_cast<float>(whole);
+    const auto bits = static_cast<uint32_t>(whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return scale * (1.0000036f + f * (0.692969551f + f * (0.241621323f + f * (0.0517177355f + f * 0.0136839829f))));
+}
+
+// gains[i] = min(1, (max(env[i], floor) * invThreshold)^exponent). With exponent > 0
+// this is the static curve of a downward expander, with exponent < 0 a compressor;
+// either way levels on the other side of the threshold pass at unity.
+inline void thresholdGain(float* gains, const float* env, float floor, float invThreshold, float exponent, int n) noexcept
+{
+    int i = 0;
+
+#if FIZZLE_SIMD_SSE
+    const auto vFloor = _mm_set1_ps(floor);
+    const auto vScale = _mm_set1_ps(invThreshold);
+    const auto vExponent = _mm_set1_ps(exponent);
+    const auto one = _mm_set1_ps(1.0f);
+    const auto mantissaMask = _mm_set1_epi32(0x007fffff);
+    const auto oneBits = _mm_set1_epi32(0x3f800000);
+    const auto bias = _mm_set1_epi32(127);
+    const auto limit = _mm_set1_ps(126.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto x = _mm_mul_ps(_mm_max_ps(_mm_loadu_ps(env + i), vFloor), vScale);
+        const auto bits = _mm_castps_si128(x);
+        const auto e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), bias));
+        const auto t = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissaMask), oneBits)), one);
+        auto p = _mm_set1_ps(0.0439286267f);
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.189832444f));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.41156148f));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.707253433f));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.44159208f));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.43909329e-05f));
+
+        auto y = _mm_mul_ps(_mm_add_ps(e, p), vExponent);
+        y = _mm_min_ps(limit, _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), limit), y));
+        // Truncation rounds towards zero; step negative fractions down to the floor.
+        auto whole = _mm_cvttps_epi32(y);
+        whole = _mm_add_epi32(whole, _mm_castps_si128(_mm_cmplt_ps(y, _mm_cvtepi32_ps(whole))));
+        const auto f = _mm_sub_ps(y, _mm_cvtepi32_ps(whole));
+        auto q = _mm_set1_ps(0.0136839829f);
+        q = _mm_add_ps(_mm_mul_ps(q, f), _mm_set1_ps(0.0517177355f));
+        q = _mm_add_ps(_mm_mul_ps(q, f), _mm_set1_ps(0.241621323f));
+        q = _mm_add_ps(_mm_mul_ps(q, f), _mm_set1_ps(0.692969551f));
+        q = _mm_add_ps(_mm_mul_ps(q, f), _mm_set1_ps(1.0000036f));
+        const auto scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(whole, bias), 23));
+        _mm_storeu_ps(gains + i, _mm_min_ps(one, _mm_mul_ps(q, scale)));
+    }
+#elif FIZZLE_SIMD_NEON
+    const auto vFloor = vdupq_n_f32(floor);
+    const auto one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto x = vmulq_n_f32(vmaxq_f32(vld1q_f32(env + i), vFloor), invThreshold);
+        const auto bits = vreinterpretq_u32_f32(x);
+        const auto e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+        const auto t = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffffu)), vdupq_n_u32(0x3f800000u))), one);
+        auto p = vdupq_n_f32(0.0439286267f);
+        p = vmlaq_f32(vdupq_n_f32(-0.189832444f), p, t);
+        p = vmlaq_f32(vdupq_n_f32(0.41156148f), p, t);
+        p = vmlaq_f32(vdupq_n_f32(-0.707253433f), p, t);
+        p = vmlaq_f32(vdupq_n_f32(1.44159208f), p, t);
+        p = vmlaq_f32(vdupq_n_f32(1.43909329e-05f), p, t);
+
+        auto y = vmulq_n_f32(vaddq_f32(e, p), exponent);
+        y = vminq_f32(vdupq_n_f32(126.0f), vmaxq_f32(vdupq_n_f32(-126.0f), y));
+        auto whole = vcvtq_s32_f32(y);
+        whole = vaddq_s32(whole, vreinterpretq_s32_u32(vcltq_f32(y, vcvtq_f32_s32(whole))));
+        const auto f = vsubq_f32(y, vcvtq_f32_s32(whole));
+        auto q = vdupq_n_f32(0.0136839829f);
+        q = vmlaq_f32(vdupq_n_f32(0.0517177355f), q, f);
+        q = vmlaq_f32(vdupq_n_f32(0.241621323f), q, f);
+        q = vmlaq_f32(vdupq_n_f32(0.692969551f), q, f);
+        q = vmlaq_f32(vdupq_n_f32(1.0000036f), q, f);
+        const auto scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(whole, vdupq_n_s32(127)), 23));
+        vst1q_f32(gains + i, vminq_f32(one, vmulq_f32(q, scale)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        gains[i] = std::min(1.0f, fastExp2(exponent * fastLog2(std::max(env[i], floor) * invThreshold)));
+}
+
+// power[k] = re^2 + im^2 for n complex values stored as re, im, re, im, ...
+inline void complexPower(float* power, const float* bins, int n) noexcept
+{
+    int k = 0;
+
+#if FIZZLE_SIMD_SSE
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto a = _mm_loadu_ps(bins + 2 * k);
+        const auto b = _mm_loadu_ps(bins + 2 * k + 4);
+        const auto re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const auto im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(power + k, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+    }
+#elif FIZZLE_SIMD_NEON
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto x = vld2q_f32(bins + 2 * k);
+        vst1q_f32(power + k, vmlaq_f32(vmulq_f32(x.val[0], x.val[0]), x.val[1], x.val[1]));
+    }
+#endif
+
+    for (; k < n; ++k)
+        power[k] = bins[2 * k] * bins[2 * k] + bins[2 * k + 1] * bins[2 * k + 1];
+}
+
+// Scales n complex values stored as re, im, re, im, ... by gains[k].
+inline void scaleComplex(float* bins, const float* gains, int n) noexcept
+{
+    int k = 0;
+
+#if FIZZLE_SIMD_SSE
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto g = _mm_loadu_ps(gains + k);
+        _mm_storeu_ps(bins + 2 * k, _mm_mul_ps(_mm_loadu_ps(bins + 2 * k), _mm_unpacklo_ps(g, g)));
+        _mm_storeu_ps(bins + 2 * k + 4, _mm_mul_ps(_mm_loadu_ps(bins + 2 * k + 4), _mm_unpackhi_ps(g, g)));
+    }
+#elif FIZZLE_SIMD_NEON
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto g = vld1q_f32(gains + k);
+        auto x = vld2q_f32(bins + 2 * k);
+        x.val[0] = vmulq_f32(x.val[0], g);
+        x.val[1] = vmulq_f32(x.val[1], g);
+        vst2q_f32(bins + 2 * k, x);
+    }
+#endif
+
+    for (; k < n; ++k)
+    {
+        bins[2 * k] *= gains[k];
+        bins[2 * k + 1] *= gains[k];
+    }
+}
+
+// Adds the products a[k] * b[k] of n complex values into sum, all stored as re, im, ...
+inline void complexMultiplyAdd(float* sum, const float* a, const float* b, int n) noexcept
+{
+    int k = 0;
+
+#if FIZZLE_SIMD_SSE
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto a0 = _mm_loadu_ps(a + 2 * k);
+        const auto a1 = _mm_loadu_ps(a + 2 * k + 4);
+        const auto b0 = _mm_loadu_ps(b + 2 * k);
+        const auto b1 = _mm_loadu_ps(b + 2 * k + 4);
+        const auto aRe = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+        const auto aIm = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+        const auto bRe = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+        const auto bIm = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+        const auto re = _mm_sub_ps(_mm_mul_ps(aRe, bRe), _mm_mul_ps(aIm, bIm));
+        const auto im = _mm_add_ps(_mm_mul_ps(aRe, bIm), _mm_mul_ps(aIm, bRe));
+        _mm_storeu_ps(sum + 2 * k, _mm_add_ps(_mm_loadu_ps(sum + 2 * k), _mm_unpacklo_ps(re, im)));
+        _mm_storeu_ps(sum + 2 * k + 4, _mm_add_ps(_mm_loadu_ps(sum + 2 * k + 4), _mm_unpackhi_ps(re, im)));
+    }
+#elif FIZZLE_SIMD_NEON
+    for (; k + 4 <= n; k += 4)
+    {
+        const auto x = vld2q_f32(a + 2 * k);
+        const auto y = vld2q_f32(b + 2 * k);
+        auto s = vld2q_f32(sum + 2 * k);
+        s.val[0] = vmlsq_f32(vmlaq_f32(s.val[0], x.val[0], y.val[0]), x.val[1], y.val[1]);
+        s.val[1] = vmlaq_f32(vmlaq_f32(s.val[1], x.val[0], y.val[1]), x.val[1], y.val[0]);
+        vst2q_f32(sum + 2 * k, s);
+    }
+#endif
+
+    for (; k < n; ++k)
+    {
+        const auto re = a[2 * k] * b[2 * k] - a[2 * k + 1] * b[2 * k + 1];
+        const auto im = a[2 * k] * b[2 * k + 1] + a[2 * k + 1] * b[2 * k];
+        sum[2 * k] += re;
+        sum[2 * k + 1] += im;
+    }
+}
+
+// Four float lanes, for kernels that keep one channel per lane rather than walking a
+// single buffer. Falls back to plain arrays where no vector unit is available.
+struct Float4
+{
+#if FIZZLE_SIMD_SSE
+    __m128 v;
+
+    static Float4 zero() noexcept { return { _mm_setzero_ps() }; }
+    static Float4 broadcast(float x) noexcept { return { _mm_set1_ps(x) }; }
+    static Float4 load(const float* p) noexcept { return { _mm_loadu_ps(p) }; }
+    void store(float* p) const noexcept { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) noexcept { return { _mm_add_ps(a.v, b.v) }; }
+    friend Float4 operator-(Float4 a, Float4 b) noexcept { return { _mm_sub_ps(a.v, b.v) }; }
+    friend Float4 operator*(Float4 a, Float4 b) noexcept { return { _mm_mul_ps(a.v, b.v) }; }
+    friend Float4 operator/(Float4 a, Float4 b) noexcept { return { _mm_div_ps(a.v, b.v) }; }
+    static Float4 min(Float4 a, Float4 b) noexcept { return { _mm_min_ps(a.v, b.v) }; }
+    static Float4 max(Float4 a, Float4 b) noexcept { return { _mm_max_ps(a.v, b.v) }; }
+    static Float4 abs(Float4 x) noexcept { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v) }; }
+
+    float maxLane() const noexcept
+    {
+        const auto pairs = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+
+    // Zeroes lanes whose magnitude is below threshold.
+    static Float4 flushBelow(Float4 x, float threshold) noexcept
+    {
+        const auto magnitude = _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v);
+        return { _mm_and_ps(x.v, _mm_cmpge_ps(magnitude, _mm_set1_ps(threshold))) };
+    }
+
+    // Treats a..d as the rows of a 4x4 matrix and transposes it.
+    static void transpose(Float4& a, Float4& b, Float4& c, Float4& d) noexcept { _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v); }
+#elif FIZZLE_SIMD_NEON
+    float32x4_t v;
+
+    static Float4 zero() noexcept { return { vdupq_n_f32(0.0f) }; }
+    static Float4 broadcast(float x) noexcept { return { vdupq_n_f32(x) }; }
+    static Float4 load(const float* p) noexcept { return { vld1q_f32(p) }; }
+    void store(float* p) const noexcept { vst1q_f32(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) noexcept { return { vaddq_f32(a.v, b.v) }; }
+    friend Float4 operator-(Float4 a, Float4 b) noexcept { return { vsubq_f32(a.v, b.v) }; }
+    friend Float4 operator*(Float4 a, Float4 b) noexcept { return { vmulq_f32(a.v, b.v) }; }
+ #if defined(__aarch64__) || defined(_M_ARM64)
+    friend Float4 operator/(Float4 a, Float4 b) noexcept { return { vdivq_f32(a.v, b.v) }; }
+ #else
+    // 32-bit NEON has no divide: refine the reciprocal estimate twice, to about full precision.
+    friend Float4 operator/(Float4 a, Float4 b) noexcept
+    {
+        auto r = vrecpeq_f32(b.v);
+        r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+        r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+        return { vmulq_f32(a.v, r) };
+    }
+ #endif
+    static Float4 min(Float4 a, Float4 b) noexcept { return { vminq_f32(a.v, b.v) }; }
+    static Float4 max(Float4 a, Float4 b) noexcept { return { vmaxq_f32(a.v, b.v) }; }
+    static Float4 abs(Float4 x) noexcept { return { vabsq_f32(x.v) }; }
+
+    float maxLane() const noexcept
+    {
+        const auto pairs = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpmax_f32(pairs, pairs), 0);
+    }
+
+    static Float4 flushBelow(Float4 x, float threshold) noexcept
+    {
+        const auto keep = vcageq_f32(x.v, vdupq_n_f32(threshold));
+        return { vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x.v), keep)) };
+    }
+
+    static void transpose(Float4& a, Float4& b, Float4& c, Float4& d) noexcept
+    {
+        const auto ab = vtrnq_f32(a.v, b.v);
+        const auto cd = vtrnq_f32(c.v, d.v);
+        a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+#else
+    float v[4];
+
+    static Float4 zero() noexcept { return broadcast(0.0f); }
+    static Float4 broadcast(float x) noexcept { return { { x, x, x, x } }; }
+    static Float4 load(const float* p) noexcept { return { { p[0], p[1], p[2], p[3] } }; }
+    void store(float* p) const noexcept { std::copy(v, v + 4, p); }
+
+    friend Float4 operator+(Float4 a, Float4 b) noexcept { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    friend Float4 operator-(Float4 a, Float4 b) noexcept { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+    friend Float4 operator*(Float4 a, Float4 b) noexcept { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+    friend Float4 operator/(Float4 a, Float4 b) noexcept { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+    static Float4 min(Float4 a, Float4 b) noexcept { return { { std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3]) } }; }
+    static Float4 max(Float4 a, Float4 b) noexcept { return { { std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3]) } }; }
+    static Float4 abs(Float4 x) noexcept { return { { std::abs(x.v[0]), std::abs(x.v[1]), std::abs(x.v[2]), std::abs(x.v[3]) } }; }
+    float maxLane() const noexcept { return std::max(std::max(v[0], v[1]), std::max(v[2], v[3])); }
+
+    static Float4 flushBelow(Float4 x, float threshold) noexcept
+    {
+        for (auto& lane : x.v)
+            lane = std::abs(lane) < threshold ? 0.0f : lane;
+        return x;
+    }
+
+    static void transpose(Float4& a, Float4& b, Float4& c, Float4& d) noexcept
+    {
+        std::swap(a.v[1], b.v[0]);
+        std::swap(a.v[2], c.v[0]);
+        std::swap(a.v[3], d.v[0]);
+        std::swap(b.v[2], c.v[1]);
+        std::swap(b.v[3], d.v[1]);
+        std::swap(c.v[3], d.v[2]);
+    }
+#endif
+};
+}
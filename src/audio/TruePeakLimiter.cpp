@@ -0,0 +1,222 @@
+#include "TruePeakLimiter.h"
+#include <cmath>
+
+namespace fizzle
+{
+void TruePeakLimiter::prepare(double sampleRate, int numChannels, double lookaheadMs, double releaseMs)
+{
+    channels = juce::jlimit(1, kMaxChannels, numChannels);
+    // The delay line must also cover the detector's taps, which sets a floor of a few
+    // samples on the lookahead.
+    window = juce::jmax(kTapsPerPhase - kDetectorDelay, juce::roundToInt(lookaheadMs * 0.001 * sampleRate));
+    latency = window + kDetectorDelay - 1;
+    releaseCoeff = static_cast<float>(1.0 - std::exp(-1.0 / (juce::jmax(0.1, releaseMs) * 0.001 * sampleRate)));
+
+    for (int c = 0; c < kMaxChannels; ++c)
+        lines[static_cast<size_t>(c)].assign(c < channels ? static_cast<size_t>(latency + kSubBlock + 4) : 0, 0.0f);
+
+    // A peak stays in the hold for window + 1 samples, and one more entry can be queued
+    // before the oldest is dropped.
+    minGains.assign(static_cast<size_t>(window + 2), 1.0f);
+    minSamples.assign(static_cast<size_t>(window + 2), 0);
+    averageRing.assign(static_cast<size_t>(window), 1.0f);
+    buildPhaseTaps();
+    reset();
+}
+
+void TruePeakLimiter::reset() noexcept
+{
+    for (auto& line : lines)
+        std::fill(line.begin(), line.end(), 0.0f);
+    std::fill(averageRing.begin(), averageRing.end(), 1.0f);
+
+    minFront = 0;
+    minCount = 0;
+    sampleCount = 0;
+    envelope = 1.0f;
+    unitySamples = 0;
+    averagePos = 0;
+    averageSum = static_cast<double>(window);
+    currentGain = 1.0f;
+}
+
+void TruePeakLimiter::buildPhaseTaps()
+{
+    // Blackman-Harris windowed sinc at the original Nyquist, centred on a whole input
+    // sample so phase 0 reproduces the input delayed by kDetectorDelay.
+    constexpr int length = kOversampling * kTapsPerPhase;
+    constexpr int centre = length / 2;
+    std::array<std::array<double, kOversampling>, kTapsPerPhase> taps {};
+    for (int phase = 0; phase < kOversampling; ++phase)
+    {
+        double sum = 0.0;
+        for (int k = 0; k < kTapsPerPhase; ++k)
+        {
+            const auto m = phase + kOversampling * k;
+            const auto t = static_cast<double>(m - centre) / kOversampling;
+            const auto x = juce::MathConstants<double>::pi * t;
+            const auto sinc = (m - centre) % kOversampling == 0 ? (m == centre ? 1.0 : 0.0) : std::sin(x) / x;
+            const auto w = 2.0 * juce::MathConstants<double>::pi * m / length;
+            const auto blackmanHarris = 0.35875 - 0.48829 * std::cos(w) + 0.14128 * std::cos(2.0 * w) - 0.01168 * std::cos(3.0 * w);
+            taps[static_cast<size_t>(k)][static_cast<size_t>(phase)] = sinc * blackmanHarris;
+            sum += sinc * blackmanHarris;
+        }
+
+        // Unity gain at DC for every phase.
+        for (auto& tap : taps)
+            tap[static_cast<size_t>(phase)] /= sum;
+    }
+
+    peakBound = 1.0f;
+    for (size_t phase = 1; phase < kOversampling; ++phase)
+    {
+        double magnitude = 0.0;
+        for (size_t k = 0; k < kTapsPerPhase; ++k)
+        {
+            phaseTaps[phase - 1][k] = simd::Float4::broadcast(static_cast<float>(taps[k][phase]));
+            magnitude += std::abs(taps[k][phase]);
+        }
+        peakBound = juce::jmax(peakBound, static_cast<float>(magnitude * 1.0001));
+    }
+}
+
+float TruePeakLimiter::holdMinimum(float gain) noexcept
+{
+    const auto capacity = static_cast<int>(minGains.size());
+
+    const auto wrap = [capacity](int index) noexcept { return index >= capacity ? index - capacity : index; };
+
+    // Anything queued that is not below the new gain can never be the minimum again.
+    while (minCount > 0 && minGains[static_cast<size_t>(wrap(minFront + minCount - 1))] >= gain)
+        --minCount;
+
+    const auto slot = static_cast<size_t>(wrap(minFront + minCount));
+    minGains[slot] = gain;
+    minSamples[slot] = sampleCount;
+    ++minCount;
+
+    // One sample enters per call, so at most one can leave.
+    if (minSamples[static_cast<size_t>(minFront)] <= sampleCount - (window + 1))
+    {
+        minFront = wrap(minFront + 1);
+        --minCount;
+    }
+
+    ++sampleCount;
+    return minGains[static_cast<size_t>(minFront)];
+}
+
+void TruePeakLimiter::process(float* const* audio, int numChannels, int numSamples, float ceiling) noexcept
+{
+    numChannels = juce::jlimit(0, channels, numChannels);
+    if (numChannels == 0 || averageRing.empty())
+        return;
+
+    for (int start = 0; start < numSamples; start += kSubBlock)
+    {
+        float* block[kMaxChannels] {};
+        for (int c = 0; c < numChannels; ++c)
+            block[c] = audio[c] + start;
+        processSubBlock(block, numChannels, juce::jmin(kSubBlock, numSamples - start), ceiling);
+    }
+}
+
+void TruePeakLimiter::processSubBlock(float* const* audio, int numChannels, int numSamples, float ceiling) noexcept
+{
+    // Lines start kTapsPerPhase - 1 samples ahead of the new block to cover the detector's
+    // history, which is guaranteed by the minimum window.
+    constexpr int history = kTapsPerPhase - 1;
+    auto samplePeak = 0.0f;
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* line = lines[static_cast<size_t>(c)].data();
+        std::copy(audio[c], audio[c] + numSamples, line + latency);
+        samplePeak = juce::jmax(samplePeak, simd::peak(line + latency - history, numSamples + history));
+    }
+
+    // Clearly under the ceiling, the detector cannot find anything. If the gain has also
+    // been back at unity for a whole window, the block only needs delaying.
+    const auto underCeiling = samplePeak * peakBound <= ceiling;
+    if (underCeiling && unitySamples > window)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto* line = lines[static_cast<size_t>(c)].data();
+            std::copy(line, line + numSamples, audio[c]);
+            std::copy(line + numSamples, line + numSamples + latency, line);
+        }
+
+        minFront = 0;
+        minCount = 1;
+        minGains[0] = 1.0f;
+        minSamples[0] = sampleCount + numSamples - 1;
+        sampleCount += numSamples;
+        averagePos = (averagePos + numSamples) % window;
+        averageSum = static_cast<double>(window);
+        currentGain = 1.0f;
+        return;
+    }
+
+    if (underCeiling)
+        std::fill(peaks.begin(), peaks.end(), 0.0f);
+    else
+        detectPeaks(numChannels, numSamples);
+
+    // Hold, then instant attack and exponential recovery, then the moving average.
+    const auto invWindow = 1.0 / static_cast<double>(window);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto peak = peaks[static_cast<size_t>(i)];
+        const auto held = holdMinimum(peak > ceiling ? ceiling / peak : 1.0f);
+        envelope = held < envelope ? held : envelope + (held - envelope) * releaseCoeff;
+        // Settle exactly, or rounding would leave the envelope a step short for good.
+        if (held - envelope < 1.0e-6f)
+            envelope = held;
+        unitySamples = envelope == 1.0f ? juce::jmin(unitySamples + 1, window + 1) : 0;
+
+        averageSum += static_cast<double>(envelope) - static_cast<double>(averageRing[static_cast<size_t>(averagePos)]);
+        averageRing[static_cast<size_t>(averagePos)] = envelope;
+        if (++averagePos == window)
+            averagePos = 0;
+        gains[static_cast<size_t>(i)] = static_cast<float>(std::min(1.0, averageSum * invWindow));
+    }
+    currentGain = gains[static_cast<size_t>(numSamples - 1)];
+
+    // The clamp only catches rounding in the smoothed gain; it should never bite.
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* line = lines[static_cast<size_t>(c)].data();
+        auto* out = audio[c];
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = juce::jlimit(-ceiling, ceiling, line[i] * gains[static_cast<size_t>(i)]);
+        std::copy(line + numSamples, line + numSamples + latency, line);
+    }
+}
+
+void TruePeakLimiter::detectPeaks(int numChannels, int numSamples) noexcept
+{
+    // Peak of every channel and every interpolation phase, four input samples at a time.
+    for (int i = 0; i < numSamples; i += 4)
+    {
+        auto peak = simd::Float4::zero();
+        for (int c = 0; c < numChannels; ++c)
+        {
+            const auto* x = lines[static_cast<size_t>(c)].data() + latency + i;
+            peak = simd::Float4::max(peak, simd::Float4::abs(simd::Float4::load(x - kDetectorDelay)));
+            for (const auto& taps : phaseTaps)
+            {
+                // Two partial sums keep the adds from queuing behind each other.
+                auto even = simd::Float4::zero();
+                auto odd = simd::Float4::zero();
+                for (int k = 0; k < kTapsPerPhase; k += 2)
+                {
+                    even = even + taps[static_cast<size_t>(k)] * simd::Float4::load(x - k);
+                    odd = odd + taps[static_cast<size_t>(k + 1)] * simd::Float4::load(x - k - 1);
+                }
+                peak = simd::Float4::max(peak, simd::Float4::abs(even + odd));
+            }
+        }
+        peak.store(peaks.data() + i);
+    }
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "SimdKernels.h"
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace fizzle
+{
+// Lookahead limiter that keeps true (inter-sample) peaks under a ceiling.
+//
+// Peaks are measured on a 4x polyphase interpolation of the input, so overs that only
+// appear once the signal is reconstructed between samples are caught as well. The
+// required gain is held with a sliding-window minimum over the lookahead (a monotonic
+// queue, O(1) amortised per sample), recovers with an exponential release and is then
+// smoothed with a moving average of the same length. The average reaches the held
+// value exactly as the peak leaves the delay line, so the gain is fully down in time
+// without ever switching abruptly. Channels are linked.
+class TruePeakLimiter
+{
+public:
+    static constexpr int kOversampling = 4;
+    static constexpr int kTapsPerPhase = 12;
+    static constexpr double kDefaultLookaheadMs = 1.5;
+    static constexpr double kDefaultReleaseMs = 60.0;
+
+    // Allocates the delay lines. Not realtime safe.
+    void prepare(double sampleRate, int numChannels, double lookaheadMs = kDefaultLookaheadMs, double releaseMs = kDefaultReleaseMs);
+    void reset() noexcept;
+
+    // Realtime safe. Limits up to the prepared number of channels in place; ceiling is
+    // a linear gain. Output lags input by getLatencySamples().
+    void process(float* const* audio, int numChannels, int numSamples, float ceiling) noexcept;
+
+    // Lookahead plus the detector's interpolation delay, in samples at the prepared rate.
+    int getLatencySamples() const noexcept { return latency; }
+
+    // Gain applied to the most recent output sample, 1 when not limiting.
+    float getCurrentGain() const noexcept { return currentGain; }
+
+private:
+    static constexpr int kMaxChannels = 2;
+    static constexpr int kSubBlock = 64;
+    // The interpolation filter's group delay; phase 0 of the filter is a pure delay of
+    // this many samples.
+    static constexpr int kDetectorDelay = kTapsPerPhase / 2;
+
+    int channels { 0 };
+    int window { 1 };
+    int latency { kDetectorDelay };
+    float releaseCoeff { 1.0f };
+
+    // Coefficients of interpolation phases 1..3, one broadcast vector per tap.
+    std::array<std::array<simd::Float4, kTapsPerPhase>, kOversampling - 1> phaseTaps {};
+    // Largest sum of tap magnitudes over the phases: no interpolated value can exceed the
+    // input's sample peak by more than this factor.
+    float peakBound { 1.0f };
+
+    // Per channel, the last `latency` input samples followed by room for a sub-block.
+    // Output is read from the front, and the detector reads its history from the same
+    // samples. Padded so the detector can work four samples at a time past a short tail.
+    std::array<std::vector<float>, kMaxChannels> lines;
+    std::array<float, kSubBlock + 4> peaks {};
+    std::array<float, kSubBlock> gains {};
+
+    // Sliding-window minimum of the required gain: a ring buffer of (sample, gain) pairs
+    // whose gains increase from front to back.
+    std::vector<float> minGains;
+    std::vector<int64_t> minSamples;
+    int minFront { 0 };
+    int minCount { 0 };
+    int64_t sampleCount { 0 };
+
+    float envelope { 1.0f };
+    // Consecutive samples the envelope has sat at exactly 1; past the window, every gain
+    // in the hold and the average is 1 too.
+    int unitySamples { 0 };
+    std::vector<float> averageRing;
+    int averagePos { 0 };
+    double averageSum { 0.0 };
+    float currentGain { 1.0f };
+
+    void buildPhaseTaps();
+    void processSubBlock(float* const* audio, int numChannels, int numSamples, float ceiling) noexcept;
+    void detectPeaks(int numChannels, int numSamples) noexcept;
+    float holdMinimum(float gain) noexcept;
+};
+}
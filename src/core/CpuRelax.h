@@ -0,0 +1,12 @@
+#pragma once
+
+#include <thread>
+
+// Hint for spin-wait loops on the realtime threads: lets the core know it is waiting on
+// another thread, without giving up the time slice where the CPU has a pause instruction.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define FIZZLE_CPU_RELAX() _mm_pause()
+#else
+ #define FIZZLE_CPU_RELAX() std::this_thread::yield()
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace fizzle
+{
+// Fixed-bucket histogram of durations in nanoseconds, written by one realtime thread
+// and summarised by one reader.
+//
+// Buckets are log-linear: exact below 32 ns, then 16 buckets per octave (about 4.4%
+// resolution) up to roughly two seconds. Counters only ever grow, so the reader
+// derives each reporting window from the difference to its previous snapshot and the
+// writer never waits, resets or allocates.
+class LatencyHistogram
+{
+public:
+    static constexpr int kLinearBuckets = 32;
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kOctaves = 26;
+    static constexpr int kNumBuckets = kLinearBuckets + kOctaves * kSubBuckets;
+
+    struct Summary
+    {
+        uint64_t count { 0 };
+        double meanUs { 0.0 };
+        double p50Us { 0.0 };
+        double p99Us { 0.0 };
+        double p999Us { 0.0 };
+        double maxUs { 0.0 };
+    };
+
+    // Writer side. Counters use plain load/store because there is one writer; the window
+    // maximum is shared with the reader's reset and retries at most once per reset.
+    void record(uint64_t nanoseconds) noexcept
+    {
+        auto& bucket = counts[static_cast<size_t>(bucketFor(nanoseconds))];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total.store(total.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+        // The reader resets windowMax with exchange(0), so a raise has to be a compare and
+        // swap: a plain store could overwrite that reset with a stale comparison, and a peak
+        // recorded between the two would be lost.
+        auto seen = windowMax.load(std::memory_order_relaxed);
+        while (nanoseconds > seen && ! windowMax.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Reader side. Summarises everything recorded since the previous call.
+    Summary takeWindow() noexcept
+    {
+        std::array<uint32_t, kNumBuckets> window {};
+        uint64_t count = 0;
+        for (int i = 0; i < kNumBuckets; ++i)
+        {
+            const auto now = counts[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+            window[static_cast<size_t>(i)] = now - consumed[static_cast<size_t>(i)];
+            consumed[static_cast<size_t>(i)] = now;
+            count += window[static_cast<size_t>(i)];
+        }
+
+        const auto totalNow = total.load(std::memory_order_relaxed);
+        const auto windowTotal = totalNow - consumedTotal;
+        consumedTotal = totalNow;
+        const auto maxNs = windowMax.exchange(0, std::memory_order_relaxed);
+
+        Summary out;
+        out.count = count;
+        if (count == 0)
+            return out;
+
+        out.meanUs = static_cast<double>(windowTotal) / static_cast<double>(count) * 1.0e-3;
+        out.maxUs = static_cast<double>(maxNs) * 1.0e-3;
+        // Bucket midpoints can overshoot the exact maximum when the tail is one bucket.
+        const auto limit = out.maxUs > 0.0 ? out.maxUs : 1.0e12;
+        out.p50Us = std::min(limit, percentile(window, count, 0.5));
+        out.p99Us = std::min(limit, percentile(window, count, 0.99));
+        out.p999Us = std::min(limit, percentile(window, count, 0.999));
+        return out;
+    }
+
+    static int bucketFor(uint64_t nanoseconds) noexcept
+    {
+        if (nanoseconds < static_cast<uint64_t>(kLinearBuckets))
+            return static_cast<int>(nanoseconds);
+
+        int octave = 0;
+        for (auto v = nanoseconds >> 5; v > 1; v >>= 1)
+            ++octave;
+
+        if (octave >= kOctaves)
+            return kNumBuckets - 1;
+
+        const auto sub = static_cast<int>((nanoseconds >> (octave + 5 - kSubBucketBits)) & (kSubBuckets - 1));
+        return kLinearBuckets + octave * kSubBuckets + sub;
+    }
+
+    // Midpoint of a bucket, in nanoseconds.
+    static double bucketValue(int bucket) noexcept
+    {
+        if (bucket < kLinearBuckets)
+            return static_cast<double>(bucket);
+
+        const auto octave = (bucket - kLinearBuckets) / kSubBuckets;
+        const auto sub = (bucket - kLinearBuckets) % kSubBuckets;
+        const auto base = static_cast<double>(uint64_t { 32 } << octave);
+        const auto width = base / kSubBuckets;
+        return base + width * (static_cast<double>(sub) + 0.5);
+    }
+
+private:
+    std::array<std::atomic<uint32_t>, kNumBuckets> counts {};
+    std::atomic<uint64_t> total { 0 };
+    std::atomic<uint64_t> windowMax { 0 };
+
+    std::array<uint32_t, kNumBuckets> consumed {};
+    uint64_t consumedTotal { 0 };
+
+    static double percentile(const std::array<uint32_t, kNumBuckets>& window, uint64_t count, double fraction) noexcept
+    {
+        const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kNumBuckets; ++i)
+        {
+            seen += window[static_cast<size_t>(i)];
+            if (seen >= rank)
+                return bucketValue(i) * 1.0e-3;
+        }
+        return bucketValue(kNumBuckets - 1) * 1.0e-3;
+    }
+};
+}
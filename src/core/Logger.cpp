@@ -1,7 +1,75 @@
 #include "Logger.h"
+#include <algorithm>
+#include <cstring>
 
 namespace fizzle
 {
+namespace
+{
+// How often the writer looks at the ring. Producers never wake it, because signalling
+// a thread is a system call.
+constexpr int kWriterPollMs = 50;
+
+const char* getLevelName(Logger::Level level)
+{
+    switch (level)
+    {
+        case Logger::Level::debug: return "debug";
+        case Logger::Level::info: return "info";
+        case Logger::Level::warning: return "warning";
+        case Logger::Level::error: return "error";
+    }
+    return "info";
+}
+}
+
+static_assert((Logger::kCapacity & (Logger::kCapacity - 1)) == 0, "ring capacity must be a power of two");
+
+// One ring slot. sequence follows the bounded MPMC queue scheme: it equals the slot's
+// position while the slot is free for that position's producer, and position + 1 once
+// the record is complete and ready for the writer.
+struct Logger::Record
+{
+    std::atomic<uint32_t> sequence { 0 };
+    Level level { Level::info };
+    juce::int64 timeMs { 0 };
+    int length { 0 };
+    char text[kRecordBytes] {};
+};
+
+class Logger::Writer final : public juce::Thread
+{
+public:
+    explicit Writer(Logger& ownerRef) : juce::Thread("Fizzle log writer"), owner(ownerRef) {}
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock scoped(owner.writeLock);
+                owner.drainLocked();
+            }
+            wait(kWriterPollMs);
+        }
+    }
+
+private:
+    Logger& owner;
+};
+
+Logger::Logger()
+    : records(new Record[kCapacity])
+{
+    for (uint32_t i = 0; i < static_cast<uint32_t>(kCapacity); ++i)
+        records[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+Logger::~Logger()
+{
+    shutdown();
+}
+
 Logger& Logger::instance()
 {
     static Logger logger;
@@ -10,24 +78,98 @@ Logger& Logger::instance()
 
 void Logger::initialise()
 {
-    const auto appData = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-                             .getChildFile("Fizzle")
-                             .getChildFile("logs");
-    appData.createDirectory();
+    initialise(getLogDirectory());
+}
+
+void Logger::initialise(const juce::File& logDirectory, juce::int64 maxBytesPerFile)
+{
+    shutdown();
 
-    const auto timestamp = juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S");
-    currentLogFile = appData.getChildFile("fizzle-" + timestamp + ".log");
-    currentLogFile.replaceWithText("Fizzle log start\n");
+    {
+        const juce::ScopedLock scoped(writeLock);
+        directory = logDirectory;
+        maxFileBytes = juce::jmax<juce::int64>(1024, maxBytesPerFile);
+        openNewFileLocked();
+        drainLocked();
+    }
+
+    writer = std::make_unique<Writer>(*this);
+    writer->startThread(juce::Thread::Priority::low);
 }
 
-void Logger::log(const juce::String& message)
+void Logger::shutdown()
 {
-    const juce::ScopedLock scoped(lock);
-    if (! currentLogFile.existsAsFile())
-        initialise();
+    if (writer != nullptr)
+    {
+        writer->stopThread(2000);
+        writer.reset();
+    }
 
-    const auto line = juce::Time::getCurrentTime().toString(true, true, true, true) + " | " + message + "\n";
-    currentLogFile.appendText(line);
+    const juce::ScopedLock scoped(writeLock);
+    drainLocked();
+    stream.reset();
+    directory = juce::File();
+}
+
+void Logger::flush()
+{
+    const juce::ScopedLock scoped(writeLock);
+    drainLocked();
+}
+
+void Logger::log(const juce::String& message, Level level) noexcept
+{
+    log(level, { message });
+}
+
+void Logger::log(Level level, std::initializer_list<juce::StringRef> parts) noexcept
+{
+    if (level < minimumLevel.load(std::memory_order_relaxed))
+        return;
+
+    auto position = enqueuePosition.load(std::memory_order_relaxed);
+    Record* record = nullptr;
+    for (;;)
+    {
+        auto& slot = records[position & static_cast<uint32_t>(kCapacity - 1)];
+        const auto difference = static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - position);
+        if (difference == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                record = &slot;
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto length = 0;
+    for (const auto& part : parts)
+    {
+        const auto* source = part.text.getAddress();
+        const auto available = static_cast<int>(std::strlen(source));
+        auto count = juce::jmin(available, kRecordBytes - length);
+        // Never split a multi-byte UTF-8 sequence.
+        if (count < available)
+            while (count > 0 && (static_cast<unsigned char>(source[count]) & 0xc0) == 0x80)
+                --count;
+        std::memcpy(record->text + length, source, static_cast<size_t>(count));
+        length += count;
+    }
+
+    record->level = level;
+    record->timeMs = juce::Time::currentTimeMillis();
+    record->length = length;
+    record->sequence.store(position + 1, std::memory_order_release);
 }
 
 juce::File Logger::getLogDirectory() const
@@ -36,4 +178,92 @@ juce::File Logger::getLogDirectory() const
         .getChildFile("Fizzle")
         .getChildFile("logs");
 }
-}
\ No newline at end of file
+
+juce::File Logger::getCurrentLogFile() const
+{
+    const juce::ScopedLock scoped(writeLock);
+    return currentLogFile;
+}
+
+void Logger::drainLocked()
+{
+    // A file that could not be opened, at start-up or on rotation, is tried again on every
+    // drain. Records wait in the ring meanwhile; once it is full, new ones are dropped and
+    // counted as usual.
+    if (stream == nullptr && directory != juce::File())
+        openNewFileLocked();
+    if (stream == nullptr)
+        return;
+
+    for (;;)
+    {
+        auto& record = records[dequeuePosition & static_cast<uint32_t>(kCapacity - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+            break;
+
+        const auto drops = droppedRecords.load(std::memory_order_relaxed);
+        if (drops != reportedDrops)
+        {
+            if (! writeLineLocked(juce::Time::getCurrentTime().toString(true, true, true, true) + " | warning | "
+                                  + juce::String(static_cast<int>(drops - reportedDrops)) + " log record(s) dropped, queue full"))
+                return;
+            reportedDrops = drops;
+        }
+
+        // The record stays queued when the next file cannot be opened.
+        if (! writeLineLocked(juce::Time(record.timeMs).toString(true, true, true, true) + " | " + getLevelName(record.level)
+                              + " | " + juce::String::fromUTF8(record.text, record.length)))
+            return;
+
+        record.sequence.store(dequeuePosition + static_cast<uint32_t>(kCapacity), std::memory_order_release);
+        ++dequeuePosition;
+    }
+
+    stream->flush();
+}
+
+bool Logger::writeLineLocked(const juce::String& line)
+{
+    if (stream->getPosition() + static_cast<juce::int64>(line.getNumBytesAsUTF8()) + 1 > maxFileBytes)
+    {
+        openNewFileLocked();
+        if (stream == nullptr)
+            return false;
+    }
+
+    stream->writeText(line + "\n", false, false, nullptr);
+    return true;
+}
+
+void Logger::openNewFileLocked()
+{
+    stream.reset();
+    directory.createDirectory();
+
+    const auto timestamp = juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S");
+    currentLogFile = directory.getNonexistentChildFile("fizzle-" + timestamp, ".log", false);
+    auto next = std::make_unique<juce::FileOutputStream>(currentLogFile);
+    if (! next->openedOk())
+        return;
+
+    stream = std::move(next);
+    stream->writeText("Fizzle log start\n", false, false, nullptr);
+    pruneOldFilesLocked();
+}
+
+void Logger::pruneOldFilesLocked() const
+{
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "fizzle-*.log");
+    if (files.size() <= kMaxFiles)
+        return;
+
+    std::sort(files.begin(), files.end(), [] (const juce::File& a, const juce::File& b)
+    {
+        return a.getLastModificationTime() > b.getLastModificationTime();
+    });
+
+    for (int i = kMaxFiles; i < files.size(); ++i)
+        if (files.getReference(i) != currentLogFile)
+            files.getReference(i).deleteFile();
+}
+}
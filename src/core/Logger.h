@@ -1,21 +1,90 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
 
 namespace fizzle
 {
+// Process-wide log that is safe to call from the audio thread.
+//
+// log() copies the message into a fixed-size slot of a lock-free multi-producer ring
+// and returns: it never blocks, allocates or makes a system call. A background thread
+// drains the ring into one open file, starts a new file once the current one passes
+// the size limit and keeps the newest kMaxFiles. A file that cannot be opened is tried
+// again on the next drain, with records waiting in the ring until then. When the ring
+// is full, records are dropped and counted; the writer reports how many before its
+// next line.
 class Logger
 {
 public:
+    enum class Level
+    {
+        debug,
+        info,
+        warning,
+        error
+    };
+
+    static constexpr int kCapacity = 1024;
+    // Text bytes per record. Longer messages are cut at a character boundary.
+    static constexpr int kRecordBytes = 240;
+    static constexpr juce::int64 kMaxFileBytes = 4 * 1024 * 1024;
+    static constexpr int kMaxFiles = 8;
+
+    Logger();
+    ~Logger();
+
     static Logger& instance();
 
+    // Not realtime safe. Starts a new log file in the given directory (the user log
+    // folder by default) and the thread that writes to it. Records queued before this
+    // are written to the new file.
     void initialise();
-    void log(const juce::String& message);
+    void initialise(const juce::File& directory, juce::int64 maxFileBytes = kMaxFileBytes);
+    // Not realtime safe. Writes everything still queued and stops the writer thread.
+    void shutdown();
+    // Not realtime safe. Returns once everything queued before the call is on disk.
+    void flush();
+
+    // Records below this level are discarded by log(). Defaults to info.
+    void setMinimumLevel(Level level) noexcept { minimumLevel.store(level, std::memory_order_relaxed); }
+
+    // Realtime safe, any thread. Building the message usually allocates, so code on the
+    // audio thread passes its pieces to the second overload instead of concatenating.
+    void log(const juce::String& message, Level level = Level::info) noexcept;
+    void log(Level level, std::initializer_list<juce::StringRef> parts) noexcept;
+
+    uint32_t getNumDroppedRecords() const noexcept { return droppedRecords.load(std::memory_order_relaxed); }
 
     juce::File getLogDirectory() const;
+    juce::File getCurrentLogFile() const;
 
 private:
-    juce::CriticalSection lock;
+    struct Record;
+    class Writer;
+
+    // Consumer side, called with writeLock held. writeLineLocked() returns false, leaving
+    // stream null, when the file is full and the next one cannot be opened.
+    void drainLocked();
+    bool writeLineLocked(const juce::String& line);
+    void openNewFileLocked();
+    void pruneOldFilesLocked() const;
+
+    std::unique_ptr<Record[]> records;
+    std::atomic<uint32_t> enqueuePosition { 0 };
+    uint32_t dequeuePosition { 0 };
+    std::atomic<uint32_t> droppedRecords { 0 };
+    std::atomic<Level> minimumLevel { Level::info };
+
+    juce::CriticalSection writeLock;
+    juce::File directory;
     juce::File currentLogFile;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::int64 maxFileBytes { kMaxFileBytes };
+    uint32_t reportedDrops { 0 };
+    std::unique_ptr<Writer> writer;
 };
-}
\ No newline at end of file
+}
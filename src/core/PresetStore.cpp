@@ -30,6 +30,7 @@ void PresetStore::savePreset(const PresetData& preset) const
         pluginObj->setProperty("name", plugin.name);
         pluginObj->setProperty("enabled", plugin.enabled);
         pluginObj->setProperty("mix", plugin.mix);
+        pluginObj->setProperty("branch", plugin.branch);
         pluginObj->setProperty("state", plugin.base64State);
         pluginsArray.add(pluginObj);
     }
@@ -76,6 +77,7 @@ std::optional<PresetData> PresetStore::loadPreset(const juce::String& name) cons
                     state.name = po->getProperty("name").toString();
                     state.enabled = po->hasProperty("enabled") ? static_cast<bool>(po->getProperty("enabled")) : true;
                     state.mix = po->hasProperty("mix") ? static_cast<float>(po->getProperty("mix")) : 1.0f;
+                    state.branch = po->hasProperty("branch") ? static_cast<int>(po->getProperty("branch")) : 0;
                     state.base64State = po->getProperty("state").toString();
                     out.plugins.add(state);
                 }
@@ -12,6 +12,7 @@ struct PluginPresetState
     juce::String name;
     bool enabled { true };
     float mix { 1.0f };
+    int branch { 0 };
     juce::String base64State;
 };
 
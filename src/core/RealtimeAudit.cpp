@@ -0,0 +1,398 @@
+#include "RealtimeAudit.h"
+
+#if FIZZLE_RT_AUDIT
+ #include <atomic>
+ #include <cerrno>
+ #include <cstdarg>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <new>
+
+ #if defined(__GLIBC__)
+  #include <dlfcn.h>
+  #include <execinfo.h>
+  #include <fcntl.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+  #define FIZZLE_RT_AUDIT_INTERPOSE 1
+ #elif JUCE_WINDOWS
+  #include <windows.h>
+ #endif
+#endif
+
+namespace fizzle
+{
+const char* RealtimeAudit::getKindName(Kind kind) noexcept
+{
+    switch (kind)
+    {
+        case Kind::allocation: return "allocation";
+        case Kind::deallocation: return "deallocation";
+        case Kind::lock: return "lock";
+        case Kind::fileIo: return "file I/O";
+    }
+    return "unknown";
+}
+
+juce::String RealtimeAudit::describe(const Violation& violation)
+{
+    auto text = juce::String("Realtime violation: ") + getKindName(violation.kind) + " (" + violation.what + ")";
+    for (const auto& frame : violation.stack)
+        text += "\n    " + frame;
+    return text;
+}
+}
+
+#if FIZZLE_RT_AUDIT
+namespace fizzle
+{
+namespace
+{
+constexpr int kMaxFrames = 24;
+
+struct RawViolation
+{
+    RealtimeAudit::Kind kind { RealtimeAudit::Kind::allocation };
+    const char* what { nullptr };
+    void* frames[kMaxFrames] {};
+    int numFrames { 0 };
+};
+
+RawViolation violations[RealtimeAudit::kMaxViolations];
+std::atomic<int> numViolations { 0 };
+std::atomic<int> numPublished { 0 };
+std::atomic<int> droppedViolations { 0 };
+
+// Constant-initialised, so touching them never allocates or runs a TLS constructor.
+thread_local int realtimeDepth = 0;
+thread_local bool insideHook = false;
+
+bool shouldReport() noexcept
+{
+    return realtimeDepth > 0 && ! insideHook;
+}
+
+int captureStack(void** frames, int maxFrames) noexcept
+{
+#if FIZZLE_RT_AUDIT_INTERPOSE
+    return backtrace(frames, maxFrames);
+#elif JUCE_WINDOWS
+    return static_cast<int>(CaptureStackBackTrace(2, static_cast<DWORD>(maxFrames), frames, nullptr));
+#else
+    juce::ignoreUnused(frames, maxFrames);
+    return 0;
+#endif
+}
+
+// Runs on the offending thread, so it only claims a preallocated slot and copies raw
+// frame addresses. Symbolising waits for takeViolations().
+void report(RealtimeAudit::Kind kind, const char* what) noexcept
+{
+    insideHook = true;
+    const auto index = numViolations.fetch_add(1, std::memory_order_relaxed);
+    if (index < RealtimeAudit::kMaxViolations)
+    {
+        auto& slot = violations[index];
+        slot.kind = kind;
+        slot.what = what;
+        slot.numFrames = captureStack(slot.frames, kMaxFrames);
+        numPublished.fetch_add(1, std::memory_order_release);
+    }
+    else
+    {
+        droppedViolations.fetch_add(1, std::memory_order_relaxed);
+    }
+    insideHook = false;
+}
+
+// Allocation hooks report, then forward with the guard set so the layer underneath
+// (operator new on top of malloc) does not report the same call twice.
+struct HookGuard
+{
+    const bool wasInside;
+    HookGuard() noexcept : wasInside(insideHook) { insideHook = true; }
+    ~HookGuard() { insideHook = wasInside; }
+};
+
+#if FIZZLE_RT_AUDIT_INTERPOSE
+// The libc functions the hooks forward to. File functions are looked up on first use
+// in case another static initialiser gets there before the resolver. dlsym() can
+// allocate and lock: allocation goes straight to the __libc entry points, and the mutex
+// hook spins on trylock until its own pointer is set, so the lookups never recurse.
+using MutexLockFn = int (*)(pthread_mutex_t*);
+using OpenFn = int (*)(const char*, int, ...);
+using OpenAtFn = int (*)(int, const char*, int, ...);
+using FopenFn = FILE* (*)(const char*, const char*);
+using ReadFn = ssize_t (*)(int, void*, size_t);
+using WriteFn = ssize_t (*)(int, const void*, size_t);
+
+MutexLockFn realMutexLock = nullptr;
+OpenFn realOpen = nullptr;
+OpenAtFn realOpenAt = nullptr;
+FopenFn realFopen = nullptr;
+ReadFn realRead = nullptr;
+WriteFn realWrite = nullptr;
+
+template <typename Fn>
+Fn resolveNext(Fn& cached, const char* name) noexcept
+{
+    if (cached == nullptr)
+        cached = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    return cached;
+}
+
+struct Resolver
+{
+    Resolver()
+    {
+        resolveNext(realMutexLock, "pthread_mutex_lock");
+        resolveNext(realOpen, "open");
+        resolveNext(realOpenAt, "openat");
+        resolveNext(realFopen, "fopen");
+        resolveNext(realRead, "read");
+        resolveNext(realWrite, "write");
+
+        // backtrace() loads its unwinder on first use; do that here rather than on the
+        // audio thread during the first violation.
+        void* frames[2];
+        backtrace(frames, 2);
+    }
+};
+
+const Resolver resolver;
+
+bool needsMode(int flags) noexcept
+{
+#ifdef O_TMPFILE
+    if ((flags & O_TMPFILE) == O_TMPFILE)
+        return true;
+#endif
+    return (flags & O_CREAT) != 0;
+}
+#endif
+}
+
+RealtimeAudit::Scope::Scope() noexcept
+{
+    ++realtimeDepth;
+}
+
+RealtimeAudit::Scope::~Scope()
+{
+    --realtimeDepth;
+}
+
+std::vector<RealtimeAudit::Violation> RealtimeAudit::takeViolations()
+{
+    std::vector<Violation> out;
+    const auto claimed = juce::jmin(kMaxViolations, numViolations.load(std::memory_order_acquire));
+    // A reporter may have claimed a slot and not finished filling it; wait it out.
+    while (numPublished.load(std::memory_order_acquire) < claimed)
+        juce::Thread::yield();
+
+    for (int i = 0; i < claimed; ++i)
+    {
+        const auto& raw = violations[i];
+        Violation violation;
+        violation.kind = raw.kind;
+        violation.what = raw.what != nullptr ? raw.what : "";
+
+#if FIZZLE_RT_AUDIT_INTERPOSE
+        if (auto** symbols = backtrace_symbols(raw.frames, raw.numFrames))
+        {
+            for (int f = 0; f < raw.numFrames; ++f)
+                violation.stack.add(symbols[f]);
+            std::free(symbols);
+        }
+#else
+        for (int f = 0; f < raw.numFrames; ++f)
+            violation.stack.add("0x" + juce::String::toHexString(static_cast<juce::int64>(reinterpret_cast<juce::pointer_sized_int>(raw.frames[f]))));
+#endif
+        out.push_back(std::move(violation));
+    }
+
+    numViolations.store(0, std::memory_order_relaxed);
+    numPublished.store(0, std::memory_order_relaxed);
+    droppedViolations.store(0, std::memory_order_relaxed);
+    return out;
+}
+
+int RealtimeAudit::getNumDroppedViolations() noexcept
+{
+    return droppedViolations.load(std::memory_order_relaxed);
+}
+}
+
+// ---- Hooks -----------------------------------------------------------------------
+// Replacing the global allocation functions is portable; everything below the
+// interposition guard relies on glibc letting the executable override libc symbols.
+
+namespace
+{
+void* auditedAllocate(std::size_t size, bool arrayForm) noexcept
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, arrayForm ? "operator new[]" : "operator new");
+
+    const fizzle::HookGuard guard;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void auditedRelease(void* p, bool arrayForm) noexcept
+{
+    if (p != nullptr && fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::deallocation, arrayForm ? "operator delete[]" : "operator delete");
+
+    const fizzle::HookGuard guard;
+    std::free(p);
+}
+}
+
+void* operator new(std::size_t size)
+{
+    if (auto* p = auditedAllocate(size, false))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (auto* p = auditedAllocate(size, true))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return auditedAllocate(size, false); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return auditedAllocate(size, true); }
+void operator delete(void* p) noexcept { auditedRelease(p, false); }
+void operator delete[](void* p) noexcept { auditedRelease(p, true); }
+void operator delete(void* p, std::size_t) noexcept { auditedRelease(p, false); }
+void operator delete[](void* p, std::size_t) noexcept { auditedRelease(p, true); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { auditedRelease(p, false); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { auditedRelease(p, true); }
+
+#if FIZZLE_RT_AUDIT_INTERPOSE
+extern "C"
+{
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+
+void* malloc(size_t size)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, "malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, "calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, "realloc");
+    return __libc_realloc(p, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::allocation, "posix_memalign");
+    *out = __libc_memalign(alignment, size);
+    return *out != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free(void* p)
+{
+    if (p != nullptr && fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::deallocation, "free");
+    __libc_free(p);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::lock, "pthread_mutex_lock");
+
+    if (fizzle::realMutexLock != nullptr)
+        return fizzle::realMutexLock(mutex);
+
+    for (;;)
+    {
+        const auto result = pthread_mutex_trylock(mutex);
+        if (result != EBUSY)
+            return result;
+        sched_yield();
+    }
+}
+
+int open(const char* path, int flags, ...)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::fileIo, "open");
+
+    mode_t mode = 0;
+    if (fizzle::needsMode(flags))
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    return fizzle::resolveNext(fizzle::realOpen, "open")(path, flags, mode);
+}
+
+int openat(int directory, const char* path, int flags, ...)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::fileIo, "openat");
+
+    mode_t mode = 0;
+    if (fizzle::needsMode(flags))
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = static_cast<mode_t>(va_arg(args, int));
+        va_end(args);
+    }
+    return fizzle::resolveNext(fizzle::realOpenAt, "openat")(directory, path, flags, mode);
+}
+
+FILE* fopen(const char* path, const char* mode)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::fileIo, "fopen");
+    return fizzle::resolveNext(fizzle::realFopen, "fopen")(path, mode);
+}
+
+ssize_t read(int fd, void* buffer, size_t count)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::fileIo, "read");
+    return fizzle::resolveNext(fizzle::realRead, "read")(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, size_t count)
+{
+    if (fizzle::shouldReport())
+        fizzle::report(fizzle::RealtimeAudit::Kind::fileIo, "write");
+    return fizzle::resolveNext(fizzle::realWrite, "write")(fd, buffer, count);
+}
+}
+#endif
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+namespace fizzle
+{
+// Debug and test aid that traps work the audio thread must never do.
+//
+// Built only when FIZZLE_RT_AUDIT is defined. While a thread is inside a
+// RealtimeAudit::Scope, heap allocation and release through operator new and delete are
+// recorded as violations, each with the stack of the offending call. On glibc, malloc
+// and free, pthread mutex locks and file opens, reads and writes are recorded too. The
+// calls still go ahead; the auditor only records them. In normal builds Scope is empty
+// and takeViolations() always returns nothing.
+class RealtimeAudit
+{
+public:
+    enum class Kind
+    {
+        allocation,
+        deallocation,
+        lock,
+        fileIo
+    };
+
+    struct Violation
+    {
+        Kind kind { Kind::allocation };
+        juce::String what;
+        juce::StringArray stack;
+    };
+
+    // Maximum violations kept between two takeViolations() calls. Later ones are counted
+    // but not stored.
+    static constexpr int kMaxViolations = 64;
+
+#if FIZZLE_RT_AUDIT
+    static constexpr bool isCompiledIn() noexcept { return true; }
+
+    // Marks the calling thread as realtime for the scope's lifetime. Scopes nest.
+    class Scope
+    {
+    public:
+        Scope() noexcept;
+        ~Scope();
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    // Not realtime safe. Returns and clears everything recorded so far, with stacks
+    // symbolised where the platform allows.
+    static std::vector<Violation> takeViolations();
+    static int getNumDroppedViolations() noexcept;
+#else
+    static constexpr bool isCompiledIn() noexcept { return false; }
+
+    class Scope
+    {
+    public:
+        Scope() noexcept {}
+    };
+
+    static std::vector<Violation> takeViolations() { return {}; }
+    static int getNumDroppedViolations() noexcept { return 0; }
+#endif
+
+    static const char* getKindName(Kind kind) noexcept;
+    // Multi-line description of a violation and its stack, for logs and test output.
+    static juce::String describe(const Violation& violation);
+};
+}
@@ -0,0 +1,123 @@
+#include "RealtimeWorkerPool.h"
+#include "CpuRelax.h"
+#include "Tracer.h"
+
+namespace fizzle
+{
+namespace
+{
+// Roughly tens of microseconds: long enough to catch a second batch in the same block
+// without burning a core between blocks.
+constexpr int kSpinIterations = 4000;
+}
+
+class RealtimeWorkerPool::Worker final : public juce::Thread
+{
+public:
+    Worker(RealtimeWorkerPool& ownerRef, int index)
+        : juce::Thread("Fizzle DSP worker " + juce::String(index + 1)), owner(ownerRef)
+    {
+    }
+
+    void run() override
+    {
+        Tracer::instance().nameCurrentThread("DSP worker");
+        owner.workerLoop(*this);
+    }
+
+private:
+    RealtimeWorkerPool& owner;
+};
+
+RealtimeWorkerPool::RealtimeWorkerPool(int numWorkers)
+{
+    for (int i = 0; i < juce::jmax(0, numWorkers); ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this, i);
+        if (! worker->startRealtimeThread(juce::Thread::RealtimeOptions {}.withPriority(9)))
+            worker->startThread(juce::Thread::Priority::highest);
+        workers.push_back(std::move(worker));
+    }
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    shuttingDown.store(true);
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    // Bump the generation with an empty batch so parked workers wake and see the flag.
+    batch.store((static_cast<uint64_t>(generationOf(batch.load()) + 1) << 32));
+    batch.notify_all();
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void RealtimeWorkerPool::run(int numTasks, Task task, void* context) noexcept
+{
+    numTasks = juce::jlimit(0, kMaxTasks, numTasks);
+    if (numTasks == 0)
+        return;
+
+    if (workers.empty() || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            task(context, i);
+        return;
+    }
+
+    // The previous batch has fully drained, so nobody reads these until the new
+    // generation below is published.
+    currentTask = task;
+    currentContext = context;
+    remaining.store(numTasks, std::memory_order_relaxed);
+
+    const auto generation = generationOf(batch.load(std::memory_order_relaxed)) + 1;
+    batch.store((static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(numTasks) << 16), std::memory_order_release);
+    batch.notify_all();
+
+    drain(generation);
+    while (remaining.load(std::memory_order_acquire) > 0)
+        FIZZLE_CPU_RELAX();
+}
+
+void RealtimeWorkerPool::drain(uint32_t generation) noexcept
+{
+    auto state = batch.load(std::memory_order_acquire);
+    for (;;)
+    {
+        if (generationOf(state) != generation || indexOf(state) >= sizeOf(state))
+            return;
+
+        if (! batch.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        currentTask(currentContext, indexOf(state));
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+        state = batch.load(std::memory_order_acquire);
+    }
+}
+
+void RealtimeWorkerPool::workerLoop(Worker& worker)
+{
+    auto seenGeneration = generationOf(batch.load(std::memory_order_acquire));
+    while (! worker.threadShouldExit() && ! shuttingDown.load(std::memory_order_acquire))
+    {
+        auto state = batch.load(std::memory_order_acquire);
+        for (int spin = 0; generationOf(state) == seenGeneration && spin < kSpinIterations; ++spin)
+        {
+            FIZZLE_CPU_RELAX();
+            state = batch.load(std::memory_order_acquire);
+        }
+
+        if (generationOf(state) == seenGeneration)
+        {
+            batch.wait(state, std::memory_order_acquire);
+            continue;
+        }
+
+        seenGeneration = generationOf(state);
+        drain(seenGeneration);
+    }
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fizzle
+{
+// Fork-join pool for splitting one audio block across cores.
+//
+// run() publishes a batch of numbered tasks. The calling thread and the workers claim
+// them from one shared counter until none are left, so whichever thread is free picks
+// up the next one, and run() returns once every task has finished. Workers are
+// realtime-priority threads that spin briefly after each batch and then park on an
+// atomic wait. Neither side locks or allocates while a batch runs.
+class RealtimeWorkerPool
+{
+public:
+    using Task = void (*)(void* context, int taskIndex) noexcept;
+
+    static constexpr int kMaxTasks = 0xffff;
+
+    explicit RealtimeWorkerPool(int numWorkers);
+    ~RealtimeWorkerPool();
+
+    int getNumWorkers() const noexcept { return static_cast<int>(workers.size()); }
+
+    // Realtime safe. Runs task(context, i) for every i in [0, numTasks) and returns when
+    // all of them are done. Only one thread may call run() at a time.
+    void run(int numTasks, Task task, void* context) noexcept;
+
+private:
+    class Worker;
+
+    // Packed batch state: generation (32 bits) | task count (16) | next task index (16).
+    // Keeping all three in one word means a claim can never pair one batch's counter
+    // with another batch's size.
+    std::atomic<uint64_t> batch { 0 };
+    std::atomic<int> remaining { 0 };
+    std::atomic<bool> shuttingDown { false };
+    Task currentTask { nullptr };
+    void* currentContext { nullptr };
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    static uint32_t generationOf(uint64_t state) noexcept { return static_cast<uint32_t>(state >> 32); }
+    static int sizeOf(uint64_t state) noexcept { return static_cast<int>((state >> 16) & 0xffff); }
+    static int indexOf(uint64_t state) noexcept { return static_cast<int>(state & 0xffff); }
+
+    // Claims and runs tasks from the given generation until it is exhausted.
+    void drain(uint32_t generation) noexcept;
+    void workerLoop(Worker& worker);
+};
+}
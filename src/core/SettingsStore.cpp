@@ -14,6 +14,20 @@ EngineSettings fromVar(const juce::var& data)
         out.outputDeviceType = obj->getProperty("outputDeviceType").toString();
         out.bufferSize = obj->hasProperty("bufferSize") ? static_cast<int>(obj->getProperty("bufferSize")) : kDefaultBlockSize;
         out.preferredSampleRate = obj->hasProperty("preferredSampleRate") ? static_cast<double>(obj->getProperty("preferredSampleRate")) : kInternalSampleRate;
+        out.resamplerQuality = obj->hasProperty("resamplerQuality")
+                                   ? juce::jlimit(0, 2, static_cast<int>(obj->getProperty("resamplerQuality")))
+                                   : 1;
+        out.internalSampleRate = obj->hasProperty("internalSampleRate")
+                                     ? static_cast<double>(obj->getProperty("internalSampleRate"))
+                                     : kInternalSampleRate;
+        out.pipelineStages = obj->hasProperty("pipelineStages")
+                                 ? juce::jlimit(1, 4, static_cast<int>(obj->getProperty("pipelineStages")))
+                                 : 1;
+        out.sandboxPlugins = obj->hasProperty("sandboxPlugins") ? static_cast<bool>(obj->getProperty("sandboxPlugins")) : false;
+        out.builtInVoiceStrip = obj->hasProperty("builtInVoiceStrip") ? static_cast<bool>(obj->getProperty("builtInVoiceStrip")) : false;
+        out.builtInNoiseSuppression = obj->hasProperty("builtInNoiseSuppression") ? static_cast<bool>(obj->getProperty("builtInNoiseSuppression")) : false;
+        out.builtInConvolution = obj->hasProperty("builtInConvolution") ? static_cast<bool>(obj->getProperty("builtInConvolution")) : false;
+        out.impulseResponsePath = obj->getProperty("impulseResponsePath").toString();
         out.vstScanFolder = obj->getProperty("vstScanFolder").toString();
         out.hasCompletedInitialVstScan = obj->hasProperty("hasCompletedInitialVstScan") ? static_cast<bool>(obj->getProperty("hasCompletedInitialVstScan")) : false;
         out.autoEnableByApp = obj->hasProperty("autoEnableByApp") ? static_cast<bool>(obj->getProperty("autoEnableByApp")) : false;
@@ -83,6 +97,14 @@ juce::var toVar(const EngineSettings& settings)
     obj->setProperty("outputDeviceType", settings.outputDeviceType);
     obj->setProperty("bufferSize", settings.bufferSize);
     obj->setProperty("preferredSampleRate", settings.preferredSampleRate);
+    obj->setProperty("resamplerQuality", settings.resamplerQuality);
+    obj->setProperty("internalSampleRate", settings.internalSampleRate);
+    obj->setProperty("pipelineStages", settings.pipelineStages);
+    obj->setProperty("sandboxPlugins", settings.sandboxPlugins);
+    obj->setProperty("builtInVoiceStrip", settings.builtInVoiceStrip);
+    obj->setProperty("builtInNoiseSuppression", settings.builtInNoiseSuppression);
+    obj->setProperty("builtInConvolution", settings.builtInConvolution);
+    obj->setProperty("impulseResponsePath", settings.impulseResponsePath);
     obj->setProperty("vstScanFolder", settings.vstScanFolder);
     obj->setProperty("hasCompletedInitialVstScan", settings.hasCompletedInitialVstScan);
     obj->setProperty("autoEnableByApp", settings.autoEnableByApp);
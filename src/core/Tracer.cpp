@@ -0,0 +1,279 @@
+#include "Tracer.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace fizzle
+{
+namespace
+{
+// Copies a NUL-terminated UTF-8 string into a fixed buffer, cutting at a character
+// boundary if it does not fit.
+void copyDetail(char* destination, const char* source) noexcept
+{
+    if (source == nullptr)
+    {
+        destination[0] = 0;
+        return;
+    }
+
+    auto count = static_cast<int>(std::strlen(source));
+    if (count >= Tracer::kDetailBytes)
+    {
+        count = Tracer::kDetailBytes - 1;
+        while (count > 0 && (static_cast<unsigned char>(source[count]) & 0xc0) == 0x80)
+            --count;
+    }
+
+    std::memcpy(destination, source, static_cast<size_t>(count));
+    destination[count] = 0;
+}
+
+void appendJsonString(std::string& out, const char* text)
+{
+    out += '"';
+    for (auto* p = text; *p != 0; ++p)
+    {
+        const auto c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+}
+
+struct Tracer::Event
+{
+    const char* category { nullptr };
+    const char* name { nullptr };
+    juce::int64 startTicks { 0 };
+    juce::int64 endTicks { 0 };
+    char detail[kDetailBytes] {};
+};
+
+// Written only by the thread that claimed it. written counts every event ever
+// recorded into the ring; the newest is at (written - 1) % kEventsPerThread.
+struct Tracer::ThreadBuffer
+{
+    std::atomic<uint64_t> written { 0 };
+    std::atomic<const char*> threadName { nullptr };
+    std::unique_ptr<Event[]> events;
+};
+
+namespace
+{
+thread_local const char* currentThreadName = nullptr;
+}
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setEnabled(bool shouldBeEnabled)
+{
+    const juce::ScopedLock scoped(enableLock);
+    if (shouldBeEnabled == enabled.load())
+        return;
+
+    if (! shouldBeEnabled)
+    {
+        enabled.store(false, std::memory_order_release);
+        return;
+    }
+
+    if (buffers == nullptr)
+    {
+        buffers.reset(new ThreadBuffer[kMaxThreads]);
+        for (int i = 0; i < kMaxThreads; ++i)
+            buffers[i].events.reset(new Event[kEventsPerThread]);
+    }
+
+    for (int i = 0; i < kMaxThreads; ++i)
+    {
+        buffers[i].written.store(0, std::memory_order_relaxed);
+        buffers[i].threadName.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // Threads holding a slot from an earlier capture see the new generation and claim again.
+    claimedBuffers.store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    enabled.store(true, std::memory_order_release);
+}
+
+void Tracer::nameCurrentThread(const char* name) noexcept
+{
+    currentThreadName = name;
+    if (enabled.load(std::memory_order_acquire))
+        if (auto* buffer = getBufferForCurrentThread())
+            buffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+Tracer::ThreadBuffer* Tracer::getBufferForCurrentThread() noexcept
+{
+    static thread_local ThreadBuffer* claimed = nullptr;
+    static thread_local uint32_t claimedGeneration = 0;
+
+    const auto current = generation.load(std::memory_order_acquire);
+    if (claimedGeneration == current)
+        return claimed;
+
+    // Once every slot is taken, further threads record nothing until the next capture.
+    const auto index = claimedBuffers.fetch_add(1, std::memory_order_relaxed);
+    claimed = index < kMaxThreads ? &buffers[index] : nullptr;
+    claimedGeneration = current;
+    if (claimed != nullptr)
+        claimed->threadName.store(currentThreadName, std::memory_order_relaxed);
+    return claimed;
+}
+
+void Tracer::record(const char* category, const char* name, juce::int64 startTicks, juce::int64 endTicks, const char* detail) noexcept
+{
+    if (! enabled.load(std::memory_order_acquire))
+        return;
+
+    auto* buffer = getBufferForCurrentThread();
+    if (buffer == nullptr)
+        return;
+
+    const auto index = buffer->written.load(std::memory_order_relaxed);
+    auto& event = buffer->events[static_cast<size_t>(index % static_cast<uint64_t>(kEventsPerThread))];
+    event.category = category;
+    event.name = name;
+    event.startTicks = startTicks;
+    event.endTicks = endTicks;
+    copyDetail(event.detail, detail);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+juce::String Tracer::toChromeTraceJson() const
+{
+    struct Exported
+    {
+        int thread;
+        Event event;
+    };
+
+    std::vector<Exported> events;
+    std::vector<const char*> threadNames;
+    {
+        const juce::ScopedLock scoped(enableLock);
+        const auto numThreads = buffers == nullptr ? 0 : juce::jmin(kMaxThreads, claimedBuffers.load());
+        const auto capacity = static_cast<uint64_t>(kEventsPerThread);
+        for (int t = 0; t < numThreads; ++t)
+        {
+            const auto& buffer = buffers[t];
+            threadNames.push_back(buffer.threadName.load(std::memory_order_relaxed));
+
+            const auto written = buffer.written.load(std::memory_order_acquire);
+            const auto first = written > capacity ? written - capacity : 0;
+            const auto copiedFrom = events.size();
+            for (auto i = first; i < written; ++i)
+                events.push_back({ t, buffer.events[static_cast<size_t>(i % capacity)] });
+
+            // The owner may have lapped the oldest copied events while we read; drop any
+            // that could have been overwritten, including one write in flight.
+            const auto writtenAfter = buffer.written.load(std::memory_order_acquire);
+            const auto safeFrom = writtenAfter + 1 > capacity ? writtenAfter + 1 - capacity : 0;
+            if (safeFrom > first)
+            {
+                const auto stale = static_cast<size_t>(juce::jmin(safeFrom, written) - first);
+                events.erase(events.begin() + static_cast<std::ptrdiff_t>(copiedFrom),
+                             events.begin() + static_cast<std::ptrdiff_t>(copiedFrom + stale));
+            }
+        }
+    }
+
+    auto origin = std::numeric_limits<juce::int64>::max();
+    for (const auto& exported : events)
+        origin = juce::jmin(origin, exported.event.startTicks);
+
+    const auto toMicroseconds = [] (juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    };
+
+    // Built as UTF-8 bytes: a capture holds hundreds of thousands of events.
+    std::string json;
+    json.reserve(64 + events.size() * 128);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char number[96];
+    for (size_t t = 0; t < threadNames.size(); ++t)
+    {
+        std::snprintf(number, sizeof(number), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                      t == 0 ? "" : ",", static_cast<int>(t) + 1);
+        json += number;
+        const auto label = threadNames[t] != nullptr ? juce::String(threadNames[t]) : "Thread " + juce::String(static_cast<int>(t) + 1);
+        appendJsonString(json, label.toRawUTF8());
+        json += "}}";
+    }
+
+    for (size_t e = 0; e < events.size(); ++e)
+    {
+        const auto& event = events[e].event;
+        json += (e == 0 && threadNames.empty()) ? "{\"name\":" : ",{\"name\":";
+        appendJsonString(json, event.name);
+        json += ",\"cat\":";
+        appendJsonString(json, event.category);
+        std::snprintf(number, sizeof(number), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                      events[e].thread + 1,
+                      toMicroseconds(event.startTicks - origin),
+                      toMicroseconds(juce::jmax<juce::int64>(0, event.endTicks - event.startTicks)));
+        json += number;
+        if (event.detail[0] != 0)
+        {
+            json += ",\"args\":{\"detail\":";
+            appendJsonString(json, event.detail);
+            json += "}";
+        }
+        json += "}";
+    }
+
+    json += "]}";
+    return juce::String::fromUTF8(json.data(), static_cast<int>(json.size()));
+}
+
+bool Tracer::writeChromeTrace(const juce::File& file) const
+{
+    return file.replaceWithText(toChromeTraceJson());
+}
+
+TraceScope::TraceScope(const char* categoryToUse, const char* nameToUse) noexcept
+    : category(categoryToUse), name(nameToUse)
+{
+    if (! Tracer::instance().isEnabled())
+        return;
+
+    active = true;
+    startTicks = juce::Time::getHighResolutionTicks();
+}
+
+TraceScope::TraceScope(const char* categoryToUse, const char* nameToUse, const juce::String& detailToCopy) noexcept
+    : TraceScope(categoryToUse, nameToUse)
+{
+    if (active)
+        copyDetail(detail, detailToCopy.toRawUTF8());
+}
+
+TraceScope::~TraceScope()
+{
+    if (active)
+        Tracer::instance().record(category, name, startTicks, juce::Time::getHighResolutionTicks(), detail);
+}
+}
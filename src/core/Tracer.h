@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace fizzle
+{
+// Opt-in timeline capture, exported in Chrome trace format for chrome://tracing or
+// Perfetto.
+//
+// Each thread that records gets its own fixed-size ring of timed events, so recording
+// is a few stores with no locks, allocation or system calls. Rings keep the most recent
+// kEventsPerThread events and overwrite the oldest. Buffers are allocated the first
+// time tracing is enabled and live for the rest of the process. While tracing is off, a
+// TraceScope costs one relaxed atomic load.
+class Tracer
+{
+public:
+    static constexpr int kMaxThreads = 16;
+    static constexpr int kEventsPerThread = 16384;
+    static constexpr int kDetailBytes = 32;
+
+    static Tracer& instance();
+
+    // Not realtime safe. Enabling starts a new capture and discards the previous one.
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    // Realtime safe. Labels the calling thread in exported traces. The string must
+    // outlive the tracer; pass a literal.
+    void nameCurrentThread(const char* name) noexcept;
+
+    // Realtime safe. category and name must be string literals; detail is copied and cut
+    // to kDetailBytes. Times are juce::Time high-resolution ticks.
+    void record(const char* category, const char* name, juce::int64 startTicks, juce::int64 endTicks, const char* detail = nullptr) noexcept;
+
+    // Not realtime safe. Serialises everything currently held in the rings.
+    juce::String toChromeTraceJson() const;
+    bool writeChromeTrace(const juce::File& file) const;
+
+private:
+    struct Event;
+    struct ThreadBuffer;
+
+    Tracer() = default;
+    ThreadBuffer* getBufferForCurrentThread() noexcept;
+
+    std::unique_ptr<ThreadBuffer[]> buffers;
+    std::atomic<bool> enabled { false };
+    std::atomic<int> claimedBuffers { 0 };
+    std::atomic<uint32_t> generation { 0 };
+    juce::CriticalSection enableLock;
+};
+
+// Records one complete event covering its own lifetime, if tracing was on when it was
+// constructed.
+class TraceScope
+{
+public:
+    TraceScope(const char* categoryToUse, const char* nameToUse) noexcept;
+    TraceScope(const char* categoryToUse, const char* nameToUse, const juce::String& detailToCopy) noexcept;
+    ~TraceScope();
+
+private:
+    const char* category;
+    const char* name;
+    juce::int64 startTicks { 0 };
+    bool active { false };
+    char detail[Tracer::kDetailBytes] {};
+
+    JUCE_DECLARE_NON_COPYABLE(TraceScope)
+};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace fizzle
+{
+// Wait-free hand-off of a trivially copyable value from one producer thread to one
+// consumer thread. The producer always owns a private back slot, the consumer a
+// private front slot, and the two exchange through an atomic middle slot, so neither
+// side ever waits on the other or observes a torn value.
+template <typename T>
+class TripleBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>, "TripleBuffer values are copied with plain stores");
+
+public:
+    TripleBuffer() = default;
+
+    explicit TripleBuffer(const T& initial)
+    {
+        slots.fill(initial);
+    }
+
+    // Producer side. Never blocks; overwrites any value the consumer has not picked up yet.
+    void write(const T& value) noexcept
+    {
+        slots[backIndex] = value;
+        const auto previous = middle.exchange(static_cast<std::uint8_t>(backIndex | dirtyBit), std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    // Consumer side. Copies the newest published value into `out` and returns true if it
+    // changed since the previous read.
+    bool read(T& out) noexcept
+    {
+        const auto fresh = (middle.load(std::memory_order_relaxed) & dirtyBit) != 0;
+        if (fresh)
+        {
+            const auto previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = previous & indexMask;
+        }
+
+        out = slots[frontIndex];
+        return fresh;
+    }
+
+private:
+    static constexpr std::uint8_t indexMask = 0x3;
+    static constexpr std::uint8_t dirtyBit = 0x4;
+
+    std::array<T, 3> slots {};
+    std::atomic<std::uint8_t> middle { 1 };
+    std::uint8_t backIndex { 0 };
+    std::uint8_t frontIndex { 2 };
+};
+}
@@ -5,6 +5,7 @@
 #include "core/Logger.h"
 #include "core/SettingsStore.h"
 #include "core/PresetStore.h"
+#include "plugins/PluginSandbox.h"
 #include "ui/MainWindow.h"
 #include "ui/MainComponent.h"
 #include "ui/TrayController.h"
@@ -17,10 +18,19 @@ class FizzleApplication final : public juce::JUCEApplication,
 public:
     const juce::String getApplicationName() override { return "Fizzle"; }
     const juce::String getApplicationVersion() override { return FIZZLE_VERSION; }
-    bool moreThanOneInstanceAllowed() override { return false; }
+    // Plugin sandbox helpers are extra copies of this executable by design.
+    bool moreThanOneInstanceAllowed() override { return PluginSandboxWorker::isSandboxCommandLine(getCommandLineParameters()); }
 
     void initialise(const juce::String& commandLine) override
     {
+        if (PluginSandboxWorker::isSandboxCommandLine(commandLine))
+        {
+            sandboxWorker = std::make_unique<PluginSandboxWorker>();
+            if (! sandboxWorker->initialiseFromCommandLine(commandLine, kPluginSandboxProcessId))
+                quit();
+            return;
+        }
+
         juce::File::getSpecialLocation(juce::File::currentExecutableFile)
             .getParentDirectory()
             .setAsCurrentWorkingDirectory();
@@ -76,11 +86,13 @@ public:
 
     void shutdown() override
     {
+        sandboxWorker.reset();
         tray.reset();
         window.reset();
         engine.stop();
         presets.reset();
         settings.reset();
+        Logger::instance().shutdown();
     }
 
     void systemRequestedQuit() override
@@ -100,6 +112,7 @@ private:
     std::unique_ptr<PresetStore> presets;
     std::unique_ptr<MainWindow> window;
     std::unique_ptr<TrayController> tray;
+    std::unique_ptr<PluginSandboxWorker> sandboxWorker;
 
     void trayOpenRequested() override
     {
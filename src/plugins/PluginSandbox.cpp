@@ -0,0 +1,507 @@
+#include "PluginSandbox.h"
+#include "../core/Logger.h"
+
+namespace fizzle
+{
+namespace
+{
+constexpr int kLoadTimeoutMs = 15000;
+constexpr int kControlTimeoutMs = 3000;
+
+juce::MemoryBlock toMessage(const juce::XmlElement& xml)
+{
+    const auto text = xml.toString(juce::XmlElement::TextFormat().singleLine().withoutHeader());
+    return { text.toRawUTF8(), text.getNumBytesAsUTF8() };
+}
+
+std::unique_ptr<juce::XmlElement> fromMessage(const juce::MemoryBlock& message)
+{
+    return juce::parseXML(message.toString());
+}
+
+bool isOk(const std::unique_ptr<juce::XmlElement>& response, const juce::String& what, juce::String& error)
+{
+    if (response == nullptr)
+    {
+        error = "Plugin sandbox did not answer (" + what + ")";
+        return false;
+    }
+
+    if (! response->getBoolAttribute("ok"))
+    {
+        error = response->getStringAttribute("error", "Plugin sandbox failed (" + what + ")");
+        return false;
+    }
+    return true;
+}
+}
+
+//==============================================================================
+class SandboxedPluginInstance::Connection final : public juce::ChildProcessCoordinator
+{
+public:
+    explicit Connection(SandboxedPluginInstance& ownerRef) : owner(ownerRef) {}
+    ~Connection() override { killWorkerProcess(); }
+
+    void handleMessageFromWorker(const juce::MemoryBlock& message) override { owner.handleReply(message); }
+    void handleConnectionLost() override { owner.handleHelperLost(); }
+
+private:
+    SandboxedPluginInstance& owner;
+};
+
+// The real editor lives in the helper process. This one only asks the helper to show
+// it while open, and says where it went.
+class SandboxedPluginInstance::Editor final : public juce::AudioProcessorEditor
+{
+public:
+    explicit Editor(SandboxedPluginInstance& ownerRef) : juce::AudioProcessorEditor(ownerRef), owner(ownerRef)
+    {
+        label.setText(owner.getName() + " is open in its sandbox window.", juce::dontSendNotification);
+        label.setJustificationType(juce::Justification::centred);
+        addAndMakeVisible(label);
+        setSize(360, 72);
+        owner.send(juce::XmlElement("SHOW_EDITOR"));
+    }
+
+    ~Editor() override
+    {
+        owner.send(juce::XmlElement("HIDE_EDITOR"));
+    }
+
+    void resized() override { label.setBounds(getLocalBounds().reduced(8)); }
+
+private:
+    SandboxedPluginInstance& owner;
+    juce::Label label;
+};
+
+SandboxedPluginInstance::SandboxedPluginInstance(const juce::PluginDescription& descriptionToUse)
+    : juce::AudioPluginInstance(BusesProperties()
+                                    .withInput("Input", juce::AudioChannelSet::stereo(), true)
+                                    .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+      description(descriptionToUse)
+{
+}
+
+SandboxedPluginInstance::~SandboxedPluginInstance()
+{
+    // Closing the pipe makes the helper quit on its own; the connection kills it if not.
+    alive.store(false);
+    connection.reset();
+    transport.reset();
+}
+
+std::unique_ptr<SandboxedPluginInstance> SandboxedPluginInstance::create(const juce::PluginDescription& description,
+                                                                         double sampleRate,
+                                                                         int blockSize,
+                                                                         juce::String& error)
+{
+    std::unique_ptr<SandboxedPluginInstance> plugin(new SandboxedPluginInstance(description));
+    plugin->transport = SandboxTransport::create(kMaxBlockSize, error);
+    if (plugin->transport == nullptr)
+        return {};
+
+    plugin->alive.store(true);
+    plugin->connection = std::make_unique<Connection>(*plugin);
+    const auto executable = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+    if (! plugin->connection->launchWorkerProcess(executable, kPluginSandboxProcessId))
+    {
+        error = "Could not start the plugin sandbox process";
+        return {};
+    }
+
+    juce::XmlElement request("LOAD");
+    request.setAttribute("channel", plugin->transport->getFile().getFullPathName());
+    request.setAttribute("sampleRate", sampleRate);
+    request.setAttribute("blockSize", blockSize);
+    request.addChildElement(description.createXml().release());
+    const auto response = plugin->call(std::move(request), kLoadTimeoutMs);
+    if (! isOk(response, "load", error))
+        return {};
+
+    if (const auto* resolved = response->getChildByName("PLUGIN"))
+        plugin->description.loadFromXml(*resolved);
+    plugin->tailSeconds = response->getDoubleAttribute("tail");
+    plugin->remoteHasEditor = response->getBoolAttribute("editor");
+    plugin->setLatencySamples(response->getIntAttribute("latency"));
+    plugin->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    plugin->preparedSampleRate.store(sampleRate);
+    Logger::instance().log("Loaded " + plugin->description.name + " in a plugin sandbox");
+    return plugin;
+}
+
+SandboxedPluginInstance::Stats SandboxedPluginInstance::takeStats()
+{
+    const auto window = overhead.takeWindow();
+    Stats stats;
+    stats.alive = alive.load();
+    stats.overheadP99Us = window.p99Us;
+    stats.overheadMaxUs = window.maxUs;
+    stats.missedBlocks = missedBlocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SandboxedPluginInstance::prepareToPlay(double sampleRate, int blockSize)
+{
+    juce::XmlElement request("PREPARE");
+    request.setAttribute("sampleRate", sampleRate);
+    request.setAttribute("blockSize", blockSize);
+    juce::String error;
+    const auto response = call(std::move(request), kControlTimeoutMs);
+    if (! isOk(response, "prepare", error))
+    {
+        Logger::instance().log(description.name + ": " + error);
+        return;
+    }
+
+    setLatencySamples(response->getIntAttribute("latency"));
+    tailSeconds = response->getDoubleAttribute("tail");
+    preparedSampleRate.store(sampleRate);
+}
+
+void SandboxedPluginInstance::releaseResources()
+{
+    call(juce::XmlElement("RELEASE"), kControlTimeoutMs);
+}
+
+void SandboxedPluginInstance::reset()
+{
+    call(juce::XmlElement("RESET"), kControlTimeoutMs);
+}
+
+void SandboxedPluginInstance::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    const auto sampleRate = preparedSampleRate.load(std::memory_order_relaxed);
+    if (! alive.load(std::memory_order_relaxed) || sampleRate <= 0.0)
+        return;
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    const auto budgetSeconds = static_cast<double>(buffer.getNumSamples()) / sampleRate * kDeadlineFraction;
+    const auto deadline = start + static_cast<juce::int64>(budgetSeconds * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+    if (! transport->submit(buffer) || ! transport->awaitResponse(buffer, deadline))
+    {
+        missedBlocks.store(missedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto roundTripNs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e9;
+    const auto helperNs = static_cast<double>(transport->getLastHelperNanos());
+    overhead.record(static_cast<uint64_t>(juce::jmax(0.0, roundTripNs - helperNs)));
+}
+
+juce::AudioProcessorEditor* SandboxedPluginInstance::createEditor()
+{
+    return remoteHasEditor && alive.load() ? new Editor(*this) : nullptr;
+}
+
+void SandboxedPluginInstance::getStateInformation(juce::MemoryBlock& destData)
+{
+    const auto response = call(juce::XmlElement("GET_STATE"), kControlTimeoutMs);
+    juce::String error;
+    if (! isOk(response, "get state", error))
+    {
+        Logger::instance().log(description.name + ": " + error);
+        return;
+    }
+
+    destData.reset();
+    destData.fromBase64Encoding(response->getStringAttribute("state"));
+}
+
+void SandboxedPluginInstance::setStateInformation(const void* data, int sizeInBytes)
+{
+    juce::XmlElement request("SET_STATE");
+    request.setAttribute("state", juce::MemoryBlock(data, static_cast<size_t>(juce::jmax(0, sizeInBytes))).toBase64Encoding());
+    juce::String error;
+    if (! isOk(call(std::move(request), kControlTimeoutMs), "set state", error))
+        Logger::instance().log(description.name + ": " + error);
+}
+
+std::unique_ptr<juce::XmlElement> SandboxedPluginInstance::call(juce::XmlElement request, int timeoutMs)
+{
+    const juce::ScopedLock callScope(callLock);
+    if (connection == nullptr || ! alive.load())
+        return {};
+
+    {
+        const juce::ScopedLock replyScope(replyLock);
+        awaitedRequestId = ++lastRequestId;
+        reply.reset();
+        replyReady.reset();
+        request.setAttribute("id", awaitedRequestId);
+    }
+
+    if (! send(request))
+        return {};
+
+    replyReady.wait(timeoutMs);
+    const juce::ScopedLock replyScope(replyLock);
+    awaitedRequestId = 0;
+    return std::move(reply);
+}
+
+bool SandboxedPluginInstance::send(const juce::XmlElement& request)
+{
+    return connection != nullptr && alive.load() && connection->sendMessageToWorker(toMessage(request));
+}
+
+void SandboxedPluginInstance::handleReply(const juce::MemoryBlock& message)
+{
+    auto response = fromMessage(message);
+    if (response == nullptr || ! response->hasTagName("REPLY"))
+        return;
+
+    const juce::ScopedLock replyScope(replyLock);
+    if (awaitedRequestId == 0 || response->getIntAttribute("id") != awaitedRequestId)
+        return;
+
+    reply = std::move(response);
+    replyReady.signal();
+}
+
+void SandboxedPluginInstance::handleHelperLost()
+{
+    if (alive.exchange(false))
+        Logger::instance().log("Plugin sandbox for " + description.name + " exited; its slot now passes audio through dry");
+    replyReady.signal();
+}
+
+//==============================================================================
+class PluginSandboxWorker::AudioThread final : public juce::Thread
+{
+public:
+    AudioThread(PluginSandboxWorker& ownerRef, SandboxTransport& transportRef)
+        : juce::Thread("Fizzle sandbox audio"), owner(ownerRef), transport(transportRef)
+    {
+    }
+
+    void run() override
+    {
+        juce::MidiBuffer midi;
+        while (! threadShouldExit())
+        {
+            if (! transport.waitForRequest(50))
+                continue;
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            {
+                const juce::ScopedLock sl(owner.processLock);
+                juce::AudioBuffer<float> block(transport.getChannels(), transport.getNumChannels(), transport.getNumSamples());
+                midi.clear();
+                if (owner.instance != nullptr)
+                    owner.instance->processBlock(block, midi);
+            }
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            transport.completeRequest(static_cast<uint64_t>(elapsed * 1.0e9));
+        }
+    }
+
+private:
+    PluginSandboxWorker& owner;
+    SandboxTransport& transport;
+};
+
+class PluginSandboxWorker::EditorWindow final : public juce::DocumentWindow
+{
+public:
+    EditorWindow(const juce::String& name, juce::AudioProcessorEditor* editor)
+        : juce::DocumentWindow(name, juce::Colours::black, juce::DocumentWindow::closeButton | juce::DocumentWindow::minimiseButton)
+    {
+        setUsingNativeTitleBar(true);
+        setContentOwned(editor, true);
+        setResizable(editor->isResizable(), false);
+        centreWithSize(getWidth(), getHeight());
+    }
+
+    // The host owns the editor's lifetime; closing here only hides it.
+    void closeButtonPressed() override { setVisible(false); }
+};
+
+PluginSandboxWorker::PluginSandboxWorker()
+{
+    formatManager.addDefaultFormats();
+}
+
+PluginSandboxWorker::~PluginSandboxWorker()
+{
+    stopAudio();
+    editorWindow.reset();
+    instance.reset();
+    transport.reset();
+}
+
+bool PluginSandboxWorker::isSandboxCommandLine(const juce::String& commandLine)
+{
+    return commandLine.contains(kPluginSandboxProcessId);
+}
+
+void PluginSandboxWorker::handleMessageFromCoordinator(const juce::MemoryBlock& message)
+{
+    // Plugins expect to be created and configured on the message thread.
+    std::shared_ptr<juce::XmlElement> request = fromMessage(message);
+    if (request == nullptr)
+        return;
+
+    juce::MessageManager::callAsync([safeThis = juce::WeakReference<PluginSandboxWorker>(this), request]
+    {
+        if (safeThis != nullptr)
+            safeThis->handleRequest(*request);
+    });
+}
+
+void PluginSandboxWorker::handleConnectionLost()
+{
+    juce::MessageManager::callAsync([] { juce::JUCEApplicationBase::quit(); });
+}
+
+void PluginSandboxWorker::handleRequest(const juce::XmlElement& request)
+{
+    juce::XmlElement response("REPLY");
+    response.setAttribute("id", request.getIntAttribute("id"));
+    juce::String error;
+    auto ok = true;
+
+    try
+    {
+        if (request.hasTagName("LOAD"))
+        {
+            ok = load(request, response, error);
+        }
+        else if (instance == nullptr)
+        {
+            ok = false;
+            error = "No plugin loaded in the sandbox";
+        }
+        else if (request.hasTagName("PREPARE"))
+        {
+            prepare(request.getDoubleAttribute("sampleRate"), request.getIntAttribute("blockSize"));
+        }
+        else if (request.hasTagName("RELEASE"))
+        {
+            const juce::ScopedLock sl(processLock);
+            instance->releaseResources();
+        }
+        else if (request.hasTagName("RESET"))
+        {
+            const juce::ScopedLock sl(processLock);
+            instance->reset();
+        }
+        else if (request.hasTagName("GET_STATE"))
+        {
+            juce::MemoryBlock state;
+            instance->getStateInformation(state);
+            response.setAttribute("state", state.toBase64Encoding());
+        }
+        else if (request.hasTagName("SET_STATE"))
+        {
+            juce::MemoryBlock state;
+            if (state.fromBase64Encoding(request.getStringAttribute("state")))
+            {
+                const juce::ScopedLock sl(processLock);
+                instance->setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+            }
+        }
+        else if (request.hasTagName("SHOW_EDITOR"))
+        {
+            if (editorWindow == nullptr)
+                if (auto* editor = instance->createEditorIfNeeded())
+                    editorWindow = std::make_unique<EditorWindow>(instance->getName(), editor);
+            if (editorWindow != nullptr)
+            {
+                editorWindow->setVisible(true);
+                editorWindow->toFront(true);
+            }
+        }
+        else if (request.hasTagName("HIDE_EDITOR"))
+        {
+            editorWindow.reset();
+        }
+    }
+    catch (...)
+    {
+        ok = false;
+        error = "Plugin threw while handling " + request.getTagName();
+    }
+
+    if (instance != nullptr)
+    {
+        response.setAttribute("latency", instance->getLatencySamples());
+        response.setAttribute("tail", instance->getTailLengthSeconds());
+    }
+    response.setAttribute("ok", ok);
+    if (! ok)
+        response.setAttribute("error", error);
+
+    // Editor requests are fire-and-forget; everything else is awaited.
+    if (request.hasAttribute("id"))
+        sendMessageToCoordinator(toMessage(response));
+}
+
+bool PluginSandboxWorker::load(const juce::XmlElement& request, juce::XmlElement& response, juce::String& error)
+{
+    if (instance != nullptr)
+    {
+        error = "The sandbox already hosts a plugin";
+        return false;
+    }
+
+    transport = SandboxTransport::open(juce::File(request.getStringAttribute("channel")), error);
+    if (transport == nullptr)
+        return false;
+
+    juce::PluginDescription description;
+    const auto* descriptionXml = request.getChildByName("PLUGIN");
+    if (descriptionXml == nullptr || ! description.loadFromXml(*descriptionXml))
+    {
+        error = "Sandbox received no plugin description";
+        return false;
+    }
+
+    // Resolve the file here rather than in the host: that is already the first call
+    // into the plugin's own code.
+    for (int i = 0; i < formatManager.getNumFormats(); ++i)
+    {
+        auto* format = formatManager.getFormat(i);
+        if (format == nullptr || format->getName() != description.pluginFormatName)
+            continue;
+
+        juce::OwnedArray<juce::PluginDescription> types;
+        format->findAllTypesForFile(types, description.fileOrIdentifier);
+        if (! types.isEmpty())
+            description = *types[0];
+        break;
+    }
+
+    const auto sampleRate = request.getDoubleAttribute("sampleRate");
+    const auto blockSize = request.getIntAttribute("blockSize");
+    instance = formatManager.createPluginInstance(description, sampleRate, blockSize, error);
+    if (instance == nullptr)
+        return false;
+
+    prepare(sampleRate, blockSize);
+    response.addChildElement(description.createXml().release());
+    response.setAttribute("editor", instance->hasEditor());
+
+    audioThread = std::make_unique<AudioThread>(*this, *transport);
+    if (! audioThread->startRealtimeThread(juce::Thread::RealtimeOptions {}.withPriority(9)))
+        audioThread->startThread(juce::Thread::Priority::highest);
+    return true;
+}
+
+void PluginSandboxWorker::prepare(double sampleRate, int blockSize)
+{
+    const juce::ScopedLock sl(processLock);
+    instance->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    instance->releaseResources();
+    instance->prepareToPlay(sampleRate, blockSize);
+    instance->reset();
+}
+
+void PluginSandboxWorker::stopAudio()
+{
+    if (audioThread != nullptr)
+        audioThread->stopThread(1000);
+    audioThread.reset();
+}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../core/LatencyHistogram.h"
+#include "SandboxTransport.h"
+#include <atomic>
+#include <memory>
+
+namespace fizzle
+{
+// Command-line id a sandbox helper is launched with. The application checks for it
+// before doing anything else and runs as a PluginSandboxWorker instead.
+inline constexpr const char* kPluginSandboxProcessId = "fizzle-plugin-sandbox";
+
+// Host-side stand-in for a plugin that runs in a helper process.
+//
+// Every instance launches its own helper, a copy of this executable in sandbox mode, so
+// a crash or hang takes down one plugin at most. Control calls (prepare, state, editor)
+// go over JUCE's child-process pipe and block their caller for a bounded time. Audio
+// goes through a SandboxTransport: the whole round trip of a block gets
+// kDeadlineFraction of the block's duration, and the block passes through dry when the
+// helper is late, still busy with a block the host gave up on, or gone. MIDI is not
+// forwarded.
+class SandboxedPluginInstance final : public juce::AudioPluginInstance
+{
+public:
+    static constexpr double kDeadlineFraction = 0.5;
+    static constexpr int kMaxBlockSize = 16384;
+
+    struct Stats
+    {
+        bool alive { false };
+        // Round trip minus the helper's own processing time, over the last window.
+        double overheadP99Us { 0.0 };
+        double overheadMaxUs { 0.0 };
+        uint32_t missedBlocks { 0 };
+    };
+
+    // Not realtime safe. Launches the helper and loads the plugin in it.
+    static std::unique_ptr<SandboxedPluginInstance> create(const juce::PluginDescription& description,
+                                                           double sampleRate,
+                                                           int blockSize,
+                                                           juce::String& error);
+    ~SandboxedPluginInstance() override;
+
+    // Message thread. Summarises the blocks processed since the previous call.
+    Stats takeStats();
+
+    void fillInPluginDescription(juce::PluginDescription& out) const override { out = description; }
+    const juce::String getName() const override { return description.name; }
+    void prepareToPlay(double sampleRate, int blockSize) override;
+    void releaseResources() override;
+    void reset() override;
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override;
+    double getTailLengthSeconds() const override { return tailSeconds; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return remoteHasEditor; }
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+private:
+    class Connection;
+    class Editor;
+
+    explicit SandboxedPluginInstance(const juce::PluginDescription& descriptionToUse);
+
+    // Sends one control request and waits up to timeoutMs for its reply. Returns null on
+    // timeout or when the helper is gone.
+    std::unique_ptr<juce::XmlElement> call(juce::XmlElement request, int timeoutMs);
+    bool send(const juce::XmlElement& request);
+    void handleReply(const juce::MemoryBlock& message);
+    void handleHelperLost();
+
+    juce::PluginDescription description;
+    std::unique_ptr<SandboxTransport> transport;
+    std::unique_ptr<Connection> connection;
+    std::atomic<bool> alive { false };
+    std::atomic<double> preparedSampleRate { 0.0 };
+    double tailSeconds { 0.0 };
+    bool remoteHasEditor { false };
+
+    juce::CriticalSection callLock;
+    juce::CriticalSection replyLock;
+    juce::WaitableEvent replyReady;
+    std::unique_ptr<juce::XmlElement> reply;
+    int awaitedRequestId { 0 };
+    int lastRequestId { 0 };
+
+    // Audio thread writes, message thread reads.
+    LatencyHistogram overhead;
+    std::atomic<uint32_t> missedBlocks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxedPluginInstance)
+};
+
+// Helper-process side of the sandbox. Loads one plugin, answers the host's control
+// requests on the message thread and processes audio blocks from the shared channel on
+// a realtime thread. The process quits as soon as the host goes away.
+class PluginSandboxWorker final : public juce::ChildProcessWorker
+{
+public:
+    PluginSandboxWorker();
+    ~PluginSandboxWorker() override;
+
+    static bool isSandboxCommandLine(const juce::String& commandLine);
+
+    void handleMessageFromCoordinator(const juce::MemoryBlock& message) override;
+    void handleConnectionLost() override;
+
+private:
+    class AudioThread;
+    class EditorWindow;
+
+    juce::AudioPluginFormatManager formatManager;
+    std::unique_ptr<juce::AudioPluginInstance> instance;
+    std::unique_ptr<SandboxTransport> transport;
+    std::unique_ptr<AudioThread> audioThread;
+    std::unique_ptr<EditorWindow> editorWindow;
+    // Held by the audio thread around each block and by control requests that
+    // reconfigure the plugin.
+    juce::CriticalSection processLock;
+
+    void handleRequest(const juce::XmlElement& request);
+    bool load(const juce::XmlElement& request, juce::XmlElement& response, juce::String& error);
+    void prepare(double sampleRate, int blockSize);
+    void stopAudio();
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PluginSandboxWorker)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginSandboxWorker)
+};
+}
@@ -0,0 +1,285 @@
+#include "SandboxTransport.h"
+#include "../core/CpuRelax.h"
+#include <chrono>
+#include <climits>
+#include <new>
+#include <thread>
+
+#if JUCE_LINUX
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#endif
+
+namespace fizzle
+{
+struct SandboxTransport::Header
+{
+    uint32_t magic { 0 };
+    uint32_t maxSamples { 0 };
+    std::atomic<uint32_t> requestSeq { 0 };
+    std::atomic<uint32_t> responseSeq { 0 };
+    std::atomic<uint32_t> numChannels { 0 };
+    std::atomic<uint32_t> numSamples { 0 };
+    std::atomic<uint64_t> helperNanos { 0 };
+};
+
+namespace
+{
+constexpr uint32_t kMagic = 0x465a5342; // "FZSB"
+constexpr size_t kHeaderBytes = 64;
+// A few microseconds of pause instructions before sleeping in the kernel. Long enough
+// to catch a helper that answers straight away, short enough not to starve it when
+// both sides share a core.
+constexpr int kSpinIterations = 128;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "sandbox sequence words are shared between processes and must be address-free");
+
+size_t getMappedBytes(int maxSamples)
+{
+    return kHeaderBytes + sizeof(float) * static_cast<size_t>(SandboxTransport::kMaxChannels) * static_cast<size_t>(maxSamples);
+}
+}
+
+#if JUCE_WINDOWS
+// Windows cannot wait on an address across processes, so each sequence word gets a
+// named auto-reset event derived from the channel file name.
+struct SandboxTransport::Signals
+{
+    HANDLE request { nullptr };
+    HANDLE response { nullptr };
+
+    Signals(const juce::File& channelFile, bool isOwner)
+    {
+        const auto base = "Local\\" + channelFile.getFileNameWithoutExtension();
+        request = openOrCreate(base + "-request", isOwner);
+        response = openOrCreate(base + "-response", isOwner);
+    }
+
+    ~Signals()
+    {
+        if (request != nullptr)
+            CloseHandle(request);
+        if (response != nullptr)
+            CloseHandle(response);
+    }
+
+    bool isValid() const noexcept { return request != nullptr && response != nullptr; }
+
+    static HANDLE openOrCreate(const juce::String& name, bool isOwner)
+    {
+        return isOwner ? CreateEventW(nullptr, FALSE, FALSE, name.toWideCharPointer())
+                       : OpenEventW(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name.toWideCharPointer());
+    }
+};
+#else
+// Futexes on Linux wait on the shared word itself; elsewhere waits degrade to short sleeps.
+struct SandboxTransport::Signals
+{
+    Signals(const juce::File&, bool) {}
+    bool isValid() const noexcept { return true; }
+};
+#endif
+
+SandboxTransport::~SandboxTransport()
+{
+    signals.reset();
+    mapping.reset();
+    if (ownsFile)
+        file.deleteFile();
+}
+
+std::unique_ptr<SandboxTransport> SandboxTransport::create(int maxSamples, juce::String& error)
+{
+    // Prefer the RAM-backed tmpfs where there is one so the mapping never touches a disk.
+    auto folder = juce::File("/dev/shm");
+    if (! folder.isDirectory())
+        folder = juce::File::getSpecialLocation(juce::File::tempDirectory);
+
+    const auto name = "fizzle-sandbox-" + juce::String::toHexString(juce::Random::getSystemRandom().nextInt64());
+    const auto channelFile = folder.getNonexistentChildFile(name, ".buf", false);
+    const juce::MemoryBlock zeros(getMappedBytes(juce::jmax(1, maxSamples)), true);
+    if (! channelFile.replaceWithData(zeros.getData(), zeros.getSize()))
+    {
+        error = "Could not create sandbox audio channel: " + channelFile.getFullPathName();
+        return {};
+    }
+
+    std::unique_ptr<SandboxTransport> transport(new SandboxTransport());
+    if (! transport->map(channelFile, true, error))
+        return {};
+
+    auto* header = new (transport->header) Header();
+    header->magic = kMagic;
+    header->maxSamples = static_cast<uint32_t>(juce::jmax(1, maxSamples));
+    transport->maxSamples = static_cast<int>(header->maxSamples);
+    return transport;
+}
+
+std::unique_ptr<SandboxTransport> SandboxTransport::open(const juce::File& channelFile, juce::String& error)
+{
+    std::unique_ptr<SandboxTransport> transport(new SandboxTransport());
+    if (! transport->map(channelFile, false, error))
+        return {};
+
+    const auto declared = static_cast<int>(transport->header->maxSamples);
+    if (transport->header->magic != kMagic || declared <= 0
+        || transport->mapping->getSize() < getMappedBytes(declared))
+    {
+        error = "Sandbox audio channel is not valid: " + channelFile.getFullPathName();
+        return {};
+    }
+
+    transport->maxSamples = declared;
+    transport->submittedSeq = transport->header->requestSeq.load();
+    return transport;
+}
+
+bool SandboxTransport::map(const juce::File& fileToMap, bool isOwner, juce::String& error)
+{
+    file = fileToMap;
+    ownsFile = isOwner;
+    mapping = std::make_unique<juce::MemoryMappedFile>(fileToMap, juce::MemoryMappedFile::readWrite, false);
+    if (mapping->getData() == nullptr || mapping->getSize() < kHeaderBytes)
+    {
+        error = "Could not map sandbox audio channel: " + fileToMap.getFullPathName();
+        return false;
+    }
+
+    signals = std::make_unique<Signals>(fileToMap, isOwner);
+    if (! signals->isValid())
+    {
+        error = "Could not open sandbox wake-up events for " + fileToMap.getFileName();
+        return false;
+    }
+
+    header = static_cast<Header*>(mapping->getData());
+    auto* audio = reinterpret_cast<float*>(static_cast<char*>(mapping->getData()) + kHeaderBytes);
+    const auto samplesPerChannel = (mapping->getSize() - kHeaderBytes) / (sizeof(float) * kMaxChannels);
+    for (int c = 0; c < kMaxChannels; ++c)
+        channels[c] = audio + static_cast<size_t>(c) * samplesPerChannel;
+    return true;
+}
+
+bool SandboxTransport::isIdle() const noexcept
+{
+    return header != nullptr && header->responseSeq.load(std::memory_order_acquire) == submittedSeq;
+}
+
+bool SandboxTransport::submit(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    const auto numSamples = buffer.getNumSamples();
+    if (! isIdle() || numSamples > maxSamples)
+        return false;
+
+    const auto numChannels = juce::jmin(kMaxChannels, buffer.getNumChannels());
+    for (int c = 0; c < numChannels; ++c)
+        juce::FloatVectorOperations::copy(channels[c], buffer.getReadPointer(c), numSamples);
+
+    header->numChannels.store(static_cast<uint32_t>(numChannels), std::memory_order_relaxed);
+    header->numSamples.store(static_cast<uint32_t>(numSamples), std::memory_order_relaxed);
+    header->requestSeq.store(++submittedSeq, std::memory_order_release);
+    wake(header->requestSeq);
+    return true;
+}
+
+bool SandboxTransport::awaitResponse(juce::AudioBuffer<float>& buffer, juce::int64 deadlineTicks) noexcept
+{
+    for (int spin = 0;; ++spin)
+    {
+        const auto response = header->responseSeq.load(std::memory_order_acquire);
+        if (response == submittedSeq)
+            break;
+
+        const auto remaining = deadlineTicks - juce::Time::getHighResolutionTicks();
+        if (remaining <= 0)
+            return false;
+
+        if (spin < kSpinIterations)
+            FIZZLE_CPU_RELAX();
+        else
+            waitWhile(header->responseSeq, response,
+                      static_cast<juce::int64>(juce::Time::highResolutionTicksToSeconds(remaining) * 1.0e9));
+    }
+
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), getNumChannels());
+    const auto numSamples = juce::jmin(buffer.getNumSamples(), getNumSamples());
+    for (int c = 0; c < numChannels; ++c)
+        juce::FloatVectorOperations::copy(buffer.getWritePointer(c), channels[c], numSamples);
+    return true;
+}
+
+uint64_t SandboxTransport::getLastHelperNanos() const noexcept
+{
+    return header->helperNanos.load(std::memory_order_relaxed);
+}
+
+bool SandboxTransport::waitForRequest(int timeoutMs) noexcept
+{
+    const auto answered = header->responseSeq.load(std::memory_order_relaxed);
+    for (int spin = 0; spin < kSpinIterations; ++spin)
+    {
+        if (header->requestSeq.load(std::memory_order_acquire) != answered)
+            return true;
+        FIZZLE_CPU_RELAX();
+    }
+
+    waitWhile(header->requestSeq, answered, static_cast<juce::int64>(timeoutMs) * 1000000);
+    return header->requestSeq.load(std::memory_order_acquire) != answered;
+}
+
+int SandboxTransport::getNumChannels() const noexcept
+{
+    return juce::jmin(kMaxChannels, static_cast<int>(header->numChannels.load(std::memory_order_relaxed)));
+}
+
+int SandboxTransport::getNumSamples() const noexcept
+{
+    return juce::jmin(maxSamples, static_cast<int>(header->numSamples.load(std::memory_order_relaxed)));
+}
+
+void SandboxTransport::completeRequest(uint64_t helperNanos) noexcept
+{
+    header->helperNanos.store(helperNanos, std::memory_order_relaxed);
+    header->responseSeq.store(header->requestSeq.load(std::memory_order_relaxed), std::memory_order_release);
+    wake(header->responseSeq);
+}
+
+void SandboxTransport::wake(std::atomic<uint32_t>& word) noexcept
+{
+#if JUCE_LINUX
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#elif JUCE_WINDOWS
+    SetEvent(&word == &header->requestSeq ? signals->request : signals->response);
+#else
+    juce::ignoreUnused(word);
+#endif
+}
+
+void SandboxTransport::waitWhile(std::atomic<uint32_t>& word, uint32_t expected, juce::int64 timeoutNanos) noexcept
+{
+    if (timeoutNanos <= 0 || word.load(std::memory_order_acquire) != expected)
+        return;
+
+#if JUCE_LINUX
+    timespec timeout {};
+    timeout.tv_sec = static_cast<time_t>(timeoutNanos / 1000000000);
+    timeout.tv_nsec = static_cast<long>(timeoutNanos % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#elif JUCE_WINDOWS
+    // Event waits have millisecond resolution; below that, yield and let the caller poll.
+    if (timeoutNanos < 1000000)
+    {
+        std::this_thread::yield();
+        return;
+    }
+    WaitForSingleObject(&word == &header->requestSeq ? signals->request : signals->response,
+                        static_cast<DWORD>(timeoutNanos / 1000000));
+#else
+    std::this_thread::sleep_for(std::chrono::nanoseconds(juce::jmin<juce::int64>(timeoutNanos, 100000)));
+#endif
+}
+}
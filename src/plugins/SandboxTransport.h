@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace fizzle
+{
+// Shared-memory audio channel between the host and one plugin sandbox process.
+//
+// Both processes map the same small file holding one request/response slot. The host
+// writes a block and bumps requestSeq; the helper processes the audio in place and
+// publishes the same value in responseSeq. The two sequence words are also the wake-up
+// points: a futex on Linux, a pair of named events on Windows and short sleeps
+// elsewhere. Only the host waits with a deadline, and it never reuses the slot until
+// the helper has answered, so a helper that hangs or dies costs the audio thread at
+// most one deadline and dry audio from then on.
+class SandboxTransport
+{
+public:
+    static constexpr int kMaxChannels = 2;
+
+    ~SandboxTransport();
+
+    // Not realtime safe. create() makes a new channel file on the host side; open() maps
+    // an existing one from the helper.
+    static std::unique_ptr<SandboxTransport> create(int maxSamples, juce::String& error);
+    static std::unique_ptr<SandboxTransport> open(const juce::File& file, juce::String& error);
+
+    const juce::File& getFile() const noexcept { return file; }
+    int getMaxSamples() const noexcept { return maxSamples; }
+
+    // Host side, realtime safe. submit() refuses while the helper still owns the slot
+    // (including a block the host already gave up on). awaitResponse() copies the
+    // processed block back and returns true only if it arrived before deadlineTicks,
+    // measured in juce::Time high-resolution ticks; otherwise the buffer is untouched.
+    bool isIdle() const noexcept;
+    bool submit(const juce::AudioBuffer<float>& buffer) noexcept;
+    bool awaitResponse(juce::AudioBuffer<float>& buffer, juce::int64 deadlineTicks) noexcept;
+    // Time the helper spent inside the plugin for the last answered block.
+    uint64_t getLastHelperNanos() const noexcept;
+
+    // Helper side. waitForRequest() returns true when a block is waiting; the helper
+    // then processes getNumChannels() x getNumSamples() samples at getChannels() in
+    // place and calls completeRequest().
+    bool waitForRequest(int timeoutMs) noexcept;
+    float* const* getChannels() noexcept { return channels; }
+    int getNumChannels() const noexcept;
+    int getNumSamples() const noexcept;
+    void completeRequest(uint64_t helperNanos) noexcept;
+
+private:
+    struct Header;
+    struct Signals;
+
+    SandboxTransport() = default;
+    bool map(const juce::File& fileToMap, bool isOwner, juce::String& error);
+    void wake(std::atomic<uint32_t>& word) noexcept;
+    // Sleeps while word still holds expected, for at most timeoutNanos.
+    void waitWhile(std::atomic<uint32_t>& word, uint32_t expected, juce::int64 timeoutNanos) noexcept;
+
+    juce::File file;
+    bool ownsFile { false };
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    std::unique_ptr<Signals> signals;
+    Header* header { nullptr };
+    float* channels[kMaxChannels] {};
+    int maxSamples { 0 };
+    uint32_t submittedSeq { 0 };
+};
+}
@@ -1,6 +1,13 @@
 #include "VstHost.h"
 #include "../AppConfig.h"
+#include "../audio/SimdKernels.h"
 #include "../core/Logger.h"
+#include "../core/Tracer.h"
+#include "PluginSandbox.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
 #if JUCE_WINDOWS && defined(_MSC_VER)
 #include <windows.h>
 #endif
@@ -20,6 +27,15 @@ juce::AudioPluginFormat* getVst3Format(juce::AudioPluginFormatManager& fm)
     return nullptr;
 }
 
+// How often the message thread looks for chains the audio thread has swapped out, while
+// an edit is waiting to be adopted.
+constexpr int kReclaimIntervalMs = 100;
+
+// A caller that passes no maximum block can still run a sample or two over the prepared
+// size while resampling, so pipeline slots and the latency they imply leave some
+// headroom per stage.
+constexpr int kPipelineSlack = 16;
+
 void sanitizeProcessingFormat(double& sampleRate, int& blockSize)
 {
     if (sampleRate <= 1000.0)
@@ -74,12 +90,37 @@ VstHost::VstHost()
     formatManager.addDefaultFormats();
 }
 
+VstHost::~VstHost()
+{
+    // The audio side must be stopped by now, so every snapshot can go from here.
+    stopTimer();
+    reclaimRetiredChains();
+    delete pendingChain.exchange(nullptr);
+    delete activeChain;
+    activeChain = nullptr;
+}
+
 bool VstHost::createHostedPlugin(const juce::PluginDescription& description,
                                  double sampleRate,
                                  int blockSize,
                                  juce::String& error,
                                  HostedPluginPtr& outHosted)
 {
+    if (sandboxPlugins.load())
+    {
+        sanitizeProcessingFormat(sampleRate, blockSize);
+        auto sandboxed = SandboxedPluginInstance::create(description, sampleRate, blockSize, error);
+        if (sandboxed == nullptr)
+            return false;
+
+        auto hosted = std::make_shared<HostedPlugin>();
+        hosted->description = sandboxed->getPluginDescription();
+        hosted->instance = std::move(sandboxed);
+        hosted->sandboxed = true;
+        outHosted = std::move(hosted);
+        return true;
+    }
+
     auto* vst3Format = getVst3Format(formatManager);
     if (vst3Format == nullptr)
     {
@@ -120,33 +161,239 @@ std::vector<VstHost::HostedPluginPtr> VstHost::copyChainSnapshot() const
     return chain;
 }
 
-void VstHost::refreshLatencyCacheLocked()
+std::vector<VstHost::ChainSnapshot::Step> VstHost::buildSteps(const std::vector<HostedPluginPtr>& plugins)
+{
+    std::vector<ChainSnapshot::Step> steps;
+    size_t i = 0;
+    while (i < plugins.size())
+    {
+        ChainSnapshot::Step step;
+        const auto branchOf = [&plugins](size_t index)
+        {
+            return plugins[index] != nullptr ? juce::jlimit(0, kMaxBranches, plugins[index]->branch.load()) : 0;
+        };
+
+        if (branchOf(i) == 0)
+        {
+            step.branches.resize(1);
+            for (; i < plugins.size() && branchOf(i) == 0; ++i)
+                step.branches.front().push_back(plugins[i].get());
+        }
+        else
+        {
+            // Branches keep their number order; plugins keep chain order within a branch.
+            std::array<std::vector<HostedPlugin*>, kMaxBranches> byBranch;
+            for (; i < plugins.size() && branchOf(i) != 0; ++i)
+                byBranch[static_cast<size_t>(branchOf(i) - 1)].push_back(plugins[i].get());
+            for (auto& branch : byBranch)
+                if (! branch.empty())
+                    step.branches.push_back(std::move(branch));
+        }
+
+        // A section that only uses one branch number is just a serial run.
+        if (! steps.empty() && steps.back().branches.size() == 1 && step.branches.size() == 1)
+        {
+            auto& run = steps.back().branches.front();
+            run.insert(run.end(), step.branches.front().begin(), step.branches.front().end());
+        }
+        else
+        {
+            steps.push_back(std::move(step));
+        }
+    }
+    return steps;
+}
+
+std::vector<int> VstHost::splitPipelineLocked(bool useMeasuredCost) const
+{
+    const auto hasBranches = std::any_of(chain.begin(), chain.end(),
+                                         [](const auto& p) { return p != nullptr && p->branch.load() > 0; });
+    const auto numPlugins = static_cast<int>(chain.size());
+    const auto stages = juce::jmin(requestedPipelineStages, numPlugins);
+    if (hasBranches || stages < 2)
+        return {};
+
+    // Plugins that have not been measured yet count as equally expensive.
+    std::vector<double> prefix(static_cast<size_t>(numPlugins) + 1, 0.0);
+    for (int i = 0; i < numPlugins; ++i)
+    {
+        const auto& p = chain[static_cast<size_t>(i)];
+        auto cost = 1.0;
+        if (useMeasuredCost && p != nullptr)
+            cost = (p->enabled.load() && ! p->faulted.load()) ? juce::jmax(1.0, static_cast<double>(p->profile.meanUs.load())) : 0.0;
+        prefix[static_cast<size_t>(i) + 1] = prefix[static_cast<size_t>(i)] + cost;
+    }
+
+    // Contiguous split into `stages` parts minimising the most expensive part. Chains are
+    // a handful of plugins, so the plain O(stages * n^2) table is plenty.
+    const auto n = static_cast<size_t>(numPlugins);
+    const auto stageCount = static_cast<size_t>(stages);
+    std::vector<std::vector<double>> best(stageCount + 1, std::vector<double>(n + 1, std::numeric_limits<double>::max()));
+    std::vector<std::vector<size_t>> cut(stageCount + 1, std::vector<size_t>(n + 1, 0));
+    best[0][0] = 0.0;
+    for (size_t k = 1; k <= stageCount; ++k)
+        for (size_t i = k; i <= n; ++i)
+            for (size_t j = k - 1; j < i; ++j)
+            {
+                const auto cost = juce::jmax(best[k - 1][j], prefix[i] - prefix[j]);
+                if (cost < best[k][i])
+                {
+                    best[k][i] = cost;
+                    cut[k][i] = j;
+                }
+            }
+
+    std::vector<int> starts(stageCount, 0);
+    for (size_t k = stageCount, i = n; k > 0; --k)
+    {
+        i = cut[k][i];
+        starts[k - 1] = static_cast<int>(i);
+    }
+    return starts;
+}
+
+int VstHost::getPipelineLatencySamples(int stages, int blockSize) noexcept
+{
+    return stages > 1 ? (stages - 1) * (blockSize + kPipelineSlack) : 0;
+}
+
+void VstHost::publishChainLocked()
+{
+    updatePluginLatenciesLocked();
+    auto* next = new ChainSnapshot { chain, buildSteps(chain), {} };
+    const auto hasParallelStep = std::any_of(next->steps.begin(), next->steps.end(),
+                                             [](const auto& step) { return step.branches.size() > 1; });
+
+    // Delay lines for aligning parallel branches are sized for every plugin in the section
+    // running, so enabling one later still fits. A plugin that raises its latency past
+    // that without an edit is only partly compensated until the next publish.
+    for (auto& step : next->steps)
+    {
+        if (step.branches.size() < 2)
+            continue;
+
+        int longest = 0;
+        for (const auto& branch : step.branches)
+            longest = juce::jmax(longest, getBranchLatencySamples(branch, false));
+        if (longest > 0)
+        {
+            step.delays.resize(step.branches.size());
+            for (auto& delay : step.delays)
+                delay.line.setSize(2, longest + 1);
+        }
+    }
+
+    publishedPipelineSplit = splitPipelineLocked(true);
+    for (size_t s = 0; s < publishedPipelineSplit.size(); ++s)
+    {
+        const auto end = s + 1 < publishedPipelineSplit.size() ? static_cast<size_t>(publishedPipelineSplit[s + 1]) : chain.size();
+        auto& stage = next->pipelineStages.emplace_back();
+        for (auto i = static_cast<size_t>(publishedPipelineSplit[s]); i < end; ++i)
+            stage.push_back(chain[i].get());
+    }
+
+    // Workers start with the first parallel section or pipeline and stay for the host's
+    // lifetime. The audio thread only touches the pool through a snapshot published after
+    // this point.
+    if ((hasParallelStep || ! publishedPipelineSplit.empty()) && workerPool == nullptr)
+    {
+        const auto workers = juce::jmin(juce::jmax(kMaxBranches, kMaxPipelineStages) - 1, juce::SystemStats::getNumCpus() - 1);
+        if (workers > 0)
+            workerPool = std::make_unique<RealtimeWorkerPool>(workers);
+    }
+
+    // A snapshot still in the mailbox was never seen by the audio thread.
+    delete pendingChain.exchange(next, std::memory_order_acq_rel);
+    reclaimRetiredChains();
+
+    // The chain this one replaces is only retired once the audio thread adopts it; the
+    // timer picks it up from there if no further edit does first.
+    startTimer(kReclaimIntervalMs);
+}
+
+const VstHost::ChainSnapshot* VstHost::adoptPublishedChain() noexcept
+{
+    // Only swap when the outgoing chain has somewhere to go; otherwise keep running the
+    // current one and pick the edit up on a later block.
+    if (pendingChain.load(std::memory_order_acquire) == nullptr || retiredFifo.getFreeSpace() < 1)
+        return activeChain;
+
+    // Only this thread empties the mailbox, so it still holds a snapshot after the
+    // retire below. Retiring first means that once the mailbox reads empty, the outgoing
+    // chain is already queued for the message thread.
+    if (activeChain != nullptr)
+    {
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+        retiredChains[static_cast<size_t>(size1 > 0 ? start1 : start2)] = activeChain;
+        retiredFifo.finishedWrite(1);
+    }
+
+    activeChain = pendingChain.exchange(nullptr, std::memory_order_acq_rel);
+    return activeChain;
+}
+
+void VstHost::reclaimRetiredChains()
+{
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    retiredFifo.prepareToRead(retiredFifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1; ++i)
+        delete std::exchange(retiredChains[static_cast<size_t>(start1 + i)], nullptr);
+    for (int i = 0; i < size2; ++i)
+        delete std::exchange(retiredChains[static_cast<size_t>(start2 + i)], nullptr);
+    retiredFifo.finishedRead(size1 + size2);
+}
+
+void VstHost::timerCallback()
+{
+    const juce::ScopedLock sl(chainLock);
+    const auto adopted = pendingChain.load(std::memory_order_acquire) == nullptr;
+    reclaimRetiredChains();
+    if (adopted)
+        stopTimer();
+}
+
+void VstHost::updatePluginLatenciesLocked()
 {
-    int total = 0;
     for (const auto& plugin : chain)
     {
-        if (plugin == nullptr || plugin->instance == nullptr || ! plugin->enabled.load()
-            || plugin->faulted.load() || plugin->editorOpen.load())
+        if (plugin == nullptr || plugin->instance == nullptr || plugin->faulted.load())
             continue;
 
+        // getLatencySamples() only reads the value the processor last reported, so it
+        // needs no callbackLock and cannot cost the audio thread a block.
         try
         {
-            const juce::SpinLock::ScopedTryLockType lock(plugin->callbackLock);
-            if (! lock.isLocked())
-                continue;
-            total += plugin->instance->getLatencySamples();
+            plugin->profile.latencySamples.store(plugin->instance->getLatencySamples());
         }
         catch (...)
         {
             Logger::instance().log("VST latency query failed for " + plugin->description.name);
         }
     }
+}
+
+void VstHost::refreshLatencyCacheLocked()
+{
+    updatePluginLatenciesLocked();
+
+    // Parallel sections are aligned to their slowest branch, which is what they add.
+    int total = 0;
+    for (const auto& step : buildSteps(chain))
+    {
+        int slowestBranch = 0;
+        for (const auto& branch : step.branches)
+            slowestBranch = juce::jmax(slowestBranch, getBranchLatencySamples(branch, true));
+        total += slowestBranch;
+    }
 
+    total += getPipelineLatencySamples(static_cast<int>(publishedPipelineSplit.size()), activeMaxBlockSize.load());
     cachedLatencySamples.store(total);
 }
 
 juce::StringArray VstHost::scanFolder(const juce::File& folder)
 {
+    const TraceScope trace("host", "VST scan", folder.getFileName());
     juce::StringArray found;
 
     if (! folder.isDirectory())
@@ -235,6 +482,7 @@ bool VstHost::addPlugin(const juce::PluginDescription& description, double sampl
 
     const juce::ScopedLock sl(chainLock);
     chain.push_back(std::move(hosted));
+    publishChainLocked();
     refreshLatencyCacheLocked();
     return true;
 }
@@ -285,12 +533,46 @@ bool VstHost::addPluginWithState(const juce::PluginDescription& description,
     {
         const juce::ScopedLock sl(chainLock);
         chain.push_back(std::move(hosted));
+        publishChainLocked();
         refreshLatencyCacheLocked();
     }
 
     return true;
 }
 
+bool VstHost::addPluginInstance(std::unique_ptr<juce::AudioPluginInstance> instance, double sampleRate, int blockSize, juce::String& error)
+{
+    if (instance == nullptr)
+    {
+        error = "No plugin instance";
+        return false;
+    }
+
+    const auto activeRate = activeProcessingSampleRate.load();
+    const auto activeBlock = activeProcessingBlockSize.load();
+    if (activeRate > 1000.0 && activeBlock > 0)
+    {
+        sampleRate = activeRate;
+        blockSize = activeBlock;
+    }
+    sanitizeProcessingFormat(sampleRate, blockSize);
+
+    auto hosted = std::make_shared<HostedPlugin>();
+    instance->fillInPluginDescription(hosted->description);
+    hosted->instance = std::move(instance);
+    if (! preparePluginInstance(*hosted, sampleRate, blockSize, "prepare"))
+    {
+        error = "Plugin failed to initialize: " + hosted->description.name;
+        return false;
+    }
+
+    const juce::ScopedLock sl(chainLock);
+    chain.push_back(std::move(hosted));
+    publishChainLocked();
+    refreshLatencyCacheLocked();
+    return true;
+}
+
 bool VstHost::findDescriptionByIdentifier(const juce::String& identifier, juce::PluginDescription& out) const
 {
     for (const auto& s : scanned)
@@ -314,6 +596,7 @@ void VstHost::removePlugin(int index)
         return;
 
     chain.erase(chain.begin() + index);
+    publishChainLocked();
     refreshLatencyCacheLocked();
 }
 
@@ -328,6 +611,7 @@ void VstHost::movePlugin(int from, int to)
     auto item = std::move(chain[static_cast<size_t>(from)]);
     chain.erase(chain.begin() + from);
     chain.insert(chain.begin() + to, std::move(item));
+    publishChainLocked();
 }
 
 void VstHost::swapPlugin(int first, int second)
@@ -339,6 +623,7 @@ void VstHost::swapPlugin(int first, int second)
         return;
 
     std::swap(chain[static_cast<size_t>(first)], chain[static_cast<size_t>(second)]);
+    publishChainLocked();
 }
 
 void VstHost::setEnabled(int index, bool enabled)
@@ -354,6 +639,82 @@ void VstHost::setEnabled(int index, bool enabled)
         refreshLatencyCacheLocked();
 }
 
+void VstHost::setBranch(int index, int branch)
+{
+    const juce::ScopedLock sl(chainLock);
+    if (! juce::isPositiveAndBelow(index, static_cast<int>(chain.size())))
+        return;
+
+    if (auto& p = chain[static_cast<size_t>(index)])
+    {
+        p->branch.store(juce::jlimit(0, kMaxBranches, branch));
+        publishChainLocked();
+        refreshLatencyCacheLocked();
+    }
+}
+
+int VstHost::getBranch(int index) const
+{
+    const juce::ScopedLock sl(chainLock);
+    if (juce::isPositiveAndBelow(index, static_cast<int>(chain.size())))
+        if (auto& p = chain[static_cast<size_t>(index)])
+            return p->branch.load();
+    return 0;
+}
+
+void VstHost::setPipelineStages(int stages)
+{
+    const juce::ScopedLock sl(chainLock);
+    stages = juce::jlimit(1, kMaxPipelineStages, stages);
+    if (stages == requestedPipelineStages)
+        return;
+
+    requestedPipelineStages = stages;
+    publishChainLocked();
+    refreshLatencyCacheLocked();
+}
+
+void VstHost::rebalancePipeline()
+{
+    const juce::ScopedLock sl(chainLock);
+    if (publishedPipelineSplit.empty())
+        return;
+
+    const auto proposed = splitPipelineLocked(true);
+    if (proposed == publishedPipelineSplit || proposed.size() != publishedPipelineSplit.size())
+        return;
+
+    const auto heaviestStage = [this](const std::vector<int>& starts)
+    {
+        double heaviest = 0.0;
+        for (size_t s = 0; s < starts.size(); ++s)
+        {
+            const auto end = s + 1 < starts.size() ? static_cast<size_t>(starts[s + 1]) : chain.size();
+            double cost = 0.0;
+            for (auto i = static_cast<size_t>(starts[s]); i < end; ++i)
+                if (const auto& p = chain[i]; p != nullptr && p->enabled.load() && ! p->faulted.load())
+                    cost += juce::jmax(1.0, static_cast<double>(p->profile.meanUs.load()));
+            heaviest = juce::jmax(heaviest, cost);
+        }
+        return heaviest;
+    };
+
+    if (heaviestStage(proposed) < 0.85 * heaviestStage(publishedPipelineSplit))
+        publishChainLocked();
+}
+
+int VstHost::getActivePipelineStages() const
+{
+    const juce::ScopedLock sl(chainLock);
+    return static_cast<int>(publishedPipelineSplit.size());
+}
+
+std::vector<int> VstHost::getPipelineSplit() const
+{
+    const juce::ScopedLock sl(chainLock);
+    return publishedPipelineSplit;
+}
+
 void VstHost::setMix(int index, float mix)
 {
     const juce::ScopedLock sl(chainLock);
@@ -377,75 +738,399 @@ void VstHost::clear()
 {
     const juce::ScopedLock sl(chainLock);
     chain.clear();
-    cachedLatencySamples.store(0);
+    publishChainLocked();
+    refreshLatencyCacheLocked();
 }
 
 void VstHost::processBlock(juce::AudioBuffer<float>& buffer)
 {
-    const auto snapshot = copyChainSnapshot();
-    if (snapshot.empty())
+    const auto* snapshot = adoptPublishedChain();
+    if (snapshot == nullptr || snapshot->plugins.empty())
         return;
 
-    juce::MidiBuffer midi;
-    if (wetBuffer.getNumChannels() != buffer.getNumChannels()
-        || wetBuffer.getNumSamples() != buffer.getNumSamples())
+    midiBuffer.clear();
+
+    // Smoothing for the per-plugin profile: about a second for the mean, a few seconds
+    // for the peak to fall back after a spike.
+    const auto rate = activeProcessingSampleRate.load();
+    const auto blockSeconds = static_cast<double>(buffer.getNumSamples()) / (rate > 1000.0 ? rate : kInternalSampleRate);
+    const auto meanCoeff = static_cast<float>(1.0 - std::exp(-blockSeconds / 1.0));
+    const auto peakDecay = static_cast<float>(std::exp(-blockSeconds / 3.0));
+    lastProcessedBlockSize.store(buffer.getNumSamples(), std::memory_order_relaxed);
+
+    if (snapshot->pipelineStages.size() > 1 && pipelineMaxBlock > 0)
     {
-        wetBuffer.setSize(buffer.getNumChannels(), buffer.getNumSamples(), false, false, true);
+        processPipelined(*snapshot, buffer, meanCoeff, peakDecay);
+        return;
     }
 
-    for (const auto& plugin : snapshot)
+    activePipelineStages = 0;
+    for (const auto& step : snapshot->steps)
     {
-        if (plugin == nullptr || plugin->instance == nullptr || ! plugin->enabled.load()
-            || plugin->faulted.load() || plugin->editorOpen.load())
-            continue;
+        if (step.branches.size() == 1)
+            processBranch(step.branches.front(), buffer, wetBuffer, midiBuffer, meanCoeff, peakDecay);
+        else
+            processParallelStep(step, buffer, meanCoeff, peakDecay);
+    }
+}
 
-        const juce::SpinLock::ScopedTryLockType lock(plugin->callbackLock);
-        if (! lock.isLocked())
-            continue;
+bool VstHost::isPassThrough() noexcept
+{
+    const auto* snapshot = adoptPublishedChain();
+    if (snapshot == nullptr || snapshot->plugins.empty())
+        return true;
 
-        wetBuffer.makeCopyOf(buffer, true);
-#if JUCE_WINDOWS && defined(_MSC_VER)
-        bool pluginCrashed = false;
-        try
+    // A pipelined chain delays the audio whether or not any stage does work.
+    if (snapshot->pipelineStages.size() > 1)
+        return false;
+
+    // Mirrors the checks in processBranch().
+    for (const auto& plugin : snapshot->plugins)
+        if (plugin != nullptr && plugin->instance != nullptr && plugin->enabled.load()
+            && ! plugin->faulted.load() && ! plugin->editorOpen.load())
+            return false;
+
+    return true;
+}
+
+void VstHost::processPipelined(const ChainSnapshot& snapshot, juce::AudioBuffer<float>& buffer, float meanCoeff, float peakDecay) noexcept
+{
+    const auto numStages = static_cast<int>(snapshot.pipelineStages.size());
+    if (numStages != activePipelineStages)
+        resetPipeline(numStages);
+
+    // Stage 0 takes this block; every later stage takes what its predecessor finished
+    // during the previous callback. All stages run at once.
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), pipelineFifoBuffer.getNumChannels());
+    auto& input = pipelineSlots[static_cast<size_t>(stageSlot[0])];
+    scratchArena.attach(pipelineSlotRegions[static_cast<size_t>(stageSlot[0])], input, numSamples);
+    for (int c = 0; c < numChannels; ++c)
+        input.copyFrom(c, 0, buffer, c, 0, input.getNumSamples());
+
+    PipelineBlock block { this, &snapshot, meanCoeff, peakDecay };
+    if (workerPool != nullptr)
+        workerPool->run(numStages, &VstHost::runPipelineStage, &block);
+    else
+        for (int s = 0; s < numStages; ++s)
+            runPipelineStage(&block, s);
+
+    // Finished blocks queue behind the latency the queue was primed with, so the output
+    // stays sample-continuous even though block sizes vary from callback to callback.
+    const auto& finished = pipelineSlots[static_cast<size_t>(stageSlot[static_cast<size_t>(numStages - 1)])];
+    const auto toWrite = juce::jmin(finished.getNumSamples(), pipelineFifo.getFreeSpace());
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    pipelineFifo.prepareToWrite(toWrite, start1, size1, start2, size2);
+    for (int c = 0; c < numChannels; ++c)
+    {
+        if (size1 > 0)
+            pipelineFifoBuffer.copyFrom(c, start1, finished, c, 0, size1);
+        if (size2 > 0)
+            pipelineFifoBuffer.copyFrom(c, start2, finished, c, size1, size2);
+    }
+    pipelineFifo.finishedWrite(size1 + size2);
+
+    const auto toRead = juce::jmin(numSamples, pipelineFifo.getNumReady());
+    pipelineFifo.prepareToRead(toRead, start1, size1, start2, size2);
+    for (int c = 0; c < numChannels; ++c)
+    {
+        if (size1 > 0)
+            buffer.copyFrom(c, 0, pipelineFifoBuffer, c, start1, size1);
+        if (size2 > 0)
+            buffer.copyFrom(c, size1, pipelineFifoBuffer, c, start2, size2);
+    }
+    pipelineFifo.finishedRead(size1 + size2);
+    if (toRead < numSamples)
+        buffer.clear(toRead, numSamples - toRead);
+
+    // Hand each stage's output to the next stage and recycle the finished slot as the
+    // next input.
+    const auto recycled = stageSlot[static_cast<size_t>(numStages - 1)];
+    for (auto s = static_cast<size_t>(numStages - 1); s > 0; --s)
+        stageSlot[s] = stageSlot[s - 1];
+    stageSlot[0] = recycled;
+}
+
+void VstHost::resetPipeline(int stages) noexcept
+{
+    activePipelineStages = stages;
+    for (size_t i = 0; i < pipelineSlots.size(); ++i)
+    {
+        stageSlot[i] = static_cast<int>(i);
+        scratchArena.attach(pipelineSlotRegions[i], pipelineSlots[i], 0);
+    }
+
+    pipelineFifo.reset();
+    pipelineFifoBuffer.clear();
+    // Primed for the longest block prepare() allowed: a run of those drains up to one per
+    // boundary before the first of them comes out, and a shorter priming would then run
+    // dry, insert silence and leave the output shifted against the reported latency.
+    const auto latency = juce::jmin(getPipelineLatencySamples(stages, pipelineMaxBlock), pipelineFifo.getFreeSpace());
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    pipelineFifo.prepareToWrite(latency, start1, size1, start2, size2);
+    pipelineFifo.finishedWrite(size1 + size2);
+}
+
+void VstHost::runPipelineStage(void* context, int stageIndex) noexcept
+{
+    auto& block = *static_cast<PipelineBlock*>(context);
+    auto& host = *block.host;
+    auto& slot = host.pipelineSlots[static_cast<size_t>(host.stageSlot[static_cast<size_t>(stageIndex)])];
+    if (slot.getNumSamples() == 0)
+        return;
+
+    auto& scratch = host.pipelineScratch[static_cast<size_t>(stageIndex)];
+    scratch.midi.clear();
+    processBranch(block.snapshot->pipelineStages[static_cast<size_t>(stageIndex)], slot, scratch.wet, scratch.midi,
+                  block.meanCoeff, block.peakDecay);
+}
+
+void VstHost::processParallelStep(const ChainSnapshot::Step& step, juce::AudioBuffer<float>& buffer, float meanCoeff, float peakDecay) noexcept
+{
+    const auto numBranches = static_cast<int>(step.branches.size());
+    for (int b = 1; b < numBranches; ++b)
+    {
+        auto& scratch = branchScratch[static_cast<size_t>(b - 1)];
+        scratchArena.attach(scratch.audioRegion, scratch.audio, buffer.getNumSamples());
+        for (int c = 0; c < juce::jmin(buffer.getNumChannels(), scratch.audio.getNumChannels()); ++c)
+            scratch.audio.copyFrom(c, 0, buffer, c, 0, scratch.audio.getNumSamples());
+        scratch.midi.clear();
+    }
+
+    ParallelBlock block { this, &step, &buffer, &midiBuffer, meanCoeff, peakDecay };
+    if (workerPool != nullptr)
+        workerPool->run(numBranches, &VstHost::runBranchTask, &block);
+    else
+        for (int b = 0; b < numBranches; ++b)
+            runBranchTask(&block, b);
+
+    // Every branch is held back to the slowest one running, so a latent plugin in one
+    // branch does not comb against the others. Delays follow plugins being enabled and
+    // disabled from block to block.
+    if (! step.delays.empty())
+    {
+        std::array<int, kMaxBranches> latencies {};
+        int slowest = 0;
+        for (int b = 0; b < numBranches; ++b)
         {
-            pluginCrashed = ! processPluginBlockWithSeh(*plugin->instance, wetBuffer, midi);
+            latencies[static_cast<size_t>(b)] = getBranchLatencySamples(step.branches[static_cast<size_t>(b)], true);
+            slowest = juce::jmax(slowest, latencies[static_cast<size_t>(b)]);
         }
-        catch (...)
+
+        for (int b = 0; b < numBranches; ++b)
         {
-            pluginCrashed = true;
+            auto& audio = b == 0 ? buffer : branchScratch[static_cast<size_t>(b - 1)].audio;
+            delayBranch(step.delays[static_cast<size_t>(b)], audio, slowest - latencies[static_cast<size_t>(b)]);
         }
+    }
 
-        if (pluginCrashed)
-        {
-            plugin->faulted.store(true);
-            plugin->enabled.store(false);
-            Logger::instance().log("VST process crashed for " + plugin->description.name + " (disabled)");
+    // Branches are summed like the layers of a parallel bus, unscaled: a section of N
+    // untouched branches comes out N times as loud, and it is up to the plugins (or their
+    // mix) to set each layer's level.
+    for (int b = 1; b < numBranches; ++b)
+    {
+        const auto& branchAudio = branchScratch[static_cast<size_t>(b - 1)].audio;
+        for (int c = 0; c < juce::jmin(buffer.getNumChannels(), branchAudio.getNumChannels()); ++c)
+            buffer.addFrom(c, 0, branchAudio, c, 0, branchAudio.getNumSamples());
+    }
+}
+
+int VstHost::getBranchLatencySamples(const std::vector<HostedPlugin*>& plugins, bool activeOnly) noexcept
+{
+    int latency = 0;
+    for (const auto* plugin : plugins)
+    {
+        if (plugin == nullptr || plugin->instance == nullptr || plugin->faulted.load())
             continue;
-        }
-#else
-        try
+        // Mirrors the checks in processBranch().
+        if (activeOnly && (! plugin->enabled.load() || plugin->editorOpen.load()))
+            continue;
+        latency += plugin->profile.latencySamples.load();
+    }
+    return latency;
+}
+
+void VstHost::delayBranch(BranchDelay& delay, juce::AudioBuffer<float>& audio, int delaySamples) noexcept
+{
+    // The line runs even at no delay, so its history is current when a delay is needed.
+    const auto length = delay.line.getNumSamples();
+    const auto numSamples = audio.getNumSamples();
+    const auto clamped = juce::jlimit(0, length - 1, delaySamples);
+    for (int c = 0; c < juce::jmin(audio.getNumChannels(), delay.line.getNumChannels()); ++c)
+    {
+        auto* data = audio.getWritePointer(c);
+        auto* line = delay.line.getWritePointer(c);
+        auto write = delay.writePosition;
+        for (int i = 0; i < numSamples; ++i)
         {
-            plugin->instance->processBlock(wetBuffer, midi);
+            line[write] = data[i];
+            const auto read = write >= clamped ? write - clamped : write - clamped + length;
+            data[i] = line[read];
+            if (++write == length)
+                write = 0;
         }
-        catch (...)
-        {
-            plugin->faulted.store(true);
-            plugin->enabled.store(false);
-            Logger::instance().log("VST process failed for " + plugin->description.name + " (disabled)");
+    }
+    delay.writePosition = (delay.writePosition + numSamples) % length;
+}
+
+void VstHost::runBranchTask(void* context, int branchIndex) noexcept
+{
+    auto& block = *static_cast<ParallelBlock*>(context);
+    const auto& plugins = block.step->branches[static_cast<size_t>(branchIndex)];
+    if (branchIndex == 0)
+    {
+        processBranch(plugins, *block.mainBuffer, block.host->wetBuffer, *block.mainMidi, block.meanCoeff, block.peakDecay);
+        return;
+    }
+
+    auto& scratch = block.host->branchScratch[static_cast<size_t>(branchIndex - 1)];
+    processBranch(plugins, scratch.audio, scratch.wet, scratch.midi, block.meanCoeff, block.peakDecay);
+}
+
+void VstHost::processBranch(const std::vector<HostedPlugin*>& plugins,
+                            juce::AudioBuffer<float>& buffer,
+                            juce::AudioBuffer<float>& wetScratch,
+                            juce::MidiBuffer& midi,
+                            float meanCoeff,
+                            float peakDecay) noexcept
+{
+    for (auto* plugin : plugins)
+    {
+        if (plugin == nullptr || plugin->instance == nullptr || ! plugin->enabled.load()
+            || plugin->faulted.load() || plugin->editorOpen.load())
             continue;
-        }
+
+        processPlugin(*plugin, buffer, wetScratch, midi, meanCoeff, peakDecay);
+    }
+}
+
+void VstHost::processPlugin(HostedPlugin& plugin,
+                            juce::AudioBuffer<float>& buffer,
+                            juce::AudioBuffer<float>& wetScratch,
+                            juce::MidiBuffer& midi,
+                            float meanCoeff,
+                            float peakDecay) noexcept
+{
+    // A plugin is never processed without its lock. Whatever holds it instead (prepare,
+    // release, the editor, or a capture of a plugin marked serialiseStateCapture) costs
+    // the plugin this block.
+    const juce::SpinLock::ScopedTryLockType lock(plugin.callbackLock);
+    if (! lock.isLocked())
+    {
+        plugin.profile.countSkippedBlock();
+        return;
+    }
+
+    const TraceScope trace("plugin", "processBlock", plugin.description.name);
+
+    // Mix changes ramp over one block. A fully wet plugin with no ramp pending works
+    // straight on the running buffer, so the default case costs no copy and no blend.
+    // wetScratch is a full-capacity view into the host's arena; the wet copy is a view
+    // of its first block-length samples. A block the arena was not sized for cannot be
+    // blended without allocating, so it is processed fully wet instead.
+    const auto targetMix = juce::jlimit(0.0f, 1.0f, plugin.mix.load());
+    const auto startMix = plugin.appliedMix < 0.0f ? targetMix : plugin.appliedMix;
+    plugin.appliedMix = targetMix;
+    const auto fitsScratch = buffer.getNumSamples() <= wetScratch.getNumSamples()
+                          && buffer.getNumChannels() <= wetScratch.getNumChannels();
+    jassert(fitsScratch);
+    const auto inPlace = (startMix >= 1.0f && targetMix >= 1.0f) || ! fitsScratch;
+    juce::AudioBuffer<float> wet(wetScratch.getArrayOfWritePointers(),
+                                 juce::jmin(buffer.getNumChannels(), wetScratch.getNumChannels()),
+                                 juce::jmin(buffer.getNumSamples(), wetScratch.getNumSamples()));
+    auto& pluginBuffer = inPlace ? buffer : wet;
+    if (! inPlace)
+        for (int c = 0; c < wet.getNumChannels(); ++c)
+            wet.copyFrom(c, 0, buffer, c, 0, wet.getNumSamples());
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+#if JUCE_WINDOWS && defined(_MSC_VER)
+    bool pluginCrashed = false;
+    try
+    {
+        pluginCrashed = ! processPluginBlockWithSeh(*plugin.instance, pluginBuffer, midi);
+    }
+    catch (...)
+    {
+        pluginCrashed = true;
+    }
+
+    if (pluginCrashed)
+    {
+        plugin.faulted.store(true);
+        plugin.enabled.store(false);
+        Logger::instance().log(Logger::Level::error, { "VST process crashed for ", plugin.description.name, " (disabled)" });
+        // Whatever the plugin left half-written in place cannot be trusted.
+        if (inPlace)
+            buffer.clear();
+        return;
+    }
+#else
+    try
+    {
+        plugin.instance->processBlock(pluginBuffer, midi);
+    }
+    catch (...)
+    {
+        plugin.faulted.store(true);
+        plugin.enabled.store(false);
+        Logger::instance().log(Logger::Level::error, { "VST process failed for ", plugin.description.name, " (disabled)" });
+        if (inPlace)
+            buffer.clear();
+        return;
+    }
 #endif
 
-        const auto mix = juce::jlimit(0.0f, 1.0f, plugin->mix.load());
-        const auto inv = 1.0f - mix;
-        for (int c = 0; c < buffer.getNumChannels(); ++c)
+    const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    plugin.profile.recordBlock(elapsed, meanCoeff, peakDecay);
+    if (! inPlace)
+        mixDryWet(buffer, wet, startMix, targetMix);
+}
+
+void VstHost::mixDryWet(juce::AudioBuffer<float>& buffer, const juce::AudioBuffer<float>& wetBuffer, float startMix, float endMix) noexcept
+{
+    const auto from = juce::jlimit(0.0f, 1.0f, startMix);
+    const auto to = juce::jlimit(0.0f, 1.0f, endMix);
+    const auto numSamples = juce::jmin(buffer.getNumSamples(), wetBuffer.getNumSamples());
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), wetBuffer.getNumChannels());
+    for (int c = 0; c < numChannels; ++c)
+        simd::crossfade(buffer.getWritePointer(c), wetBuffer.getReadPointer(c), from, to, numSamples);
+}
+
+bool VstHost::capturePluginState(HostedPlugin& plugin, juce::MemoryBlock& outState, const juce::String& logContext)
+{
+    if (plugin.instance == nullptr || plugin.faulted.load() || plugin.editorOpen.load())
+        return false;
+
+    const juce::ScopedLock lifecycle(plugin.lifecycleLock);
+    const TraceScope trace("host", "State capture", plugin.description.name);
+    const auto skippedBefore = plugin.profile.skippedBlocks.load();
+    auto captured = false;
+    try
+    {
+        if (plugin.serialiseStateCapture.load() && ! plugin.sandboxed)
+        {
+            // The audio thread holds the lock only while it processes this plugin, so
+            // this waits out at most the tail of one block.
+            const juce::SpinLock::ScopedLockType lock(plugin.callbackLock);
+            plugin.instance->getStateInformation(outState);
+        }
+        else
         {
-            auto* dry = buffer.getWritePointer(c);
-            const auto* wet = wetBuffer.getReadPointer(c);
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-                dry[i] = dry[i] * inv + wet[i] * mix;
+            plugin.instance->getStateInformation(outState);
         }
+        captured = true;
     }
+    catch (...)
+    {
+        if (logContext.isNotEmpty())
+            Logger::instance().log(logContext + plugin.description.name);
+    }
+
+    if (const auto skipped = plugin.profile.skippedBlocks.load() - skippedBefore; skipped > 0)
+        Logger::instance().log(juce::String(static_cast<int>(skipped)) + " block(s) skipped during state capture for "
+                               + plugin.description.name);
+    return captured;
 }
 
 int VstHost::getLatencySamples() const
@@ -453,6 +1138,46 @@ int VstHost::getLatencySamples() const
     return cachedLatencySamples.load();
 }
 
+std::vector<VstHost::PluginProfileSnapshot> VstHost::takeProfileWindow()
+{
+    const auto snapshot = copyChainSnapshot();
+    const auto rate = activeProcessingSampleRate.load();
+    const auto block = lastProcessedBlockSize.load(std::memory_order_relaxed);
+    const auto budgetUs = rate > 1000.0 && block > 0 ? static_cast<double>(block) / rate * 1.0e6 : 0.0;
+
+    const juce::ScopedLock sl(profileReadLock);
+    std::vector<PluginProfileSnapshot> out;
+    out.reserve(snapshot.size());
+    for (const auto& plugin : snapshot)
+    {
+        PluginProfileSnapshot entry;
+        if (plugin != nullptr)
+        {
+            auto& profile = plugin->profile;
+            const auto window = profile.histogram.takeWindow();
+            entry.name = plugin->description.name;
+            entry.meanUs = profile.meanUs.load(std::memory_order_relaxed);
+            entry.peakUs = profile.peakUs.load(std::memory_order_relaxed);
+            entry.p99Us = window.p99Us;
+            entry.maxUs = window.maxUs;
+            entry.budgetPercent = budgetUs > 0.0 ? entry.meanUs / budgetUs * 100.0 : 0.0;
+            entry.latencySamples = profile.latencySamples.load(std::memory_order_relaxed);
+            entry.processedBlocks = profile.processedBlocks.load(std::memory_order_relaxed);
+            entry.skippedBlocks = profile.skippedBlocks.load(std::memory_order_relaxed);
+            if (auto* sandboxed = dynamic_cast<SandboxedPluginInstance*>(plugin->instance.get()))
+            {
+                const auto stats = sandboxed->takeStats();
+                entry.sandboxed = true;
+                entry.sandboxAlive = stats.alive;
+                entry.sandboxOverheadUs = stats.overheadP99Us;
+                entry.sandboxMissedBlocks = stats.missedBlocks;
+            }
+        }
+        out.push_back(std::move(entry));
+    }
+    return out;
+}
+
 juce::Array<HostedPlugin*> VstHost::getChain()
 {
     const juce::ScopedLock sl(chainLock);
@@ -484,12 +1209,52 @@ std::vector<VstHost::HostedPluginHandle> VstHost::getChainHandles() const
     return copyChainSnapshot();
 }
 
-void VstHost::prepare(double sampleRate, int blockSize)
+void VstHost::prepare(double sampleRate, int blockSize, int maxBlockSize)
 {
     sanitizeProcessingFormat(sampleRate, blockSize);
     activeProcessingSampleRate.store(sampleRate);
     activeProcessingBlockSize.store(blockSize);
 
+    // Lay out every buffer the audio thread touches in one allocation sized for the
+    // longest block, so nothing is resized when a driver varies its block length.
+    const auto maxBlock = juce::jmax(blockSize, maxBlockSize);
+    activeMaxBlockSize.store(maxBlock);
+    const auto slotSize = maxBlock + kPipelineSlack;
+    const auto fifoSize = kMaxPipelineStages * slotSize + 1;
+    scratchArena.clear();
+    const auto wetRegion = scratchArena.reserve(2, maxBlock);
+    std::array<int, kMaxBranches - 1> branchWetRegions {};
+    for (size_t i = 0; i < branchScratch.size(); ++i)
+    {
+        branchScratch[i].audioRegion = scratchArena.reserve(2, maxBlock);
+        branchWetRegions[i] = scratchArena.reserve(2, maxBlock);
+    }
+
+    std::array<int, kMaxPipelineStages> pipelineWetRegions {};
+    for (size_t i = 0; i < pipelineSlots.size(); ++i)
+    {
+        pipelineSlotRegions[i] = scratchArena.reserve(2, slotSize);
+        pipelineWetRegions[i] = scratchArena.reserve(2, slotSize);
+    }
+    const auto fifoRegion = scratchArena.reserve(2, fifoSize);
+    scratchArena.allocate();
+
+    scratchArena.attach(wetRegion, wetBuffer, maxBlock);
+    for (size_t i = 0; i < branchScratch.size(); ++i)
+    {
+        scratchArena.attach(branchScratch[i].audioRegion, branchScratch[i].audio, maxBlock);
+        scratchArena.attach(branchWetRegions[i], branchScratch[i].wet, maxBlock);
+    }
+    for (size_t i = 0; i < pipelineSlots.size(); ++i)
+    {
+        scratchArena.attach(pipelineSlotRegions[i], pipelineSlots[i], slotSize);
+        scratchArena.attach(pipelineWetRegions[i], pipelineScratch[i].wet, slotSize);
+    }
+    pipelineFifo.setTotalSize(fifoSize);
+    scratchArena.attach(fifoRegion, pipelineFifoBuffer, fifoSize);
+    pipelineMaxBlock = maxBlock;
+    activePipelineStages = 0;
+
     const auto snapshot = copyChainSnapshot();
     for (const auto& plugin : snapshot)
     {
@@ -497,6 +1262,7 @@ void VstHost::prepare(double sampleRate, int blockSize)
             continue;
         try
         {
+            const juce::ScopedLock lifecycle(plugin->lifecycleLock);
             const juce::SpinLock::ScopedTryLockType lock(plugin->callbackLock);
             if (! lock.isLocked())
             {
@@ -514,7 +1280,9 @@ void VstHost::prepare(double sampleRate, int blockSize)
         }
     }
 
+    // Latencies can change with the rate, so branch delay lines are resized for them.
     const juce::ScopedLock sl(chainLock);
+    publishChainLocked();
     refreshLatencyCacheLocked();
 }
 
@@ -522,6 +1290,7 @@ void VstHost::release()
 {
     activeProcessingSampleRate.store(0.0);
     activeProcessingBlockSize.store(0);
+    activeMaxBlockSize.store(0);
 
     const auto snapshot = copyChainSnapshot();
     for (const auto& plugin : snapshot)
@@ -530,6 +1299,7 @@ void VstHost::release()
             continue;
         try
         {
+            const juce::ScopedLock lifecycle(plugin->lifecycleLock);
             const juce::SpinLock::ScopedTryLockType lock(plugin->callbackLock);
             if (! lock.isLocked())
             {
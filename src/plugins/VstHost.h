@@ -1,12 +1,46 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "../audio/BufferArena.h"
+#include "../core/LatencyHistogram.h"
+#include "../core/RealtimeWorkerPool.h"
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <memory>
 #include <vector>
 
 namespace fizzle
 {
+// Realtime profile of one hosted plugin. Written only by the processing thread; the
+// message thread reads it through VstHost::takeProfileWindow().
+struct PluginProfile
+{
+    std::atomic<float> meanUs { 0.0f };
+    std::atomic<float> peakUs { 0.0f };
+    std::atomic<uint32_t> processedBlocks { 0 };
+    std::atomic<uint32_t> skippedBlocks { 0 };
+    std::atomic<int> latencySamples { 0 };
+    LatencyHistogram histogram;
+
+    // meanCoeff and peakDecay are per-block smoothing factors derived from the block length.
+    void recordBlock(double seconds, float meanCoeff, float peakDecay) noexcept
+    {
+        const auto us = static_cast<float>(seconds * 1.0e6);
+        const auto mean = meanUs.load(std::memory_order_relaxed);
+        meanUs.store(processedBlocks.load(std::memory_order_relaxed) == 0 ? us : mean + (us - mean) * meanCoeff,
+                     std::memory_order_relaxed);
+        peakUs.store(std::max(us, peakUs.load(std::memory_order_relaxed) * peakDecay), std::memory_order_relaxed);
+        processedBlocks.store(processedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        histogram.record(static_cast<uint64_t>(std::max(0.0, seconds * 1.0e9)));
+    }
+
+    void countSkippedBlock() noexcept
+    {
+        skippedBlocks.store(skippedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
 struct HostedPlugin
 {
     juce::PluginDescription description;
@@ -15,15 +49,67 @@ struct HostedPlugin
     std::atomic<bool> faulted { false };
     std::atomic<bool> editorOpen { false };
     std::atomic<float> mix { 1.0f };
+    std::atomic<int> branch { 0 }; // 0 runs in series; 1..VstHost::kMaxBranches picks a parallel branch.
+    // Set for a plugin whose getStateInformation() cannot run alongside processBlock().
+    // Its state captures then take callbackLock, and blocks that arrive meanwhile pass
+    // through dry and are counted as skipped.
+    std::atomic<bool> serialiseStateCapture { false };
+    // Set before the plugin joins the chain when it runs in a sandbox process. Its state
+    // calls are control round trips of up to seconds, and the helper already keeps them
+    // apart from its own audio thread, so they are never serialised with processing.
+    bool sandboxed { false };
+    // Held by the audio thread while it processes the plugin, and by the lifecycle calls
+    // that reconfigure it (prepare, release, editor creation).
     juce::SpinLock callbackLock;
+    // Message thread. Serialises the lifecycle calls and state captures with each other;
+    // the audio thread never takes it.
+    juce::CriticalSection lifecycleLock;
+    PluginProfile profile;
+    float appliedMix { -1.0f }; // Audio thread only: mix reached at the end of the last block.
 };
 
-class VstHost
+// Owns the hosted plugin chain. The message thread edits `chain` under chainLock and
+// publishes every edit as an immutable snapshot; the audio thread adopts the newest one
+// at the start of a block and hands the one it replaces back for deletion on the message
+// thread, so processBlock() never locks, allocates or drops the last plugin reference.
+class VstHost : private juce::Timer
 {
 public:
     using HostedPluginHandle = std::shared_ptr<HostedPlugin>;
 
+    // Consecutive plugins with a non-zero branch form one parallel section: each branch
+    // runs its plugins in series on its own copy of the section input, branches run
+    // concurrently on the worker pool, and their outputs are summed back together after
+    // every branch is delayed to match the section's slowest one.
+    static constexpr int kMaxBranches = 4;
+
+    // Pipelined mode splits a serial chain into up to this many stages by measured cost.
+    // Every stage works on a different block at the same time, one block behind the
+    // stage before it, so the chain can use several cores at the price of one maximum
+    // processing block (see prepare()) of latency per stage boundary. That covers a
+    // driver that varies its block length. Chains with parallel sections run unpipelined.
+    static constexpr int kMaxPipelineStages = 4;
+
+    struct PluginProfileSnapshot
+    {
+        juce::String name;
+        double meanUs { 0.0 };
+        double peakUs { 0.0 };
+        double p99Us { 0.0 };
+        double maxUs { 0.0 };
+        double budgetPercent { 0.0 };
+        int latencySamples { 0 };
+        uint32_t processedBlocks { 0 };
+        uint32_t skippedBlocks { 0 };
+        // Only filled in for plugins running in a sandbox process.
+        bool sandboxed { false };
+        bool sandboxAlive { false };
+        double sandboxOverheadUs { 0.0 };
+        uint32_t sandboxMissedBlocks { 0 };
+    };
+
     VstHost();
+    ~VstHost() override;
 
     juce::StringArray scanFolder(const juce::File& folder);
     juce::Array<juce::PluginDescription> getKnownPluginDescriptions() const;
@@ -35,24 +121,104 @@ public:
                             int blockSize,
                             const juce::String& base64State,
                             juce::String& error);
+    // Hosts an instance created outside the format manager, such as an internal
+    // processor or a stand-in plugin in the tests. Prepared like a loaded plugin.
+    bool addPluginInstance(std::unique_ptr<juce::AudioPluginInstance> instance, double sampleRate, int blockSize, juce::String& error);
     bool findDescriptionByIdentifier(const juce::String& identifier, juce::PluginDescription& out) const;
     void removePlugin(int index);
     void movePlugin(int from, int to);
     void swapPlugin(int first, int second);
     void setEnabled(int index, bool enabled);
+    void setBranch(int index, int branch);
+    int getBranch(int index) const;
+    void setPipelineStages(int stages);
+    // Re-splits the pipeline when measured plugin costs have drifted far enough from the
+    // current split to be worth the one-block hiccup of moving a plugin between stages.
+    void rebalancePipeline();
+    int getActivePipelineStages() const;
+    // First chain index of each pipeline stage, or empty while the chain runs unpipelined.
+    std::vector<int> getPipelineSplit() const;
+    // Plugins added while this is on run in their own helper process (see
+    // SandboxedPluginInstance). Plugins already in the chain stay where they are.
+    void setSandboxPlugins(bool shouldSandbox) { sandboxPlugins.store(shouldSandbox); }
+    bool isSandboxingPlugins() const { return sandboxPlugins.load(); }
     void clear();
 
     void processBlock(juce::AudioBuffer<float>& buffer);
+    // Processing thread only, like processBlock(). True when processBlock() would leave
+    // the audio untouched: no chain, or no plugin in it that would run.
+    bool isPassThrough() noexcept;
     juce::Array<HostedPlugin*> getChain();
     HostedPlugin* getPlugin(int index);
     HostedPluginHandle getPluginHandle(int index);
     std::vector<HostedPluginHandle> getChainHandles() const;
-    void prepare(double sampleRate, int blockSize);
+    // Not realtime safe. blockSize is what plugins are told to expect; maxBlockSize, if
+    // larger, is the longest block processBlock() may be handed. All scratch audio is
+    // allocated here for it.
+    void prepare(double sampleRate, int blockSize, int maxBlockSize = 0);
     void release();
 
 private:
     using HostedPluginPtr = HostedPluginHandle;
 
+    struct BranchDelay
+    {
+        juce::AudioBuffer<float> line;
+        int writePosition { 0 };
+    };
+
+    struct ChainSnapshot
+    {
+        // A step with one branch is a plain serial run; more than one is a parallel section.
+        struct Step
+        {
+            std::vector<std::vector<HostedPlugin*>> branches;
+            // Parallel sections with any latency in them: one delay line per branch, long
+            // enough for the slowest branch at publish time. Only the audio thread touches
+            // them once the snapshot is published.
+            mutable std::vector<BranchDelay> delays;
+        };
+
+        std::vector<HostedPluginPtr> plugins;
+        std::vector<Step> steps;
+        // Empty unless the chain runs pipelined; otherwise one serial run per stage.
+        std::vector<std::vector<HostedPlugin*>> pipelineStages;
+    };
+
+    struct BranchScratch
+    {
+        int audioRegion { -1 };
+        juce::AudioBuffer<float> audio;
+        juce::AudioBuffer<float> wet;
+        juce::MidiBuffer midi;
+    };
+
+    struct PipelineScratch
+    {
+        juce::AudioBuffer<float> wet;
+        juce::MidiBuffer midi;
+    };
+
+    struct PipelineBlock
+    {
+        VstHost* host { nullptr };
+        const ChainSnapshot* snapshot { nullptr };
+        float meanCoeff { 0.0f };
+        float peakDecay { 1.0f };
+    };
+
+    struct ParallelBlock
+    {
+        VstHost* host { nullptr };
+        const ChainSnapshot::Step* step { nullptr };
+        juce::AudioBuffer<float>* mainBuffer { nullptr };
+        juce::MidiBuffer* mainMidi { nullptr };
+        float meanCoeff { 0.0f };
+        float peakDecay { 1.0f };
+    };
+
+    static constexpr int kRetiredSlots = 32;
+
     struct ScannedEntry
     {
         juce::String name;
@@ -62,11 +228,44 @@ private:
     juce::AudioPluginFormatManager formatManager;
     mutable juce::CriticalSection chainLock;
     std::vector<HostedPluginPtr> chain;
+
+    // Snapshot hand-off. pendingChain is a single-slot mailbox: a newer edit replaces an
+    // unadopted one, which the message thread deletes itself. activeChain belongs to the
+    // audio thread; the chains it retires queue up in retiredChains until the next publish
+    // or the reclaim timer deletes them. The audio thread only ever pushes to that queue.
+    std::atomic<ChainSnapshot*> pendingChain { nullptr };
+    ChainSnapshot* activeChain { nullptr };
+    juce::AbstractFifo retiredFifo { kRetiredSlots };
+    std::array<ChainSnapshot*, kRetiredSlots> retiredChains {};
     juce::Array<ScannedEntry> scanned;
+    // Every scratch buffer below is a view into scratchArena. The wet buffers stay
+    // attached at full capacity; the rest are re-pointed per block.
+    BufferArena scratchArena;
     juce::AudioBuffer<float> wetBuffer;
+    juce::MidiBuffer midiBuffer;
+    // Branch 0 of a parallel section runs on the main buffers; the others use these.
+    std::array<BranchScratch, kMaxBranches - 1> branchScratch;
+    std::unique_ptr<RealtimeWorkerPool> workerPool;
+
+    // Pipelined mode. The message thread owns the requested stage count and the split it
+    // last published; everything else is audio thread state.
+    int requestedPipelineStages { 1 };
+    std::vector<int> publishedPipelineSplit;
+    std::array<juce::AudioBuffer<float>, kMaxPipelineStages> pipelineSlots;
+    std::array<int, kMaxPipelineStages> pipelineSlotRegions {};
+    std::array<int, kMaxPipelineStages> stageSlot {};
+    std::array<PipelineScratch, kMaxPipelineStages> pipelineScratch;
+    juce::AbstractFifo pipelineFifo { 1 };
+    juce::AudioBuffer<float> pipelineFifoBuffer;
+    int activePipelineStages { 0 };
+    int pipelineMaxBlock { 0 };
+    std::atomic<bool> sandboxPlugins { false };
     std::atomic<int> cachedLatencySamples { 0 };
     std::atomic<double> activeProcessingSampleRate { 0.0 };
     std::atomic<int> activeProcessingBlockSize { 0 };
+    std::atomic<int> activeMaxBlockSize { 0 };
+    std::atomic<int> lastProcessedBlockSize { 0 };
+    juce::CriticalSection profileReadLock;
 
     bool createHostedPlugin(const juce::PluginDescription& description,
                             double sampleRate,
@@ -74,11 +273,57 @@ private:
                             juce::String& error,
                             HostedPluginPtr& outHosted);
     std::vector<HostedPluginPtr> copyChainSnapshot() const;
+    void updatePluginLatenciesLocked();
     void refreshLatencyCacheLocked();
+    void publishChainLocked();
+    static std::vector<ChainSnapshot::Step> buildSteps(const std::vector<HostedPluginPtr>& plugins);
+    std::vector<int> splitPipelineLocked(bool useMeasuredCost) const;
+    static int getPipelineLatencySamples(int stages, int blockSize) noexcept;
+    const ChainSnapshot* adoptPublishedChain() noexcept;
+    void reclaimRetiredChains();
+    void timerCallback() override;
+
+    void processPipelined(const ChainSnapshot& snapshot, juce::AudioBuffer<float>& buffer, float meanCoeff, float peakDecay) noexcept;
+    void resetPipeline(int stages) noexcept;
+    static void runPipelineStage(void* context, int stageIndex) noexcept;
+    void processParallelStep(const ChainSnapshot::Step& step, juce::AudioBuffer<float>& buffer, float meanCoeff, float peakDecay) noexcept;
+    static void runBranchTask(void* context, int branchIndex) noexcept;
+    // Sum of the reported latencies of the branch's plugins; with activeOnly, only of
+    // those processBranch() would run.
+    static int getBranchLatencySamples(const std::vector<HostedPlugin*>& plugins, bool activeOnly) noexcept;
+    static void delayBranch(BranchDelay& delay, juce::AudioBuffer<float>& audio, int delaySamples) noexcept;
+    static void processBranch(const std::vector<HostedPlugin*>& plugins,
+                              juce::AudioBuffer<float>& buffer,
+                              juce::AudioBuffer<float>& wetScratch,
+                              juce::MidiBuffer& midi,
+                              float meanCoeff,
+                              float peakDecay) noexcept;
+    static void processPlugin(HostedPlugin& plugin,
+                              juce::AudioBuffer<float>& buffer,
+                              juce::AudioBuffer<float>& wetScratch,
+                              juce::MidiBuffer& midi,
+                              float meanCoeff,
+                              float peakDecay) noexcept;
 
 public:
     void setMix(int index, float mix);
     float getMix(int index) const;
     int getLatencySamples() const;
+
+    // Message thread. Captures a plugin's state under its lifecycleLock, alongside the
+    // audio thread's processBlock() the way plugin hosts usually call
+    // getStateInformation(), so a capture costs the plugin no blocks however long it
+    // takes. A plugin marked serialiseStateCapture, unless sandboxed, is captured under
+    // its callbackLock instead; the blocks it skips meanwhile are counted and logged.
+    // Fails if the plugin is faulted, has its editor open, or throws.
+    bool capturePluginState(HostedPlugin& plugin, juce::MemoryBlock& outState, const juce::String& logContext = {});
+
+    // One entry per chain slot, in chain order. Percentiles and the window maximum cover
+    // the blocks processed since the previous call; mean and peak are rolling values.
+    std::vector<PluginProfileSnapshot> takeProfileWindow();
+
+    // Blends a plugin's output (wetBuffer) back into the running buffer, the wet share ramping
+    // from startMix at the first sample to endMix at the last. Both are clamped to 0..1.
+    static void mixDryWet(juce::AudioBuffer<float>& buffer, const juce::AudioBuffer<float>& wetBuffer, float startMix, float endMix) noexcept;
 };
 }
@@ -52,6 +52,39 @@ private:
     AudioEngine& engine;
     juce::TextEditor text;
     juce::String lastText;
+    juce::String timingText;
+    int timingTicks { 0 };
+
+    static juce::String line(juce::String key, const juce::String& value)
+    {
+        key = key.paddedRight(' ', 14);
+        return key + " : " + value + "\n";
+    }
+
+    // Timing windows span about a second so the percentiles cover a few hundred callbacks.
+    void refreshTimingText()
+    {
+        const auto report = engine.takeTimingWindow();
+        const auto& cb = report.callback;
+        const auto ms = [](double us) { return juce::String(us * 0.001, 2); };
+        const auto us = [](double v) { return juce::String(v, 1); };
+
+        timingText.clear();
+        if (cb.count == 0)
+            return;
+
+        timingText << line("Callback p50", ms(cb.p50Us) + " ms (" + juce::String(100.0 * cb.p50Us / report.blockBudgetUs, 1) + "% of " + ms(report.blockBudgetUs) + " ms)");
+        timingText << line("Callback p99", ms(cb.p99Us) + " ms");
+        timingText << line("Callback p99.9", ms(cb.p999Us) + " ms");
+        timingText << line("Callback max", ms(cb.maxUs) + " ms");
+        timingText << line("Stage (us)", "mean / p99 / max");
+        for (int i = 0; i < SignalPath::kNumStages; ++i)
+        {
+            const auto& stage = report.stages[static_cast<size_t>(i)];
+            timingText << line(SignalPath::getStageName(static_cast<SignalPath::Stage>(i)),
+                               us(stage.meanUs) + " / " + us(stage.p99Us) + " / " + us(stage.maxUs));
+        }
+    }
 
     void timerCallback() override
     {
@@ -62,15 +95,12 @@ private:
                 return juce::String("-inf dB");
             return juce::String(juce::Decibels::gainToDecibels(v), 1) + " dB";
         };
-        const auto line = [](juce::String key, juce::String value)
-        {
-            key = key.paddedRight(' ', 14);
-            return key + " : " + value + "\n";
-        };
         juce::String s;
         s << line("Input Device", d.inputDevice);
         s << line("Output Device", d.outputDevice);
         s << line("Sample Rate", juce::String(d.sampleRate, 1) + " Hz");
+        s << line("Processing", juce::String(d.processingSampleRate, 1) + " Hz"
+                                    + (std::abs(d.processingSampleRate - d.sampleRate) < 0.01 ? " (native)" : ""));
         s << line("Buffer Size", juce::String(d.bufferSize));
         s << line("CPU Load", juce::String(d.cpuPercent, 2) + "%");
         s << line("Latency (Dry)", juce::String(d.dryLatencyMs, 1) + " ms");
@@ -78,6 +108,15 @@ private:
         s << line("Input Level", levelToText(d.inputLevel));
         s << line("Output Level", levelToText(d.outputLevel));
         s << line("Dropped Buffers", juce::String(static_cast<int64_t>(d.droppedBuffers)));
+        if (d.monitorActive)
+        {
+            s << line("Listen Queue", juce::String(d.monitorQueueMs, 1) + " ms");
+            s << line("Listen Drift", juce::String(d.monitorDriftPpm, 1) + " ppm");
+            s << line("Listen Gaps", juce::String(static_cast<int64_t>(d.monitorUnderruns)));
+        }
+        if (timingTicks++ % 4 == 0)
+            refreshTimingText();
+        s << timingText;
         if (s != lastText)
         {
             lastText = s;
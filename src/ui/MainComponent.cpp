@@ -2,6 +2,8 @@
 #include "MainWindow.h"
 #include "Theme.h"
 #include "../core/Logger.h"
+#include "../core/RealtimeAudit.h"
+#include "../core/Tracer.h"
 #include <BinaryData.h>
 #include <array>
 #include <algorithm>
@@ -32,6 +34,7 @@ float kUiBackgroundAlphaScale = 0.84f;
 const juce::String kGithubRepoUrl("https://github.com/softlynn/Fizzle");
 const juce::String kWebsiteUrl("https://softlynn.github.io/Fizzle/");
 constexpr std::array<int, 8> kBufferSizeOptions { 64, 96, 128, 192, 256, 384, 512, 1024 };
+constexpr std::array<double, 4> kProcessingRateOptions { kInternalSampleRate, 44100.0, 96000.0, kDeviceNativeSampleRate };
 
 struct PluginRuntimeFormat
 {
@@ -42,39 +45,16 @@ struct PluginRuntimeFormat
 PluginRuntimeFormat getPluginRuntimeFormat(const Diagnostics& diagnostics)
 {
     const auto deviceRate = diagnostics.sampleRate > 1000.0 ? diagnostics.sampleRate : kInternalSampleRate;
+    const auto processingRate = diagnostics.processingSampleRate > 1000.0 ? diagnostics.processingSampleRate : kInternalSampleRate;
     const auto deviceBlock = diagnostics.bufferSize > 0 ? diagnostics.bufferSize : kDefaultBlockSize;
-    const auto internalBlock = static_cast<int>(std::ceil((static_cast<double>(deviceBlock) * kInternalSampleRate) / deviceRate));
+    const auto internalBlock = static_cast<int>(std::ceil((static_cast<double>(deviceBlock) * processingRate) / deviceRate));
 
     PluginRuntimeFormat out;
-    out.sampleRate = kInternalSampleRate;
+    out.sampleRate = processingRate;
     out.blockSize = juce::jmax(64, internalBlock);
     return out;
 }
 
-bool tryCapturePluginStateNonBlocking(HostedPlugin& plugin,
-                                      juce::MemoryBlock& outState,
-                                      const juce::String& logContext = {})
-{
-    if (plugin.instance == nullptr || plugin.faulted.load() || plugin.editorOpen.load())
-        return false;
-
-    const juce::SpinLock::ScopedTryLockType lock(plugin.callbackLock);
-    if (! lock.isLocked())
-        return false;
-
-    try
-    {
-        plugin.instance->getStateInformation(outState);
-        return true;
-    }
-    catch (...)
-    {
-        if (logContext.isNotEmpty())
-            Logger::instance().log(logContext + plugin.description.name);
-        return false;
-    }
-}
-
 void populateBufferBox(juce::ComboBox& comboBox, int selectedBuffer)
 {
     comboBox.clear();
@@ -194,6 +174,7 @@ juce::var presetDataToJsonVar(const PresetData& preset)
         pluginObj->setProperty("name", plugin.name);
         pluginObj->setProperty("enabled", plugin.enabled);
         pluginObj->setProperty("mix", plugin.mix);
+        pluginObj->setProperty("branch", plugin.branch);
         pluginObj->setProperty("state", plugin.base64State);
         pluginsArray.add(pluginObj);
     }
@@ -231,6 +212,7 @@ bool presetDataFromJsonVar(const juce::var& parsed, PresetData& out)
                 state.name = po->getProperty("name").toString();
                 state.enabled = po->hasProperty("enabled") ? static_cast<bool>(po->getProperty("enabled")) : true;
                 state.mix = po->hasProperty("mix") ? static_cast<float>(po->getProperty("mix")) : 1.0f;
+                state.branch = po->hasProperty("branch") ? static_cast<int>(po->getProperty("branch")) : 0;
                 state.base64State = po->getProperty("state").toString();
                 out.plugins.add(state);
             }
@@ -766,6 +748,39 @@ private:
     std::function<void()> onClose;
 };
 
+juce::String getBranchLetter(int branch)
+{
+    return juce::String::charToString(static_cast<juce::juce_wchar>('A' + branch - 1));
+}
+
+// Compact per-row readout of a plugin's processing cost: rolling mean and peak, share of
+// the block budget, the worst block of the last window, latency and missed blocks.
+// Sandboxed plugins add the transport's p99 overhead and the blocks that passed dry.
+juce::String formatPluginProfile(const VstHost::PluginProfileSnapshot& p)
+{
+    if (p.sandboxed && ! p.sandboxAlive)
+        return "Sandbox exited - passing audio through dry";
+
+    if (p.processedBlocks == 0 && p.skippedBlocks == 0)
+        return p.latencySamples > 0 ? "Latency " + juce::String(p.latencySamples) + " smp" : juce::String();
+
+    auto text = juce::String(p.meanUs / 1000.0, 2) + " ms avg  "
+              + juce::String(p.peakUs / 1000.0, 2) + " peak  "
+              + juce::String(p.maxUs / 1000.0, 2) + " max  "
+              + juce::String(juce::roundToInt(p.budgetPercent)) + "%";
+    if (p.latencySamples > 0)
+        text << "  " << p.latencySamples << " smp";
+    if (p.skippedBlocks > 0)
+        text << "  " << static_cast<int>(p.skippedBlocks) << " skipped";
+    if (p.sandboxed)
+    {
+        text << "  ipc " << juce::roundToInt(p.sandboxOverheadUs) << " us";
+        if (p.sandboxMissedBlocks > 0)
+            text << "  " << static_cast<int>(p.sandboxMissedBlocks) << " late";
+    }
+    return text;
+}
+
 class VstRowComponent final : public juce::Component,
                               private juce::Button::Listener,
                               private juce::Slider::Listener,
@@ -784,6 +799,7 @@ public:
         : dragStart(std::move(ds)), dragHover(std::move(dh)), dragEnd(std::move(de)), open(std::move(op)), setMix(std::move(mx)), toggle(std::move(tg)), showMenu(std::move(mf))
     {
         addAndMakeVisible(name);
+        addAndMakeVisible(profile);
         addAndMakeVisible(mix);
         addAndMakeVisible(mixLabel);
         addAndMakeVisible(enabled);
@@ -810,9 +826,19 @@ public:
         mixLabel.setFont(juce::FontOptions(10.5f, juce::Font::plain));
         name.setJustificationType(juce::Justification::centredLeft);
         name.setInterceptsMouseClicks(false, false);
+        profile.setJustificationType(juce::Justification::topLeft);
+        profile.setColour(juce::Label::textColourId, kUiTextMuted);
+        profile.setMinimumHorizontalScale(0.7f);
+        profile.setInterceptsMouseClicks(false, false);
         addMouseListener(this, true);
     }
 
+    void setProfileText(const juce::String& text)
+    {
+        if (profile.getText() != text)
+            profile.setText(text, juce::dontSendNotification);
+    }
+
     void setRowData(int rowIn, const juce::String& pluginName, bool isEnabled, float mixAmount, bool selectedIn)
     {
         row = rowIn;
@@ -826,6 +852,7 @@ public:
         juce::Font mixFont(juce::FontOptions(11.4f * kUiControlScale, juce::Font::plain));
         mixFont.setExtraKerningFactor(0.01f);
         mixLabel.setFont(mixFont);
+        profile.setFont(juce::FontOptions(10.5f * kUiControlScale, juce::Font::plain));
     }
 
     void resized() override
@@ -838,6 +865,7 @@ public:
                                                     juce::roundToInt(48.0f * kUiControlScale)));
         mixLabel.setBounds(knobArea.withTrimmedTop(10));
         openButton.setBounds(r.removeFromRight(juce::roundToInt(76.0f * kUiControlScale)));
+        profile.setBounds(r.removeFromBottom(juce::roundToInt(15.0f * kUiControlScale)));
         name.setBounds(r);
     }
 
@@ -957,6 +985,7 @@ private:
     float currentScale { 1.0f };
     float targetScale { 1.0f };
     juce::Label name;
+    juce::Label profile;
     juce::Label mixLabel;
     juce::Slider mix;
     juce::ToggleButton enabled;
@@ -1054,6 +1083,7 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
 {
     static ModernLookAndFeel modern;
     setLookAndFeel(&modern);
+    Tracer::instance().nameCurrentThread("Message thread");
     setWantsKeyboardFocus(true);
     setMouseClickGrabsKeyboardFocus(true);
     addMouseListener(this, true);
@@ -1211,7 +1241,15 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
     startWithWindowsToggle.setButtonText("Start with Windows");
     startMinimizedToggle.setButtonText("Start minimized to tray");
     followAutoEnableWindowToggle.setButtonText("Open/close window with Program Auto-Enable");
+    sandboxPluginsToggle.setButtonText("Run plugins in a separate process (applies to newly loaded plugins)");
+    voiceStripToggle.setButtonText("Built-in voice strip ahead of plugins (HPF, gate, de-esser, compressor, limiter)");
+    noiseSuppressionToggle.setButtonText("Built-in noise suppression ahead of plugins (steady background noise)");
+    convolutionToggle.setButtonText("Built-in convolution ahead of plugins (room, mic or EQ impulse response)");
+    traceToggle.setButtonText("Record performance trace");
     behaviorListenDeviceLabel.setText("Listen Output Device", juce::dontSendNotification);
+    behaviorResamplerLabel.setText("Resampler Quality", juce::dontSendNotification);
+    behaviorProcessingRateLabel.setText("Processing Rate", juce::dontSendNotification);
+    behaviorPipelineLabel.setText("Plugin Chain Cores", juce::dontSendNotification);
     behaviorVstFoldersLabel.setText("VST Search Folders", juce::dontSendNotification);
     lightModeToggle.setButtonText("Light mode");
 
@@ -1224,6 +1262,19 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
     appearanceSizeBox.addItem("Large", 3);
     behaviorListenDeviceBox.setTextWhenNothingSelected("Select device...");
     behaviorListenDeviceBox.addListener(this);
+    behaviorResamplerBox.addItem("Low latency", 1);
+    behaviorResamplerBox.addItem("Balanced", 2);
+    behaviorResamplerBox.addItem("High quality", 3);
+    behaviorResamplerBox.addListener(this);
+    behaviorProcessingRateBox.addItem("48 kHz", 1);
+    behaviorProcessingRateBox.addItem("44.1 kHz", 2);
+    behaviorProcessingRateBox.addItem("96 kHz", 3);
+    behaviorProcessingRateBox.addItem("Device native (no resampling)", 4);
+    behaviorProcessingRateBox.addListener(this);
+    behaviorPipelineBox.addItem("1 core (no added latency)", 1);
+    for (int stages = 2; stages <= VstHost::kMaxPipelineStages; ++stages)
+        behaviorPipelineBox.addItem(juce::String(stages) + " cores (+" + juce::String(stages - 1) + (stages == 2 ? " max block)" : " max blocks)"), stages);
+    behaviorPipelineBox.addListener(this);
     appSearchEditor.setTextToShowWhenEmpty("Type to search programs...", juce::Colour(0xff9aa7b6));
     appSearchEditor.onTextChange = [this]
     {
@@ -1257,6 +1308,13 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
     startWithWindowsToggle.addListener(this);
     startMinimizedToggle.addListener(this);
     followAutoEnableWindowToggle.addListener(this);
+    sandboxPluginsToggle.addListener(this);
+    voiceStripToggle.addListener(this);
+    noiseSuppressionToggle.addListener(this);
+    convolutionToggle.addListener(this);
+    loadImpulseButton.addListener(this);
+    traceToggle.addListener(this);
+    exportTraceButton.addListener(this);
     appearanceThemeBox.addListener(this);
     appearanceBackgroundBox.addListener(this);
     appearanceSizeBox.addListener(this);
@@ -1407,6 +1465,19 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
     settingsPanel->addAndMakeVisible(startupLabel);
     settingsPanel->addAndMakeVisible(behaviorListenDeviceLabel);
     settingsPanel->addAndMakeVisible(behaviorListenDeviceBox);
+    settingsPanel->addAndMakeVisible(behaviorResamplerLabel);
+    settingsPanel->addAndMakeVisible(behaviorResamplerBox);
+    settingsPanel->addAndMakeVisible(behaviorProcessingRateLabel);
+    settingsPanel->addAndMakeVisible(behaviorProcessingRateBox);
+    settingsPanel->addAndMakeVisible(behaviorPipelineLabel);
+    settingsPanel->addAndMakeVisible(behaviorPipelineBox);
+    settingsPanel->addAndMakeVisible(sandboxPluginsToggle);
+    settingsPanel->addAndMakeVisible(voiceStripToggle);
+    settingsPanel->addAndMakeVisible(noiseSuppressionToggle);
+    settingsPanel->addAndMakeVisible(convolutionToggle);
+    settingsPanel->addAndMakeVisible(loadImpulseButton);
+    settingsPanel->addAndMakeVisible(traceToggle);
+    settingsPanel->addAndMakeVisible(exportTraceButton);
     settingsPanel->addAndMakeVisible(behaviorVstFoldersLabel);
     settingsPanel->addAndMakeVisible(behaviorVstFoldersListBox);
     settingsPanel->addAndMakeVisible(behaviorAddVstFolderButton);
@@ -1477,9 +1548,34 @@ MainComponent::MainComponent(AudioEngine& engineRef, SettingsStore& settingsRef,
     appearanceThemeBox.setSelectedId(cachedSettings.themeVariant + 1, juce::dontSendNotification);
     appearanceBackgroundBox.setSelectedId(cachedSettings.transparentBackground ? 1 : 2, juce::dontSendNotification);
     appearanceSizeBox.setSelectedId(cachedSettings.uiDensity + 1, juce::dontSendNotification);
+    behaviorResamplerBox.setSelectedId(cachedSettings.resamplerQuality + 1, juce::dontSendNotification);
+    {
+        int rateId = 1;
+        for (size_t i = 0; i < kProcessingRateOptions.size(); ++i)
+            if (std::abs(kProcessingRateOptions[i] - cachedSettings.internalSampleRate) < 0.01)
+                rateId = static_cast<int>(i) + 1;
+        behaviorProcessingRateBox.setSelectedId(rateId, juce::dontSendNotification);
+    }
+    behaviorPipelineBox.setSelectedId(juce::jlimit(1, VstHost::kMaxPipelineStages, cachedSettings.pipelineStages), juce::dontSendNotification);
     startWithWindowsToggle.setToggleState(cachedSettings.startWithWindows, juce::dontSendNotification);
     startMinimizedToggle.setToggleState(cachedSettings.startMinimizedToTray, juce::dontSendNotification);
     followAutoEnableWindowToggle.setToggleState(cachedSettings.followAutoEnableWindowState, juce::dontSendNotification);
+    sandboxPluginsToggle.setToggleState(cachedSettings.sandboxPlugins, juce::dontSendNotification);
+    engine.getVstHost().setSandboxPlugins(cachedSettings.sandboxPlugins);
+    voiceStripToggle.setToggleState(cachedSettings.builtInVoiceStrip, juce::dontSendNotification);
+    params.voiceStrip.store(cachedSettings.builtInVoiceStrip);
+    noiseSuppressionToggle.setToggleState(cachedSettings.builtInNoiseSuppression, juce::dontSendNotification);
+    params.noiseSuppression.store(cachedSettings.builtInNoiseSuppression);
+    convolutionToggle.setToggleState(cachedSettings.builtInConvolution, juce::dontSendNotification);
+    params.convolution.store(cachedSettings.builtInConvolution);
+    if (cachedSettings.impulseResponsePath.isNotEmpty())
+    {
+        juce::String impulseError;
+        if (engine.loadImpulseResponse(juce::File(cachedSettings.impulseResponsePath), impulseError))
+            loadImpulseButton.setTooltip(cachedSettings.impulseResponsePath);
+        else
+            Logger::instance().log(impulseError, Logger::Level::warning);
+    }
     applyThemePalette();
     applyUiDensity();
     refreshAppearanceControls();
@@ -2106,6 +2202,19 @@ void MainComponent::updateSettingsTabVisibility()
     for (auto* c : { static_cast<juce::Component*>(&startupLabel),
                      static_cast<juce::Component*>(&behaviorListenDeviceLabel),
                      static_cast<juce::Component*>(&behaviorListenDeviceBox),
+                     static_cast<juce::Component*>(&behaviorResamplerLabel),
+                     static_cast<juce::Component*>(&behaviorResamplerBox),
+                     static_cast<juce::Component*>(&behaviorProcessingRateLabel),
+                     static_cast<juce::Component*>(&behaviorProcessingRateBox),
+                     static_cast<juce::Component*>(&behaviorPipelineLabel),
+                     static_cast<juce::Component*>(&behaviorPipelineBox),
+                     static_cast<juce::Component*>(&sandboxPluginsToggle),
+                     static_cast<juce::Component*>(&voiceStripToggle),
+                     static_cast<juce::Component*>(&noiseSuppressionToggle),
+                     static_cast<juce::Component*>(&convolutionToggle),
+                     static_cast<juce::Component*>(&loadImpulseButton),
+                     static_cast<juce::Component*>(&traceToggle),
+                     static_cast<juce::Component*>(&exportTraceButton),
                      static_cast<juce::Component*>(&behaviorVstFoldersLabel),
                      static_cast<juce::Component*>(&behaviorVstFoldersListBox),
                      static_cast<juce::Component*>(&behaviorAddVstFolderButton),
@@ -2374,6 +2483,25 @@ void MainComponent::refreshPluginChainUi()
     vstChainList.repaint();
 }
 
+void MainComponent::refreshPluginProfiles()
+{
+    const auto profiles = engine.getVstHost().takeProfileWindow();
+    pluginProfileText.clearQuick();
+    for (const auto& p : profiles)
+        pluginProfileText.add(formatPluginProfile(p));
+
+    for (int r = 0; r < pluginProfileText.size(); ++r)
+        if (auto* row = dynamic_cast<VstRowComponent*>(vstChainList.getComponentForRowNumber(r)))
+            row->setProfileText(pluginProfileText[r]);
+
+    // Fresh costs are in; move pipeline stage boundaries if the load has shifted.
+    engine.getVstHost().rebalancePipeline();
+
+    // Only realtime-audit builds record anything here.
+    for (const auto& violation : RealtimeAudit::takeViolations())
+        Logger::instance().log(RealtimeAudit::describe(violation), Logger::Level::warning);
+}
+
 void MainComponent::loadDeviceLists()
 {
     const juce::ScopedValueSetter<bool> svs(suppressControlCallbacks, true);
@@ -2447,13 +2575,20 @@ void MainComponent::applySettingsFromControls()
     s.outputDeviceName = getSelectedOutputDeviceName();
     const auto requestedBuffer = bufferBox.getText().getIntValue();
     s.bufferSize = requestedBuffer > 0 ? requestedBuffer : kDefaultBlockSize;
+    s.resamplerQuality = juce::jlimit(0, 2, behaviorResamplerBox.getSelectedId() - 1);
+    s.internalSampleRate = kProcessingRateOptions[static_cast<size_t>(juce::jlimit(0, static_cast<int>(kProcessingRateOptions.size()) - 1,
+                                                                                    behaviorProcessingRateBox.getSelectedId() - 1))];
+    s.pipelineStages = juce::jlimit(1, VstHost::kMaxPipelineStages, behaviorPipelineBox.getSelectedId());
 
     if (s.inputDeviceName.isEmpty() || s.outputDeviceName.isEmpty())
         return;
 
     if (s.inputDeviceName == previous.inputDeviceName
         && s.outputDeviceName == previous.outputDeviceName
-        && s.bufferSize == previous.bufferSize)
+        && s.bufferSize == previous.bufferSize
+        && s.resamplerQuality == previous.resamplerQuality
+        && std::abs(s.internalSampleRate - previous.internalSampleRate) < 0.01
+        && s.pipelineStages == previous.pipelineStages)
         return;
 
     saveAutosaveDraftIfNeeded(true);
@@ -2471,6 +2606,9 @@ void MainComponent::applySettingsFromControls()
     cachedSettings.inputDeviceName = applied.inputDeviceName;
     cachedSettings.outputDeviceName = applied.outputDeviceName;
     cachedSettings.bufferSize = applied.bufferSize;
+    cachedSettings.resamplerQuality = applied.resamplerQuality;
+    cachedSettings.internalSampleRate = applied.internalSampleRate;
+    cachedSettings.pipelineStages = applied.pipelineStages;
     saveCachedSettings();
     loadDeviceLists();
 }
@@ -2551,6 +2689,7 @@ void MainComponent::rowOpenEditor(int row)
         try
         {
             hosted->editorOpen.store(true);
+            const juce::ScopedLock lifecycle(hosted->lifecycleLock);
             const juce::SpinLock::ScopedTryLockType lock(hosted->callbackLock);
             if (! lock.isLocked())
             {
@@ -2822,6 +2961,9 @@ void MainComponent::applyThemePalette()
                      static_cast<juce::Label*>(&appearanceBackgroundLabel),
                      static_cast<juce::Label*>(&appearanceSizeLabel),
                      static_cast<juce::Label*>(&behaviorListenDeviceLabel),
+                     static_cast<juce::Label*>(&behaviorResamplerLabel),
+                     static_cast<juce::Label*>(&behaviorProcessingRateLabel),
+                     static_cast<juce::Label*>(&behaviorPipelineLabel),
                      static_cast<juce::Label*>(&behaviorVstFoldersLabel),
                      static_cast<juce::Label*>(&dragHintLabel),
                      static_cast<juce::Label*>(&title),
@@ -2860,7 +3002,10 @@ void MainComponent::applyThemePalette()
                       static_cast<juce::ComboBox*>(&appearanceThemeBox),
                       static_cast<juce::ComboBox*>(&appearanceBackgroundBox),
                       static_cast<juce::ComboBox*>(&appearanceSizeBox),
-                      static_cast<juce::ComboBox*>(&behaviorListenDeviceBox) })
+                      static_cast<juce::ComboBox*>(&behaviorListenDeviceBox),
+                      static_cast<juce::ComboBox*>(&behaviorResamplerBox),
+                      static_cast<juce::ComboBox*>(&behaviorProcessingRateBox),
+                      static_cast<juce::ComboBox*>(&behaviorPipelineBox) })
     {
         if (cb == nullptr)
             continue;
@@ -2887,6 +3032,8 @@ void MainComponent::applyThemePalette()
                      static_cast<juce::TextButton*>(&removeProgramButton),
                      static_cast<juce::TextButton*>(&behaviorAddVstFolderButton),
                      static_cast<juce::TextButton*>(&behaviorRemoveVstFolderButton),
+                     static_cast<juce::TextButton*>(&exportTraceButton),
+                     static_cast<juce::TextButton*>(&loadImpulseButton),
                      static_cast<juce::TextButton*>(&closeSettingsButton),
                      static_cast<juce::TextButton*>(&checkUpdatesButton),
                      static_cast<juce::TextButton*>(&updatesGithubButton),
@@ -2911,6 +3058,11 @@ void MainComponent::applyThemePalette()
                      static_cast<juce::ToggleButton*>(&startWithWindowsToggle),
                      static_cast<juce::ToggleButton*>(&startMinimizedToggle),
                      static_cast<juce::ToggleButton*>(&followAutoEnableWindowToggle),
+                     static_cast<juce::ToggleButton*>(&sandboxPluginsToggle),
+                     static_cast<juce::ToggleButton*>(&voiceStripToggle),
+                     static_cast<juce::ToggleButton*>(&noiseSuppressionToggle),
+                     static_cast<juce::ToggleButton*>(&convolutionToggle),
+                     static_cast<juce::ToggleButton*>(&traceToggle),
                      static_cast<juce::ToggleButton*>(&lightModeToggle) })
     {
         if (t != nullptr)
@@ -2985,6 +3137,9 @@ void MainComponent::applyUiDensity()
     appearanceBackgroundLabel.setFont(sectionLabelFont);
     appearanceSizeLabel.setFont(sectionLabelFont);
     behaviorListenDeviceLabel.setFont(sectionLabelFont);
+    behaviorResamplerLabel.setFont(sectionLabelFont);
+    behaviorProcessingRateLabel.setFont(sectionLabelFont);
+    behaviorPipelineLabel.setFont(sectionLabelFont);
     behaviorVstFoldersLabel.setFont(sectionLabelFont);
 
     juce::Font versionFont(juce::FontOptions(11.0f * uiScale));
@@ -3213,10 +3368,11 @@ PresetData MainComponent::buildCurrentPresetData(const juce::String& name, bool
         state.name = plugin->description.name;
         state.enabled = plugin->enabled.load();
         state.mix = plugin->mix.load();
+        state.branch = plugin->branch.load();
         if (includePluginStates)
         {
             juce::MemoryBlock block;
-            if (tryCapturePluginStateNonBlocking(*plugin, block, "Preset save: state capture failed for "))
+            if (engine.getVstHost().capturePluginState(*plugin, block, "Preset save: state capture failed for "))
             {
                 state.base64State = block.toBase64Encoding();
             }
@@ -3486,12 +3642,13 @@ void MainComponent::capturePluginSnapshotForUndo(int index)
         return;
 
     juce::MemoryBlock block;
-    if (! tryCapturePluginStateNonBlocking(*plugin, block, "Undo capture failed for "))
+    if (! engine.getVstHost().capturePluginState(*plugin, block, "Undo capture failed for "))
         Logger::instance().log("Undo capture skipped for " + plugin->description.name);
     lastRemovedPlugin.description = plugin->description;
     lastRemovedPlugin.base64State = block.toBase64Encoding();
     lastRemovedPlugin.enabled = plugin->enabled.load();
     lastRemovedPlugin.mix = plugin->mix.load();
+    lastRemovedPlugin.branch = plugin->branch.load();
     lastRemovedPlugin.index = index;
     lastRemovedPlugin.valid = true;
 }
@@ -3533,6 +3690,7 @@ void MainComponent::restoreLastRemovedPlugin()
     const auto newIndex = getNumRows() - 1;
     engine.getVstHost().setEnabled(newIndex, lastRemovedPlugin.enabled);
     engine.getVstHost().setMix(newIndex, lastRemovedPlugin.mix);
+    engine.getVstHost().setBranch(newIndex, lastRemovedPlugin.branch);
 
     const auto targetIndex = juce::jlimit(0, juce::jmax(0, getNumRows() - 1), lastRemovedPlugin.index);
     if (targetIndex != newIndex)
@@ -3557,6 +3715,14 @@ void MainComponent::rowQuickActionMenu(int row, juce::Point<int> screenPosition)
     m.addItem(2, "Solo");
     m.addItem(3, "Remove");
 
+    // Adjacent rows on a branch run side by side and are summed back together.
+    juce::PopupMenu branchMenu;
+    const auto currentBranch = plugin->branch.load();
+    branchMenu.addItem(10, "Serial", true, currentBranch == 0);
+    for (int b = 1; b <= VstHost::kMaxBranches; ++b)
+        branchMenu.addItem(10 + b, "Branch " + getBranchLetter(b), true, currentBranch == b);
+    m.addSubMenu("Parallel Branch", branchMenu);
+
     juce::Component::SafePointer<MainComponent> safeThis(this);
     m.showMenuAsync(juce::PopupMenu::Options().withTargetScreenArea(juce::Rectangle<int>(screenPosition.x, screenPosition.y, 1, 1)),
                     [safeThis, row](int result)
@@ -3580,11 +3746,20 @@ void MainComponent::rowQuickActionMenu(int row, juce::Point<int> screenPosition)
         {
             safeThis->removePluginAtIndex(row, true);
         }
+        else if (result >= 10 && result <= 10 + VstHost::kMaxBranches)
+        {
+            const auto branch = result - 10;
+            safeThis->engine.getVstHost().setBranch(row, branch);
+            safeThis->refreshPluginChainUi();
+            safeThis->setEffectsHint(branch == 0 ? juce::String("VST moved to serial chain")
+                                                 : "VST moved to branch " + getBranchLetter(branch), 45);
+        }
     });
 }
 
 void MainComponent::loadPresetByName(const juce::String& name)
 {
+    const TraceScope trace("ui", "Preset load", name);
     if (auto preset = presetStore.loadPreset(name))
     {
         auto engineSettings = engine.currentSettings();
@@ -3640,6 +3815,7 @@ void MainComponent::loadPresetByName(const juce::String& name)
                     {
                         last->enabled.store(p.enabled);
                         last->mix.store(p.mix);
+                        engine.getVstHost().setBranch(chain.size() - 1, p.branch);
                     }
                 }
             }
@@ -3969,6 +4145,78 @@ void MainComponent::buttonClicked(juce::Button* button)
         cachedSettings.followAutoEnableWindowState = followAutoEnableWindowToggle.getToggleState();
         saveCachedSettings();
     }
+    else if (button == &sandboxPluginsToggle)
+    {
+        cachedSettings.sandboxPlugins = sandboxPluginsToggle.getToggleState();
+        engine.getVstHost().setSandboxPlugins(cachedSettings.sandboxPlugins);
+        saveCachedSettings();
+    }
+    else if (button == &voiceStripToggle)
+    {
+        cachedSettings.builtInVoiceStrip = voiceStripToggle.getToggleState();
+        params.voiceStrip.store(cachedSettings.builtInVoiceStrip);
+        saveCachedSettings();
+    }
+    else if (button == &noiseSuppressionToggle)
+    {
+        cachedSettings.builtInNoiseSuppression = noiseSuppressionToggle.getToggleState();
+        params.noiseSuppression.store(cachedSettings.builtInNoiseSuppression);
+        saveCachedSettings();
+    }
+    else if (button == &convolutionToggle)
+    {
+        cachedSettings.builtInConvolution = convolutionToggle.getToggleState();
+        params.convolution.store(cachedSettings.builtInConvolution);
+        saveCachedSettings();
+    }
+    else if (button == &loadImpulseButton)
+    {
+        fileChooser = std::make_unique<juce::FileChooser>("Select impulse response", juce::File(cachedSettings.impulseResponsePath), "*.wav;*.aif;*.aiff;*.flac");
+        const int chooserFlags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+        fileChooser->launchAsync(chooserFlags, [this](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+            if (! file.existsAsFile())
+                return;
+
+            juce::String error;
+            if (! engine.loadImpulseResponse(file, error))
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Impulse Response", error);
+                return;
+            }
+
+            // A freshly loaded response is meant to be heard.
+            cachedSettings.impulseResponsePath = file.getFullPathName();
+            cachedSettings.builtInConvolution = true;
+            convolutionToggle.setToggleState(true, juce::dontSendNotification);
+            params.convolution.store(true);
+            loadImpulseButton.setTooltip(cachedSettings.impulseResponsePath);
+            saveCachedSettings();
+        });
+    }
+    else if (button == &traceToggle)
+    {
+        Tracer::instance().setEnabled(traceToggle.getToggleState());
+        Logger::instance().log(traceToggle.getToggleState() ? "Performance trace recording started" : "Performance trace recording stopped");
+    }
+    else if (button == &exportTraceButton)
+    {
+        const auto suggested = Logger::instance().getLogDirectory()
+                                   .getChildFile("fizzle-trace-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S") + ".json");
+        fileChooser = std::make_unique<juce::FileChooser>("Export performance trace", suggested, "*.json");
+        const int chooserFlags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting;
+        fileChooser->launchAsync(chooserFlags, [](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+            if (Tracer::instance().writeChromeTrace(file))
+                Logger::instance().log("Performance trace exported to " + file.getFullPathName());
+            else
+                Logger::instance().log("Performance trace export failed: " + file.getFullPathName(), Logger::Level::warning);
+        });
+    }
     else if (button == &checkUpdatesButton)
     {
         triggerUpdateCheck(true);
@@ -3985,7 +4233,9 @@ void MainComponent::buttonClicked(juce::Button* button)
 
 void MainComponent::comboBoxChanged(juce::ComboBox* comboBoxThatHasChanged)
 {
-    if (comboBoxThatHasChanged == &inputBox || comboBoxThatHasChanged == &outputBox || comboBoxThatHasChanged == &bufferBox)
+    if (comboBoxThatHasChanged == &inputBox || comboBoxThatHasChanged == &outputBox || comboBoxThatHasChanged == &bufferBox
+        || comboBoxThatHasChanged == &behaviorResamplerBox || comboBoxThatHasChanged == &behaviorProcessingRateBox
+        || comboBoxThatHasChanged == &behaviorPipelineBox)
     {
         if (suppressControlCallbacks)
             return;
@@ -4226,6 +4476,13 @@ void MainComponent::timerCallback()
         }
     }
 
+    const auto nowMs = juce::Time::getMillisecondCounter();
+    if (nowMs - lastPluginProfileMs >= 1000)
+    {
+        lastPluginProfileMs = nowMs;
+        refreshPluginProfiles();
+    }
+
     const auto listenEnabled = engine.isListenEnabled();
     const bool listenStateChanged = (listenEnabled != lastListenEnabledState);
     lastListenEnabledState = listenEnabled;
@@ -4438,10 +4695,12 @@ juce::Component* MainComponent::refreshComponentForRow(int rowNumber, bool isRow
 
     if (auto* plugin = engine.getVstHost().getPlugin(rowNumber))
         row->setRowData(rowNumber,
-                        plugin->description.name,
+                        plugin->branch.load() > 0 ? "[" + getBranchLetter(plugin->branch.load()) + "]  " + plugin->description.name
+                                                  : plugin->description.name,
                         plugin->enabled.load(),
                         plugin->mix.load(),
                         isRowSelected);
+    row->setProfileText(pluginProfileText[rowNumber]);
 
     return row;
 }
@@ -5095,6 +5354,31 @@ void MainComponent::resized()
             behaviorListenDeviceLabel.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(20.0f * uiScale)));
             behaviorListenDeviceBox.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale)));
             contentNoFooter.removeFromTop(gap);
+            behaviorResamplerLabel.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(20.0f * uiScale)));
+            behaviorResamplerBox.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            behaviorProcessingRateLabel.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(20.0f * uiScale)));
+            behaviorProcessingRateBox.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            behaviorPipelineLabel.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(20.0f * uiScale)));
+            behaviorPipelineBox.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            sandboxPluginsToggle.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(28.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            voiceStripToggle.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(28.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            noiseSuppressionToggle.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(28.0f * uiScale)));
+            contentNoFooter.removeFromTop(gap);
+            auto convolutionRow = contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale));
+            loadImpulseButton.setBounds(convolutionRow.removeFromRight(juce::roundToInt(132.0f * uiScale)));
+            convolutionRow.removeFromRight(gap);
+            convolutionToggle.setBounds(convolutionRow);
+            contentNoFooter.removeFromTop(gap);
+            auto traceRow = contentNoFooter.removeFromTop(juce::roundToInt(30.0f * uiScale));
+            exportTraceButton.setBounds(traceRow.removeFromRight(juce::roundToInt(132.0f * uiScale)));
+            traceRow.removeFromRight(gap);
+            traceToggle.setBounds(traceRow);
+            contentNoFooter.removeFromTop(gap);
             behaviorVstFoldersLabel.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(20.0f * uiScale)));
             behaviorVstFoldersListBox.setBounds(contentNoFooter.removeFromTop(juce::roundToInt(96.0f * uiScale)));
             contentNoFooter.removeFromTop(gap);
@@ -119,6 +119,19 @@ private:
     juce::Label startupLabel;
     juce::Label behaviorListenDeviceLabel;
     juce::ComboBox behaviorListenDeviceBox;
+    juce::Label behaviorResamplerLabel;
+    juce::ComboBox behaviorResamplerBox;
+    juce::Label behaviorProcessingRateLabel;
+    juce::ComboBox behaviorProcessingRateBox;
+    juce::Label behaviorPipelineLabel;
+    juce::ComboBox behaviorPipelineBox;
+    juce::ToggleButton sandboxPluginsToggle { "Run plugins in a separate process" };
+    juce::ToggleButton voiceStripToggle { "Built-in voice strip" };
+    juce::ToggleButton noiseSuppressionToggle { "Built-in noise suppression" };
+    juce::ToggleButton convolutionToggle { "Built-in convolution" };
+    juce::TextButton loadImpulseButton { "Load IR..." };
+    juce::ToggleButton traceToggle { "Record performance trace" };
+    juce::TextButton exportTraceButton { "Export Trace..." };
     juce::Label behaviorVstFoldersLabel;
     juce::ListBox behaviorVstFoldersListBox { "VST Search Folders", nullptr };
     juce::TextButton behaviorAddVstFolderButton { "Add Folder..." };
@@ -153,6 +166,8 @@ private:
     int dragFromRow { -1 };
     int dragToRow { -1 };
     int uiTickCount { 0 };
+    juce::uint32 lastPluginProfileMs { 0 };
+    juce::StringArray pluginProfileText;
     int effectsHintTicks { 0 };
     float effectsHintAlpha { 0.0f };
     float effectsHintTargetAlpha { 0.0f };
@@ -231,6 +246,7 @@ private:
         juce::String base64State;
         bool enabled { true };
         float mix { 1.0f };
+        int branch { 0 };
         int index { -1 };
         bool valid { false };
     };
@@ -247,6 +263,7 @@ private:
     void applySettingsFromControls();
     void refreshKnownPlugins();
     void refreshPluginChainUi();
+    void refreshPluginProfiles();
     void autoScanVstFolders();
     void refreshRunningApps();
     void refreshProgramsList();
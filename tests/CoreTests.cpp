@@ -0,0 +1,387 @@
+#include <JuceHeader.h>
+#include "../src/core/LatencyHistogram.h"
+#include "../src/core/Logger.h"
+#include "../src/core/RealtimeWorkerPool.h"
+#include "../src/core/Tracer.h"
+#include "../src/core/TripleBuffer.h"
+#include "../src/plugins/SandboxTransport.h"
+#include <array>
+#include <atomic>
+#include <set>
+#include <thread>
+
+namespace
+{
+class TripleBufferTest final : public juce::UnitTest
+{
+public:
+    TripleBufferTest() : juce::UnitTest("Triple buffer hand-off", "Core") {}
+
+    void runTest() override
+    {
+        beginTest("Reader sees newest value and reports freshness");
+
+        struct Sample
+        {
+            int a { 0 };
+            int b { 0 };
+        };
+
+        fizzle::TripleBuffer<Sample> channel;
+        Sample out;
+        expect(! channel.read(out));
+        expectEquals(out.a, 0);
+
+        channel.write({ 1, 1 });
+        channel.write({ 2, 2 });
+        expect(channel.read(out));
+        expectEquals(out.a, 2);
+        expect(! channel.read(out));
+        expectEquals(out.b, 2);
+
+        beginTest("Concurrent writer never produces torn values");
+
+        std::atomic<bool> done { false };
+        std::thread writer([&]
+        {
+            for (int i = 1; i <= 200000; ++i)
+                channel.write({ i, -i });
+            done.store(true);
+        });
+
+        bool consistent = true;
+        int last = 0;
+        while (! done.load())
+        {
+            if (channel.read(out))
+            {
+                consistent = consistent && out.a == -out.b && out.a >= last;
+                last = out.a;
+            }
+        }
+        writer.join();
+        channel.read(out);
+        expect(consistent);
+        expectEquals(out.a, 200000);
+    }
+};
+
+class LatencyHistogramTest final : public juce::UnitTest
+{
+public:
+    LatencyHistogramTest() : juce::UnitTest("Latency histogram windows", "Core") {}
+
+    void runTest() override
+    {
+        beginTest("Percentiles land within bucket resolution");
+
+        fizzle::LatencyHistogram histogram;
+        for (int i = 1; i <= 1000; ++i)
+            histogram.record(static_cast<uint64_t>(i) * 1000);
+
+        auto summary = histogram.takeWindow();
+        expectEquals(static_cast<int>(summary.count), 1000);
+        expectWithinAbsoluteError(summary.meanUs, 500.5, 0.01);
+        expectWithinAbsoluteError(summary.p50Us, 500.0, 500.0 * 0.05);
+        expectWithinAbsoluteError(summary.p99Us, 990.0, 990.0 * 0.05);
+        expectWithinAbsoluteError(summary.maxUs, 1000.0, 0.001);
+        expect(summary.p999Us <= summary.maxUs);
+
+        beginTest("Each window only covers new samples");
+
+        summary = histogram.takeWindow();
+        expectEquals(static_cast<int>(summary.count), 0);
+
+        histogram.record(20);
+        histogram.record(5'000'000);
+        summary = histogram.takeWindow();
+        expectEquals(static_cast<int>(summary.count), 2);
+        expectWithinAbsoluteError(summary.p50Us, 0.02, 0.001);
+        expectWithinAbsoluteError(summary.maxUs, 5000.0, 0.001);
+
+        beginTest("Bucket mapping is monotonic");
+
+        int previous = 0;
+        for (uint64_t ns = 0; ns < 10'000'000; ns = ns < 100 ? ns + 1 : ns + ns / 7)
+        {
+            const auto bucket = fizzle::LatencyHistogram::bucketFor(ns);
+            expect(bucket >= previous);
+            const auto value = fizzle::LatencyHistogram::bucketValue(bucket);
+            expect(std::abs(value - static_cast<double>(ns)) <= juce::jmax(0.5, static_cast<double>(ns) * 0.04));
+            previous = bucket;
+        }
+    }
+};
+
+class RealtimeWorkerPoolTest final : public juce::UnitTest
+{
+public:
+    RealtimeWorkerPoolTest() : juce::UnitTest("Realtime worker pool", "Core") {}
+
+    void runTest() override
+    {
+        beginTest("Every task of every batch runs exactly once");
+
+        struct Batch
+        {
+            std::array<std::atomic<int>, 8> hits {};
+        };
+
+        fizzle::RealtimeWorkerPool pool(3);
+        bool allOnce = true;
+        for (int round = 0; round < 2000; ++round)
+        {
+            Batch batch;
+            const auto numTasks = 1 + round % 8;
+            pool.run(numTasks, [](void* context, int index) noexcept
+            {
+                static_cast<Batch*>(context)->hits[static_cast<size_t>(index)].fetch_add(1);
+            }, &batch);
+
+            for (int i = 0; i < 8; ++i)
+                allOnce = allOnce && batch.hits[static_cast<size_t>(i)].load() == (i < numTasks ? 1 : 0);
+        }
+        expect(allOnce);
+
+        beginTest("Work is shared with the workers");
+
+        int distinctThreads = 0;
+        struct Spread
+        {
+            std::array<std::atomic<juce::Thread::ThreadID>, 4> ids {};
+        } spread;
+        for (int round = 0; round < 200; ++round)
+        {
+            pool.run(4, [](void* context, int index) noexcept
+            {
+                juce::Thread::sleep(1);
+                static_cast<Spread*>(context)->ids[static_cast<size_t>(index)].store(juce::Thread::getCurrentThreadId());
+            }, &spread);
+
+            std::set<juce::Thread::ThreadID> ids;
+            for (auto& id : spread.ids)
+                ids.insert(id.load());
+            distinctThreads = juce::jmax(distinctThreads, static_cast<int>(ids.size()));
+        }
+        expect(distinctThreads > 1);
+    }
+};
+
+class SandboxTransportTest final : public juce::UnitTest
+{
+public:
+    SandboxTransportTest() : juce::UnitTest("Sandbox transport", "Core") {}
+
+    void runTest() override
+    {
+        beginTest("Blocks make the round trip through shared memory");
+
+        juce::String error;
+        auto host = fizzle::SandboxTransport::create(256, error);
+        expect(host != nullptr, error);
+        if (host == nullptr)
+            return;
+
+        auto helper = fizzle::SandboxTransport::open(host->getFile(), error);
+        expect(helper != nullptr, error);
+        if (helper == nullptr)
+            return;
+
+        std::atomic<bool> stop { false };
+        std::thread helperThread([&]
+        {
+            while (! stop.load())
+            {
+                if (! helper->waitForRequest(20))
+                    continue;
+                for (int c = 0; c < helper->getNumChannels(); ++c)
+                    juce::FloatVectorOperations::multiply(helper->getChannels()[c], 2.0f, helper->getNumSamples());
+                helper->completeRequest(1000);
+            }
+        });
+
+        juce::AudioBuffer<float> block(2, 128);
+        bool allDoubled = true;
+        for (int round = 0; round < 200; ++round)
+        {
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < block.getNumSamples(); ++i)
+                    block.setSample(c, i, static_cast<float>(round + c * 1000 + i));
+
+            const auto sent = host->submit(block);
+            const auto deadline = juce::Time::getHighResolutionTicks() + juce::Time::getHighResolutionTicksPerSecond();
+            allDoubled = allDoubled && sent && host->awaitResponse(block, deadline);
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < block.getNumSamples(); ++i)
+                    allDoubled = allDoubled && block.getSample(c, i) == 2.0f * static_cast<float>(round + c * 1000 + i);
+        }
+        expect(allDoubled);
+        expectEquals(static_cast<int>(host->getLastHelperNanos()), 1000);
+
+        beginTest("A silent helper costs one deadline and leaves the block dry");
+
+        stop.store(true);
+        helperThread.join();
+
+        block.clear();
+        block.setSample(0, 0, 0.5f);
+        expect(host->submit(block));
+        const auto start = juce::Time::getHighResolutionTicks();
+        const auto deadline = start + juce::Time::getHighResolutionTicksPerSecond() / 500;
+        expect(! host->awaitResponse(block, deadline));
+        expect(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) < 0.5);
+        expectEquals(block.getSample(0, 0), 0.5f);
+        expect(! host->isIdle());
+        expect(! host->submit(block));
+    }
+};
+
+class LoggerTest final : public juce::UnitTest
+{
+public:
+    LoggerTest() : juce::UnitTest("Asynchronous logger", "Core") {}
+
+    void runTest() override
+    {
+        const auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                .getChildFile("fizzle-logger-test-" + juce::String::toHexString(juce::Random::getSystemRandom().nextInt64()));
+
+        beginTest("Records queued before and after initialise reach the file in order");
+        {
+            fizzle::Logger logger;
+            logger.log("before start");
+            logger.initialise(folder);
+            logger.log(fizzle::Logger::Level::warning, { "plugin ", juce::String("Reverb"), " stalled" });
+            logger.log("too chatty", fizzle::Logger::Level::debug);
+            logger.flush();
+
+            const auto text = logger.getCurrentLogFile().loadFileAsString();
+            expect(text.contains("info | before start"));
+            expect(text.contains("warning | plugin Reverb stalled"));
+            expect(! text.contains("too chatty"));
+            logger.shutdown();
+        }
+
+        beginTest("A full ring drops and counts instead of blocking");
+        {
+            fizzle::Logger logger;
+            for (int i = 0; i < fizzle::Logger::kCapacity + 5; ++i)
+                logger.log(fizzle::Logger::Level::info, { "queued" });
+            expectEquals(static_cast<int>(logger.getNumDroppedRecords()), 5);
+
+            logger.initialise(folder);
+            logger.flush();
+            expect(logger.getCurrentLogFile().loadFileAsString().contains("5 log record(s) dropped"));
+            logger.shutdown();
+        }
+
+        beginTest("Files rotate at the size limit");
+        {
+            fizzle::Logger logger;
+            logger.initialise(folder, 2048);
+            const auto first = logger.getCurrentLogFile();
+            const juce::String line = juce::String::repeatedString("x", 100);
+            for (int i = 0; i < 100; ++i)
+            {
+                logger.log(line);
+                if (i % 10 == 9)
+                    logger.flush();
+            }
+            logger.flush();
+
+            expect(logger.getCurrentLogFile() != first);
+            expect(first.getSize() <= 2048);
+            logger.shutdown();
+        }
+
+        beginTest("Records wait out a rotation into a folder that cannot be written");
+        {
+            const auto rotating = folder.getChildFile("rotating");
+            fizzle::Logger logger;
+            logger.initialise(rotating, 1024);
+            logger.flush();
+
+            // A plain file in the folder's place stops the next file being created, even
+            // for a user who may write anywhere. Windows will not remove a folder while
+            // the current log file in it is open.
+            if (! rotating.deleteRecursively())
+            {
+                logMessage("The log folder cannot be removed while in use here; skipped");
+            }
+            else
+            {
+                expect(rotating.replaceWithText("not a folder"));
+                const juce::String line = juce::String::repeatedString("y", 100);
+                for (int i = 0; i < 20; ++i)
+                    logger.log(line);
+                logger.log("queued through the failed rotation");
+                logger.flush();
+                logger.flush();
+                expect(rotating.existsAsFile());
+
+                expect(rotating.deleteFile());
+                logger.flush();
+                expect(logger.getCurrentLogFile().getParentDirectory() == rotating);
+                expect(logger.getCurrentLogFile().loadFileAsString().contains("queued through the failed rotation"));
+            }
+            logger.shutdown();
+        }
+
+        folder.deleteRecursively();
+    }
+};
+
+class TracerTest final : public juce::UnitTest
+{
+public:
+    TracerTest() : juce::UnitTest("Chrome trace capture", "Core") {}
+
+    void runTest() override
+    {
+        auto& tracer = fizzle::Tracer::instance();
+
+        beginTest("Nothing is recorded while tracing is off");
+        tracer.setEnabled(false);
+        {
+            const fizzle::TraceScope scope("test", "ignored");
+        }
+        expect(! tracer.toChromeTraceJson().contains("ignored"));
+
+        beginTest("Scopes from several threads export as complete events");
+        tracer.setEnabled(true);
+        {
+            const fizzle::TraceScope scope("test", "outer", juce::String("Say \"hi\""));
+            std::thread worker([]
+            {
+                fizzle::Tracer::instance().nameCurrentThread("Test worker");
+                const fizzle::TraceScope inner("test", "inner");
+            });
+            worker.join();
+        }
+        const auto json = tracer.toChromeTraceJson();
+        expect(json.startsWith("{\"displayTimeUnit\""));
+        expect(json.contains("\"name\":\"outer\",\"cat\":\"test\",\"ph\":\"X\""));
+        expect(json.contains("\"name\":\"inner\""));
+        expect(json.contains("\"args\":{\"name\":\"Test worker\"}"));
+        expect(json.contains("\"detail\":\"Say \\\"hi\\\"\""));
+
+        beginTest("A thread keeps only its newest events");
+        tracer.setEnabled(false);
+        tracer.setEnabled(true);
+        const auto now = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < fizzle::Tracer::kEventsPerThread + 10; ++i)
+            tracer.record("test", i < 10 ? "oldest" : "newest", now, now + 1);
+        const auto wrapped = tracer.toChromeTraceJson();
+        expect(! wrapped.contains("oldest"));
+        expect(wrapped.contains("newest"));
+        tracer.setEnabled(false);
+    }
+};
+
+TripleBufferTest tripleBufferTest;
+LatencyHistogramTest latencyHistogramTest;
+RealtimeWorkerPoolTest realtimeWorkerPoolTest;
+SandboxTransportTest sandboxTransportTest;
+LoggerTest loggerTest;
+TracerTest tracerTest;
+}
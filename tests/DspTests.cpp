@@ -1,5 +1,14 @@
 #include <JuceHeader.h>
+#include "../src/audio/BiquadCascade.h"
+#include "../src/audio/BufferArena.h"
 #include "../src/audio/BuiltInProcessors.h"
+#include "../src/audio/DriftCompensator.h"
+#include "../src/audio/NoiseSuppressor.h"
+#include "../src/audio/PartitionedConvolver.h"
+#include "../src/audio/ProcessorChain.h"
+#include "../src/audio/Resampler.h"
+#include "../src/audio/SimdKernels.h"
+#include "../src/audio/TruePeakLimiter.h"
 
 namespace
 {
@@ -76,7 +85,7 @@ public:
     {
         beginTest("High signal is limited");
 
-        fizzle::BuiltInProcessors proc;
+        fizzle::ProcessorChain proc;
         proc.prepare(48000.0, 1);
 
         fizzle::EffectParameters params;
@@ -84,6 +93,7 @@ public:
         params.compRatio.store(4.0f);
         params.compMakeupDb.store(0.0f);
         params.limiterCeilDb.store(-3.0f);
+        params.voiceStrip.store(true);
 
         juce::AudioBuffer<float> buf(1, 4096);
         for (int i = 0; i < buf.getNumSamples(); ++i)
@@ -98,7 +108,899 @@ public:
     }
 };
 
+class VoiceStripBlockTest final : public juce::UnitTest
+{
+public:
+    VoiceStripBlockTest() : juce::UnitTest("Voice strip block processing", "DSP") {}
+
+    void runTest() override
+    {
+        beginTest("Vector gain curve tracks the exact power law");
+        for (const auto exponent : { 0.75f, -0.7425f, -0.2475f })
+        {
+            std::array<float, 37> envelope {}, gains {};
+            for (size_t i = 0; i < envelope.size(); ++i)
+                envelope[i] = std::pow(10.0f, -7.5f + 0.2f * static_cast<float>(i));
+
+            const auto invThreshold = 1.0f / 0.0316f;
+            fizzle::simd::thresholdGain(gains.data(), envelope.data(), 1.0e-7f, invThreshold, exponent, static_cast<int>(envelope.size()));
+            for (size_t i = 0; i < envelope.size(); ++i)
+            {
+                const auto expected = juce::jmin(1.0f, std::pow(juce::jmax(envelope[i], 1.0e-7f) * invThreshold, exponent));
+                expectWithinAbsoluteError(gains[i], expected, expected * 1.0e-4f);
+            }
+        }
+
+        beginTest("Output does not depend on how the audio is split into blocks");
+        fizzle::EffectParameters params;
+        params.deEssAmount.store(0.6f);
+        params.compThresholdDb.store(-30.0f);
+
+        juce::AudioBuffer<float> whole(2, 4800);
+        juce::Random random(11);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < whole.getNumSamples(); ++i)
+                whole.setSample(c, i, 0.5f * std::sin(0.03f * static_cast<float>(i)) * (0.2f + 0.8f * random.nextFloat()));
+        juce::AudioBuffer<float> split(whole);
+
+        fizzle::BuiltInProcessors a, b;
+        a.prepare(48000.0, 2);
+        b.prepare(48000.0, 2);
+        a.process(whole, params);
+        for (int start = 0; start < split.getNumSamples(); start += 97)
+        {
+            const auto n = juce::jmin(97, split.getNumSamples() - start);
+            juce::AudioBuffer<float> view(split.getArrayOfWritePointers(), 2, start, n);
+            b.process(view, params);
+        }
+
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < whole.getNumSamples(); ++i)
+                expectEquals(split.getSample(c, i), whole.getSample(c, i));
+    }
+};
+
+class BiquadCascadeTest final : public juce::UnitTest
+{
+public:
+    BiquadCascadeTest() : juce::UnitTest("Biquad cascade", "DSP") {}
+
+    void runTest() override
+    {
+        constexpr float rate = 48000.0f;
+        juce::Random random(7);
+        const auto fillNoise = [&random](juce::AudioBuffer<float>& buffer)
+        {
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    buffer.setSample(c, i, random.nextFloat() * 2.0f - 1.0f);
+        };
+
+        beginTest("Every lane matches the scalar biquad");
+        {
+            fizzle::BiquadCascade<1, 3> cascade;
+            std::array<fizzle::Biquad, 3> reference;
+            const auto coefficients = fizzle::BiquadCoefficients::highPass(rate, 120.0f);
+            cascade.setStage(0, coefficients, false);
+            for (auto& biquad : reference)
+                biquad.setCoefficients(coefficients);
+
+            juce::AudioBuffer<float> buffer(3, 1001);
+            fillNoise(buffer);
+            juce::AudioBuffer<float> expected(buffer);
+            cascade.process(buffer.getArrayOfWritePointers(), 3, buffer.getNumSamples());
+            for (int c = 0; c < 3; ++c)
+                for (int i = 0; i < expected.getNumSamples(); ++i)
+                    expectWithinAbsoluteError(buffer.getSample(c, i), reference[static_cast<size_t>(c)].process(expected.getSample(c, i)), 1.0e-6f);
+        }
+
+        beginTest("Shelf and peak sections hit their designed gains");
+        {
+            const auto gainAt = [rate](const fizzle::BiquadCoefficients& coefficients, float frequency)
+            {
+                fizzle::BiquadCascade<1, 1> cascade;
+                cascade.setStage(0, coefficients, false);
+                juce::AudioBuffer<float> sine(1, 9600);
+                for (int i = 0; i < sine.getNumSamples(); ++i)
+                    sine.setSample(0, i, std::sin(juce::MathConstants<float>::twoPi * frequency * static_cast<float>(i) / rate));
+
+                const auto before = sine.getRMSLevel(0, 4800, 4800);
+                cascade.process(sine.getArrayOfWritePointers(), 1, sine.getNumSamples());
+                return juce::Decibels::gainToDecibels(sine.getRMSLevel(0, 4800, 4800) / before);
+            };
+
+            expectWithinAbsoluteError(gainAt(fizzle::BiquadCoefficients::lowShelf(rate, 200.0f, 6.0f), 30.0f), 6.0f, 0.3f);
+            expectWithinAbsoluteError(gainAt(fizzle::BiquadCoefficients::highShelf(rate, 5000.0f, -6.0f), 16000.0f), -6.0f, 0.5f);
+            expectWithinAbsoluteError(gainAt(fizzle::BiquadCoefficients::peak(rate, 1000.0f, 9.0f), 1000.0f), 9.0f, 0.1f);
+            expectWithinAbsoluteError(gainAt(fizzle::BiquadCoefficients::lowPass(rate, 1000.0f), 8000.0f), -36.0f, 2.0f);
+            expect(fizzle::BiquadCoefficients::peak(rate, 1000.0f, 0.0f).isIdentity());
+        }
+
+        beginTest("Changes ramp in once and repeated settings are cached");
+        {
+            const auto peak = fizzle::BiquadCoefficients::peak(rate, 1000.0f, 12.0f);
+            fizzle::BiquadCascade<1> snapped, ramping, settled;
+            snapped.setStage(0, peak, false);
+            ramping.setStage(0, peak);
+            settled.setStage(0, peak);
+
+            // Run the ramp out on silence, which leaves the state empty, then set the same
+            // coefficients again; that must not start another ramp.
+            juce::AudioBuffer<float> silence(2, fizzle::BiquadCascade<1>::kDefaultRampSamples);
+            silence.clear();
+            settled.process(silence.getArrayOfWritePointers(), 2, silence.getNumSamples());
+            settled.setStage(0, peak);
+
+            juce::AudioBuffer<float> noise(2, 512);
+            fillNoise(noise);
+            juce::AudioBuffer<float> a(noise), b(noise), c(noise);
+            snapped.process(a.getArrayOfWritePointers(), 2, a.getNumSamples());
+            ramping.process(b.getArrayOfWritePointers(), 2, b.getNumSamples());
+            settled.process(c.getArrayOfWritePointers(), 2, c.getNumSamples());
+
+            expect(b.getSample(0, 1) != a.getSample(0, 1));
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < a.getNumSamples(); ++i)
+                    expectEquals(c.getSample(ch, i), a.getSample(ch, i));
+        }
+
+        beginTest("Silence after a burst leaves the state exactly zero");
+        {
+            fizzle::BiquadCascade<2> cascade;
+            cascade.setStage(0, fizzle::BiquadCoefficients::highPass(rate, 4200.0f, 0.8f), false);
+            cascade.setStage(1, fizzle::BiquadCoefficients::lowPass(rate, 100.0f), false);
+            juce::AudioBuffer<float> buffer(2, 256);
+            fillNoise(buffer);
+            cascade.process(buffer.getArrayOfWritePointers(), 2, buffer.getNumSamples());
+
+            for (int block = 0; block < 200; ++block)
+            {
+                buffer.clear();
+                cascade.process(buffer.getArrayOfWritePointers(), 2, buffer.getNumSamples());
+            }
+
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    expectEquals(buffer.getSample(c, i), 0.0f);
+        }
+    }
+};
+
+class TruePeakLimiterTest final : public juce::UnitTest
+{
+public:
+    TruePeakLimiterTest() : juce::UnitTest("True-peak limiter", "DSP") {}
+
+    void runTest() override
+    {
+        constexpr double rate = 48000.0;
+        const auto sine = [](juce::AudioBuffer<float>& buffer, int start, int length, float amplitude, double frequency, double phase)
+        {
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                for (int i = start; i < start + length; ++i)
+                    buffer.setSample(c, i, amplitude * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * frequency * i / rate + phase)));
+        };
+
+        beginTest("Audio under the ceiling only picks up the reported delay");
+        {
+            fizzle::TruePeakLimiter limiter;
+            limiter.prepare(rate, 2);
+            const auto latency = limiter.getLatencySamples();
+            expectEquals(latency, juce::roundToInt(fizzle::TruePeakLimiter::kDefaultLookaheadMs * rate / 1000.0) + fizzle::TruePeakLimiter::kTapsPerPhase / 2 - 1);
+
+            juce::AudioBuffer<float> buffer(2, 2000);
+            sine(buffer, 0, buffer.getNumSamples(), 0.5f, 440.0, 0.0);
+            juce::AudioBuffer<float> original(buffer);
+            for (int start = 0; start < buffer.getNumSamples(); start += 100)
+            {
+                float* block[2] { buffer.getWritePointer(0, start), buffer.getWritePointer(1, start) };
+                limiter.process(block, 2, 100, 0.9f);
+            }
+
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int i = 0; i < latency; ++i)
+                    expectEquals(buffer.getSample(c, i), 0.0f);
+                for (int i = latency; i < buffer.getNumSamples(); ++i)
+                    expectEquals(buffer.getSample(c, i), original.getSample(c, i - latency));
+            }
+        }
+
+        beginTest("Peaks between samples are caught");
+        {
+            // A quarter-rate sine at 45 degrees never samples its crest: every sample sits
+            // 3 dB under the true peak.
+            fizzle::TruePeakLimiter limiter;
+            limiter.prepare(rate, 1);
+            juce::AudioBuffer<float> buffer(1, 4800);
+            sine(buffer, 0, buffer.getNumSamples(), 1.0f, rate / 4.0, juce::MathConstants<double>::pi / 4.0);
+            expect(buffer.getMagnitude(0, 0, buffer.getNumSamples()) < 0.75f);
+
+            auto* data = buffer.getWritePointer(0);
+            limiter.process(&data, 1, buffer.getNumSamples(), 0.75f);
+            const auto truePeak = buffer.getMagnitude(0, 2400, 2400) * std::sqrt(2.0f);
+            expectWithinAbsoluteError(truePeak, 0.75f, 0.01f);
+        }
+
+        beginTest("A sudden burst is held under the ceiling and the gain recovers");
+        {
+            fizzle::TruePeakLimiter limiter;
+            limiter.prepare(rate, 2);
+            juce::AudioBuffer<float> buffer(2, 48000);
+            buffer.clear();
+            sine(buffer, 1000, 4000, 0.99f, 7100.0, 0.3);
+            sine(buffer, 5000, 43000, 0.1f, 300.0, 0.0);
+            // Short fades keep the burst's edges band limited; a hard step rings by
+            // different amounts depending on the filter used to reconstruct it.
+            for (int c = 0; c < 2; ++c)
+            {
+                buffer.applyGainRamp(c, 1000, 48, 0.0f, 1.0f);
+                buffer.applyGainRamp(c, 4952, 48, 1.0f, 0.0f);
+            }
+            for (int start = 0; start < buffer.getNumSamples(); start += 480)
+            {
+                float* block[2] { buffer.getWritePointer(0, start), buffer.getWritePointer(1, start) };
+                limiter.process(block, 2, 480, 0.5f);
+            }
+
+            // Measure the output's true peak independently, on a 4x resampled copy.
+            fizzle::Resampler upsampler;
+            upsampler.prepare(rate, 4.0 * rate, 2, buffer.getNumSamples(), fizzle::Resampler::Quality::high);
+            juce::AudioBuffer<float> upsampled(2, upsampler.getMaxOutputForInput(buffer.getNumSamples()));
+            const auto produced = upsampler.process(buffer, buffer.getNumSamples(), upsampled);
+            for (int c = 0; c < 2; ++c)
+            {
+                const auto truePeak = upsampled.getMagnitude(c, 0, produced);
+                expect(truePeak < 0.5f * 1.01f, "true peak " + juce::String(truePeak));
+            }
+
+            expect(limiter.getCurrentGain() > 0.99f, "gain " + juce::String(limiter.getCurrentGain()));
+        }
+    }
+};
+
+class NoiseSuppressorTest final : public juce::UnitTest
+{
+public:
+    NoiseSuppressorTest() : juce::UnitTest("Noise suppressor", "DSP") {}
+
+    void runTest() override
+    {
+        constexpr double rate = 48000.0;
+
+        beginTest("Audio with no noise under it only picks up the reported delay");
+        {
+            fizzle::NoiseSuppressor suppressor;
+            suppressor.prepare(rate, 2);
+            const auto latency = suppressor.getLatencySamples();
+            expectEquals(latency, 256);
+
+            juce::AudioBuffer<float> buffer(2, 4000);
+            buffer.clear();
+            buffer.setSample(0, 1000, 1.0f);
+            buffer.setSample(1, 1500, -0.5f);
+            for (int start = 0; start < buffer.getNumSamples(); start += 100)
+            {
+                float* block[2] { buffer.getWritePointer(0, start), buffer.getWritePointer(1, start) };
+                suppressor.process(block, 2, 100);
+            }
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                expectWithinAbsoluteError(buffer.getSample(0, i), i == 1000 + latency ? 1.0f : 0.0f, 1.0e-5f);
+                expectWithinAbsoluteError(buffer.getSample(1, i), i == 1500 + latency ? -0.5f : 0.0f, 1.0e-5f);
+            }
+        }
+
+        beginTest("Steady noise is pulled down and a voice over it comes through");
+        {
+            fizzle::NoiseSuppressor suppressor;
+            suppressor.prepare(rate, 1);
+            const auto latency = suppressor.getLatencySamples();
+
+            // Four seconds of hiss, then a harmonic tone on top of it for one more.
+            const auto noiseOnly = 4 * static_cast<int>(rate);
+            const auto total = noiseOnly + static_cast<int>(rate);
+            const auto voice = [rate](int i)
+            {
+                const auto t = juce::MathConstants<double>::twoPi * i / rate;
+                return static_cast<float>(0.1 * std::sin(220.0 * t) + 0.05 * std::sin(660.0 * t));
+            };
+
+            juce::Random random(5);
+            juce::AudioBuffer<float> buffer(1, total);
+            for (int i = 0; i < total; ++i)
+                buffer.setSample(0, i, (random.nextFloat() * 2.0f - 1.0f) * 0.01f + (i >= noiseOnly ? voice(i) : 0.0f));
+            const auto noiseRms = buffer.getRMSLevel(0, noiseOnly - static_cast<int>(rate), static_cast<int>(rate));
+
+            for (int start = 0; start < total; start += 256)
+            {
+                auto* data = buffer.getWritePointer(0, start);
+                suppressor.process(&data, 1, juce::jmin(256, total - start));
+            }
+
+            const auto reducedRms = buffer.getRMSLevel(0, noiseOnly - static_cast<int>(rate) + latency, static_cast<int>(rate) - latency);
+            const auto reductionDb = juce::Decibels::gainToDecibels(noiseRms / reducedRms);
+            expect(reductionDb > 10.0f && reductionDb < fizzle::NoiseSuppressor::kMaxReductionDb + 1.0f, "reduction " + juce::String(reductionDb) + " dB");
+
+            // Skip the tone's first 100 ms, while the gains open up.
+            auto error = 0.0;
+            auto energy = 0.0;
+            for (int i = noiseOnly + 4800; i < total - latency; ++i)
+            {
+                const auto clean = static_cast<double>(voice(i));
+                const auto difference = static_cast<double>(buffer.getSample(0, i + latency)) - clean;
+                error += difference * difference;
+                energy += clean * clean;
+            }
+            const auto errorDb = 10.0 * std::log10(error / energy);
+            expect(errorDb < -25.0, "error " + juce::String(errorDb) + " dB");
+        }
+
+        beginTest("The chain reports the delay of the stages that are on");
+        {
+            fizzle::ProcessorChain chain;
+            chain.prepare(rate, 2);
+            fizzle::EffectParameters params;
+            expectEquals(chain.getLatencySamples(params), 0);
+            params.noiseSuppression.store(true);
+            expectEquals(chain.getLatencySamples(params), 256);
+            params.voiceStrip.store(true);
+            fizzle::TruePeakLimiter limiter;
+            limiter.prepare(rate, 2);
+            expectEquals(chain.getLatencySamples(params), 256 + limiter.getLatencySamples());
+        }
+    }
+};
+
+class ConvolverTest final : public juce::UnitTest
+{
+public:
+    ConvolverTest() : juce::UnitTest("Partitioned convolver", "DSP") {}
+
+    void runTest() override
+    {
+        constexpr double rate = 48000.0;
+
+        beginTest("Matches direct convolution with no added delay");
+        {
+            // Long enough to reach the first three partition sizes; the two channels differ.
+            juce::Random random(11);
+            juce::AudioBuffer<float> response(2, 9000);
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < response.getNumSamples(); ++i)
+                    response.setSample(c, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-static_cast<float>(i) / 2000.0f) * 0.1f);
+
+            fizzle::PartitionedConvolver convolver;
+            convolver.setNonRealtime(true);
+            convolver.prepare(rate, 2);
+            convolver.setImpulseResponse(response, rate);
+            expect(convolver.hasImpulseResponse());
+
+            juce::AudioBuffer<float> input(2, 12000);
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < input.getNumSamples(); ++i)
+                    input.setSample(c, i, random.nextFloat() * 2.0f - 1.0f);
+
+            juce::AudioBuffer<float> output(input);
+            for (int start = 0, block = 0; start < output.getNumSamples(); ++block)
+            {
+                const auto n = juce::jmin(std::array<int, 4> { 37, 256, 1, 480 }[static_cast<size_t>(block % 4)], output.getNumSamples() - start);
+                float* io[2] { output.getWritePointer(0, start), output.getWritePointer(1, start) };
+                convolver.process(io, 2, n);
+                start += n;
+            }
+
+            auto worst = 0.0;
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int i = 0; i < output.getNumSamples(); i += 7)
+                {
+                    auto expected = 0.0;
+                    for (int j = 0; j <= juce::jmin(i, response.getNumSamples() - 1); ++j)
+                        expected += static_cast<double>(response.getSample(c, j)) * input.getSample(c, i - j);
+                    worst = juce::jmax(worst, std::abs(expected - output.getSample(c, i)));
+                }
+            }
+            expect(worst < 1.0e-4, "error " + juce::String(worst));
+        }
+
+        beginTest("Taps land at the right place in every level");
+        {
+            // A sparse response keeps the direct sum cheap while reaching deep into the
+            // last level; a mono response feeds both channels.
+            const std::array<std::pair<int, float>, 7> taps { { { 0, 0.5f }, { 63, -0.25f }, { 700, 0.125f }, { 5000, 0.5f }, { 9001, -0.3f }, { 40000, 0.2f }, { 70000, -0.4f } } };
+            juce::AudioBuffer<float> response(1, 70001);
+            response.clear();
+            for (const auto& [index, gain] : taps)
+                response.setSample(0, index, gain);
+
+            fizzle::PartitionedConvolver convolver;
+            convolver.setNonRealtime(true);
+            convolver.setImpulseResponse(response, rate);
+            convolver.prepare(rate, 2);
+
+            juce::Random random(12);
+            juce::AudioBuffer<float> input(1, 110000);
+            for (int i = 0; i < input.getNumSamples(); ++i)
+                input.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+
+            juce::AudioBuffer<float> output(2, input.getNumSamples());
+            output.copyFrom(0, 0, input, 0, 0, input.getNumSamples());
+            output.copyFrom(1, 0, input, 0, 0, input.getNumSamples());
+            for (int start = 0; start < output.getNumSamples(); start += 441)
+            {
+                float* io[2] { output.getWritePointer(0, start), output.getWritePointer(1, start) };
+                convolver.process(io, 2, juce::jmin(441, output.getNumSamples() - start));
+            }
+
+            auto worst = 0.0;
+            for (int i = 0; i < output.getNumSamples(); ++i)
+            {
+                auto expected = 0.0;
+                for (const auto& [index, gain] : taps)
+                    if (index <= i)
+                        expected += static_cast<double>(gain) * input.getSample(0, i - index);
+                for (int c = 0; c < 2; ++c)
+                    worst = juce::jmax(worst, std::abs(expected - output.getSample(c, i)));
+            }
+            expect(worst < 1.0e-4, "error " + juce::String(worst));
+        }
+
+        beginTest("A response recorded at another rate keeps its gain");
+        {
+            juce::AudioBuffer<float> response(1, 100);
+            response.clear();
+            response.setSample(0, 10, 1.0f);
+
+            fizzle::PartitionedConvolver convolver;
+            convolver.setNonRealtime(true);
+            convolver.prepare(rate, 1);
+            convolver.setImpulseResponse(response, 44100.0);
+
+            juce::AudioBuffer<float> buffer(1, 4800);
+            std::fill(buffer.getWritePointer(0), buffer.getWritePointer(0) + buffer.getNumSamples(), 0.5f);
+            auto* data = buffer.getWritePointer(0);
+            convolver.process(&data, 1, buffer.getNumSamples());
+            expectWithinAbsoluteError(buffer.getSample(0, buffer.getNumSamples() - 1), 0.5f, 0.005f);
+        }
+
+        beginTest("Removing the response lets audio through untouched");
+        {
+            juce::AudioBuffer<float> response(1, 2000);
+            response.clear();
+            response.setSample(0, 1500, 1.0f);
+
+            fizzle::PartitionedConvolver convolver;
+            convolver.setNonRealtime(true);
+            convolver.prepare(rate, 1);
+            convolver.setImpulseResponse(response, rate);
+            juce::AudioBuffer<float> buffer(1, 4096);
+            buffer.clear();
+            auto* data = buffer.getWritePointer(0);
+            convolver.process(&data, 1, buffer.getNumSamples());
+
+            // The removal is picked up at the first boundary with no background job in flight.
+            convolver.setImpulseResponse({}, rate);
+            expect(! convolver.hasImpulseResponse());
+            convolver.process(&data, 1, buffer.getNumSamples());
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(0, i, std::sin(0.01f * static_cast<float>(i)));
+            juce::AudioBuffer<float> expected(buffer);
+            convolver.process(&data, 1, buffer.getNumSamples());
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                expectEquals(buffer.getSample(0, i), expected.getSample(0, i));
+
+            fizzle::ProcessorChain chain;
+            chain.prepare(rate, 2);
+            fizzle::EffectParameters params;
+            params.convolution.store(true);
+            expectEquals(chain.getLatencySamples(params), 0);
+        }
+
+        beginTest("A late level is left out of its block and counted");
+        {
+            // One tap in the 32768-sample level. Fed far faster than real time, its jobs
+            // are likely to be late; each of its blocks must then hold either the whole
+            // delayed tap or none of it.
+            constexpr int delay = 70000;
+            constexpr int levelBlock = 32768;
+            juce::AudioBuffer<float> response(1, delay + 1);
+            response.clear();
+            response.setSample(0, 0, 1.0f);
+            response.setSample(0, delay, 0.5f);
+
+            fizzle::PartitionedConvolver convolver;
+            convolver.prepare(rate, 1);
+            convolver.setImpulseResponse(response, rate);
+
+            juce::Random random(13);
+            juce::AudioBuffer<float> input(1, 8 * levelBlock);
+            for (int i = 0; i < input.getNumSamples(); ++i)
+                input.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+            juce::AudioBuffer<float> output(input);
+            auto* data = output.getWritePointer(0);
+            convolver.process(&data, 1, output.getNumSamples());
+
+            auto worst = 0.0;
+            auto silentBlocks = 0;
+            for (int start = 2 * levelBlock + levelBlock; start < output.getNumSamples(); start += levelBlock)
+            {
+                auto present = 0.0;
+                auto absent = 0.0;
+                for (int i = start; i < start + levelBlock; ++i)
+                {
+                    const auto dry = static_cast<double>(input.getSample(0, i));
+                    const auto tap = 0.5 * input.getSample(0, i - delay);
+                    present = juce::jmax(present, std::abs(dry + tap - output.getSample(0, i)));
+                    absent = juce::jmax(absent, std::abs(dry - output.getSample(0, i)));
+                }
+                if (absent < present)
+                    ++silentBlocks;
+                worst = juce::jmax(worst, juce::jmin(present, absent));
+            }
+            expect(worst < 1.0e-4, "error " + juce::String(worst));
+            expect(silentBlocks <= static_cast<int>(convolver.getNumMissedBlocks()), "every block left out is counted");
+            logMessage(juce::String(silentBlocks) + " of " + juce::String(output.getNumSamples() / levelBlock - 3) + " blocks late; "
+                       + juce::String(static_cast<int>(convolver.getNumMissedBlocks())) + " misses counted");
+        }
+
+        beginTest("The cost per sample grows far more slowly than the response");
+        {
+            // Stereo noise through responses ten times apart in length. Offline, so the
+            // time covers the background levels' work as well.
+            std::array<double, 3> nsPerSample {};
+            const std::array<double, 3> seconds { 0.5, 2.0, 5.0 };
+            juce::Random random(14);
+            juce::AudioBuffer<float> input(2, 3 * static_cast<int>(rate));
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < input.getNumSamples(); ++i)
+                    input.setSample(c, i, random.nextFloat() * 2.0f - 1.0f);
+
+            for (size_t n = 0; n < seconds.size(); ++n)
+            {
+                juce::AudioBuffer<float> response(2, static_cast<int>(seconds[n] * rate));
+                for (int c = 0; c < 2; ++c)
+                    for (int i = 0; i < response.getNumSamples(); ++i)
+                        response.setSample(c, i, (random.nextFloat() * 2.0f - 1.0f) * 0.01f);
+
+                fizzle::PartitionedConvolver convolver;
+                convolver.setNonRealtime(true);
+                convolver.prepare(rate, 2);
+                convolver.setImpulseResponse(response, rate);
+
+                juce::AudioBuffer<float> buffer(input);
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int offset = 0; offset < buffer.getNumSamples(); offset += 256)
+                {
+                    float* io[2] { buffer.getWritePointer(0, offset), buffer.getWritePointer(1, offset) };
+                    convolver.process(io, 2, juce::jmin(256, buffer.getNumSamples() - offset));
+                }
+                const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                nsPerSample[n] = elapsed * 1.0e9 / static_cast<double>(buffer.getNumSamples());
+                logMessage(juce::String(seconds[n], 1) + " s response: " + juce::String(nsPerSample[n], 1) + " ns per sample");
+            }
+
+            expect(nsPerSample[2] < 3.0 * nsPerSample[0], "a 5 s response costs less than three times a 0.5 s one per sample");
+        }
+    }
+};
+
+class ResamplerTest final : public juce::UnitTest
+{
+public:
+    ResamplerTest() : juce::UnitTest("Streaming resampler continuity", "DSP") {}
+
+    void runTest() override
+    {
+        for (const auto& rates : { std::pair { 44100.0, 48000.0 }, std::pair { 48000.0, 44100.0 }, std::pair { 96000.0, 48000.0 } })
+        {
+            beginTest("Sine survives " + juce::String(rates.first) + " -> " + juce::String(rates.second) + " across uneven blocks");
+
+            fizzle::Resampler resampler;
+            resampler.prepare(rates.first, rates.second, 1, 512);
+
+            const auto totalIn = static_cast<int>(rates.first / 10.0);
+            juce::AudioBuffer<float> in(1, totalIn);
+            for (int i = 0; i < totalIn; ++i)
+                in.setSample(0, i, std::sin(juce::MathConstants<float>::twoPi * 1000.0f * static_cast<float>(i) / static_cast<float>(rates.first)));
+
+            std::vector<float> out;
+            juce::AudioBuffer<float> block(1, 2048);
+            int pos = 0;
+            int step = 0;
+            while (pos < totalIn)
+            {
+                const auto n = juce::jmin(totalIn - pos, 37 + (step++ * 53) % 480);
+                const float* src[] { in.getReadPointer(0, pos) };
+                resampler.push(src, 1, n);
+                pos += n;
+                auto* dst = block.getWritePointer(0);
+                const auto produced = resampler.pull(&dst, 1, block.getNumSamples());
+                out.insert(out.end(), dst, dst + produced);
+            }
+
+            const auto expectedCount = static_cast<double>(totalIn) * rates.second / rates.first;
+            expect(static_cast<double>(out.size()) > expectedCount - resampler.getNumTaps());
+
+            float maxError = 0.0f;
+            for (size_t n = static_cast<size_t>(resampler.getNumTaps()); n < out.size(); ++n)
+            {
+                const auto ideal = std::sin(juce::MathConstants<double>::twoPi * 1000.0 * static_cast<double>(n) / rates.second);
+                maxError = juce::jmax(maxError, std::abs(out[n] - static_cast<float>(ideal)));
+            }
+            expect(maxError < 2.0e-3f, "max error " + juce::String(maxError));
+        }
+    }
+};
+
+class BufferArenaTest final : public juce::UnitTest
+{
+public:
+    BufferArenaTest() : juce::UnitTest("Buffer arena layout", "DSP") {}
+
+    void runTest() override
+    {
+        beginTest("Regions are aligned, zeroed and disjoint");
+        fizzle::BufferArena arena;
+        const auto first = arena.reserve(2, 100);
+        const auto second = arena.reserve(3, 17);
+        arena.allocate();
+
+        std::vector<std::pair<const float*, const float*>> spans;
+        for (const auto region : { first, second })
+        {
+            for (int c = 0; c < arena.getNumChannels(region); ++c)
+            {
+                const auto* data = arena.getChannel(region, c);
+                expect(reinterpret_cast<std::uintptr_t>(data) % fizzle::BufferArena::kAlignment == 0);
+                for (int i = 0; i < arena.getCapacity(region); ++i)
+                    expectEquals(data[i], 0.0f);
+                spans.emplace_back(data, data + arena.getCapacity(region));
+            }
+        }
+
+        for (size_t a = 0; a < spans.size(); ++a)
+            for (size_t b = a + 1; b < spans.size(); ++b)
+                expect(spans[a].second <= spans[b].first || spans[b].second <= spans[a].first);
+
+        beginTest("Views re-point without reallocating and clamp to capacity");
+        juce::AudioBuffer<float> view;
+        arena.attach(first, view, 64);
+        expectEquals(view.getNumChannels(), 2);
+        expectEquals(view.getNumSamples(), 64);
+        expect(view.getReadPointer(1) == arena.getChannel(first, 1));
+        view.setSample(1, 63, 0.5f);
+        expectEquals(arena.getChannel(first, 1)[63], 0.5f);
+
+        arena.attach(first, view, 4096);
+        expectEquals(view.getNumSamples(), 100);
+        arena.attach(second, view, 0);
+        expectEquals(view.getNumChannels(), 3);
+        expectEquals(view.getNumSamples(), 0);
+    }
+};
+
+class FusedKernelTest final : public juce::UnitTest
+{
+public:
+    FusedKernelTest() : juce::UnitTest("Fused callback kernels", "DSP") {}
+
+    void runTest() override
+    {
+        beginTest("Scaled copy matches separate gain and magnitude passes");
+        juce::Random random(3);
+        for (const auto n : { 1, 7, 64, 301 })
+        {
+            std::vector<float> src(static_cast<size_t>(n)), dst(static_cast<size_t>(n)), a(static_cast<size_t>(n)), b(static_cast<size_t>(n));
+            for (auto& x : src)
+                x = random.nextFloat() * 2.0f - 1.0f;
+
+            float expectedPeak = 0.0f;
+            for (const auto x : src)
+                expectedPeak = juce::jmax(expectedPeak, std::abs(x * 0.5f));
+
+            const auto peak = fizzle::simd::copyScaledWithPeak(dst.data(), src.data(), 0.5f, n);
+            expectWithinAbsoluteError(peak, expectedPeak, 1.0e-7f);
+            expectEquals(fizzle::simd::peak(src.data(), n) * 0.5f, expectedPeak);
+            for (int i = 0; i < n; ++i)
+                expectWithinAbsoluteError(dst[static_cast<size_t>(i)], src[static_cast<size_t>(i)] * 0.5f, 1.0e-7f);
+
+            fizzle::simd::copyToBoth(a.data(), b.data(), src.data(), n);
+            expect(a == src && b == src);
+        }
+
+        beginTest("Crossfade matches a per-sample ramp, including the block ends");
+        struct Ramp
+        {
+            float startMix;
+            float endMix;
+        };
+        for (const auto n : { 1, 3, 4, 7, 64, 301 })
+        {
+            for (const auto ramp : { Ramp { 0.0f, 1.0f }, Ramp { 1.0f, 0.0f }, Ramp { 0.25f, 0.75f }, Ramp { 0.0f, 0.0f }, Ramp { 1.0f, 1.0f } })
+            {
+                std::vector<float> dry(static_cast<size_t>(n)), wet(static_cast<size_t>(n));
+                for (size_t i = 0; i < dry.size(); ++i)
+                {
+                    dry[i] = random.nextFloat() * 2.0f - 1.0f;
+                    wet[i] = random.nextFloat() * 2.0f - 1.0f;
+                }
+
+                // Sample i gets startMix + i/n of the way to endMix, which it reaches on
+                // the sample after the last.
+                auto expected = dry;
+                for (int i = 0; i < n; ++i)
+                {
+                    const auto g = ramp.startMix + (ramp.endMix - ramp.startMix) * static_cast<float>(i) / static_cast<float>(n);
+                    expected[static_cast<size_t>(i)] += (wet[static_cast<size_t>(i)] - dry[static_cast<size_t>(i)]) * g;
+                }
+
+                auto out = dry;
+                fizzle::simd::crossfade(out.data(), wet.data(), ramp.startMix, ramp.endMix, n);
+                for (size_t i = 0; i < out.size(); ++i)
+                    expectWithinAbsoluteError(out[i], expected[i], 1.0e-5f);
+
+                // The first sample is blended at exactly startMix. A constant 0 leaves the
+                // dry signal untouched and a constant 1 replaces it with the wet one.
+                expectWithinAbsoluteError(out.front(), dry.front() + (wet.front() - dry.front()) * ramp.startMix, 1.0e-6f);
+                if (ramp.startMix == 0.0f && ramp.endMix == 0.0f)
+                    expect(out == dry);
+                if (ramp.startMix == 1.0f && ramp.endMix == 1.0f)
+                    for (size_t i = 0; i < out.size(); ++i)
+                        expectWithinAbsoluteError(out[i], wet[i], 1.0e-6f);
+            }
+        }
+
+        beginTest("Resampler pull applies gain and reports the output peak");
+        fizzle::Resampler plain, fused;
+        plain.prepare(44100.0, 48000.0, 2, 256);
+        fused.prepare(44100.0, 48000.0, 2, 256);
+        juce::AudioBuffer<float> input(2, 256), plainOut(2, 512), fusedOut(2, 512);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < 256; ++i)
+                input.setSample(c, i, std::sin(0.05f * static_cast<float>(i + c)));
+
+        for (int block = 0; block < 4; ++block)
+        {
+            plain.push(input.getArrayOfReadPointers(), 2, 256);
+            fused.push(input.getArrayOfReadPointers(), 2, 256);
+            const auto numPlain = plain.pull(plainOut.getArrayOfWritePointers(), 2, 512);
+            float peak = -1.0f;
+            const auto numFused = fused.pull(fusedOut.getArrayOfWritePointers(), 2, 512, 0.25f, peak);
+            expectEquals(numFused, numPlain);
+
+            float expectedPeak = 0.0f;
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int i = 0; i < numPlain; ++i)
+                    expectWithinAbsoluteError(fusedOut.getSample(c, i), plainOut.getSample(c, i) * 0.25f, 1.0e-6f);
+                expectedPeak = juce::jmax(expectedPeak, plainOut.getMagnitude(c, 0, numPlain) * 0.25f);
+            }
+            expectWithinAbsoluteError(peak, expectedPeak, 1.0e-6f);
+        }
+    }
+};
+
+class DriftCompensatorTest final : public juce::UnitTest
+{
+public:
+    DriftCompensatorTest() : juce::UnitTest("Monitor drift compensation", "DSP") {}
+
+    void runTest() override
+    {
+        beginTest("Queue settles on target and drift is estimated between mismatched clocks");
+        {
+            constexpr int producerBlock = 256;
+            constexpr int consumerBlock = 480;
+            const auto run = simulate(producerBlock, consumerBlock, consumerBlock, 90.0);
+
+            expectEquals(static_cast<int>(run.underrunsAfterSettling), 0);
+            expectEquals(static_cast<int>(run.resyncs), 0);
+            expect(run.maxQueueMs < 1000.0 * (producerBlock + 2 * consumerBlock) / kNominalRate, "queue " + juce::String(run.maxQueueMs) + " ms");
+            expect(std::abs(run.driftPpm + kConsumerDriftPpm) < 25.0, "drift " + juce::String(run.driftPpm) + " ppm");
+        }
+
+        // The second is longer than one pass through the compensator's work buffer.
+        for (const auto delivered : { 1024, 5000 })
+        {
+            beginTest("A consumer delivering " + juce::String(delivered) + " samples after announcing 256 recovers and keeps playing");
+            const auto run = simulate(256, 256, delivered, 30.0);
+
+            expectEquals(static_cast<int>(run.underrunsAfterSettling), 0);
+            expectEquals(static_cast<int>(run.silentBlocksAfterSettling), 0);
+            expect(run.maxQueueMs < 1000.0 * (256 + 2 * delivered) / kNominalRate, "queue " + juce::String(run.maxQueueMs) + " ms");
+        }
+    }
+
+private:
+    static constexpr double kNominalRate = 48000.0;
+    static constexpr double kConsumerDriftPpm = 150.0;
+
+    struct Run
+    {
+        uint64_t underrunsAfterSettling { 0 };
+        int silentBlocksAfterSettling { 0 };
+        uint64_t resyncs { 0 };
+        double maxQueueMs { 0.0 };
+        double driftPpm { 0.0 };
+    };
+
+    // Feeds a sine from a producer clock into the FIFO and drains it through the
+    // compensator from a consumer clock running kConsumerDriftPpm fast. The compensator
+    // is told the consumer uses announcedBlock but is handed deliveredBlock.
+    static Run simulate(int producerBlock, int announcedBlock, int deliveredBlock, double seconds)
+    {
+        juce::AbstractFifo fifo { 32768 };
+        juce::AudioBuffer<float> fifoBuffer { 2, 32768 };
+        fizzle::DriftCompensator compensator;
+        compensator.prepare(kNominalRate, kNominalRate, producerBlock, announcedBlock);
+
+        juce::AudioBuffer<float> produced(2, producerBlock);
+        juce::AudioBuffer<float> consumed(2, deliveredBlock);
+        const auto producerPeriod = producerBlock / kNominalRate;
+        const auto consumerPeriod = deliveredBlock / (kNominalRate * (1.0 + kConsumerDriftPpm * 1.0e-6));
+
+        double producerTime = 0.0;
+        double consumerTime = 0.5 * consumerPeriod;
+        int64_t written = 0;
+        const auto settleSeconds = seconds / 4.5;
+        Run run;
+
+        while (consumerTime < seconds)
+        {
+            if (producerTime <= consumerTime)
+            {
+                for (int i = 0; i < producerBlock; ++i)
+                {
+                    const auto v = static_cast<float>(0.5 * std::sin(juce::MathConstants<double>::twoPi * 440.0 * static_cast<double>(written + i) / kNominalRate));
+                    produced.setSample(0, i, v);
+                    produced.setSample(1, i, v);
+                }
+                written += producerBlock;
+
+                int start1, size1, start2, size2;
+                fifo.prepareToWrite(producerBlock, start1, size1, start2, size2);
+                for (int c = 0; c < 2; ++c)
+                {
+                    if (size1 > 0)
+                        juce::FloatVectorOperations::copy(fifoBuffer.getWritePointer(c, start1), produced.getReadPointer(c), size1);
+                    if (size2 > 0)
+                        juce::FloatVectorOperations::copy(fifoBuffer.getWritePointer(c, start2), produced.getReadPointer(c, size1), size2);
+                }
+                fifo.finishedWrite(size1 + size2);
+                producerTime += producerPeriod;
+                continue;
+            }
+
+            const auto before = compensator.getUnderrunCount();
+            compensator.process(fifo, fifoBuffer, consumed.getArrayOfWritePointers(), 2, deliveredBlock);
+            if (consumerTime > settleSeconds)
+            {
+                run.underrunsAfterSettling += compensator.getUnderrunCount() - before;
+                run.maxQueueMs = juce::jmax(run.maxQueueMs, compensator.getQueueMs());
+                if (consumed.getMagnitude(0, 0, deliveredBlock) < 0.1f)
+                    ++run.silentBlocksAfterSettling;
+            }
+            consumerTime += consumerPeriod;
+        }
+
+        run.resyncs = compensator.getResyncCount();
+        run.driftPpm = compensator.getDriftPpm();
+        return run;
+    }
+};
+
 HpfTest hpfTest;
 ExpanderTest expanderTest;
 CompressorTest compressorTest;
+VoiceStripBlockTest voiceStripBlockTest;
+BiquadCascadeTest biquadCascadeTest;
+TruePeakLimiterTest truePeakLimiterTest;
+NoiseSuppressorTest noiseSuppressorTest;
+ConvolverTest convolverTest;
+ResamplerTest resamplerTest;
+BufferArenaTest bufferArenaTest;
+FusedKernelTest fusedKernelTest;
+DriftCompensatorTest driftCompensatorTest;
 }
\ No newline at end of file
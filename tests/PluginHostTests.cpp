@@ -0,0 +1,804 @@
+#include <JuceHeader.h>
+#include "../src/audio/AudioEngine.h"
+#include "../src/audio/SignalPath.h"
+#include "../src/core/RealtimeAudit.h"
+#include "../src/plugins/VstHost.h"
+#include "SyntheticDevice.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Stand-in for a hosted plugin. Scales the audio by a fixed gain and can spend a set time
+// in every block, so the host's chain handling and timing can be checked without loading
+// a real plugin.
+class GainPlugin final : public juce::AudioPluginInstance
+{
+public:
+    explicit GainPlugin(juce::String nameIn, float gainIn = 1.0f, double busyMicroseconds = 0.0)
+        : name(std::move(nameIn)), gain(gainIn), busyTicks(juce::Time::secondsToHighResolutionTicks(busyMicroseconds * 1.0e-6))
+    {
+        liveInstances.fetch_add(1);
+    }
+
+    ~GainPlugin() override { liveInstances.fetch_sub(1); }
+
+    const juce::String getName() const override { return name; }
+    void prepareToPlay(double, int) override {}
+    void releaseResources() override {}
+
+    using juce::AudioPluginInstance::processBlock;
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
+    {
+        const CallScope call(*this);
+        spinFor(busyTicks);
+        buffer.applyGain(gain);
+        delay(buffer);
+        processedBlocks.fetch_add(1);
+    }
+
+    double getTailLengthSeconds() const override { return 0.0; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+    void getStateInformation(juce::MemoryBlock& state) override
+    {
+        const CallScope call(*this);
+        spinFor(stateTicks.load());
+        state.append(&gain, sizeof(gain));
+    }
+
+    void setStateInformation(const void*, int) override {}
+
+    void fillInPluginDescription(juce::PluginDescription& description) const override
+    {
+        description.name = name;
+        description.pluginFormatName = "Internal";
+    }
+
+    void setStateCaptureMicroseconds(double microseconds) { stateTicks.store(juce::Time::secondsToHighResolutionTicks(microseconds * 1.0e-6)); }
+
+    // Delays the output by this many samples and reports it as the plugin's latency.
+    void setLatency(int samples)
+    {
+        for (auto& line : delayLines)
+            line.assign(static_cast<size_t>(samples), 0.0f);
+        delayPosition = 0;
+        setLatencySamples(samples);
+    }
+
+    std::atomic<int> processedBlocks { 0 };
+    // Times processBlock() and getStateInformation() ran at the same time.
+    std::atomic<int> overlappingCalls { 0 };
+    static inline std::atomic<int> liveInstances { 0 };
+
+private:
+    struct CallScope
+    {
+        explicit CallScope(GainPlugin& p) : plugin(p)
+        {
+            if (plugin.callsInFlight.fetch_add(1) != 0)
+                plugin.overlappingCalls.fetch_add(1);
+        }
+
+        ~CallScope() { plugin.callsInFlight.fetch_sub(1); }
+
+        GainPlugin& plugin;
+    };
+
+    static void spinFor(juce::int64 ticks)
+    {
+        const auto until = juce::Time::getHighResolutionTicks() + ticks;
+        while (ticks > 0 && juce::Time::getHighResolutionTicks() < until)
+        {
+        }
+    }
+
+    void delay(juce::AudioBuffer<float>& buffer)
+    {
+        const auto length = delayLines.front().size();
+        if (length == 0)
+            return;
+
+        for (int c = 0; c < juce::jmin(buffer.getNumChannels(), static_cast<int>(delayLines.size())); ++c)
+        {
+            auto& line = delayLines[static_cast<size_t>(c)];
+            auto* data = buffer.getWritePointer(c);
+            auto position = delayPosition;
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                std::swap(data[i], line[position]);
+                position = (position + 1) % length;
+            }
+        }
+        delayPosition = (delayPosition + static_cast<size_t>(buffer.getNumSamples())) % length;
+    }
+
+    juce::String name;
+    float gain;
+    juce::int64 busyTicks;
+    std::atomic<juce::int64> stateTicks { 0 };
+    std::atomic<int> callsInFlight { 0 };
+    std::array<std::vector<float>, 2> delayLines;
+    size_t delayPosition { 0 };
+};
+
+constexpr double kSampleRate = 48000.0;
+constexpr int kBlockSize = 256;
+
+GainPlugin* addGainPlugin(fizzle::VstHost& host, const juce::String& name, float gain = 1.0f, double busyMicroseconds = 0.0)
+{
+    auto plugin = std::make_unique<GainPlugin>(name, gain, busyMicroseconds);
+    auto* raw = plugin.get();
+    juce::String error;
+    return host.addPluginInstance(std::move(plugin), kSampleRate, kBlockSize, error) ? raw : nullptr;
+}
+
+void fillNoise(juce::AudioBuffer<float>& buffer, int seed)
+{
+    juce::Random random(seed);
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+            buffer.setSample(c, i, random.nextFloat() - 0.5f);
+}
+
+class PluginProfileTest final : public juce::UnitTest
+{
+public:
+    PluginProfileTest() : juce::UnitTest("Per-plugin profiling", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        beginTest("Each plugin's window counts and times the blocks it processed");
+
+        fizzle::VstHost host;
+        host.prepare(kSampleRate, kBlockSize);
+        expect(addGainPlugin(host, "Light") != nullptr);
+        expect(addGainPlugin(host, "Heavy", 1.0f, 300.0) != nullptr);
+
+        juce::AudioBuffer<float> buffer(2, kBlockSize);
+        for (int n = 0; n < 20; ++n)
+        {
+            fillNoise(buffer, n);
+            host.processBlock(buffer);
+        }
+
+        auto window = host.takeProfileWindow();
+        expectEquals(static_cast<int>(window.size()), 2);
+        expectEquals(window[0].name, juce::String("Light"));
+        expectEquals(window[1].name, juce::String("Heavy"));
+        for (const auto& entry : window)
+        {
+            expectEquals(static_cast<int>(entry.processedBlocks), 20);
+            expectEquals(static_cast<int>(entry.skippedBlocks), 0);
+            expect(entry.p99Us <= entry.maxUs * 1.05);
+        }
+
+        const auto budgetUs = kBlockSize / kSampleRate * 1.0e6;
+        expect(window[1].meanUs >= 250.0, "heavy mean " + juce::String(window[1].meanUs) + " us");
+        expect(window[1].maxUs >= 250.0, "heavy max " + juce::String(window[1].maxUs) + " us");
+        expect(window[1].meanUs > window[0].meanUs);
+        expectWithinAbsoluteError(window[1].budgetPercent, window[1].meanUs / budgetUs * 100.0, 0.01);
+
+        beginTest("A disabled plugin is not timed and a window only covers new blocks");
+
+        host.setEnabled(1, false);
+        for (int n = 0; n < 5; ++n)
+            host.processBlock(buffer);
+
+        window = host.takeProfileWindow();
+        expectEquals(static_cast<int>(window[0].processedBlocks), 25);
+        expectEquals(static_cast<int>(window[1].processedBlocks), 20);
+        expect(window[0].maxUs > 0.0);
+        expectEquals(window[1].maxUs, 0.0);
+        expectEquals(window[1].p99Us, 0.0);
+        // The rolling mean is kept while the plugin sits idle.
+        expect(window[1].meanUs >= 250.0);
+    }
+};
+
+class ChainHandOffTest final : public juce::UnitTest
+{
+public:
+    ChainHandOffTest() : juce::UnitTest("Chain snapshot hand-off", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+        fizzle::RealtimeAudit::takeViolations();
+
+        beginTest("Swapped-out chains are reclaimed by the next publish, never by the audio thread");
+        {
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize);
+            juce::AudioBuffer<float> buffer(2, kBlockSize);
+            fillNoise(buffer, 1);
+
+            // Well past the retired queue's capacity, so a leak or a stalled queue shows.
+            for (int n = 0; n < 100; ++n)
+            {
+                auto* plugin = addGainPlugin(host, "Plugin " + juce::String(n));
+                expect(plugin != nullptr);
+                expectEquals(GainPlugin::liveInstances.load(), 1);
+                processAudited(host, buffer);
+                expectEquals(plugin->processedBlocks.load(), 1);
+
+                // The audio thread is still running the chain that holds the plugin.
+                host.removePlugin(0);
+                expectEquals(GainPlugin::liveInstances.load(), 1);
+
+                // Swapped out, but only parked for the message thread.
+                processAudited(host, buffer);
+                expectEquals(GainPlugin::liveInstances.load(), 1);
+            }
+
+            host.clear();
+            expectEquals(GainPlugin::liveInstances.load(), 0);
+        }
+
+        beginTest("Edits the audio thread never saw are dropped by the publisher");
+        {
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize);
+            juce::AudioBuffer<float> buffer(2, kBlockSize);
+            for (int n = 0; n < 3; ++n)
+                addGainPlugin(host, "Plugin " + juce::String(n));
+            processAudited(host, buffer);
+
+            // Each of these replaces the last in the mailbox.
+            for (int n = 0; n < 3; ++n)
+            {
+                host.setBranch(0, 1);
+                host.setBranch(0, 0);
+                host.removePlugin(0);
+            }
+            expectEquals(GainPlugin::liveInstances.load(), 3);
+
+            processAudited(host, buffer);
+            expectEquals(GainPlugin::liveInstances.load(), 3);
+            host.clear();
+            expectEquals(GainPlugin::liveInstances.load(), 0);
+        }
+
+        const auto violations = fizzle::RealtimeAudit::takeViolations();
+        for (const auto& violation : violations)
+            logMessage(fizzle::RealtimeAudit::describe(violation));
+        expectEquals(static_cast<int>(violations.size()), 0);
+    }
+
+private:
+    static void processAudited(fizzle::VstHost& host, juce::AudioBuffer<float>& buffer)
+    {
+        const fizzle::RealtimeAudit::Scope scope;
+        host.processBlock(buffer);
+    }
+};
+
+class ParallelBranchTest final : public juce::UnitTest
+{
+public:
+    ParallelBranchTest() : juce::UnitTest("Parallel plugin branches", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        beginTest("Branch outputs are summed, then the serial run continues");
+
+        fizzle::VstHost host;
+        host.prepare(kSampleRate, kBlockSize);
+        addGainPlugin(host, "Branch A", 0.5f);
+        addGainPlugin(host, "Branch B", 0.25f);
+        addGainPlugin(host, "Serial", 2.0f);
+        host.setBranch(0, 1);
+        host.setBranch(1, 2);
+
+        juce::AudioBuffer<float> input(2, kBlockSize);
+        fillNoise(input, 5);
+        juce::AudioBuffer<float> buffer(input);
+        host.processBlock(buffer);
+        expectProcessedWithGain(buffer, input, (0.5f + 0.25f) * 2.0f);
+
+        beginTest("A branch with nothing running passes its copy of the input into the sum");
+
+        host.setEnabled(1, false);
+        buffer.makeCopyOf(input);
+        host.processBlock(buffer);
+        expectProcessedWithGain(buffer, input, (0.5f + 1.0f) * 2.0f);
+
+        beginTest("Branches are delayed to the slowest one, which is the latency reported");
+        {
+            constexpr int latency = 100;
+            fizzle::VstHost latentHost;
+            latentHost.prepare(kSampleRate, kBlockSize);
+            auto* latent = addGainPlugin(latentHost, "Latent", 0.5f);
+            addGainPlugin(latentHost, "Immediate", 0.25f);
+            latent->setLatency(latency);
+            latentHost.setBranch(0, 1);
+            latentHost.setBranch(1, 2);
+            expectEquals(latentHost.getLatencySamples(), latency);
+
+            constexpr int numBlocks = 4;
+            juce::AudioBuffer<float> stream(2, numBlocks * kBlockSize), output(2, numBlocks * kBlockSize);
+            fillNoise(stream, 6);
+            juce::AudioBuffer<float> block(2, kBlockSize);
+            for (int n = 0; n < numBlocks; ++n)
+            {
+                for (int c = 0; c < 2; ++c)
+                    block.copyFrom(c, 0, stream, c, n * kBlockSize, kBlockSize);
+                latentHost.processBlock(block);
+                for (int c = 0; c < 2; ++c)
+                    output.copyFrom(c, n * kBlockSize, block, c, 0, kBlockSize);
+            }
+
+            // Unaligned, the immediate branch would lead by the full latency and comb.
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < output.getNumSamples(); ++i)
+                {
+                    const auto expected = i >= latency ? stream.getSample(c, i - latency) * 0.75f : 0.0f;
+                    expectWithinAbsoluteError(output.getSample(c, i), expected, 1.0e-6f);
+                }
+
+            // With the latent plugin off, neither branch is delayed any more.
+            latentHost.setEnabled(0, false);
+            expectEquals(latentHost.getLatencySamples(), 0);
+            buffer.makeCopyOf(input);
+            latentHost.processBlock(buffer);
+            expectProcessedWithGain(buffer, input, 1.0f + 0.25f);
+        }
+    }
+
+private:
+    void expectProcessedWithGain(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& input, float gain)
+    {
+        for (int c = 0; c < input.getNumChannels(); ++c)
+            for (int i = 0; i < input.getNumSamples(); ++i)
+                expectWithinAbsoluteError(output.getSample(c, i), input.getSample(c, i) * gain, 1.0e-6f);
+    }
+};
+
+class PipelineTest final : public juce::UnitTest
+{
+public:
+    PipelineTest() : juce::UnitTest("Pipelined plugin chain", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        beginTest("Unmeasured plugins split into equal contiguous stages");
+        {
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize);
+            for (int n = 0; n < 4; ++n)
+                addGainPlugin(host, "Plugin " + juce::String(n));
+            expectEquals(host.getLatencySamples(), 0);
+
+            host.setPipelineStages(2);
+            expectEquals(host.getActivePipelineStages(), 2);
+            expect(host.getPipelineSplit() == std::vector<int> { 0, 2 });
+
+            beginTest("Each stage boundary adds one block of latency");
+
+            // Every boundary holds one block, plus a little headroom for blocks that run
+            // a sample or two long.
+            const auto perBoundary = host.getLatencySamples();
+            expect(perBoundary >= kBlockSize && perBoundary < kBlockSize + kBlockSize / 4, "latency " + juce::String(perBoundary));
+            host.setPipelineStages(3);
+            expect(host.getPipelineSplit() == std::vector<int> { 0, 1, 2 });
+            expectEquals(host.getLatencySamples(), 2 * perBoundary);
+
+            // A parallel section cannot be pipelined, so the latency goes with the split.
+            host.setBranch(1, 1);
+            expectEquals(host.getActivePipelineStages(), 0);
+            expectEquals(host.getLatencySamples(), 0);
+        }
+
+        beginTest("Audio comes out in order, delayed by exactly the reported latency");
+        {
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize);
+            addGainPlugin(host, "Plugin 0", 0.5f);
+            addGainPlugin(host, "Plugin 1", 3.0f);
+            addGainPlugin(host, "Plugin 2", 0.25f);
+            host.setPipelineStages(3);
+            const auto latency = host.getLatencySamples();
+
+            constexpr int numBlocks = 12;
+            juce::AudioBuffer<float> input(2, numBlocks * kBlockSize), output(2, numBlocks * kBlockSize);
+            fillNoise(input, 9);
+            juce::AudioBuffer<float> block(2, kBlockSize);
+            for (int n = 0; n < numBlocks; ++n)
+            {
+                for (int c = 0; c < 2; ++c)
+                    block.copyFrom(c, 0, input, c, n * kBlockSize, kBlockSize);
+                host.processBlock(block);
+                for (int c = 0; c < 2; ++c)
+                    output.copyFrom(c, n * kBlockSize, block, c, 0, kBlockSize);
+            }
+
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < output.getNumSamples(); ++i)
+                {
+                    const auto expected = i >= latency ? input.getSample(c, i - latency) * 0.375f : 0.0f;
+                    expectWithinAbsoluteError(output.getSample(c, i), expected, 1.0e-6f);
+                }
+        }
+
+        beginTest("Blocks of varying length up to the prepared maximum stay continuous at the reported latency");
+        {
+            constexpr int maxBlock = 4 * kBlockSize;
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize, maxBlock);
+            addGainPlugin(host, "Plugin 0", 0.5f);
+            addGainPlugin(host, "Plugin 1", 3.0f);
+            addGainPlugin(host, "Plugin 2", 0.25f);
+            host.setPipelineStages(3);
+            const auto latency = host.getLatencySamples();
+            expect(latency >= 2 * maxBlock, "latency " + juce::String(latency));
+
+            // Long blocks back to back drain the queue hardest; short ones in between refill it.
+            std::vector<int> lengths;
+            for (int n = 0; n < 40; ++n)
+                lengths.push_back(n % 10 < 4 ? maxBlock : 1 + (n * 97) % maxBlock);
+
+            int total = 0;
+            for (const auto length : lengths)
+                total += length;
+            juce::AudioBuffer<float> input(2, total), output(2, total);
+            fillNoise(input, 11);
+            juce::AudioBuffer<float> block(2, maxBlock);
+            int position = 0;
+            for (const auto length : lengths)
+            {
+                block.setSize(2, length, false, false, true);
+                for (int c = 0; c < 2; ++c)
+                    block.copyFrom(c, 0, input, c, position, length);
+                host.processBlock(block);
+                for (int c = 0; c < 2; ++c)
+                    output.copyFrom(c, position, block, c, 0, length);
+                position += length;
+            }
+
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < total; ++i)
+                {
+                    const auto expected = i >= latency ? input.getSample(c, i - latency) * 0.375f : 0.0f;
+                    expectWithinAbsoluteError(output.getSample(c, i), expected, 1.0e-6f);
+                }
+        }
+
+        beginTest("Measured costs move the split towards equal stage cost");
+        {
+            fizzle::VstHost host;
+            host.prepare(kSampleRate, kBlockSize);
+            for (const auto busyMicroseconds : { 400.0, 400.0, 50.0, 50.0, 50.0, 50.0 })
+                addGainPlugin(host, "Plugin", 1.0f, busyMicroseconds);
+            host.setPipelineStages(2);
+            expect(host.getPipelineSplit() == std::vector<int> { 0, 3 });
+
+            juce::AudioBuffer<float> buffer(2, kBlockSize);
+            for (int n = 0; n < 10; ++n)
+            {
+                fillNoise(buffer, n);
+                host.processBlock(buffer);
+            }
+
+            // 400 | 600 beats the unmeasured 850 | 150 split by far more than the margin
+            // rebalancePipeline() asks for.
+            host.rebalancePipeline();
+            expect(host.getPipelineSplit() == std::vector<int> { 0, 1 });
+            expectEquals(host.getActivePipelineStages(), 2);
+        }
+    }
+};
+
+class StateCaptureTest final : public juce::UnitTest
+{
+public:
+    StateCaptureTest() : juce::UnitTest("Plugin state capture", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        beginTest("A capture longer than the gap between blocks skips none of them");
+        {
+            const auto result = captureWhileProcessing(false, false, 1000.0, 40);
+            expectEquals(result.captured, 40);
+            expectEquals(result.skippedBlocks, 0);
+            expect(result.processedBlocks > 0);
+        }
+
+        beginTest("A plugin marked unsafe is never captured alongside its processBlock()");
+        {
+            const auto result = captureWhileProcessing(true, false, 1000.0, 40);
+            expectEquals(result.captured, 40);
+            expectEquals(result.overlappingCalls, 0);
+            expect(result.skippedBlocks > 0, "the blocks a serialised capture displaces are counted");
+            logMessage(juce::String(result.skippedBlocks) + " block(s) skipped during " + juce::String(result.captured)
+                       + " serialised captures");
+        }
+
+        beginTest("A sandboxed slot keeps processing through a slow state round trip");
+        {
+            // A sandboxed plugin's state comes back over the helper's control pipe, which
+            // can take as long as a control timeout. Marking it unsafe must not put that
+            // wait on the audio thread's lock.
+            const auto result = captureWhileProcessing(true, true, 20000.0, 5);
+            expectEquals(result.captured, 5);
+            expectEquals(result.skippedBlocks, 0);
+            expect(result.fewestBlocksPerCapture > 0, "blocks keep being processed while a capture is in flight");
+        }
+    }
+
+private:
+    struct Result
+    {
+        int captured { 0 };
+        int skippedBlocks { 0 };
+        int processedBlocks { 0 };
+        int overlappingCalls { 0 };
+        int fewestBlocksPerCapture { 0 };
+    };
+
+    // The audio loop leaves about 200 us between blocks, so a capture of captureMicroseconds
+    // beyond that spans several of them.
+    Result captureWhileProcessing(bool serialise, bool sandboxed, double captureMicroseconds, int captures)
+    {
+        fizzle::VstHost host;
+        host.prepare(kSampleRate, kBlockSize);
+        auto* plugin = addGainPlugin(host, "Stateful", 0.5f, 100.0);
+        expect(plugin != nullptr);
+        plugin->setStateCaptureMicroseconds(captureMicroseconds);
+        auto handle = host.getPluginHandle(0);
+        handle->serialiseStateCapture.store(serialise);
+        handle->sandboxed = sandboxed;
+
+        std::atomic<bool> running { true };
+        std::thread audio([&host, &running]
+        {
+            juce::AudioBuffer<float> buffer(2, kBlockSize);
+            while (running.load())
+            {
+                fillNoise(buffer, 3);
+                host.processBlock(buffer);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+
+        Result result;
+        result.fewestBlocksPerCapture = std::numeric_limits<int>::max();
+        for (int n = 0; n < captures; ++n)
+        {
+            juce::MemoryBlock state;
+            const auto blocksBefore = plugin->processedBlocks.load();
+            if (host.capturePluginState(*handle, state))
+                ++result.captured;
+            result.fewestBlocksPerCapture = juce::jmin(result.fewestBlocksPerCapture, plugin->processedBlocks.load() - blocksBefore);
+            expectEquals(static_cast<int>(state.getSize()), static_cast<int>(sizeof(float)));
+        }
+
+        running.store(false);
+        audio.join();
+
+        result.skippedBlocks = static_cast<int>(host.takeProfileWindow().front().skippedBlocks);
+        result.processedBlocks = plugin->processedBlocks.load();
+        result.overlappingCalls = plugin->overlappingCalls.load();
+        return result;
+    }
+};
+
+class DirectPathTest final : public juce::UnitTest
+{
+public:
+    DirectPathTest() : juce::UnitTest("Signal path idle fast path", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+        fizzle::RealtimeAudit::takeViolations();
+
+        fizzle::VstHost host;
+        host.prepare(kSampleRate, kBlockSize);
+        fizzle::SignalPath::BlockOptions options;
+        options.outputGain = 0.5f;
+
+        beginTest("An empty chain gives the same output and peaks as the full path");
+        for (const auto numInputChannels : { 1, 2 })
+            expectMatchesFullPath(host, options, numInputChannels);
+
+        beginTest("A chain of disabled plugins still takes the fast path");
+        addGainPlugin(host, "First", 0.5f);
+        addGainPlugin(host, "Second", 2.0f);
+        host.setEnabled(0, false);
+        host.setEnabled(1, false);
+        expectMatchesFullPath(host, options, 2);
+
+        beginTest("A muted block is silent on both paths");
+        options.mute = true;
+        expectMatchesFullPath(host, options, 2);
+        options.mute = false;
+
+        beginTest("A plugin that would run, even half wet, sends the block down the full path");
+        host.setEnabled(1, true);
+        host.setMix(1, 0.5f);
+        expect(! tryDirect(host, options));
+        host.setEnabled(1, false);
+        expect(tryDirect(host, options));
+
+        beginTest("A pipelined chain is declined even when no stage has work");
+        host.setPipelineStages(2);
+        expectEquals(host.getActivePipelineStages(), 2);
+        expect(! tryDirect(host, options));
+        host.setPipelineStages(1);
+        expect(tryDirect(host, options));
+
+        beginTest("Bypass skips the chain check; built-in processing and the test tone do not");
+        host.setEnabled(1, true);
+        options.bypass = true;
+        expect(tryDirect(host, options));
+        options.bypass = false;
+        host.setEnabled(1, false);
+
+        fizzle::EffectParameters params;
+        options.builtIn = &params;
+        expect(! tryDirect(host, options));
+        options.builtIn = nullptr;
+        options.testTone = true;
+        expect(! tryDirect(host, options));
+
+        // Every fast-path call above ran inside a realtime scope, chain swaps included.
+        const auto violations = fizzle::RealtimeAudit::takeViolations();
+        for (const auto& violation : violations)
+            logMessage(fizzle::RealtimeAudit::describe(violation));
+        expectEquals(static_cast<int>(violations.size()), 0);
+    }
+
+private:
+    static bool tryDirect(fizzle::VstHost& host, const fizzle::SignalPath::BlockOptions& options)
+    {
+        fizzle::SignalPath path;
+        path.prepare(kSampleRate, kSampleRate, 2, kBlockSize, fizzle::Resampler::Quality::balanced);
+        juce::AudioBuffer<float> input(2, kBlockSize), output(2, kBlockSize);
+        fillNoise(input, 4);
+        const fizzle::RealtimeAudit::Scope scope;
+        return path.processDirect(input.getArrayOfReadPointers(), 2, output.getArrayOfWritePointers(), 2, kBlockSize, host, options);
+    }
+
+    void expectMatchesFullPath(fizzle::VstHost& host, const fizzle::SignalPath::BlockOptions& options, int numInputChannels)
+    {
+        fizzle::SignalPath direct, full;
+        direct.prepare(kSampleRate, kSampleRate, numInputChannels, kBlockSize, fizzle::Resampler::Quality::balanced);
+        full.prepare(kSampleRate, kSampleRate, numInputChannels, kBlockSize, fizzle::Resampler::Quality::balanced);
+
+        juce::AudioBuffer<float> input(numInputChannels, kBlockSize), output(2, kBlockSize);
+        for (int n = 0; n < 3; ++n)
+        {
+            fillNoise(input, 20 + n);
+            output.clear();
+            {
+                const fizzle::RealtimeAudit::Scope scope;
+                expect(direct.processDirect(input.getArrayOfReadPointers(), numInputChannels, output.getArrayOfWritePointers(), 2, kBlockSize, host, options));
+            }
+            const auto& reference = full.process(input.getArrayOfReadPointers(), numInputChannels, kBlockSize, host, options);
+
+            expectEquals(reference.getNumSamples(), kBlockSize);
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < kBlockSize; ++i)
+                    expectEquals(output.getSample(c, i), reference.getSample(c, i));
+            expectEquals(direct.getInputPeak(), full.getInputPeak());
+            expectEquals(direct.getOutputPeak(), full.getOutputPeak());
+        }
+    }
+};
+
+class ProcessingRateTest final : public juce::UnitTest
+{
+public:
+    ProcessingRateTest() : juce::UnitTest("Processing rate", "Plugins") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        for (const auto deviceRate : { 44100.0, 96000.0 })
+        {
+            beginTest("Device-native processing at " + juce::String(static_cast<int>(deviceRate))
+                      + " Hz runs the chain at the device rate without resampling");
+
+            fizzle::AudioEngine engine;
+            fizzle::EffectParameters params;
+            engine.setEffectParameters(&params);
+            engine.setProcessingSampleRate(fizzle::kDeviceNativeSampleRate);
+            auto* plugin = addGainPlugin(engine.getVstHost(), "Unity");
+            expect(plugin != nullptr);
+
+            fizzle::testing::SyntheticDevice device(deviceRate, kBlockSize);
+            engine.audioDeviceAboutToStart(&device);
+            expectEquals(engine.getProcessingSampleRate(), deviceRate);
+            expectEquals(plugin->getSampleRate(), deviceRate);
+
+            // With the plugin running the block takes the full path; with it disabled, and
+            // nothing else switched on, the idle fast path. Both must hand the input through
+            // untouched and undelayed.
+            expectBitExactPassThrough(engine, plugin, 3);
+            engine.getVstHost().setEnabled(0, false);
+            expectBitExactPassThrough(engine, plugin, 0);
+
+            const auto diagnostics = engine.getDiagnostics();
+            expectEquals(diagnostics.processingSampleRate, deviceRate);
+            // Two device buffers and nothing for resampling.
+            expectWithinAbsoluteError(diagnostics.dryLatencyMs, 2000.0 * kBlockSize / deviceRate, 1.0e-9);
+            engine.audioDeviceStopped();
+        }
+
+        beginTest("A fixed processing rate other than the device's resamples both ways");
+        {
+            fizzle::AudioEngine engine;
+            fizzle::EffectParameters params;
+            engine.setEffectParameters(&params);
+            auto* plugin = addGainPlugin(engine.getVstHost(), "Unity");
+            fizzle::testing::SyntheticDevice device(96000.0, kBlockSize);
+            engine.audioDeviceAboutToStart(&device);
+            expectEquals(engine.getProcessingSampleRate(), fizzle::kInternalSampleRate);
+            expectEquals(plugin->getSampleRate(), fizzle::kInternalSampleRate);
+
+            runBlocks(engine, 3);
+            expect(engine.getDiagnostics().dryLatencyMs > 2000.0 * kBlockSize / 96000.0);
+            engine.audioDeviceStopped();
+        }
+    }
+
+private:
+    juce::AudioBuffer<float> input { 2, kBlockSize };
+    juce::AudioBuffer<float> output { 2, kBlockSize };
+
+    void runBlocks(fizzle::AudioEngine& engine, int numBlocks)
+    {
+        const juce::AudioIODeviceCallbackContext context {};
+        for (int n = 0; n < numBlocks; ++n)
+        {
+            fillNoise(input, 30 + n);
+            engine.audioDeviceIOCallbackWithContext(input.getArrayOfReadPointers(), 2, output.getArrayOfWritePointers(), 2, kBlockSize, context);
+        }
+    }
+
+    void expectBitExactPassThrough(fizzle::AudioEngine& engine, GainPlugin* plugin, int expectedBlocks)
+    {
+        const auto before = plugin->processedBlocks.load();
+        const juce::AudioIODeviceCallbackContext context {};
+        for (int n = 0; n < 3; ++n)
+        {
+            fillNoise(input, 40 + n);
+            output.clear();
+            engine.audioDeviceIOCallbackWithContext(input.getArrayOfReadPointers(), 2, output.getArrayOfWritePointers(), 2, kBlockSize, context);
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < kBlockSize; ++i)
+                    expectEquals(output.getSample(c, i), input.getSample(c, i));
+        }
+        expectEquals(plugin->processedBlocks.load() - before, expectedBlocks);
+    }
+};
+
+PluginProfileTest pluginProfileTest;
+ChainHandOffTest chainHandOffTest;
+ParallelBranchTest parallelBranchTest;
+PipelineTest pipelineTest;
+StateCaptureTest stateCaptureTest;
+DirectPathTest directPathTest;
+ProcessingRateTest processingRateTest;
+}
@@ -0,0 +1,157 @@
+#include <JuceHeader.h>
+#include "../src/AppConfig.h"
+#include "../src/audio/AudioEngine.h"
+#include "../src/core/RealtimeAudit.h"
+#include "SyntheticDevice.h"
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+using fizzle::testing::SyntheticDevice;
+
+class RealtimeAuditTest final : public juce::UnitTest
+{
+public:
+    RealtimeAuditTest() : juce::UnitTest("Realtime audit", "Realtime") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+        fizzle::RealtimeAudit::takeViolations();
+
+        beginTest("The auditor traps work the audio thread must not do");
+        {
+            const fizzle::RealtimeAudit::Scope scope;
+            int* volatile allocated = new int(1);
+            delete allocated;
+
+            std::mutex mutex;
+            mutex.lock();
+            mutex.unlock();
+
+            if (auto* file = std::fopen("/dev/null", "w"))
+                std::fclose(file);
+        }
+
+        auto counts = countKinds(fizzle::RealtimeAudit::takeViolations());
+        expect(counts[fizzle::RealtimeAudit::Kind::allocation] > 0);
+        expect(counts[fizzle::RealtimeAudit::Kind::deallocation] > 0);
+#if defined(__GLIBC__)
+        expect(counts[fizzle::RealtimeAudit::Kind::lock] > 0);
+        expect(counts[fizzle::RealtimeAudit::Kind::fileIo] > 0);
+#endif
+
+        beginTest("Work outside a realtime scope is not reported");
+        {
+            std::vector<float> scratch(1024);
+            scratch[0] = 1.0f;
+        }
+        expect(fizzle::RealtimeAudit::takeViolations().empty());
+
+        for (const auto deviceRate : { 48000.0, 44100.0 })
+        {
+            for (const auto block : { 64, 480 })
+            {
+                beginTest("Engine callback stays realtime safe at " + juce::String(static_cast<int>(deviceRate))
+                          + " Hz, " + juce::String(block) + " samples");
+                driveEngine(deviceRate, block, false);
+
+                const auto violations = fizzle::RealtimeAudit::takeViolations();
+                for (const auto& violation : violations)
+                    logMessage(fizzle::RealtimeAudit::describe(violation));
+                expectEquals(static_cast<int>(violations.size()), 0);
+                expectEquals(fizzle::RealtimeAudit::getNumDroppedViolations(), 0);
+            }
+        }
+
+        beginTest("Engine callback stays realtime safe when the driver varies its block length");
+        driveEngine(44100.0, 256, true);
+        const auto violations = fizzle::RealtimeAudit::takeViolations();
+        for (const auto& violation : violations)
+            logMessage(fizzle::RealtimeAudit::describe(violation));
+        expectEquals(static_cast<int>(violations.size()), 0);
+    }
+
+private:
+    static std::map<fizzle::RealtimeAudit::Kind, int> countKinds(const std::vector<fizzle::RealtimeAudit::Violation>& violations)
+    {
+        std::map<fizzle::RealtimeAudit::Kind, int> counts;
+        for (const auto& violation : violations)
+            ++counts[violation.kind];
+        return counts;
+    }
+
+    // A decaying noise burst; the first response reaches four of the convolver's partition sizes.
+    static juce::File writeImpulseResponse(int length, int seed)
+    {
+        const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("fizzle-audit-ir", ".wav", false);
+        juce::AudioBuffer<float> response(1, length);
+        juce::Random random(seed);
+        for (int i = 0; i < length; ++i)
+            response.setSample(0, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-static_cast<float>(i) / 4000.0f));
+
+        auto stream = file.createOutputStream();
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), 48000.0, 1, 24, {}, 0));
+        if (writer != nullptr)
+        {
+            stream.release();
+            writer->writeFromAudioSampleBuffer(response, 0, length);
+        }
+        return file;
+    }
+
+    // Runs blocks through every option the callback branches on. With variableBlocks the
+    // device delivers anything from a few samples to twice the block it announced.
+    static void driveEngine(double deviceRate, int block, bool variableBlocks)
+    {
+        fizzle::AudioEngine engine;
+        fizzle::EffectParameters params;
+        engine.setEffectParameters(&params);
+        SyntheticDevice device(deviceRate, block);
+        const auto firstResponse = writeImpulseResponse(70000, 9);
+        const auto secondResponse = writeImpulseResponse(3000, 10);
+        juce::String error;
+        engine.loadImpulseResponse(firstResponse, error);
+        engine.audioDeviceAboutToStart(&device);
+
+        const auto capacity = variableBlocks ? 2 * block : block;
+        juce::AudioBuffer<float> input(2, capacity);
+        juce::AudioBuffer<float> output(2, capacity);
+        juce::Random random(7);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < capacity; ++i)
+                input.setSample(c, i, random.nextFloat() * 0.5f - 0.25f);
+
+        const juce::AudioIODeviceCallbackContext context {};
+        for (int n = 0; n < 400; ++n)
+        {
+            params.bypass.store(n % 100 >= 50 && n % 100 < 60);
+            params.mute.store(n % 100 >= 60 && n % 100 < 70);
+            params.outputGainDb.store(n % 100 >= 70 ? -6.0f : 0.0f);
+            params.voiceStrip.store(n % 100 >= 20 && n % 100 < 40);
+            params.noiseSuppression.store(n % 100 >= 30 && n % 100 < 50);
+            params.convolution.store(n % 100 >= 10 && n % 100 < 45);
+            engine.setTestToneEnabled(n % 100 >= 80 && n % 100 < 90);
+            const auto numSamples = variableBlocks ? 1 + (n * 97) % capacity : block;
+            engine.audioDeviceIOCallbackWithContext(input.getArrayOfReadPointers(), 2, output.getArrayOfWritePointers(), 2, numSamples, context);
+
+            // Swap responses while the convolver is running, then take it away.
+            if (n == 120)
+                engine.loadImpulseResponse(secondResponse, error);
+            else if (n == 220)
+                engine.clearImpulseResponse();
+        }
+
+        engine.audioDeviceStopped();
+        firstResponse.deleteFile();
+        secondResponse.deleteFile();
+    }
+};
+
+RealtimeAuditTest realtimeAuditTest;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace fizzle::testing
+{
+// Minimal stand-in so AudioEngine can be started and driven without audio hardware.
+class SyntheticDevice final : public juce::AudioIODevice
+{
+public:
+    SyntheticDevice(double rate, int block) : juce::AudioIODevice("Synthetic", "Synthetic"), sampleRate(rate), blockSize(block)
+    {
+        channels.setRange(0, 2, true);
+    }
+
+    juce::StringArray getOutputChannelNames() override { return { "L", "R" }; }
+    juce::StringArray getInputChannelNames() override { return { "L", "R" }; }
+    juce::Array<double> getAvailableSampleRates() override { return { sampleRate }; }
+    juce::Array<int> getAvailableBufferSizes() override { return { blockSize }; }
+    int getDefaultBufferSize() override { return blockSize; }
+    juce::String open(const juce::BigInteger&, const juce::BigInteger&, double, int) override { return {}; }
+    void close() override {}
+    bool isOpen() override { return true; }
+    void start(juce::AudioIODeviceCallback*) override {}
+    void stop() override {}
+    bool isPlaying() override { return true; }
+    juce::String getLastError() override { return {}; }
+    int getCurrentBufferSizeSamples() override { return blockSize; }
+    double getCurrentSampleRate() override { return sampleRate; }
+    int getCurrentBitDepth() override { return 32; }
+    juce::BigInteger getActiveOutputChannels() const override { return channels; }
+    juce::BigInteger getActiveInputChannels() const override { return channels; }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+
+private:
+    double sampleRate;
+    int blockSize;
+    juce::BigInteger channels;
+};
+}
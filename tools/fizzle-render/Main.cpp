@@ -0,0 +1,394 @@
+#include <JuceHeader.h>
+
+#include "AppConfig.h"
+#include "audio/SignalPath.h"
+#include "core/PresetStore.h"
+#include "core/SettingsStore.h"
+#include "plugins/VstHost.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Headless batch renderer: runs WAV files through the same SignalPath the live audio
+// callback uses, with a preset's plugin chain, as fast as the CPU allows.
+namespace fizzle
+{
+namespace
+{
+struct RenderOptions
+{
+    juce::String presetName;
+    juce::File appDirectory;
+    juce::File outputDirectory;
+    juce::Array<juce::File> inputs;
+    int jobs { 1 };
+    int blockSize { kDefaultBlockSize };
+    double processingRate { kInternalSampleRate };
+    Resampler::Quality quality { Resampler::Quality::balanced };
+    bool voiceStrip { false };
+    bool noiseSuppression { false };
+    juce::File impulseResponse; // none when it is the default File
+};
+
+struct RenderResult
+{
+    juce::File input;
+    juce::File output;
+    double audioSeconds { 0.0 };
+    double wallSeconds { 0.0 };
+    bool ok { false };
+    juce::String error;
+};
+
+void printUsage()
+{
+    std::cout << "Usage: fizzle-render --preset <name> [options] <file.wav>...\n"
+                 "\n"
+                 "Options:\n"
+                 "  --preset <name>          Preset to load from the preset store\n"
+                 "  --app-dir <dir>          Fizzle data directory holding presets/ (default: user app data)\n"
+                 "  --out <dir>              Output directory (default: next to each input)\n"
+                 "  --jobs <n>               Files rendered in parallel (default: CPU cores)\n"
+                 "  --block <n>              Device block size in samples (default: saved setting)\n"
+                 "  --processing-rate <hz>   Chain rate, or 'native' to run at the file rate\n"
+                 "  --quality <0|1|2>        Resampler quality: low latency, balanced, high\n"
+                 "  --voice-strip <on|off>   Built-in voice strip ahead of the plugins (default: saved setting)\n"
+                 "  --noise-suppression <on|off>\n"
+                 "                           Built-in noise suppressor ahead of the plugins (default: saved setting)\n"
+                 "  --impulse <file|off>     Impulse response for the built-in convolver (default: saved setting)\n";
+}
+
+bool parseArguments(const juce::StringArray& args, RenderOptions& options, juce::String& error)
+{
+    SettingsStore settings;
+    const auto saved = settings.loadEngineSettings();
+    options.appDirectory = settings.getAppDirectory();
+    options.jobs = juce::SystemStats::getNumCpus();
+    options.blockSize = saved.bufferSize > 0 ? saved.bufferSize : kDefaultBlockSize;
+    options.processingRate = saved.internalSampleRate;
+    options.quality = Resampler::qualityFromIndex(saved.resamplerQuality);
+    options.voiceStrip = saved.builtInVoiceStrip;
+    options.noiseSuppression = saved.builtInNoiseSuppression;
+    if (saved.builtInConvolution && saved.impulseResponsePath.isNotEmpty())
+        options.impulseResponse = juce::File(saved.impulseResponsePath);
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto& arg = args[i];
+        const auto hasValue = i + 1 < args.size();
+        const auto value = hasValue ? args[i + 1] : juce::String();
+
+        if (arg.startsWith("--") && ! hasValue)
+        {
+            error = "Missing value for " + arg;
+            return false;
+        }
+
+        if (arg == "--preset")
+            options.presetName = value;
+        else if (arg == "--app-dir")
+            options.appDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (arg == "--out")
+            options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (arg == "--jobs")
+            options.jobs = juce::jmax(1, value.getIntValue());
+        else if (arg == "--block")
+            options.blockSize = juce::jlimit(16, 8192, value.getIntValue());
+        else if (arg == "--processing-rate")
+            options.processingRate = value.equalsIgnoreCase("native") ? kDeviceNativeSampleRate : value.getDoubleValue();
+        else if (arg == "--quality")
+            options.quality = Resampler::qualityFromIndex(value.getIntValue());
+        else if (arg == "--voice-strip")
+            options.voiceStrip = value.equalsIgnoreCase("on") || value.getIntValue() != 0;
+        else if (arg == "--noise-suppression")
+            options.noiseSuppression = value.equalsIgnoreCase("on") || value.getIntValue() != 0;
+        else if (arg == "--impulse")
+            options.impulseResponse = value.equalsIgnoreCase("off") ? juce::File() : juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (arg.startsWith("--"))
+        {
+            error = "Unknown option " + arg;
+            return false;
+        }
+        else
+        {
+            options.inputs.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+            continue;
+        }
+
+        ++i;
+    }
+
+    if (options.presetName.isEmpty())
+        error = "No preset given";
+    else if (options.inputs.isEmpty())
+        error = "No input files given";
+
+    return error.isEmpty();
+}
+
+double resolveProcessingRate(const RenderOptions& options, double fileRate)
+{
+    return options.processingRate > 1000.0 ? options.processingRate : fileRate;
+}
+
+// One render lane: its own plugin instances, signal path and file I/O, so lanes never
+// share state and can run on separate threads.
+class RenderWorker
+{
+public:
+    explicit RenderWorker(const RenderOptions& optionsRef) : options(optionsRef)
+    {
+        formatManager.registerBasicFormats();
+        path.setNonRealtime(true);
+        // The built-in stages run on their default settings, as they do in the app.
+        builtInParams.voiceStrip.store(options.voiceStrip);
+        builtInParams.noiseSuppression.store(options.noiseSuppression);
+        if (options.voiceStrip || options.noiseSuppression)
+            blockOptions.builtIn = &builtInParams;
+    }
+
+    // Reads the impulse response, if there is one, and switches the convolver on.
+    bool loadImpulseResponse(juce::String& error)
+    {
+        if (options.impulseResponse == juce::File())
+            return true;
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(options.impulseResponse));
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+        {
+            error = "Unreadable impulse response " + options.impulseResponse.getFullPathName();
+            return false;
+        }
+
+        const auto maxSamples = static_cast<juce::int64>(PartitionedConvolver::kMaxImpulseSeconds * reader->sampleRate);
+        const auto length = static_cast<int>(juce::jmin(reader->lengthInSamples, maxSamples));
+        juce::AudioBuffer<float> response(juce::jlimit(1, 2, static_cast<int>(reader->numChannels)), length);
+        reader->read(&response, 0, length, 0, true, response.getNumChannels() > 1);
+        path.setImpulseResponse(response, reader->sampleRate);
+        builtInParams.convolution.store(true);
+        blockOptions.builtIn = &builtInParams;
+        return true;
+    }
+
+    // Instantiates the preset's plugins. Call on the message thread.
+    bool loadPreset(const PresetData& preset, juce::String& error)
+    {
+        juce::StringArray identifiers;
+        for (const auto& p : preset.plugins)
+            identifiers.add(p.identifier);
+        host.importScannedPaths(identifiers);
+
+        const auto rate = resolveProcessingRate(options, kInternalSampleRate);
+        for (const auto& p : preset.plugins)
+        {
+            juce::PluginDescription description;
+            if (! host.findDescriptionByIdentifier(p.identifier, description)
+                || ! host.addPluginWithState(description, rate, options.blockSize, p.base64State, error))
+            {
+                error = "Could not load plugin " + p.name + (error.isNotEmpty() ? ": " + error : juce::String());
+                return false;
+            }
+
+            const auto chain = host.getChain();
+            if (auto* last = chain.getLast())
+            {
+                last->enabled.store(p.enabled);
+                last->mix.store(p.mix);
+                host.setBranch(chain.size() - 1, p.branch);
+            }
+        }
+
+        if (const auto it = preset.values.find("outputGainDb"); it != preset.values.end())
+            blockOptions.outputGain = juce::Decibels::decibelsToGain(it->second);
+        return true;
+    }
+
+    RenderResult render(const juce::File& input)
+    {
+        RenderResult result;
+        result.input = input;
+        const auto outputDirectory = options.outputDirectory == juce::File() ? input.getParentDirectory() : options.outputDirectory;
+        result.output = outputDirectory.getChildFile(input.getFileNameWithoutExtension() + "-fizzle.wav");
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+        if (reader == nullptr)
+        {
+            result.error = "Unreadable audio file";
+            return result;
+        }
+
+        const auto fileRate = reader->sampleRate;
+        const auto procRate = resolveProcessingRate(options, fileRate);
+        const auto block = options.blockSize;
+        const auto inputChannels = juce::jlimit(1, 2, static_cast<int>(reader->numChannels));
+        path.prepare(fileRate, procRate, inputChannels, block, options.quality);
+        host.prepare(procRate, juce::jmax(64, path.getMaxProcessingBlock()));
+
+        outputDirectory.createDirectory();
+        result.output.deleteFile();
+        auto stream = result.output.createOutputStream();
+        if (stream == nullptr)
+        {
+            result.error = "Cannot write " + result.output.getFullPathName();
+            return result;
+        }
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), fileRate, 2, 24, {}, 0));
+        if (writer == nullptr)
+        {
+            result.error = "Cannot create WAV writer";
+            return result;
+        }
+        stream.release();
+
+        // Trim the chain's delay so the render lines up sample for sample with the input.
+        const auto pluginSeconds = static_cast<double>(host.getLatencySamples()) / procRate;
+        const auto builtInSeconds = path.getBuiltInLatencySeconds(builtInParams);
+        auto latencyToSkip = static_cast<juce::int64>(std::llround((path.getResamplingLatencySeconds() + pluginSeconds + builtInSeconds) * fileRate));
+        const auto totalSamples = reader->lengthInSamples;
+        juce::int64 readPosition = 0;
+        juce::int64 written = 0;
+
+        juce::AudioBuffer<float> inputBuffer(inputChannels, block);
+        const auto start = juce::Time::getHighResolutionTicks();
+        while (written < totalSamples)
+        {
+            const auto available = static_cast<int>(juce::jlimit<juce::int64>(0, block, totalSamples - readPosition));
+            inputBuffer.clear();
+            if (available > 0)
+                reader->read(&inputBuffer, 0, available, readPosition, true, inputChannels > 1);
+            readPosition += block;
+
+            const auto& out = path.process(inputBuffer.getArrayOfReadPointers(), inputChannels, block, host, blockOptions);
+            const auto skip = static_cast<int>(juce::jmin<juce::int64>(latencyToSkip, block));
+            latencyToSkip -= skip;
+            const auto toWrite = static_cast<int>(juce::jmin<juce::int64>(block - skip, totalSamples - written));
+            if (toWrite > 0)
+            {
+                const float* channels[] { out.getReadPointer(0, skip), out.getReadPointer(1, skip) };
+                writer->writeFromFloatArrays(channels, 2, toWrite);
+                written += toWrite;
+            }
+        }
+
+        writer.reset();
+        result.wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        result.audioSeconds = static_cast<double>(totalSamples) / fileRate;
+        result.ok = true;
+        host.release();
+        return result;
+    }
+
+private:
+    const RenderOptions& options;
+    juce::AudioFormatManager formatManager;
+    VstHost host;
+    SignalPath path;
+    EffectParameters builtInParams;
+    SignalPath::BlockOptions blockOptions;
+};
+
+int run(const juce::StringArray& args)
+{
+    RenderOptions options;
+    juce::String error;
+    if (! parseArguments(args, options, error))
+    {
+        std::cerr << error << "\n\n";
+        printUsage();
+        return 2;
+    }
+
+    PresetStore presets(options.appDirectory);
+    const auto preset = presets.loadPreset(options.presetName);
+    if (! preset.has_value())
+    {
+        std::cerr << "Preset not found: " << options.presetName << " in " << presets.getPresetDirectory().getFullPathName() << "\n";
+        return 2;
+    }
+
+    // Plugin instances are created here on the message thread; rendering itself only
+    // calls into them from the worker threads.
+    const auto lanes = juce::jmin(options.jobs, options.inputs.size());
+    std::vector<std::unique_ptr<RenderWorker>> workers;
+    for (int i = 0; i < lanes; ++i)
+    {
+        auto worker = std::make_unique<RenderWorker>(options);
+        if (! worker->loadPreset(*preset, error) || ! worker->loadImpulseResponse(error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        workers.push_back(std::move(worker));
+    }
+
+    std::vector<RenderResult> results(static_cast<size_t>(options.inputs.size()));
+    std::atomic<int> nextInput { 0 };
+    std::atomic<int> activeLanes { lanes };
+    juce::WaitableEvent finished;
+    juce::ThreadPool pool(lanes);
+
+    const auto batchStart = juce::Time::getHighResolutionTicks();
+    for (auto& worker : workers)
+    {
+        pool.addJob([&, w = worker.get()]
+        {
+            for (auto index = nextInput.fetch_add(1); index < options.inputs.size(); index = nextInput.fetch_add(1))
+            {
+                auto& result = results[static_cast<size_t>(index)];
+                result = w->render(options.inputs[index]);
+            }
+
+            if (activeLanes.fetch_sub(1) == 1)
+                finished.signal();
+        });
+    }
+
+    // Plugins post work to the message thread (callAsync, async updates, VST3 restarts),
+    // and some wait for it from prepareToPlay() or releaseResources() on the render
+    // threads, so it keeps dispatching until the batch is done.
+    while (! finished.wait(10))
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+    const auto batchSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - batchStart);
+
+    int failures = 0;
+    double totalAudioSeconds = 0.0;
+    for (const auto& r : results)
+    {
+        if (! r.ok)
+        {
+            ++failures;
+            std::cout << r.input.getFileName() << ": FAILED (" << r.error << ")\n";
+            continue;
+        }
+
+        totalAudioSeconds += r.audioSeconds;
+        const auto factor = r.wallSeconds > 0.0 ? r.audioSeconds / r.wallSeconds : 0.0;
+        std::cout << r.input.getFileName() << ": " << juce::String(r.audioSeconds, 2) << " s audio in "
+                  << juce::String(r.wallSeconds, 3) << " s, " << juce::String(factor, 1) << "x realtime -> "
+                  << r.output.getFullPathName() << "\n";
+    }
+
+    std::cout << "Rendered " << (results.size() - static_cast<size_t>(failures)) << "/" << results.size() << " files on "
+              << lanes << " lanes: " << juce::String(totalAudioSeconds, 2) << " s audio in " << juce::String(batchSeconds, 3)
+              << " s (" << juce::String(batchSeconds > 0.0 ? totalAudioSeconds / batchSeconds : 0.0, 1) << "x realtime)\n";
+
+    return failures == 0 ? 0 : 1;
+}
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // VST3 instantiation needs a message manager even without a window.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    return fizzle::run(args);
+}